@@ -0,0 +1,1550 @@
+/**
+ * @file kernel_bench.c
+ * @brief Micro-benchmarks for OpenCog Kernel primitives
+ *
+ * Measures per-operation latency of kernel hot paths and compares them
+ * with reference implementations where one exists. Results are checked
+ * along the way; any failed check makes the run exit non-zero.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cogkern.h>
+
+#define BENCH_OPS 1000000
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void *ptrs[BENCH_OPS];
+
+/**
+ * Correctness checks that failed
+ */
+static int check_failures;
+
+/**
+ * Report a correctness check that did not hold
+ */
+static void check(int ok, const char *what) {
+    if (!ok) {
+        printf("  CHECK FAILED: %s\n", what);
+        check_failures++;
+    }
+}
+
+/**
+ * hgfs_alloc/hgfs_free against malloc+memset/free for one request size
+ */
+static void bench_alloc(size_t size) {
+    size_t failed = 0;
+
+    /* Warm both allocators so neither pays first-touch page faults */
+    for (int i = 0; i < BENCH_OPS; i++) {
+        ptrs[i] = hgfs_alloc(size, (uint32_t)(i & 3));
+    }
+    for (int i = 0; i < BENCH_OPS; i++) {
+        hgfs_free(ptrs[i]);
+    }
+
+    double t0 = now_ns();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        ptrs[i] = hgfs_alloc(size, (uint32_t)(i & 3));
+        failed += ptrs[i] == NULL;
+    }
+    double t1 = now_ns();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        hgfs_free(ptrs[i]);
+    }
+    double t2 = now_ns();
+
+    for (int i = 0; i < BENCH_OPS; i++) {
+        ptrs[i] = malloc(size);
+        memset(ptrs[i], 0, size);
+    }
+    double t3 = now_ns();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        free(ptrs[i]);
+    }
+    double t4 = now_ns();
+
+    if (failed) {
+        printf("  %6zu B  (%zu hgfs_alloc failures: budget exhausted)\n", size, failed);
+    }
+    printf("  %6zu B  hgfs_alloc %6.1f ns  hgfs_free %6.1f ns  |  "
+           "malloc %6.1f ns  free %6.1f ns\n",
+           size,
+           (t1 - t0) / BENCH_OPS, (t2 - t1) / BENCH_OPS,
+           (t3 - t2) / BENCH_OPS, (t4 - t3) / BENCH_OPS);
+}
+
+/**
+ * Bulk release of a populated depth
+ */
+static void bench_release_depth(void) {
+    for (int i = 0; i < BENCH_OPS; i++) {
+        hgfs_alloc(48, 5);
+    }
+    double t0 = now_ns();
+    hgfs_release_depth(5);
+    double t1 = now_ns();
+
+    printf("  hgfs_release_depth (%d objects): %.1f us\n", BENCH_OPS, (t1 - t0) / 1e3);
+}
+
+/**
+ * Steady-state churn: replace a quarter of a linked graph every round
+ */
+static void bench_churn(void) {
+    enum { CHURN_ATOMS = 100000, CHURN_ROUNDS = 8 };
+    static atom_handle_t atoms[CHURN_ATOMS];
+    static atom_handle_t removed[CHURN_ATOMS];
+    struct attention_value av = {1.0f, 1.0f, 0.0f};
+    struct dtesn_mem_stats ms;
+
+    for (int i = 0; i < CHURN_ATOMS; i++) {
+        atoms[i] = cog_atom_alloc(ATOM_CONCEPT, "churn");
+        dtesn_sched_set_av(atoms[i], &av);
+    }
+
+    for (int round = 0; round < CHURN_ROUNDS; round++) {
+        double t0 = now_ns();
+        for (int i = round & 3; i < CHURN_ATOMS; i += 4) {
+            cog_atom_remove(atoms[i]);
+            removed[i] = atoms[i];
+            atoms[i] = cog_atom_alloc(ATOM_CONCEPT, "churn");
+            dtesn_sched_set_av(atoms[i], &av);
+
+            atom_handle_t pair[2] = {atoms[i], atoms[(i + 1) % CHURN_ATOMS]};
+            cog_link_create(ATOM_INHERITANCE, pair, 2);
+        }
+        double t1 = now_ns();
+
+        dtesn_mem_get_stats(&ms);
+        printf("  round %d: %.1f ns per remove+alloc+link, %zu KB of region pages in use\n",
+               round, (t1 - t0) / (CHURN_ATOMS / 4), ms.bytes_allocated >> 10);
+    }
+
+    /* Recycled slots must not revive the handles removed from them */
+    int stale = 0;
+    for (int i = 0; i < CHURN_ATOMS; i++) {
+        stale += !cog_atom_valid(atoms[i]) + cog_atom_valid(removed[i]);
+    }
+    check(stale == 0, "removed handles stay stale, replacements stay valid");
+    check(cog_atom_type_count(ATOM_CONCEPT) == CHURN_ATOMS, "churn keeps the atom count");
+}
+
+/**
+ * Forgetting under memory pressure: only AtomSpace growth failures count
+ */
+static void bench_pressure(void) {
+    enum { PRESSURE_ATOMS = 1000 };
+    struct cogkern_stats stats;
+
+    if (cogkern_init((size_t)64 * 1024 * 1024) != 0 || dtesn_sched_init(5) != 0) {
+        printf("  pressure check unavailable\n");
+        cogkern_shutdown();
+        return;
+    }
+
+    for (int i = 0; i < PRESSURE_ATOMS; i++) {
+        struct attention_value av = {1.0f, (float)i, 0.0f};
+        dtesn_sched_set_av(cog_atom_alloc(ATOM_CONCEPT, NULL), &av);
+    }
+
+    /* 40 GB cannot fit in 64 MB, but failing to get it is no reason to forget */
+    struct ggml_tensor *t = cog_tensor_new_2d(cogkern_get_context(), 100000, 100000);
+    double t0 = now_ns();
+    dtesn_sched_tick();
+    double t1 = now_ns();
+    cogkern_stats(&stats);
+    check(t == NULL, "oversized tensor refused");
+    check(stats.atoms == PRESSURE_ATOMS, "failed tensor allocation evicts no atoms");
+    printf("  tick after a refused 40 GB tensor: %.0f ns, %zu of %d atoms kept\n",
+           t1 - t0, stats.atoms, PRESSURE_ATOMS);
+
+    cogkern_shutdown();
+}
+
+/**
+ * Out-of-core tier: page out the cold majority, then access with skew.
+ * Faulting an atom back in must restore what paging it out saved
+ */
+static void bench_tier(void) {
+    enum { TIER_ATOMS = 200000, TIER_HOT = TIER_ATOMS / 20, TIER_ACCESSES = 1000000 };
+    static atom_handle_t atoms[TIER_ATOMS];
+    static atom_handle_t links[TIER_ATOMS];
+    const char *path = "/tmp/cogkern_bench.seg";
+    struct attention_value av = {100.0f, 10.0f, 0.0f};
+    struct truth_value tv = {0.8f, 0.5f};
+    struct hgfs_stats before, after;
+    struct cog_tier_stats ts;
+    char name[32];
+
+    for (int i = 0; i < TIER_ATOMS; i++) {
+        snprintf(name, sizeof(name), "concept-%d", i);
+        atoms[i] = cog_atom_alloc(ATOM_CONCEPT, name);
+        tv.strength = (float)(i % 1000) / 1000.0f;
+        links[i] = i > 0 ? cog_link_infer(atoms[i - 1], atoms[i], &tv) : 0;
+    }
+    for (int i = 0; i < TIER_HOT; i++) {
+        dtesn_sched_set_av(atoms[i * (TIER_ATOMS / TIER_HOT)], &av);
+    }
+
+    if (cog_tier_open(path, (size_t)256 * 1024 * 1024) != 0) {
+        printf("  tier unavailable\n");
+        return;
+    }
+
+    hgfs_get_stats(0, &before);
+    double t0 = now_ns();
+    for (int t = 0; t < (2 * TIER_ATOMS) / 1024 + 1; t++) {
+        dtesn_sched_tick();
+    }
+    double t1 = now_ns();
+    hgfs_get_stats(0, &after);
+    cog_tier_get_stats(&ts);
+    printf("  paged out %zu of %zu atoms in %.1f ms (%.1f MB segment)\n",
+           ts.cold_atoms, ts.cold_atoms + ts.hot_atoms, (t1 - t0) / 1e6,
+           ts.segment_used / 1e6);
+    printf("  arena bytes in use: %zu KB -> %zu KB\n",
+           before.bytes_in_use >> 10, after.bytes_in_use >> 10);
+
+    /* 95% of accesses go to the hot set, the rest anywhere */
+    uint64_t x = 88172645463325252ULL;
+    struct truth_value out;
+    t0 = now_ns();
+    for (int i = 0; i < TIER_ACCESSES; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        int idx = (x % 100) < 95 ? (int)((x >> 8) % TIER_HOT) * (TIER_ATOMS / TIER_HOT)
+                                 : (int)((x >> 8) % TIER_ATOMS);
+        if ((x >> 40) & 1) {
+            dtesn_sched_spread_importance(atoms[idx], 0.01f);
+        } else if (idx > 0) {
+            pln_infer(links[idx], &out);
+        }
+    }
+    t1 = now_ns();
+
+    cog_tier_get_stats(&ts);
+    printf("  %d skewed accesses: %.1f ns each, hit rate %.4f, %llu faults\n",
+           TIER_ACCESSES, (t1 - t0) / TIER_ACCESSES, ts.hit_rate,
+           (unsigned long long)ts.faults);
+    printf("  fault cost: %.0f ns avg, %.0f ns max, %.1f MB read\n",
+           ts.faults ? (double)ts.fault_ns_total / ts.faults : 0.0,
+           (double)ts.fault_ns_max, ts.bytes_read / 1e6);
+
+    /* Every link, cold or not, still has its members and truth value */
+    int intact = 1;
+    for (int i = 1; i < TIER_ATOMS; i++) {
+        atom_handle_t set[2];
+        intact &= pln_infer(links[i], &out) == 0 &&
+                  out.strength == (float)(i % 1000) / 1000.0f &&
+                  cog_link_outgoing(links[i], set, 2) == 2 &&
+                  set[0] == atoms[i - 1] && set[1] == atoms[i];
+    }
+    check(intact, "links survive page-out and fault-in");
+
+    /* Explicit round trips of hot atoms keep their attention values */
+    intact = 1;
+    for (int i = 0; i < TIER_HOT; i++) {
+        struct attention_value a, b;
+        atom_handle_t atom = atoms[i * (TIER_ATOMS / TIER_HOT)];
+        intact &= dtesn_sched_get_av(atom, &a) == 0 && cog_tier_page_out(atom) == 0 &&
+                  dtesn_sched_get_av(atom, &b) == 0 && memcmp(&a, &b, sizeof(a)) == 0;
+    }
+    check(intact, "attention values survive page-out and fault-in");
+
+    cog_tier_close();
+    remove(path);
+}
+
+/**
+ * Stimulus queue: cost of posting and of draining in cogloop_tick()
+ */
+static void bench_events(void) {
+    enum { EVENT_ROUNDS = 256, EVENT_BATCH = 4096 };
+    struct cog_event ev;
+    struct cog_event_stats es;
+    double post_ns = 0.0, drain_ns = 0.0;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.type = COG_EVENT_STI_BOOST;
+    ev.atom = cog_atom_alloc(ATOM_CONCEPT, "stimulus");
+    ev.sti = 1.0f;
+
+    for (int round = 0; round < EVENT_ROUNDS; round++) {
+        double t0 = now_ns();
+        for (int i = 0; i < EVENT_BATCH; i++) {
+            cog_event_post(&ev);
+        }
+        double t1 = now_ns();
+        cogloop_tick();
+        double t2 = now_ns();
+
+        post_ns += t1 - t0;
+        drain_ns += t2 - t1;
+    }
+
+    cog_event_get_stats(&es);
+    printf("  post %.1f ns, drain+apply %.1f ns per event (%llu drained, %llu dropped)\n",
+           post_ns / ((double)EVENT_ROUNDS * EVENT_BATCH),
+           drain_ns / ((double)EVENT_ROUNDS * EVENT_BATCH),
+           (unsigned long long)es.drained, (unsigned long long)es.dropped);
+}
+
+/**
+ * Read snapshots: pin cost, pinned reads, and copy-on-write under a pin
+ */
+static void bench_snapshot(void) {
+    enum { SNAP_ATOMS = 100000, SNAP_PINS = 10000 };
+    static atom_handle_t atoms[SNAP_ATOMS];
+    struct attention_value av = {10.0f, 1.0f, 0.0f};
+    struct cogkern_stats ks;
+    char name[32];
+
+    for (int i = 0; i < SNAP_ATOMS; i++) {
+        snprintf(name, sizeof(name), "snap-%d", i);
+        atoms[i] = cog_atom_alloc(ATOM_CONCEPT, name);
+        dtesn_sched_set_av(atoms[i], &av);
+    }
+
+    double t0 = now_ns();
+    for (int i = 0; i < SNAP_PINS; i++) {
+        cog_snapshot_begin();
+        cog_snapshot_end();
+    }
+    double t1 = now_ns();
+    printf("  begin+end %.1f ns\n", (t1 - t0) / SNAP_PINS);
+
+    for (int pinned = 0; pinned < 2; pinned++) {
+        if (pinned) {
+            cog_snapshot_begin();
+        }
+
+        t0 = now_ns();
+        for (int i = 0; i < SNAP_ATOMS; i++) {
+            av.sti += 1.0f;
+            dtesn_sched_set_av(atoms[i], &av);
+        }
+        t1 = now_ns();
+        for (int i = 0; i < SNAP_ATOMS; i++) {
+            dtesn_sched_get_av(atoms[i], &av);
+        }
+        double t2 = now_ns();
+
+        cogkern_stats(&ks);
+        printf("  %s: set_av %.1f ns, get_av %.1f ns, %zu old versions\n",
+               pinned ? "pinned  " : "unpinned", (t1 - t0) / SNAP_ATOMS,
+               (t2 - t1) / SNAP_ATOMS, ks.snapshot_versions);
+    }
+
+    cog_snapshot_end();
+    cogloop_tick();
+}
+
+static void bench_task_fn(atom_handle_t atom, void *arg) {
+    (void)atom;
+    __atomic_add_fetch((uint64_t *)arg, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Task scheduler: submit and dispatch overhead per task
+ */
+static void bench_tasks(uint32_t workers) {
+    enum { TASK_ATOMS = 1024, TASK_ROUNDS = 64, TASK_BATCH = 16384 };
+    static atom_handle_t atoms[TASK_ATOMS];
+    struct dtesn_sched_stats ss;
+    double submit_ns = 0.0, tick_ns = 0.0;
+    uint64_t count = 0;
+    char name[32];
+
+    if (dtesn_sched_set_workers(workers) != 0) {
+        printf("  %u workers unavailable\n", workers);
+        return;
+    }
+
+    for (int i = 0; i < TASK_ATOMS; i++) {
+        struct attention_value av = {(float)((i * 7919) % TASK_ATOMS), 1.0f, 0.0f};
+        snprintf(name, sizeof(name), "task-%u-%d", workers, i);
+        atoms[i] = cog_atom_alloc(ATOM_CONCEPT, name);
+        dtesn_sched_set_av(atoms[i], &av);
+    }
+
+    for (int round = 0; round < TASK_ROUNDS; round++) {
+        double t0 = now_ns();
+        for (int i = 0; i < TASK_BATCH; i++) {
+            dtesn_sched_submit(atoms[i % TASK_ATOMS], bench_task_fn, &count);
+        }
+        double t1 = now_ns();
+        dtesn_sched_tick();
+        double t2 = now_ns();
+
+        submit_ns += t1 - t0;
+        tick_ns += t2 - t1;
+    }
+
+    dtesn_sched_get_stats(&ss);
+    printf("  %u worker%s: submit %.1f ns, dispatch+run %.1f ns per task, mean latency %.1f us, %llu stolen\n",
+           workers, workers == 1 ? " " : "s",
+           submit_ns / ((double)TASK_ROUNDS * TASK_BATCH),
+           tick_ns / ((double)TASK_ROUNDS * TASK_BATCH),
+           ss.tasks_run ? ss.latency_ns_total / 1e3 / ss.tasks_run : 0.0,
+           (unsigned long long)ss.tasks_stolen);
+}
+
+/**
+ * Cognitive cycle: tick rate in serial and pipelined mode
+ */
+static void bench_pipeline(int pipelined) {
+    enum { PIPE_ATOMS = 20000, PIPE_LINKS = 80000, PIPE_TICKS = 500 };
+    static atom_handle_t atoms[PIPE_ATOMS];
+    struct cogloop_pipeline_params params = {pipelined, 256, 32};
+    struct cogloop_stats cs;
+    uint64_t x = 0x2545F4914F6CDD1DULL;
+    char name[32];
+
+    if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 || dtesn_sched_init(5) != 0 ||
+        cogloop_set_pipeline(&params) != 0) {
+        printf("  pipeline unavailable\n");
+        cogkern_shutdown();
+        return;
+    }
+
+    for (int i = 0; i < PIPE_ATOMS; i++) {
+        struct attention_value av = {(float)(i % 997), 1.0f, 0.0f};
+        snprintf(name, sizeof(name), "concept-%d", i);
+        atoms[i] = cog_atom_alloc(ATOM_CONCEPT, name);
+        dtesn_sched_set_av(atoms[i], &av);
+    }
+    for (int i = 0; i < PIPE_LINKS; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        struct truth_value tv = {(float)(x % 100) / 100.0f, 0.5f};
+        cog_link_infer(atoms[x % PIPE_ATOMS], atoms[(x >> 24) % PIPE_ATOMS], &tv);
+    }
+
+    double t0 = now_ns();
+    for (int t = 0; t < PIPE_TICKS; t++) {
+        cogloop_tick();
+    }
+    double t1 = now_ns();
+
+    cogloop_get_stats(&cs);
+    printf("  %-9s %.0f ticks/s (attention %.1f, pattern %.1f, inference %.1f, stall %.1f us/tick), %llu conclusions\n",
+           pipelined ? "pipelined" : "serial", PIPE_TICKS / ((t1 - t0) / 1e9),
+           cs.attention_ns / 1e3 / cs.iterations, cs.pattern_ns / 1e3 / cs.iterations,
+           cs.inference_ns / 1e3 / cs.iterations, cs.stall_ns / 1e3 / cs.iterations,
+           (unsigned long long)(cs.conclusions_created + cs.conclusions_revised));
+
+    cogkern_shutdown();
+}
+
+/**
+ * Batch creation and setters against the single-item calls
+ */
+static void bench_batch(void) {
+    enum { BATCH_ATOMS = 100000 };
+    static atom_handle_t atoms[BATCH_ATOMS];
+    static atom_handle_t links[BATCH_ATOMS];
+    static atom_handle_t outgoing[2 * BATCH_ATOMS];
+    static struct attention_value avs[BATCH_ATOMS];
+    static struct truth_value tvs[BATCH_ATOMS];
+    /* A warm-up pass, then single, batch, batch, single so neither mode always goes first */
+    static const int order[] = {0, 0, 1, 1, 0};
+    double single[4], batch[4], ns[4];
+
+    for (int i = 0; i < BATCH_ATOMS; i++) {
+        avs[i].sti = (float)(i % 100);
+        avs[i].lti = 1.0f;
+        avs[i].vlti = 0.0f;
+        tvs[i].strength = 0.5f;
+        tvs[i].confidence = 0.1f;
+    }
+
+    for (int round = 0; round < 5; round++) {
+        int pass = order[round];
+
+        if (cogkern_init((size_t)1024 * 1024 * 1024) != 0) {
+            printf("  batch benchmark unavailable\n");
+            return;
+        }
+
+        double t0 = now_ns();
+        if (pass) {
+            cog_atom_alloc_batch(ATOM_CONCEPT, NULL, BATCH_ATOMS, atoms);
+        } else {
+            for (int i = 0; i < BATCH_ATOMS; i++) {
+                atoms[i] = cog_atom_alloc(ATOM_CONCEPT, NULL);
+            }
+        }
+        double t1 = now_ns();
+        ns[0] = (t1 - t0) / BATCH_ATOMS;
+
+        for (int i = 0; i < BATCH_ATOMS; i++) {
+            outgoing[2 * i] = atoms[i];
+            outgoing[2 * i + 1] = atoms[(i * 7919LL) % BATCH_ATOMS];
+        }
+        t0 = now_ns();
+        if (pass) {
+            cog_link_create_batch(ATOM_INHERITANCE, outgoing, 2, BATCH_ATOMS, links);
+        } else {
+            for (int i = 0; i < BATCH_ATOMS; i++) {
+                links[i] = cog_link_create(ATOM_INHERITANCE, &outgoing[2 * i], 2);
+            }
+        }
+        t1 = now_ns();
+        ns[1] = (t1 - t0) / BATCH_ATOMS;
+
+        t0 = now_ns();
+        if (pass) {
+            dtesn_sched_set_av_batch(atoms, avs, BATCH_ATOMS);
+        } else {
+            for (int i = 0; i < BATCH_ATOMS; i++) {
+                dtesn_sched_set_av(atoms[i], &avs[i]);
+            }
+        }
+        t1 = now_ns();
+        ns[2] = (t1 - t0) / BATCH_ATOMS;
+
+        t0 = now_ns();
+        if (pass) {
+            pln_set_tv_batch(links, tvs, BATCH_ATOMS);
+        } else {
+            for (int i = 0; i < BATCH_ATOMS; i++) {
+                pln_set_tv(links[i], &tvs[i]);
+            }
+        }
+        t1 = now_ns();
+        ns[3] = (t1 - t0) / BATCH_ATOMS;
+
+        cogkern_shutdown();
+
+        /* Keep each mode's faster pass; rounds 1 and 2 replace the warm-up */
+        double *best = pass ? batch : single;
+        for (int i = 0; i < 4; i++) {
+            if (round <= 2 || ns[i] < best[i]) {
+                best[i] = ns[i];
+            }
+        }
+    }
+
+    printf("  %-10s %8s %8s\n", "ns/item", "single", "batch");
+    printf("  %-10s %8.1f %8.1f\n", "atom", single[0], batch[0]);
+    printf("  %-10s %8.1f %8.1f\n", "link", single[1], batch[1]);
+    printf("  %-10s %8.1f %8.1f\n", "set_av", single[2], batch[2]);
+    printf("  %-10s %8.1f %8.1f\n", "set_tv", single[3], batch[3]);
+}
+
+/**
+ * Link storage: memory per ternary link and outgoing-set read cost
+ */
+static void bench_links(void) {
+    enum { LINK_ATOMS = 100000 };
+    static atom_handle_t atoms[LINK_ATOMS];
+    static atom_handle_t links[LINK_ATOMS];
+    static atom_handle_t outgoing[3 * LINK_ATOMS];
+    struct cogkern_stats before, after;
+    atom_handle_t set[3];
+
+    if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 ||
+        cog_atom_alloc_batch(ATOM_CONCEPT, NULL, LINK_ATOMS, atoms) != 0) {
+        printf("  link benchmark unavailable\n");
+        return;
+    }
+    for (int i = 0; i < LINK_ATOMS; i++) {
+        outgoing[3 * i] = atoms[i];
+        outgoing[3 * i + 1] = atoms[(i * 7919LL) % LINK_ATOMS];
+        outgoing[3 * i + 2] = atoms[(i * 104729LL) % LINK_ATOMS];
+    }
+
+    cogkern_stats(&before);
+    cog_link_create_batch(ATOM_LINK, outgoing, 3, LINK_ATOMS, links);
+    cogkern_stats(&after);
+    double bytes = (double)(after.arena_in_use + after.edge_table_bytes -
+                            before.arena_in_use - before.edge_table_bytes) / LINK_ATOMS;
+
+    /* Visit links in a scattered order, as a traversal would */
+    uint64_t sum = 0;
+    double t0 = now_ns();
+    for (int i = 0; i < LINK_ATOMS; i++) {
+        int n = cog_link_outgoing(links[(i * 7919LL) % LINK_ATOMS], set, 3);
+        sum += (uint64_t)n + set[2];
+    }
+    double t1 = now_ns();
+
+    printf("  %.1f bytes/link (arenas + edge table), outgoing read %.1f ns/link (%llu)\n",
+           bytes, (t1 - t0) / LINK_ATOMS, (unsigned long long)(sum & 1));
+
+    cogkern_shutdown();
+}
+
+/**
+ * Per-type enumeration: cost of visiting every atom of a rare and a common type
+ */
+static void bench_types(void) {
+    enum { TYPE_ATOMS = 200000 };
+    static atom_handle_t atoms[TYPE_ATOMS];
+    enum atom_type types[2] = {ATOM_PREDICATE, ATOM_CONCEPT};
+    atom_handle_t batch[256];
+
+    if (cogkern_init((size_t)256 * 1024 * 1024) != 0) {
+        printf("  type benchmark unavailable\n");
+        return;
+    }
+    for (int i = 0; i < TYPE_ATOMS; i++) {
+        atoms[i] = cog_atom_alloc(i % 100 == 0 ? ATOM_PREDICATE : ATOM_CONCEPT, NULL);
+    }
+    /* Punch holes so the posting lists see swaps */
+    for (int i = 0; i < TYPE_ATOMS; i += 7) {
+        cog_atom_remove(atoms[i]);
+    }
+
+    for (int t = 0; t < 2; t++) {
+        struct cog_atom_iter it;
+        uint64_t sum = 0;
+        size_t matches = 0, n;
+
+        double t0 = now_ns();
+        cog_atom_iter_init(&it, types[t]);
+        while ((n = cog_atom_iter_next(&it, batch, 256)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                sum += batch[i];
+            }
+            matches += n;
+        }
+        double t1 = now_ns();
+
+        printf("  %-10s %7zu matches in %8.1f us (%.2f ns/match, %llu)\n",
+               t ? "concept" : "predicate", matches, (t1 - t0) / 1000.0,
+               (t1 - t0) / (matches ? matches : 1), (unsigned long long)(sum & 1));
+    }
+
+    cogkern_shutdown();
+}
+
+/**
+ * Spread importance from every concept of a clustered graph
+ */
+static double reorder_spread(const atom_handle_t *concepts, int count) {
+    double t0 = now_ns();
+    for (int i = 0; i < count; i++) {
+        dtesn_sched_spread_importance(concepts[i], 0.1f);
+    }
+    return (now_ns() - t0) / count;
+}
+
+/**
+ * Graph reordering: spreading over a clustered graph built in shuffled order,
+ * before and after renumbering the atoms. Every handle must still name the
+ * same atom afterwards, including once some atoms have been removed
+ */
+static void bench_reorder(void) {
+    enum { REORDER_ATOMS = 262144, REORDER_CLUSTER = 64, REORDER_DEGREE = 4 };
+    enum { REORDER_LINKS = REORDER_ATOMS * REORDER_DEGREE / 2, REORDER_REMOVE = 4096 };
+    static atom_handle_t concepts[REORDER_ATOMS];
+    static atom_handle_t links[REORDER_LINKS];
+    static uint32_t members[2 * REORDER_LINKS];
+    static uint32_t shuffle[REORDER_ATOMS];
+    const char *names[] = {"bfs", "rcm", "degree"};
+
+    for (int m = 0; m < 3; m++) {
+        if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 || dtesn_sched_init(1000) != 0) {
+            printf("  reorder benchmark unavailable\n");
+            return;
+        }
+
+        /* Members of a cluster are created far apart, as an import would */
+        for (uint32_t i = 0; i < REORDER_ATOMS; i++) {
+            shuffle[i] = i;
+        }
+        srand(43);
+        for (uint32_t i = REORDER_ATOMS - 1; i > 0; i--) {
+            uint32_t j = (uint32_t)rand() % (i + 1);
+            uint32_t t = shuffle[i];
+            shuffle[i] = shuffle[j];
+            shuffle[j] = t;
+        }
+        for (int i = 0; i < REORDER_ATOMS; i++) {
+            concepts[shuffle[i]] = cog_atom_alloc(ATOM_CONCEPT, NULL);
+        }
+        for (int i = 0; i < REORDER_LINKS; i++) {
+            int a = shuffle[i % REORDER_ATOMS];
+            int b = a - a % REORDER_CLUSTER + rand() % REORDER_CLUSTER;
+            atom_handle_t pair[2] = {concepts[a], concepts[b]};
+            links[i] = cog_link_create(ATOM_INHERITANCE, pair, 2);
+            members[2 * i] = (uint32_t)a;
+            members[2 * i + 1] = (uint32_t)b;
+        }
+        for (int i = 0; i < REORDER_ATOMS; i++) {
+            struct attention_value av = {100.0f, 0.0f, 0.0f};
+            dtesn_sched_set_av(concepts[i], &av);
+        }
+
+        double before = reorder_spread(concepts, REORDER_ATOMS);
+        double t0 = now_ns();
+        int rc = cog_atom_reorder((enum cog_reorder_method)m);
+        double t1 = now_ns();
+        double after = reorder_spread(concepts, REORDER_ATOMS);
+
+        printf("  %-6s reorder %6.1f ms (%d), spread %6.1f -> %6.1f ns/source\n",
+               names[m], (t1 - t0) / 1e6, rc, before, after);
+
+        /* Remove a few atoms, reorder again, and resolve every handle */
+        for (int i = 0; i < REORDER_ATOMS; i += REORDER_REMOVE) {
+            cog_atom_remove(concepts[i]);
+        }
+        check(cog_atom_reorder((enum cog_reorder_method)m) == 0, "reorder after removals");
+        int stable = 1;
+        for (int i = 0; i < REORDER_ATOMS; i++) {
+            stable &= cog_atom_valid(concepts[i]) == (i % REORDER_REMOVE != 0);
+        }
+        for (int i = 0; i < REORDER_LINKS; i++) {
+            atom_handle_t set[2];
+            int removed = members[2 * i] % REORDER_REMOVE == 0 ||
+                          members[2 * i + 1] % REORDER_REMOVE == 0;
+            if (removed) {
+                stable &= !cog_atom_valid(links[i]);
+            } else {
+                stable &= cog_link_outgoing(links[i], set, 2) == 2 &&
+                          set[0] == concepts[members[2 * i]] &&
+                          set[1] == concepts[members[2 * i + 1]];
+            }
+        }
+        check(stable, "handles stable after remove and reorder");
+        cogkern_shutdown();
+    }
+}
+
+/**
+ * Order handles for comparing traversal results as sets
+ */
+static int handle_cmp(const void *a, const void *b) {
+    atom_handle_t x = *(const atom_handle_t *)a;
+    atom_handle_t y = *(const atom_handle_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Check that every link still has the outgoing set it was created with
+ */
+static int outgoing_intact(const atom_handle_t *links, const atom_handle_t *outgoing,
+                           size_t count) {
+    atom_handle_t set[2];
+
+    for (size_t i = 0; i < count; i++) {
+        if (cog_link_outgoing(links[i], set, 2) != 2 ||
+            set[0] != outgoing[2 * i] || set[1] != outgoing[2 * i + 1]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Compressed adjacency: memory and traversal cost before and after packing,
+ * checking that packing and unpacking again change no outgoing set or
+ * neighbourhood
+ */
+static void bench_pack(void) {
+    enum { PACK_ATOMS = 200000, PACK_LINKS = 400000 };
+    static atom_handle_t atoms[PACK_ATOMS];
+    static atom_handle_t links[PACK_LINKS];
+    static atom_handle_t outgoing[2 * PACK_LINKS];
+    static atom_handle_t reach[2][PACK_ATOMS + PACK_LINKS];
+    struct cog_traverse_params hops3 = {3, 0, 0, 1};
+    struct cogkern_stats st;
+    atom_handle_t set[2];
+    int reached[2];
+
+    if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 || dtesn_sched_init(1000) != 0 ||
+        cog_atom_alloc_batch(ATOM_CONCEPT, NULL, PACK_ATOMS, atoms) != 0) {
+        printf("  pack benchmark unavailable\n");
+        return;
+    }
+    for (int i = 0; i < PACK_LINKS; i++) {
+        outgoing[2 * i] = atoms[i % PACK_ATOMS];
+        outgoing[2 * i + 1] = atoms[(i * 7919LL) % PACK_ATOMS];
+    }
+    cog_link_create_batch(ATOM_INHERITANCE, outgoing, 2, PACK_LINKS, links);
+    for (int i = 0; i < PACK_ATOMS; i++) {
+        struct attention_value av = {100.0f, 0.0f, 0.0f};
+        dtesn_sched_set_av(atoms[i], &av);
+    }
+    reached[0] = cog_traverse(atoms[0], &hops3, reach[0], NULL, PACK_ATOMS + PACK_LINKS, NULL);
+    qsort(reach[0], (size_t)reached[0], sizeof(atom_handle_t), handle_cmp);
+
+    for (int packed = 0; packed < 2; packed++) {
+        if (packed && cog_adjacency_pack() != 0) {
+            printf("  pack failed\n");
+            break;
+        }
+        cogkern_stats(&st);
+
+        uint64_t sum = 0;
+        double t0 = now_ns();
+        for (int i = 0; i < PACK_LINKS; i++) {
+            int n = cog_link_outgoing(links[(i * 7919LL) % PACK_LINKS], set, 2);
+            sum += (uint64_t)n + set[1];
+        }
+        double t1 = now_ns();
+        for (int i = 0; i < PACK_ATOMS; i++) {
+            dtesn_sched_spread_importance(atoms[i], 0.1f);
+        }
+        double t2 = now_ns();
+
+        printf("  %-8s adjacency %6.2f bytes/link, outgoing %5.1f ns/link, "
+               "spread %6.1f ns/source (%llu)\n",
+               packed ? "packed" : "arrays",
+               (double)(st.arena_in_use + st.adjacency_pack_bytes) / PACK_LINKS,
+               (t1 - t0) / PACK_LINKS, (t2 - t1) / PACK_ATOMS, (unsigned long long)(sum & 1));
+    }
+
+    /* Packed, then unpacked again by reordering: same links, same 3-hop neighbourhood */
+    for (int round = 0; round < 2; round++) {
+        if (round && cog_atom_reorder(COG_REORDER_BFS) != 0) {
+            check(0, "reorder unpacks the adjacency");
+            break;
+        }
+        check(outgoing_intact(links, outgoing, PACK_LINKS),
+              round ? "outgoing sets survive unpacking" : "outgoing sets survive packing");
+        reached[1] = cog_traverse(atoms[0], &hops3, reach[1], NULL, PACK_ATOMS + PACK_LINKS,
+                                  NULL);
+        qsort(reach[1], (size_t)reached[1], sizeof(atom_handle_t), handle_cmp);
+        check(reached[1] == reached[0] &&
+              memcmp(reach[0], reach[1], (size_t)reached[0] * sizeof(atom_handle_t)) == 0,
+              round ? "neighbourhood survives unpacking" : "neighbourhood survives packing");
+    }
+
+    cogkern_shutdown();
+}
+
+/**
+ * Traversal graph as the benchmark built it: link members as atom
+ * indices, and each atom's links in CSR form
+ */
+enum { TRAVERSE_ATOMS = 250000, TRAVERSE_LINKS = 500000 };
+static uint32_t trav_members[2 * TRAVERSE_LINKS];
+static uint32_t trav_inc_start[TRAVERSE_ATOMS + 1];
+static uint32_t trav_inc[2 * TRAVERSE_LINKS];
+static uint32_t trav_dist[TRAVERSE_ATOMS + TRAVERSE_LINKS];
+static uint32_t trav_queue[TRAVERSE_ATOMS + TRAVERSE_LINKS];
+
+/**
+ * Serial breadth-first search over the recorded graph; nodes below
+ * TRAVERSE_ATOMS are atoms, the rest links. Leaves each node's hop
+ * count in trav_dist (UINT32_MAX if unreached)
+ */
+static void serial_bfs(uint32_t start, uint32_t max_hops) {
+    size_t head = 0, tail = 0;
+
+    for (uint32_t i = 0; i < TRAVERSE_ATOMS + TRAVERSE_LINKS; i++) {
+        trav_dist[i] = UINT32_MAX;
+    }
+    trav_dist[start] = 0;
+    trav_queue[tail++] = start;
+    while (head < tail) {
+        uint32_t node = trav_queue[head++];
+        uint32_t d = trav_dist[node];
+        const uint32_t *next;
+        uint32_t count;
+
+        if (max_hops && d == max_hops) {
+            continue;
+        }
+        if (node < TRAVERSE_ATOMS) {
+            next = trav_inc + trav_inc_start[node];
+            count = trav_inc_start[node + 1] - trav_inc_start[node];
+        } else {
+            next = trav_members + 2 * (node - TRAVERSE_ATOMS);
+            count = 2;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t m = node < TRAVERSE_ATOMS ? TRAVERSE_ATOMS + next[i] : next[i];
+            if (trav_dist[m] == UINT32_MAX) {
+                trav_dist[m] = d + 1;
+                trav_queue[tail++] = m;
+            }
+        }
+    }
+}
+
+/**
+ * Check cog_traverse() output against serial_bfs(): every atom found at
+ * its serial hop count, once, and nothing reachable left out
+ */
+static int traverse_matches(const atom_handle_t *found, const uint32_t *hops, int n,
+                            atom_handle_t first_atom, atom_handle_t first_link,
+                            uint32_t start, int concepts_only) {
+    int expected = 0;
+
+    for (uint32_t i = 0; i < TRAVERSE_ATOMS + TRAVERSE_LINKS; i++) {
+        expected += i != start && trav_dist[i] != UINT32_MAX &&
+                    (!concepts_only || i < TRAVERSE_ATOMS);
+    }
+    if (n != expected) {
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        uint64_t node = found[i] - first_atom < TRAVERSE_ATOMS
+                            ? found[i] - first_atom
+                            : TRAVERSE_ATOMS + (found[i] - first_link);
+        if (node >= TRAVERSE_ATOMS + TRAVERSE_LINKS || node == start ||
+            trav_dist[node] != hops[i]) {
+            return 0;
+        }
+        /* A second copy of the same atom no longer matches */
+        trav_dist[node] = UINT32_MAX - 1;
+    }
+    return 1;
+}
+
+/**
+ * Traversal: whole-graph BFS and 3-hop neighbourhoods on a random graph,
+ * each checked against a serial BFS
+ */
+static void bench_traverse(void) {
+    static atom_handle_t atoms[TRAVERSE_ATOMS];
+    static atom_handle_t links[TRAVERSE_LINKS];
+    static atom_handle_t outgoing[2 * TRAVERSE_LINKS];
+    static atom_handle_t found[TRAVERSE_ATOMS + TRAVERSE_LINKS];
+    static uint32_t hops[TRAVERSE_ATOMS + TRAVERSE_LINKS];
+    struct cog_traverse_stats st;
+
+    if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 ||
+        cog_atom_alloc_batch(ATOM_CONCEPT, NULL, TRAVERSE_ATOMS, atoms) != 0) {
+        printf("  traversal benchmark unavailable\n");
+        return;
+    }
+    srand(42);
+    for (int i = 0; i < 2 * TRAVERSE_LINKS; i++) {
+        trav_members[i] = (uint32_t)(rand() % TRAVERSE_ATOMS);
+        outgoing[i] = atoms[trav_members[i]];
+        trav_inc_start[trav_members[i] + 1]++;
+    }
+    cog_link_create_batch(ATOM_INHERITANCE, outgoing, 2, TRAVERSE_LINKS, links);
+
+    /* Batch handles are consecutive, so a handle maps straight to its node */
+    for (int i = 0; i < TRAVERSE_ATOMS; i++) {
+        trav_inc_start[i + 1] += trav_inc_start[i];
+    }
+    for (uint32_t l = 0; l < TRAVERSE_LINKS; l++) {
+        for (int m = 0; m < 2; m++) {
+            trav_inc[trav_inc_start[trav_members[2 * l + m]]++] = l;
+        }
+    }
+    for (int i = TRAVERSE_ATOMS; i > 0; i--) {
+        trav_inc_start[i] = trav_inc_start[i - 1];
+    }
+    trav_inc_start[0] = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t threads = pass == 0 ? 1 : 0;
+        struct cog_traverse_params whole = {0, COG_TYPE_BIT(ATOM_CONCEPT), 0, threads};
+        struct cog_traverse_params hops3 = {3, 0, 0, threads};
+        int n = cog_traverse(atoms[0], &whole, found, hops, TRAVERSE_ATOMS, &st);
+        printf("  whole graph: %d concepts in %u levels (%u bottom-up), %.2f ms on %u threads\n",
+               n, st.levels, st.bottom_up_levels, st.elapsed_ns / 1e6, st.threads);
+        serial_bfs(0, 0);
+        check(traverse_matches(found, hops, n, atoms[0], links[0], 0, 1),
+              "whole-graph traversal matches a serial BFS");
+
+        uint64_t ns = 0;
+        size_t reached = 0;
+        for (int i = 0; i < 100; i++) {
+            n = cog_traverse(atoms[i * 997], &hops3, found, hops,
+                             TRAVERSE_ATOMS + TRAVERSE_LINKS, &st);
+            ns += st.elapsed_ns;
+            reached += st.reached;
+            if (i % 10 == 0) {
+                serial_bfs((uint32_t)i * 997, 3);
+                check(traverse_matches(found, hops, n, atoms[0], links[0], (uint32_t)i * 997, 0),
+                      "3-hop traversal matches a serial BFS");
+            }
+        }
+        printf("  3 hops:      %zu atoms on average, %.1f us per query\n",
+               reached / 100, ns / 100 / 1e3);
+    }
+
+    cogkern_shutdown();
+}
+
+/**
+ * Embeddings: exact and inverted-file top-10 search, float and int8 rows
+ */
+static void bench_embed(void) {
+    enum { EMBED_ATOMS = 100000, EMBED_DIM = 128, EMBED_CLUSTERS = 256, EMBED_QUERIES = 100 };
+    static atom_handle_t atoms[EMBED_ATOMS];
+    static float centers[EMBED_CLUSTERS][EMBED_DIM];
+    static float vec[EMBED_DIM];
+    struct cog_embed_match exact[10];
+    struct cog_embed_match approx[10];
+    struct cogkern_stats stats;
+
+    srand(42);
+    for (int c = 0; c < EMBED_CLUSTERS; c++) {
+        for (int d = 0; d < EMBED_DIM; d++) {
+            centers[c][d] = (float)rand() / RAND_MAX - 0.5f;
+        }
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        enum cog_embed_format format = pass == 0 ? COG_EMBED_F32 : COG_EMBED_I8;
+        if (cogkern_init((size_t)512 * 1024 * 1024) != 0 ||
+            cog_embed_init(EMBED_DIM, format) != 0 ||
+            cog_atom_alloc_batch(ATOM_CONCEPT, NULL, EMBED_ATOMS, atoms) != 0) {
+            printf("  embedding benchmark unavailable\n");
+            return;
+        }
+        srand(7);
+        double set_ns = 0;
+        for (int i = 0; i < EMBED_ATOMS; i++) {
+            for (int d = 0; d < EMBED_DIM; d++) {
+                vec[d] = centers[i % EMBED_CLUSTERS][d] + 0.2f * ((float)rand() / RAND_MAX - 0.5f);
+            }
+            double start = now_ns();
+            cog_embed_set(atoms[i], vec);
+            set_ns += now_ns() - start;
+        }
+        set_ns /= EMBED_ATOMS;
+        cogkern_stats(&stats);
+        printf("  %s: %.1f bytes per embedding, set %.0f ns\n",
+               pass == 0 ? "float" : "int8 ", (double)stats.embedding_bytes / EMBED_ATOMS, set_ns);
+
+        double start = now_ns();
+        for (int q = 0; q < EMBED_QUERIES; q++) {
+            cog_embed_get(atoms[q * 997], vec);
+            cog_embed_search(vec, 10, 0, exact);
+        }
+        printf("    exact search: %.1f us per query\n",
+               (now_ns() - start) / EMBED_QUERIES / 1e3);
+
+        start = now_ns();
+        cog_embed_index_build(0);
+        printf("    index build:  %.1f ms\n", (now_ns() - start) / 1e6);
+
+        double ns = 0;
+        int hits = 0;
+        for (int q = 0; q < EMBED_QUERIES; q++) {
+            cog_embed_get(atoms[q * 997], vec);
+            cog_embed_search(vec, 10, 0, exact);
+            start = now_ns();
+            int n = cog_embed_search(vec, 10, 8, approx);
+            ns += now_ns() - start;
+            for (int i = 0; i < 10; i++) {
+                for (int j = 0; j < n; j++) {
+                    hits += exact[i].atom == approx[j].atom;
+                }
+            }
+        }
+        printf("    8 probes:     %.1f us per query, recall@10 %.2f\n",
+               ns / EMBED_QUERIES / 1e3, hits / (10.0 * EMBED_QUERIES));
+
+        cogkern_shutdown();
+    }
+}
+
+/**
+ * Similarity discovery: MinHash/LSH over concepts sharing feature links,
+ * at two sizes to show the scaling
+ */
+static void bench_similar(void) {
+    enum { SIMILAR_FEATURES = 16, SIMILAR_GROUP = 20 };
+    static atom_handle_t atoms[30000];
+    static atom_handle_t features[30000 / SIMILAR_GROUP * SIMILAR_FEATURES];
+
+    for (int size = 15000; size <= 30000; size *= 2) {
+        int feature_count = size / SIMILAR_GROUP * SIMILAR_FEATURES;
+        if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 ||
+            cog_atom_alloc_batch(ATOM_CONCEPT, NULL, (size_t)size, atoms) != 0 ||
+            cog_atom_alloc_batch(ATOM_PREDICATE, NULL, (size_t)feature_count, features) != 0) {
+            printf("  similarity benchmark unavailable\n");
+            return;
+        }
+
+        /* Groups of concepts share features, each member swapping a few */
+        srand(42);
+        for (int i = 0; i < size; i++) {
+            int group = i / SIMILAR_GROUP;
+            for (int f = 0; f < SIMILAR_FEATURES; f++) {
+                int feature = f < i % 4 ? rand() % feature_count : group * SIMILAR_FEATURES + f;
+                atom_handle_t pair[2] = {atoms[i], features[feature]};
+                cog_link_create(ATOM_EVALUATION, pair, 2);
+            }
+        }
+
+        struct cog_similarity_params params = {COG_TYPE_BIT(ATOM_CONCEPT), 0, 0, 0, 0.5f, 0.9f, 0};
+        struct cog_similarity_stats st;
+        int n = cog_similarity_discover(&params, &st);
+        printf("  %d concepts: %d links from %zu candidates, %.1f ms (%.0f ns per atom) "
+               "on %u threads\n", size, n, st.candidates, st.elapsed_ns / 1e6,
+               (double)st.elapsed_ns / size, st.threads);
+
+        cogkern_shutdown();
+    }
+}
+
+/**
+ * Tensors: elementwise, reduction, dense and sparse products per call
+ */
+static void bench_tensor(void) {
+    enum { TENSOR_N = 1 << 20, TENSOR_DIM = 256, TENSOR_NNZ = 8, TENSOR_REPS = 20 };
+    static uint32_t row_start[TENSOR_N + 1];
+    static uint32_t col[TENSOR_N * TENSOR_NNZ];
+    static float value[TENSOR_N * TENSOR_NNZ];
+
+    if (cogkern_init((size_t)256 * 1024 * 1024) != 0) {
+        printf("  tensors unavailable\n");
+        return;
+    }
+
+    struct ggml_context *ctx = cogkern_get_context();
+    struct ggml_tensor *a = cog_tensor_new_1d(ctx, TENSOR_N);
+    struct ggml_tensor *b = cog_tensor_new_1d(ctx, TENSOR_N);
+    struct ggml_tensor *m = cog_tensor_new_2d(ctx, TENSOR_DIM, TENSOR_DIM);
+    if (!a || !b || !m) {
+        printf("  tensors unavailable\n");
+        cogkern_shutdown();
+        return;
+    }
+
+    srand(42);
+    for (int i = 0; i < TENSOR_N; i++) {
+        cog_tensor_data(a)[i] = (float)rand() / RAND_MAX;
+        cog_tensor_data(b)[i] = (float)rand() / RAND_MAX;
+    }
+    for (int i = 0; i < TENSOR_DIM * TENSOR_DIM; i++) {
+        cog_tensor_data(m)[i] = (float)rand() / RAND_MAX;
+    }
+    for (int i = 0; i < TENSOR_N; i++) {
+        row_start[i] = (uint32_t)(i * TENSOR_NNZ);
+        for (int k = 0; k < TENSOR_NNZ; k++) {
+            col[i * TENSOR_NNZ + k] = (uint32_t)rand() % TENSOR_N;
+            value[i * TENSOR_NNZ + k] = 1.0f / TENSOR_NNZ;
+        }
+    }
+    row_start[TENSOR_N] = TENSOR_N * TENSOR_NNZ;
+    struct cog_tensor_csr csr = {TENSOR_N, TENSOR_N, row_start, col, value};
+
+    size_t mark = cog_tensor_mark(ctx);
+    double add_ns = 0, sum_ns = 0, mat_ns = 0, spmv_ns = 0;
+    for (int rep = 0; rep < TENSOR_REPS; rep++) {
+        double t0 = now_ns();
+        cog_tensor_add(ctx, a, b);
+        double t1 = now_ns();
+        cog_tensor_sum(ctx, a);
+        double t2 = now_ns();
+        cog_tensor_mul_mat(ctx, m, m);
+        double t3 = now_ns();
+        cog_tensor_spmv(ctx, &csr, a);
+        double t4 = now_ns();
+
+        add_ns += t1 - t0;
+        sum_ns += t2 - t1;
+        mat_ns += t3 - t2;
+        spmv_ns += t4 - t3;
+        cog_tensor_release(ctx, mark);
+    }
+
+    printf("  add %d elements: %.1f us (%.2f GB/s)\n", TENSOR_N, add_ns / TENSOR_REPS / 1e3,
+           3.0 * TENSOR_N * sizeof(float) / (add_ns / TENSOR_REPS));
+    printf("  sum %d elements: %.1f us\n", TENSOR_N, sum_ns / TENSOR_REPS / 1e3);
+    printf("  mul_mat %dx%dx%d: %.2f ms (%.2f GFLOP/s)\n", TENSOR_DIM, TENSOR_DIM, TENSOR_DIM,
+           mat_ns / TENSOR_REPS / 1e6,
+           2.0 * TENSOR_DIM * TENSOR_DIM * TENSOR_DIM / (mat_ns / TENSOR_REPS));
+    printf("  spmv %d rows, %d entries each: %.2f ms\n", TENSOR_N, TENSOR_NNZ,
+           spmv_ns / TENSOR_REPS / 1e6);
+
+    cogkern_shutdown();
+}
+
+/**
+ * CPU dispatch: the same operations under each kernel variant the host runs
+ */
+static void bench_dispatch(void) {
+    enum { DISPATCH_ROWS = 20000, DISPATCH_DIM = 128, DISPATCH_CONCEPTS = 10000,
+           DISPATCH_PREMISES = 1 << 20, DISPATCH_REPS = 10 };
+    static float vec[DISPATCH_DIM];
+    static atom_handle_t concepts[DISPATCH_CONCEPTS];
+    static atom_handle_t features[DISPATCH_CONCEPTS];
+    struct cog_embed_match hits[10];
+
+    if (cogkern_init((size_t)512 * 1024 * 1024) != 0 ||
+        cog_embed_init(DISPATCH_DIM, COG_EMBED_F32) != 0 ||
+        cog_atom_alloc_batch(ATOM_CONCEPT, NULL, DISPATCH_CONCEPTS, concepts) != 0 ||
+        cog_atom_alloc_batch(ATOM_PREDICATE, NULL, DISPATCH_CONCEPTS, features) != 0) {
+        printf("  dispatch benchmark unavailable\n");
+        cogkern_shutdown();
+        return;
+    }
+
+    srand(42);
+    for (int i = 0; i < DISPATCH_ROWS; i++) {
+        atom_handle_t atom = cog_atom_alloc(ATOM_NODE, NULL);
+        for (int d = 0; d < DISPATCH_DIM; d++) {
+            vec[d] = (float)rand() / RAND_MAX - 0.5f;
+        }
+        cog_embed_set(atom, vec);
+    }
+    for (int i = 0; i < DISPATCH_CONCEPTS; i++) {
+        for (int f = 0; f < 16; f++) {
+            atom_handle_t pair[2] = {concepts[i], features[(i / 20 * 16 + f) % DISPATCH_CONCEPTS]};
+            cog_link_create(ATOM_EVALUATION, pair, 2);
+        }
+    }
+
+    struct ggml_context *ctx = cogkern_get_context();
+    struct ggml_tensor *m = cog_tensor_new_2d(ctx, 256, 256);
+    struct ggml_tensor *premises = cog_tensor_new_2d(ctx, 2, DISPATCH_PREMISES);
+    if (!m || !premises) {
+        printf("  dispatch benchmark unavailable\n");
+        cogkern_shutdown();
+        return;
+    }
+    for (int i = 0; i < 256 * 256; i++) {
+        cog_tensor_data(m)[i] = (float)rand() / RAND_MAX;
+    }
+    for (int i = 0; i < 2 * DISPATCH_PREMISES; i++) {
+        cog_tensor_data(premises)[i] = 1.0f - (float)rand() / RAND_MAX * 1e-6f;
+    }
+
+    struct cog_similarity_params params = {COG_TYPE_BIT(ATOM_CONCEPT), 0, 0, 0, 0.5f, 0.9f, 1};
+    size_t mark = cog_tensor_mark(ctx);
+    for (int isa = COGKERN_ISA_SCALAR; isa <= (int)cogkern_isa_best(); isa++) {
+        struct cog_similarity_stats st;
+        struct truth_value tv;
+
+        cogkern_isa_force(isa);
+        double t0 = now_ns();
+        for (int rep = 0; rep < DISPATCH_REPS; rep++) {
+            cog_embed_search(vec, 10, 0, hits);
+        }
+        double t1 = now_ns();
+        for (int rep = 0; rep < DISPATCH_REPS; rep++) {
+            cog_tensor_mul_mat(ctx, m, m);
+            cog_tensor_release(ctx, mark);
+        }
+        double t2 = now_ns();
+        for (int rep = 0; rep < DISPATCH_REPS; rep++) {
+            pln_eval_tensor(premises, &tv);
+        }
+        double t3 = now_ns();
+        cog_similarity_discover(&params, &st);
+
+        printf("  %-7s embed search %.2f ms, mul_mat %.2f ms, PLN conjunction %.2f ms, "
+               "similarity signing+linking %.1f ms\n",
+               cogkern_isa_name((enum cogkern_isa)isa), (t1 - t0) / DISPATCH_REPS / 1e6,
+               (t2 - t1) / DISPATCH_REPS / 1e6, (t3 - t2) / DISPATCH_REPS / 1e6,
+               st.elapsed_ns / 1e6);
+    }
+    cogkern_isa_force(COGKERN_ISA_AUTO);
+
+    cogkern_shutdown();
+}
+
+/**
+ * Compact values: table size, scheduler tick, focus selection and spreading
+ * with attention and truth values stored as floats, then compact
+ */
+static void bench_compact(void) {
+    enum { COMPACT_ATOMS = 400000, COMPACT_TICKS = 20, COMPACT_SOURCES = 100000 };
+    static atom_handle_t atoms[COMPACT_ATOMS];
+    static atom_handle_t outgoing[2 * COMPACT_ATOMS];
+    static atom_handle_t links[COMPACT_ATOMS];
+    static struct attention_value avs[COMPACT_ATOMS];
+    static struct truth_value tvs[COMPACT_ATOMS];
+    struct cogloop_pipeline_params focus = {0, 32, 8};
+    struct cogloop_stats c0, c1;
+    struct cogkern_stats st;
+
+    if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 || dtesn_sched_init(1000) != 0 ||
+        cogloop_set_pipeline(&focus) != 0 ||
+        cog_atom_alloc_batch(ATOM_CONCEPT, NULL, COMPACT_ATOMS, atoms) != 0) {
+        printf("  compact benchmark unavailable\n");
+        cogkern_shutdown();
+        return;
+    }
+    for (int i = 0; i < COMPACT_ATOMS; i++) {
+        outgoing[2 * i] = atoms[i];
+        outgoing[2 * i + 1] = atoms[(i + 1 + i % 61) % COMPACT_ATOMS];
+        avs[i] = (struct attention_value){(float)(i % 10007), (float)(i % 13), 0.0f};
+        tvs[i] = (struct truth_value){(float)(i % 100) / 100.0f, 0.5f};
+    }
+    cog_link_create_batch(ATOM_INHERITANCE, outgoing, 2, COMPACT_ATOMS, links);
+    dtesn_sched_set_av_batch(atoms, avs, COMPACT_ATOMS);
+    pln_set_tv_batch(atoms, tvs, COMPACT_ATOMS);
+    for (int i = 0; i < COMPACT_SOURCES; i++) {
+        /* Spreading gives the links attention values too */
+        dtesn_sched_spread_importance(atoms[(i * 7919LL) % COMPACT_ATOMS], 0.1f);
+    }
+
+    for (int compact = 0; compact < 2; compact++) {
+        if (cog_values_compact(compact) != 0) {
+            printf("  compact switch failed\n");
+            break;
+        }
+        cogkern_stats(&st);
+
+        double t0 = now_ns();
+        for (int t = 0; t < COMPACT_TICKS; t++) {
+            dtesn_sched_tick();
+        }
+        double t1 = now_ns();
+        cogloop_get_stats(&c0);
+        for (int t = 0; t < COMPACT_TICKS; t++) {
+            cogloop_tick();
+        }
+        cogloop_get_stats(&c1);
+        double t2 = now_ns();
+        for (int i = 0; i < COMPACT_SOURCES; i++) {
+            dtesn_sched_spread_importance(atoms[(i * 7919LL) % COMPACT_ATOMS], 0.1f);
+        }
+        double t3 = now_ns();
+
+        printf("  %-8s values %5.2f bytes/atom, sched tick %8.1f us, focus %7.1f us, "
+               "spread %5.1f ns/source\n",
+               compact ? "compact" : "float",
+               (double)(st.av_table_bytes + st.tv_table_bytes) / st.atoms,
+               (t1 - t0) / 1e3 / COMPACT_TICKS,
+               (double)(c1.attention_ns - c0.attention_ns) / 1e3 / COMPACT_TICKS,
+               (t3 - t2) / COMPACT_SOURCES);
+    }
+
+    cogkern_shutdown();
+}
+
+/**
+ * Bulk import: parse and commit throughput for a generated file
+ */
+static void bench_import(uint32_t threads) {
+    enum { IMPORT_NODES = 250000, IMPORT_LINKS = 500000 };
+    const char *path = "/tmp/cogkern_bench.tsv";
+    struct cog_import_stats st;
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        printf("  import unavailable\n");
+        return;
+    }
+    for (int i = 0; i < IMPORT_NODES; i++) {
+        fprintf(f, "concept\tconcept-%d\n", i);
+    }
+    for (int i = 0; i < IMPORT_LINKS; i++) {
+        fprintf(f, "inheritance\tconcept-%d\tconcept-%d\n",
+                i % IMPORT_NODES, (int)((i * 7919LL) % IMPORT_NODES));
+    }
+    fclose(f);
+
+    if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 ||
+        cog_import_file(path, threads, &st) != 0) {
+        printf("  import failed\n");
+    } else {
+        printf("  %u threads: parse %.1f ms, commit %.1f ms, %.2f M atoms/s\n",
+               st.threads, st.parse_ns / 1e6, st.commit_ns / 1e6,
+               (st.nodes + st.links) / ((st.parse_ns + st.commit_ns) / 1e9) / 1e6);
+    }
+    cogkern_shutdown();
+    remove(path);
+}
+
+/**
+ * Tracing: tick cost with tracing idle and recording
+ */
+static void bench_trace(void) {
+    enum { TRACE_ATOMS = 2000, TRACE_TICKS = 20000 };
+    double idle_ns, active_ns;
+    char name[32];
+
+    if (cogkern_init((size_t)256 * 1024 * 1024) != 0 || dtesn_sched_init(5) != 0) {
+        printf("  tracing unavailable\n");
+        cogkern_shutdown();
+        return;
+    }
+
+    for (int i = 0; i < TRACE_ATOMS; i++) {
+        struct attention_value av = {(float)(i % 97), 1.0f, 0.0f};
+        snprintf(name, sizeof(name), "traced-%d", i);
+        dtesn_sched_set_av(cog_atom_alloc(ATOM_CONCEPT, name), &av);
+    }
+
+    double t0 = now_ns();
+    for (int t = 0; t < TRACE_TICKS; t++) {
+        cogloop_tick();
+    }
+    double t1 = now_ns();
+    idle_ns = (t1 - t0) / TRACE_TICKS;
+
+    if (cog_trace_start(0) != 0) {
+        printf("  idle %.0f ns per tick (tracing compiled out)\n", idle_ns);
+        cogkern_shutdown();
+        return;
+    }
+    t0 = now_ns();
+    for (int t = 0; t < TRACE_TICKS; t++) {
+        cogloop_tick();
+    }
+    t1 = now_ns();
+    cog_trace_stop();
+    active_ns = (t1 - t0) / TRACE_TICKS;
+
+    long spans = cog_trace_dump("/dev/null");
+    printf("  idle %.0f ns, recording %.0f ns per tick (%ld spans kept)\n",
+           idle_ns, active_ns, spans);
+
+    struct cogkern_stats stats;
+    if (cogkern_stats(&stats) == 0) {
+        printf("  tick p50 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns (%llu ticks)\n",
+               (unsigned long long)stats.tick.p50_ns, (unsigned long long)stats.tick.p99_ns,
+               (unsigned long long)stats.tick.p999_ns, (unsigned long long)stats.tick.max_ns,
+               (unsigned long long)stats.tick.count);
+    }
+
+    cogkern_shutdown();
+}
+
+int main(void) {
+    printf("OpenCog Kernel - Micro-benchmarks\n");
+    printf("=================================\n\n");
+
+    if (cogkern_init((size_t)4096 * 1024 * 1024) != 0) {
+        fprintf(stderr, "Failed to initialize kernel\n");
+        return 1;
+    }
+
+    printf("Allocator, heap-backed chunks (%d ops per size):\n", BENCH_OPS);
+    bench_alloc(16);
+    bench_alloc(64);
+    bench_alloc(200);
+    bench_alloc(1024);
+    bench_release_depth();
+    printf("\n");
+
+    cogkern_shutdown();
+    if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 ||
+        dtesn_mem_set_flags(DTESN_MEM_TRANSPARENT_HUGEPAGES | DTESN_MEM_PREFAULT) != 0 ||
+        dtesn_mem_init_regions(16) != 0) {
+        fprintf(stderr, "Failed to initialize memory regions\n");
+        return 1;
+    }
+
+    struct dtesn_mem_stats ms;
+    dtesn_mem_get_stats(&ms);
+    printf("Allocator, region-backed chunks (%zu x %zu MB, flags 0x%x):\n",
+           ms.num_regions, ms.region_size >> 20, ms.active_flags);
+    bench_alloc(16);
+    bench_alloc(64);
+    bench_alloc(200);
+    bench_release_depth();
+    printf("\n");
+
+    printf("AtomSpace churn (%d atoms, 25%% replaced per round):\n", 100000);
+    bench_churn();
+    printf("\n");
+
+    cogkern_shutdown();
+    if (cogkern_init((size_t)1024 * 1024 * 1024) != 0 || dtesn_sched_init(5) != 0) {
+        fprintf(stderr, "Failed to initialize kernel\n");
+        return 1;
+    }
+
+    printf("Stimulus event queue (%d events per tick):\n", 4096);
+    if (cog_event_queue_init(4096, 4096) == 0) {
+        bench_events();
+    }
+    printf("\n");
+
+    printf("Read snapshots (%d atoms):\n", 100000);
+    bench_snapshot();
+    printf("\n");
+
+    printf("Task scheduler (%d tasks per tick):\n", 16384);
+    bench_tasks(1);
+    bench_tasks(2);
+    dtesn_sched_set_workers(1);
+    printf("\n");
+
+    printf("Out-of-core tier (%d atoms, 5%% hot):\n", 200000);
+    bench_tier();
+    printf("\n");
+
+    cogkern_shutdown();
+
+    printf("Memory pressure (%d atoms, 64 MB):\n", 1000);
+    bench_pressure();
+    printf("\n");
+
+    printf("Cognitive cycle (%d atoms, focus 256):\n", 20000);
+    bench_pipeline(0);
+    bench_pipeline(1);
+    printf("\n");
+
+    printf("Batch APIs (%d atoms, %d binary links):\n", 100000, 100000);
+    bench_batch();
+    printf("\n");
+
+    printf("Link storage (%d ternary links):\n", 100000);
+    bench_links();
+    printf("\n");
+
+    printf("Atoms by type (%d atoms, 1%% predicates):\n", 200000);
+    bench_types();
+    printf("\n");
+
+    printf("Graph reordering (%d atoms in clusters of %d):\n", 262144, 64);
+    bench_reorder();
+    printf("\n");
+
+    printf("Compressed adjacency (%d atoms, %d binary links):\n", 200000, 400000);
+    bench_pack();
+    printf("\n");
+
+    printf("Traversal (%d atoms, %d binary links):\n", 250000, 500000);
+    bench_traverse();
+    printf("\n");
+
+    printf("Embeddings (%d atoms, %d dimensions):\n", 100000, 128);
+    bench_embed();
+    printf("\n");
+
+    printf("Similarity discovery (%d features per concept):\n", 16);
+    bench_similar();
+    printf("\n");
+
+    printf("Tensors (built-in CPU backend):\n");
+    bench_tensor();
+    printf("\n");
+
+    printf("CPU dispatch (best variant %s):\n", cogkern_isa_name(cogkern_isa_best()));
+    bench_dispatch();
+    printf("\n");
+
+    printf("Compact values (%d atoms, %d binary links):\n", 400000, 400000);
+    bench_compact();
+    printf("\n");
+
+    printf("Bulk import (%d nodes, %d links):\n", 250000, 500000);
+    bench_import(1);
+    bench_import(0);
+    printf("\n");
+
+    printf("Tracing (%d atoms):\n", 2000);
+    bench_trace();
+    printf("\n");
+
+    if (check_failures > 0) {
+        printf("%d correctness checks failed\n", check_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -43,12 +43,416 @@ int cogkern_init(size_t mem_size);
 void cogkern_shutdown(void);
 
 /**
- * Get the global GGML context
+ * Get the tensor context of the current kernel context
  * 
- * @return Pointer to GGML context or NULL if not initialized
+ * The built-in CPU backend (see the tensor group) provides the context;
+ * tensors allocated from it are charged against the cogkern_init() budget.
+ * 
+ * @return Pointer to tensor context or NULL if not initialized
  */
 struct ggml_context *cogkern_get_context(void);
 
+/**
+ * Query memory accounted against the cogkern_init() budget
+ * 
+ * @param used Pointer to receive bytes currently charged (can be NULL)
+ * @param budget Pointer to receive the total budget in bytes (can be NULL)
+ * @return 0 on success, negative if the kernel is not initialized
+ */
+int cogkern_mem_usage(size_t *used, size_t *budget);
+
+/**
+ * Independent kernel instance
+ * 
+ * A context owns one AtomSpace with its attention and truth values,
+ * memory budget and regions, scheduler, event queue, cognitive loop and
+ * metrics. Each function in this header works on the calling thread's
+ * current context, which is the default context (the one cogkern_init()
+ * sets up) until cogkern_ctx_bind() selects another; the functions with a
+ * _ctx suffix take the context explicitly. Contexts share no state, so
+ * several can run on separate cores, each driven by its own thread.
+ * Handles are only meaningful in the context that issued them. Tracing
+ * is process-wide.
+ */
+struct cogkern_ctx;
+
+/**
+ * Create and initialize an independent kernel context
+ * 
+ * @param mem_size Memory pool size in bytes
+ * @return Context or NULL on error
+ */
+struct cogkern_ctx *cogkern_ctx_create(size_t mem_size);
+
+/**
+ * Shut down a kernel context and free it
+ * 
+ * No other thread may be using the context. Destroying the default
+ * context only shuts it down, like cogkern_shutdown().
+ * 
+ * @param ctx Context to destroy (NULL is ignored)
+ */
+void cogkern_ctx_destroy(struct cogkern_ctx *ctx);
+
+/**
+ * Make a context current for the calling thread
+ * 
+ * @param ctx Context (NULL for the default context)
+ * @return Previously current context
+ */
+struct cogkern_ctx *cogkern_ctx_bind(struct cogkern_ctx *ctx);
+
+/**
+ * Get the default kernel context
+ * 
+ * @return Default context
+ */
+struct cogkern_ctx *cogkern_ctx_default(void);
+
+/** @} */
+
+/**
+ * @defgroup tensor Tensors - Built-in CPU tensor backend
+ * 
+ * One- and two-dimensional float tensors allocated from the arena of a
+ * tensor context (cogkern_get_context()), and operations named after the
+ * GGML ops they stand in for. ne0 is the contiguous dimension and ne1 the
+ * number of rows, as in GGML. Operations compute eagerly and return a new
+ * tensor from the same context. They return NULL on a shape mismatch or
+ * when the budget is exhausted, and pass NULL inputs through, so a chain
+ * of operations can be checked once at the end. A tensor context belongs
+ * to its kernel context and must not be used by two threads at once.
+ * @{
+ */
+
+/**
+ * Unary functions of cog_tensor_map()
+ */
+enum cog_tensor_unary {
+    COG_TENSOR_NEG = 0,       /**< -x (ggml_neg) */
+    COG_TENSOR_ABS = 1,       /**< |x| (ggml_abs) */
+    COG_TENSOR_SQR = 2,       /**< x * x (ggml_sqr) */
+    COG_TENSOR_SQRT = 3,      /**< Square root (ggml_sqrt) */
+    COG_TENSOR_EXP = 4,       /**< e^x (ggml_exp) */
+    COG_TENSOR_LOG = 5,       /**< Natural logarithm (ggml_log) */
+    COG_TENSOR_RELU = 6,      /**< max(x, 0) (ggml_relu) */
+    COG_TENSOR_SIGMOID = 7    /**< 1 / (1 + e^-x) (ggml_sigmoid) */
+};
+
+/**
+ * Sparse matrix in compressed row form, for cog_tensor_spmv()
+ * 
+ * The arrays belong to the caller. The entries of row r are
+ * row_start[r] to row_start[r + 1] - 1; each column index must be
+ * below cols.
+ */
+struct cog_tensor_csr {
+    int64_t rows;
+    int64_t cols;
+    const uint32_t *row_start;  /**< rows + 1 entry offsets */
+    const uint32_t *col;        /**< Column of each entry */
+    const float *value;         /**< Value of each entry */
+};
+
+/**
+ * Allocate a one-dimensional tensor (ggml_new_tensor_1d)
+ * 
+ * @param ctx Tensor context
+ * @param ne0 Number of elements
+ * @return Tensor with uninitialized data, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_new_1d(struct ggml_context *ctx, int64_t ne0);
+
+/**
+ * Allocate a two-dimensional tensor (ggml_new_tensor_2d)
+ * 
+ * @param ctx Tensor context
+ * @param ne0 Elements per row
+ * @param ne1 Number of rows
+ * @return Tensor with uninitialized data, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_new_2d(struct ggml_context *ctx, int64_t ne0, int64_t ne1);
+
+/**
+ * Get the element storage of a tensor (ggml_get_data_f32)
+ * 
+ * Rows are stored one after another, ne0 floats each.
+ * 
+ * @param t Tensor
+ * @return Pointer to the elements, or NULL for a NULL tensor
+ */
+float *cog_tensor_data(const struct ggml_tensor *t);
+
+/**
+ * Get the size of a tensor along one dimension
+ * 
+ * @param t Tensor
+ * @param dim Dimension (0 or 1; higher dimensions have size 1)
+ * @return Number of elements along dim, 0 for a NULL tensor
+ */
+int64_t cog_tensor_ne(const struct ggml_tensor *t, int dim);
+
+/**
+ * Get the number of elements of a tensor (ggml_nelements)
+ * 
+ * @param t Tensor
+ * @return Element count, 0 for a NULL tensor
+ */
+int64_t cog_tensor_nelements(const struct ggml_tensor *t);
+
+/**
+ * Set every element of a tensor (ggml_set_f32)
+ * 
+ * @param t Tensor
+ * @param value Value to store
+ * @return t
+ */
+struct ggml_tensor *cog_tensor_fill(struct ggml_tensor *t, float value);
+
+/**
+ * Get the current position of a tensor context's arena
+ * 
+ * @param ctx Tensor context
+ * @return Mark for cog_tensor_release()
+ */
+size_t cog_tensor_mark(struct ggml_context *ctx);
+
+/**
+ * Free every tensor allocated since a mark
+ * 
+ * Tensors allocated before the mark stay valid. Storage no longer needed
+ * is returned to the memory budget.
+ * 
+ * @param ctx Tensor context
+ * @param mark Value from cog_tensor_mark() (0 frees every tensor)
+ */
+void cog_tensor_release(struct ggml_context *ctx, size_t mark);
+
+/**
+ * Elementwise a + b (ggml_add)
+ * 
+ * b is repeated to the shape of a, so it may also be a single row, a
+ * single column or a single element. The same holds for the other
+ * elementwise binary operations.
+ * 
+ * @param ctx Tensor context
+ * @param a First operand
+ * @param b Second operand; each dimension must divide that of a
+ * @return New tensor shaped like a, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_add(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   struct ggml_tensor *b);
+
+/**
+ * Elementwise a - b (ggml_sub)
+ */
+struct ggml_tensor *cog_tensor_sub(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   struct ggml_tensor *b);
+
+/**
+ * Elementwise a * b (ggml_mul)
+ */
+struct ggml_tensor *cog_tensor_mul(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   struct ggml_tensor *b);
+
+/**
+ * Elementwise a / b (ggml_div)
+ */
+struct ggml_tensor *cog_tensor_div(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   struct ggml_tensor *b);
+
+/**
+ * Multiply every element by a constant (ggml_scale)
+ * 
+ * @param ctx Tensor context
+ * @param a Operand
+ * @param s Factor
+ * @return New tensor shaped like a, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_scale(struct ggml_context *ctx, struct ggml_tensor *a,
+                                     float s);
+
+/**
+ * Clamp every element to [min, max] (ggml_clamp)
+ * 
+ * @param ctx Tensor context
+ * @param a Operand
+ * @param min Lower bound
+ * @param max Upper bound
+ * @return New tensor shaped like a, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_clamp(struct ggml_context *ctx, struct ggml_tensor *a,
+                                     float min, float max);
+
+/**
+ * Apply a unary function to every element
+ * 
+ * @param ctx Tensor context
+ * @param a Operand
+ * @param op Function (each names the GGML op it stands in for)
+ * @return New tensor shaped like a, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_map(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   enum cog_tensor_unary op);
+
+/**
+ * Sum all elements (ggml_sum)
+ * 
+ * @param ctx Tensor context
+ * @param a Operand
+ * @return New single-element tensor, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_sum(struct ggml_context *ctx, struct ggml_tensor *a);
+
+/**
+ * Sum each row (ggml_sum_rows)
+ * 
+ * @param ctx Tensor context
+ * @param a Operand
+ * @return New tensor of shape [1, ne1], or NULL on error
+ */
+struct ggml_tensor *cog_tensor_sum_rows(struct ggml_context *ctx, struct ggml_tensor *a);
+
+/**
+ * Average each row (ggml_mean)
+ * 
+ * @param ctx Tensor context
+ * @param a Operand
+ * @return New tensor of shape [1, ne1], or NULL on error
+ */
+struct ggml_tensor *cog_tensor_mean(struct ggml_context *ctx, struct ggml_tensor *a);
+
+/**
+ * Find the largest element
+ * 
+ * GGML has no direct equivalent; a port would use ggml_argmax.
+ * 
+ * @param ctx Tensor context
+ * @param a Operand
+ * @return New single-element tensor, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_max(struct ggml_context *ctx, struct ggml_tensor *a);
+
+/**
+ * Matrix product (ggml_mul_mat)
+ * 
+ * As in GGML, both operands hold their rows along ne0: the result has
+ * element [i, j] = dot(row i of a, row j of b).
+ * 
+ * @param ctx Tensor context
+ * @param a Matrix of shape [k, m]
+ * @param b Matrix of shape [k, n]
+ * @return New tensor of shape [m, n], or NULL on error
+ */
+struct ggml_tensor *cog_tensor_mul_mat(struct ggml_context *ctx, struct ggml_tensor *a,
+                                       struct ggml_tensor *b);
+
+/**
+ * Multiply a sparse matrix by a dense vector
+ * 
+ * GGML has no sparse tensors; a port would keep this function on the CPU
+ * or expand the matrix for ggml_mul_mat.
+ * 
+ * @param ctx Tensor context
+ * @param m Matrix in compressed row form
+ * @param x Vector of m->cols elements (any shape)
+ * @return New tensor of m->rows elements, or NULL on error
+ */
+struct ggml_tensor *cog_tensor_spmv(struct ggml_context *ctx, const struct cog_tensor_csr *m,
+                                    struct ggml_tensor *x);
+
+/** @} */
+
+/**
+ * @defgroup cpu CPU dispatch - Instruction set selection for numeric kernels
+ * 
+ * The numeric kernels behind embeddings, tensors, similarity discovery
+ * and PLN formulas are built for several instruction sets. The first
+ * cogkern_init() picks the widest one the CPU supports, unless the
+ * COGKERN_ISA environment variable names a narrower one ("scalar",
+ * "avx2" or "avx512"). An unknown name, or one the CPU cannot run, is
+ * ignored with a warning on stderr. The choice is process-wide. Results
+ * can differ between variants in the last bits of floating-point sums.
+ * @{
+ */
+
+/**
+ * Kernel variants
+ */
+enum cogkern_isa {
+    COGKERN_ISA_SCALAR = 0,   /**< Baseline target of the build (SSE2 on x86-64) */
+    COGKERN_ISA_AVX2 = 1,     /**< AVX2 and FMA */
+    COGKERN_ISA_AVX512 = 2    /**< AVX-512 F, BW and VL */
+};
+
+/**
+ * Return cogkern_isa_force() to automatic selection
+ */
+#define COGKERN_ISA_AUTO (-1)
+
+/**
+ * Instruction set extensions reported by cogkern_cpu_features()
+ */
+#define COGKERN_CPU_SSE42    (1u << 0)
+#define COGKERN_CPU_AVX      (1u << 1)
+#define COGKERN_CPU_AVX2     (1u << 2)
+#define COGKERN_CPU_FMA      (1u << 3)
+#define COGKERN_CPU_AVX512F  (1u << 4)
+#define COGKERN_CPU_AVX512BW (1u << 5)
+#define COGKERN_CPU_AVX512VL (1u << 6)
+
+/**
+ * Query the instruction set extensions of the host (CPUID)
+ * 
+ * Only extensions the operating system has enabled are reported.
+ * 
+ * @return Mask of COGKERN_CPU_ flags (0 on other architectures)
+ */
+uint32_t cogkern_cpu_features(void);
+
+/**
+ * Get the widest kernel variant the host can run
+ * 
+ * @return Kernel variant
+ */
+enum cogkern_isa cogkern_isa_best(void);
+
+/**
+ * Get the kernel variant in use
+ * 
+ * Makes the selection cogkern_init() would if none has been made yet.
+ * 
+ * @return Kernel variant
+ */
+enum cogkern_isa cogkern_isa_get(void);
+
+/**
+ * Pin the kernel variant, for testing and comparison
+ * 
+ * Takes effect for operations started afterwards, in every context.
+ * A later cogkern_init() keeps the pinned variant.
+ * 
+ * @param isa Kernel variant, or COGKERN_ISA_AUTO for the widest supported
+ * @return 0 on success, negative if the host cannot run the variant
+ */
+int cogkern_isa_force(int isa);
+
+/**
+ * Check whether the COGKERN_ISA environment variable chose the variant in use
+ * 
+ * @return 1 if it named a variant the host can run and no
+ *         cogkern_isa_force() call has replaced it since, 0 otherwise
+ */
+int cogkern_isa_from_env(void);
+
+/**
+ * Get the name of a kernel variant
+ * 
+ * @param isa Kernel variant
+ * @return Name, as accepted by COGKERN_ISA
+ */
+const char *cogkern_isa_name(enum cogkern_isa isa);
+
 /** @} */
 
 /**
@@ -58,6 +462,10 @@ struct ggml_context *cogkern_get_context(void);
 
 /**
  * Atom handle type
+ * 
+ * The low 32 bits hold the table slot plus one and the high 32 bits the
+ * slot's generation, so handles of removed atoms are never confused with
+ * atoms that later reuse the slot. 0 is never a valid handle.
  */
 typedef uint64_t atom_handle_t;
 
@@ -74,15 +482,64 @@ enum atom_type {
     ATOM_SIMILARITY = 6
 };
 
+/**
+ * Number of atom types, one posting list each
+ */
+#define ATOM_TYPE_COUNT 7
+
+/**
+ * Number of membrane depths with their own allocation arena
+ */
+#define HGFS_MAX_DEPTH 16
+
+/**
+ * Per-depth allocator statistics
+ */
+struct hgfs_stats {
+    size_t bytes_reserved;  /**< Chunk memory owned by the depth */
+    size_t bytes_in_use;    /**< Bytes in live allocations (rounded to size class) */
+    uint64_t alloc_count;   /**< Allocations since the depth was last released */
+    uint64_t free_count;    /**< Frees since the depth was last released */
+};
+
 /**
  * Allocate a hypergraph node as a GGML tensor
  * 
+ * Memory is zeroed and comes from the arena of the given membrane depth.
+ * Small requests are served from size-class slabs; the arena is charged
+ * against the cogkern_init() budget.
+ * 
  * @param size Size in bytes
- * @param depth Membrane depth (OEIS A000081)
+ * @param depth Membrane depth (OEIS A000081), below HGFS_MAX_DEPTH
  * @return Pointer to allocated memory or NULL on failure
  */
 void *hgfs_alloc(size_t size, uint32_t depth);
 
+/**
+ * Free memory returned by hgfs_alloc()
+ * 
+ * @param ptr Pointer to free (NULL is ignored)
+ */
+void hgfs_free(void *ptr);
+
+/**
+ * Release every allocation made at a membrane depth in bulk
+ * 
+ * Pointers previously returned for this depth become invalid.
+ * 
+ * @param depth Membrane depth to release
+ */
+void hgfs_release_depth(uint32_t depth);
+
+/**
+ * Get allocator statistics for a membrane depth
+ * 
+ * @param depth Membrane depth
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
+ */
+int hgfs_get_stats(uint32_t depth, struct hgfs_stats *stats);
+
 /**
  * Create a hypergraph edge connecting atoms
  * 
@@ -93,6 +550,14 @@ void *hgfs_alloc(size_t size, uint32_t depth);
  */
 atom_handle_t hgfs_edge(atom_handle_t from, atom_handle_t to, enum atom_type edge_type);
 
+/**
+ * Remove a hypergraph edge
+ * 
+ * @param edge Edge handle returned by hgfs_edge()
+ * @return 0 on success, negative on error
+ */
+int hgfs_edge_remove(atom_handle_t edge);
+
 /**
  * Allocate an atom in the AtomSpace
  * 
@@ -105,6 +570,8 @@ atom_handle_t cog_atom_alloc(enum atom_type type, const char *name);
 /**
  * Create a link between atoms
  * 
+ * The outgoing set is stored in order as one contiguous array.
+ * 
  * @param type Link type
  * @param outgoing Array of outgoing atom handles
  * @param outgoing_count Number of outgoing atoms
@@ -112,63 +579,580 @@ atom_handle_t cog_atom_alloc(enum atom_type type, const char *name);
  */
 atom_handle_t cog_link_create(enum atom_type type, const atom_handle_t *outgoing, size_t outgoing_count);
 
+/**
+ * Copy the outgoing set of a link
+ * 
+ * Reads the link's inline outgoing array; a cold link is not faulted in.
+ * 
+ * @param link Link handle
+ * @param out Array to receive the member handles in order
+ * @param max Capacity of out
+ * @return Arity of the link (0 for nodes), which may exceed max, or
+ *         negative if the handle is invalid
+ */
+int cog_link_outgoing(atom_handle_t link, atom_handle_t *out, size_t max);
+
+/**
+ * Allocate a batch of atoms of one type
+ * 
+ * The atoms take a contiguous range of fresh slots, so their handles are
+ * consecutive; slots freed by removals are left to cog_atom_alloc().
+ * 
+ * @param type Atom type
+ * @param names Array of count names (NULL, or NULL entries, for unnamed atoms)
+ * @param count Number of atoms
+ * @param out Array to receive count handles
+ * @return 0 on success, negative on error (no atom is created)
+ */
+int cog_atom_alloc_batch(enum atom_type type, const char *const *names, size_t count,
+                         atom_handle_t *out);
+
+/**
+ * Create a batch of links of one type and arity
+ * 
+ * Links and their outgoing sets are written in one pass over a contiguous
+ * slot range; the result is the same as count cog_link_create() calls.
+ * 
+ * @param type Link type
+ * @param outgoing Outgoing sets, arity handles per link, back to back
+ * @param arity Outgoing set size of every link
+ * @param count Number of links
+ * @param out Array to receive count handles
+ * @return 0 on success, negative on error (no link is created)
+ */
+int cog_link_create_batch(enum atom_type type, const atom_handle_t *outgoing, size_t arity,
+                          size_t count, atom_handle_t *out);
+
+/**
+ * Remove an atom from the AtomSpace
+ * 
+ * Incident edges, attention and truth values are dropped with the atom,
+ * and links whose outgoing set contains it are removed recursively.
+ * The slot is recycled under a new generation.
+ * 
+ * @param atom Atom handle
+ * @return 0 on success, negative if the handle is invalid or stale
+ */
+int cog_atom_remove(atom_handle_t atom);
+
+/**
+ * Check whether a handle refers to a live atom
+ * 
+ * @param atom Atom handle
+ * @return 1 if the atom exists, 0 otherwise
+ */
+int cog_atom_valid(atom_handle_t atom);
+
+/**
+ * Cursor over the live atoms of one type
+ */
+struct cog_atom_iter {
+    enum atom_type type;
+    size_t next;               /**< Posting list entries left to visit */
+};
+
+/**
+ * Number of live atoms of a type
+ * 
+ * @param type Atom type
+ * @return Number of atoms (0 for types outside enum atom_type)
+ */
+size_t cog_atom_type_count(enum atom_type type);
+
+/**
+ * Start enumerating the live atoms of a type
+ * 
+ * Every type keeps a dense posting list, so a full enumeration costs
+ * O(matches) rather than a scan of the atom table. Atoms created after
+ * this call are not returned.
+ * 
+ * @param it Iterator to initialize
+ * @param type Atom type
+ */
+void cog_atom_iter_init(struct cog_atom_iter *it, enum atom_type type);
+
+/**
+ * Fetch the next atoms of an iterator's type
+ * 
+ * Removing atoms already returned is safe and never makes the iterator
+ * skip one; removing atoms not yet returned may return some twice.
+ * 
+ * @param it Iterator from cog_atom_iter_init()
+ * @param out Array to receive handles
+ * @param max Capacity of out
+ * @return Number of handles stored, 0 once the type is exhausted
+ */
+size_t cog_atom_iter_next(struct cog_atom_iter *it, atom_handle_t *out, size_t max);
+
+/**
+ * Atom orders for cog_atom_reorder()
+ */
+enum cog_reorder_method {
+    COG_REORDER_BFS = 0,       /**< Breadth-first from each unplaced atom in slot order */
+    COG_REORDER_RCM = 1,       /**< Reverse Cuthill-McKee: BFS by ascending degree, reversed */
+    COG_REORDER_DEGREE = 2     /**< Highest degree first */
+};
+
+/**
+ * Renumber atom storage so that connected atoms sit in nearby slots
+ * 
+ * Permutes the atom, attention value and truth value tables into the
+ * chosen order and copies outgoing sets and incidence lists to fresh
+ * memory in that order, so spreading and traversal touch fewer cache
+ * lines. Handles do not change; they are translated through an
+ * indirection table from then on.
+ * 
+ * Call from the context's own thread between scheduler ticks. Fails while
+ * any read snapshot is pinned.
+ * 
+ * @param method Order to lay the atoms out in
+ * @return 0 on success, negative on error (nothing is moved)
+ */
+int cog_atom_reorder(enum cog_reorder_method method);
+
+/**
+ * Compress the adjacency of every atom currently in memory
+ * 
+ * Outgoing sets and incidence lists move into one shared block, encoded
+ * as sorted varint deltas, and their arena memory is freed.
+ * Traversal, spreading and removal work on the compressed form directly;
+ * adding a link or edge to a packed atom, paging it out or reordering
+ * unpacks it again. Meant for bulk-loaded or otherwise settled graphs;
+ * call again to fold in atoms created or unpacked since. Packed atoms
+ * report their incident links in slot order rather than creation order.
+ * A link whose members lie 2^30 or more slots apart stays unpacked.
+ * 
+ * @return 0 on success, negative on error (nothing is changed)
+ */
+int cog_adjacency_pack(void);
+
+/**
+ * Switch attention and truth values between float and compact storage
+ * 
+ * The compact layout keeps the values of 32 consecutive atom slots in one
+ * block: STI as int16 and LTI and VLTI as int8, each counted in units of
+ * a scale shared by the context, and strength and confidence as 16-bit
+ * fixed point. Each table takes under 5 bytes per atom instead of 40.
+ * A scheduler tick decays STI by shrinking its scale alone, and focus
+ * selection skips whole blocks after one vector reduction over their
+ * packed STIs. Every call still takes and returns floats, converted on
+ * the way in and out, to within:
+ * 
+ * - STI: one unit, at most 2/32767 of the largest STI stored since its
+ *   scale last grew. A value that does not fit grows the scale and
+ *   requantizes the table, which keeps the bound.
+ * - LTI and VLTI: one unit, at most 2/127 of the largest value likewise.
+ * - Strength and confidence: 1/131070, after clamping to [0, 1].
+ * 
+ * NaN is stored as 0 and infinities as the largest value that fits.
+ * Call from the context's own thread. Fails while any read snapshot is
+ * pinned. The layout lasts until cogkern_shutdown().
+ * 
+ * @param enable Nonzero for compact storage, zero for floats
+ * @return 0 on success, negative on error (nothing is changed)
+ */
+int cog_values_compact(int enable);
+
+/**
+ * Whether attention and truth values are stored compact
+ * 
+ * @return 1 if compact, 0 if stored as floats
+ */
+int cog_values_compact_get(void);
+
+/**
+ * Bit of an atom type in the type masks of struct cog_traverse_params
+ */
+#define COG_TYPE_BIT(type) (1u << (type))
+
+/**
+ * Neighbourhood traversal parameters
+ * 
+ * A hop crosses one edge as atomspace neighbours define it: from a link
+ * to a member, from an atom to a link containing it, or along an edge.
+ */
+struct cog_traverse_params {
+    uint32_t max_hops;         /**< Hop limit, 0 for the whole connected region */
+    uint32_t result_types;     /**< Types to return (COG_TYPE_BIT mask), 0 for all */
+    uint32_t follow_types;     /**< Types to expand beyond, 0 for all */
+    uint32_t threads;          /**< Worker threads (0 uses every online CPU) */
+};
+
+/**
+ * Neighbourhood traversal statistics
+ */
+struct cog_traverse_stats {
+    size_t reached;            /**< Atoms reached besides the start, of any type */
+    uint32_t levels;           /**< Hops expanded */
+    uint32_t bottom_up_levels; /**< Levels expanded bottom-up */
+    uint32_t threads;          /**< Most threads used on one level */
+    uint64_t elapsed_ns;
+};
+
+/**
+ * Find the atoms within a number of hops of an atom
+ * 
+ * Runs a level-synchronous breadth-first search over visited and
+ * frontier bitsets. Small frontiers are expanded top-down; once the
+ * frontier is large compared with the atoms not yet reached, each of
+ * those looks for a parent in the frontier instead (bottom-up). Wide
+ * levels are split across worker threads. Atoms of types outside
+ * follow_types are returned but not expanded; the start atom always is.
+ * 
+ * Results come in hop order, and in storage order within a hop, so the
+ * output does not depend on the thread count. The start atom is not
+ * returned. Call from the context's own thread; the AtomSpace must not
+ * change during the call.
+ * 
+ * @param start Atom to start from
+ * @param params Traversal parameters (NULL for no limits)
+ * @param out Array to receive the handles of the atoms found
+ * @param hops Array to receive each atom's distance in hops (may be NULL)
+ * @param max Capacity of out and hops
+ * @param stats Pointer to receive traversal statistics (may be NULL)
+ * @return Number of atoms found, which may exceed max, or negative on
+ *         error (invalid start atom or out of memory)
+ */
+int cog_traverse(atom_handle_t start, const struct cog_traverse_params *params,
+                 atom_handle_t *out, uint32_t *hops, size_t max,
+                 struct cog_traverse_stats *stats);
+
+/**
+ * Out-of-core tier parameters
+ * 
+ * Each scheduler tick examines scan_batch atom slots and pages out atoms
+ * whose STI and LTI are both below the thresholds (atoms without an
+ * attention value count as zero). A scan_batch of 0 disables automatic
+ * paging; cog_tier_page_out() still works.
+ */
+struct cog_tier_params {
+    float sti_threshold;    /**< Page out atoms with STI below this */
+    float lti_threshold;    /**< ...and LTI below this */
+    uint32_t scan_batch;    /**< Atom slots examined per tick */
+};
+
+/**
+ * Out-of-core tier statistics
+ */
+struct cog_tier_stats {
+    size_t hot_atoms;           /**< Atoms resident in memory */
+    size_t cold_atoms;          /**< Atoms held in the segment */
+    size_t segment_size;        /**< Segment file size in bytes */
+    size_t segment_used;        /**< Bytes written, including dead records */
+    size_t segment_dead;        /**< Bytes of records already faulted back */
+    uint64_t lookups;           /**< Handle lookups since the tier opened */
+    uint64_t faults;            /**< Lookups that had to fault an atom in */
+    float hit_rate;             /**< Fraction of lookups served from memory */
+    uint64_t page_outs;         /**< Atoms written to the segment */
+    uint64_t bytes_written;     /**< Record bytes written by page-outs */
+    uint64_t bytes_read;        /**< Record bytes read by faults */
+    uint64_t fault_ns_total;    /**< Time spent faulting atoms in */
+    uint64_t fault_ns_max;      /**< Slowest single fault */
+    uint64_t compactions;       /**< Segment compactions */
+};
+
+/**
+ * Open the out-of-core tier backed by a memory-mapped segment file
+ * 
+ * Cold atoms keep their handle and slot; their name, incidence list,
+ * attention value and truth value move to the segment. Any API that
+ * dereferences a cold atom (including pln_infer() and importance
+ * spreading) faults it back in transparently. The file is created or
+ * truncated.
+ * 
+ * @param path Segment file path
+ * @param segment_size Segment size in bytes
+ * @return 0 on success, negative on error
+ */
+int cog_tier_open(const char *path, size_t segment_size);
+
+/**
+ * Fault every cold atom back in and close the segment
+ * 
+ * @return 0 on success, negative if atoms could not be brought back
+ */
+int cog_tier_close(void);
+
+/**
+ * Configure automatic paging
+ * 
+ * @param params Tier parameters
+ * @return 0 on success, negative on error
+ */
+int cog_tier_set_params(const struct cog_tier_params *params);
+
+/**
+ * Page an atom out to the segment immediately
+ * 
+ * @param atom Atom handle
+ * @return 0 on success, negative on error
+ */
+int cog_tier_page_out(atom_handle_t atom);
+
+/**
+ * Get out-of-core tier statistics
+ * 
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative if the tier is not open
+ */
+int cog_tier_get_stats(struct cog_tier_stats *stats);
+
+/**
+ * Pin a read snapshot on the calling thread
+ * 
+ * Until cog_snapshot_end(), cog_atom_valid(), dtesn_sched_get_av() and
+ * pln_infer() called on this thread see the AtomSpace as it was when the
+ * snapshot began: atoms created later are invisible and attention and
+ * truth values keep the values they had, while writers on other threads
+ * go on appending atoms and changing attention. Reads take no lock and
+ * never fault cold atoms in. Removed atoms disappear from snapshots at
+ * once. Writers keep old values only while snapshots need them.
+ * 
+ * @return 0 on success, negative if the thread already holds a snapshot
+ *         or too many threads do
+ */
+int cog_snapshot_begin(void);
+
+/**
+ * Release the calling thread's read snapshot
+ */
+void cog_snapshot_end(void);
+
+/**
+ * Bulk import statistics
+ */
+struct cog_import_stats {
+    size_t lines;              /**< Lines read, including blank and comment lines */
+    size_t nodes;              /**< Nodes created */
+    size_t links;              /**< Links created */
+    size_t errors;             /**< Malformed lines skipped */
+    uint32_t threads;          /**< Parser threads used */
+    uint64_t parse_ns;         /**< Time spent mapping, parsing and interning names */
+    uint64_t commit_ns;        /**< Time spent creating atoms and edges */
+    const char *error;         /**< Why the import failed (NULL on success) */
+};
+
+/**
+ * Import atoms from a tab-separated file
+ * 
+ * Each line is a type keyword (the atom type names used by the CLI)
+ * followed by tab-separated names: one name declares a node of a node
+ * type, one or more names create a link of a link type over those nodes.
+ * A name denotes the same node throughout the file; names only used in
+ * links become concept nodes. Blank lines and lines starting with '#'
+ * are skipped, malformed lines are counted and skipped. Every import
+ * creates new nodes; names are not matched against existing atoms.
+ * 
+ * The file is parsed on several threads and committed by the caller in
+ * one batch, in file order. Table space for every atom is reserved before
+ * the first one is created, so a file that does not fit the memory budget
+ * fails without creating atoms; if the commit fails later anyway, the
+ * atoms created so far are kept. On failure stats->error says why.
+ * 
+ * @param path File to import
+ * @param threads Parser threads (0 uses every online CPU)
+ * @param stats Pointer to receive import statistics (may be NULL)
+ * @return 0 on success, negative on error
+ */
+int cog_import_file(const char *path, uint32_t threads, struct cog_import_stats *stats);
+
 /** @} */
 
 /**
- * @defgroup ecan ECAN - Economic Attention Allocation
- * @{
+ * @defgroup ecan ECAN - Economic Attention Allocation
+ * @{
+ */
+
+/**
+ * Attention value structure
+ */
+struct attention_value {
+    float sti;  /**< Short-term importance */
+    float lti;  /**< Long-term importance */
+    float vlti; /**< Very long-term importance */
+};
+
+/**
+ * Initialize the ECAN scheduler
+ * 
+ * @param tick_interval_us Scheduler tick interval in microseconds
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_init(uint32_t tick_interval_us);
+
+/**
+ * Execute one scheduler tick
+ * 
+ * Runs the cognitive tasks submitted since the previous tick, then the
+ * incremental forgetting and tiering passes.
+ * 
+ * @return Number of tasks processed (tasks run, atoms forgotten and
+ *         atoms paged out), negative on error
+ */
+int dtesn_sched_tick(void);
+
+/**
+ * Set attention value for an atom
+ * 
+ * @param atom Atom handle
+ * @param av Pointer to attention value structure
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_set_av(atom_handle_t atom, const struct attention_value *av);
+
+/**
+ * Set attention values for a batch of atoms
+ * 
+ * @param atoms Array of atom handles
+ * @param avs Array of attention values, one per atom
+ * @param count Number of atoms
+ * @return Number of attention values stored (stale handles are skipped),
+ *         negative on error
+ */
+int dtesn_sched_set_av_batch(const atom_handle_t *atoms, const struct attention_value *avs,
+                             size_t count);
+
+/**
+ * Get attention value for an atom
+ * 
+ * @param atom Atom handle
+ * @param av Pointer to structure to receive attention value
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_get_av(atom_handle_t atom, struct attention_value *av);
+
+/**
+ * LTI-driven forgetting parameters
+ * 
+ * When the AtomSpace fill (live atoms over capacity) or the share of the
+ * memory budget in use reaches high_watermark, dtesn_sched_tick() starts
+ * evicting the atoms with the lowest LTI until the low watermark is
+ * reached. An atom, edge, attention or truth value table that could not
+ * grow for lack of budget counts as a full budget, so the next tick frees
+ * slots for reuse; other failed allocations, such as a tensor too large
+ * for the budget, evict nothing. Atoms with a non-zero VLTI are never
+ * forgotten.
+ */
+struct ecan_forget_params {
+    int enabled;           /**< Non-zero to forget during scheduler ticks */
+    size_t capacity;       /**< Atom capacity (0: bounded by memory budget only) */
+    float high_watermark;  /**< Fill fraction that starts a pass (default 0.95) */
+    float low_watermark;   /**< Fill fraction that ends a pass (default 0.85) */
+    uint32_t scan_batch;   /**< Atom slots examined per tick (default 1024) */
+};
+
+/**
+ * Forgetting statistics
+ */
+struct ecan_forget_stats {
+    uint64_t atoms_forgotten;  /**< Atoms evicted since scheduler init */
+    uint64_t passes;           /**< Forgetting passes started */
+    int pass_active;           /**< Non-zero while a pass is in progress */
+    float threshold;           /**< Current LTI eviction threshold */
+    float pressure;            /**< Current fill fraction */
+};
+
+/**
+ * Configure LTI-driven forgetting
+ * 
+ * @param params Forgetting parameters
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_set_forgetting(const struct ecan_forget_params *params);
+
+/**
+ * Get forgetting statistics
+ * 
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_get_forget_stats(struct ecan_forget_stats *stats);
+
+/**
+ * Spread importance across connected atoms
+ * 
+ * Moves diffusion_rate of the source's STI to the atoms it shares an
+ * edge with, split evenly between them.
+ * 
+ * @param source Source atom handle
+ * @param diffusion_rate Rate of importance diffusion (0.0-1.0)
+ * @return Number of atoms affected
  */
+int dtesn_sched_spread_importance(atom_handle_t source, float diffusion_rate);
 
 /**
- * Attention value structure
+ * Maximum number of task workers
  */
-struct attention_value {
-    float sti;  /**< Short-term importance */
-    float lti;  /**< Long-term importance */
-    float vlti; /**< Very long-term importance */
-};
+#define DTESN_SCHED_MAX_WORKERS 16
 
 /**
- * Initialize the ECAN scheduler
+ * Cognitive task function
  * 
- * @param tick_interval_us Scheduler tick interval in microseconds
- * @return 0 on success, negative on error
+ * @param atom Atom the task was submitted for (0 if none)
+ * @param arg Argument given to dtesn_sched_submit()
  */
-int dtesn_sched_init(uint32_t tick_interval_us);
+typedef void (*dtesn_task_fn)(atom_handle_t atom, void *arg);
 
 /**
- * Execute one scheduler tick
+ * Task scheduler statistics
  * 
- * @return Number of tasks processed
+ * Latency is measured from submission to the start of the task.
+ * Utilization is each worker's share of dispatch time spent running
+ * tasks.
  */
-int dtesn_sched_tick(void);
+struct dtesn_sched_stats {
+    uint32_t workers;          /**< Workers including the loop thread */
+    uint64_t tasks_submitted;
+    uint64_t tasks_run;
+    uint64_t tasks_stolen;     /**< Tasks run by a worker other than their owner */
+    uint64_t tasks_cancelled;  /**< Dropped because their atom was removed */
+    size_t tasks_pending;      /**< Waiting for the next tick */
+    uint64_t latency_ns_total;
+    uint64_t latency_ns_max;
+    uint64_t run_ns_total;
+    uint64_t dispatch_ns_total; /**< Wall time from dispatch to the last task finishing */
+    float utilization[DTESN_SCHED_MAX_WORKERS];
+};
 
 /**
- * Set attention value for an atom
+ * Set the number of task workers
  * 
- * @param atom Atom handle
- * @param av Pointer to attention value structure
+ * The loop thread calling dtesn_sched_tick() is worker 0, so one worker
+ * (the default) runs every task inline. With more workers tasks run
+ * concurrently and must synchronize any AtomSpace writes themselves.
+ * Reads race too: outside a snapshot, lookups update shared counters and
+ * fault cold atoms in. Tasks that may run concurrently must read between
+ * cog_snapshot_begin() and cog_snapshot_end(), which take no lock and
+ * never fault in.
+ * 
+ * @param workers Worker count including the loop thread
+ *                (1-DTESN_SCHED_MAX_WORKERS)
  * @return 0 on success, negative on error
  */
-int dtesn_sched_set_av(atom_handle_t atom, const struct attention_value *av);
+int dtesn_sched_set_workers(uint32_t workers);
 
 /**
- * Get attention value for an atom
+ * Submit a cognitive task
  * 
- * @param atom Atom handle
- * @param av Pointer to structure to receive attention value
+ * The task runs during the next dtesn_sched_tick() with the STI of its
+ * atom at submission as priority; higher priorities are dispatched first.
+ * May be called from the loop thread or from a running task, whose
+ * subtasks run in the same tick.
+ * 
+ * @param atom Atom the task works on (0 for none, priority 0)
+ * @param fn Task function
+ * @param arg Argument passed to fn
  * @return 0 on success, negative on error
  */
-int dtesn_sched_get_av(atom_handle_t atom, struct attention_value *av);
+int dtesn_sched_submit(atom_handle_t atom, dtesn_task_fn fn, void *arg);
 
 /**
- * Spread importance across connected atoms
+ * Get task scheduler statistics
  * 
- * @param source Source atom handle
- * @param diffusion_rate Rate of importance diffusion (0.0-1.0)
- * @return Number of atoms affected
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
  */
-int dtesn_sched_spread_importance(atom_handle_t source, float diffusion_rate);
+int dtesn_sched_get_stats(struct dtesn_sched_stats *stats);
 
 /** @} */
 
@@ -188,9 +1172,14 @@ struct truth_value {
 /**
  * Evaluate a PLN expression using tensor operations
  * 
+ * The expression is the conjunction of its premises: a tensor of shape
+ * [2, n] holding one (strength, confidence) row per premise. The result
+ * strength is the product of the strengths (independent premises) and
+ * the result confidence the smallest confidence.
+ * 
  * @param expr Expression tensor
  * @param result Pointer to receive truth value result
- * @return 0 on success, negative on error
+ * @return 0 on success, negative on error (or if expr is not [2, n])
  */
 int pln_eval_tensor(struct ggml_tensor *expr, struct truth_value *result);
 
@@ -214,6 +1203,26 @@ int pln_unify_graph(struct ggml_tensor *pattern, struct ggml_tensor *target,
  */
 int pln_infer(atom_handle_t atom, struct truth_value *tv);
 
+/**
+ * Set the truth value of an atom
+ * 
+ * @param atom Atom handle
+ * @param tv Truth value to store
+ * @return 0 on success, negative on error
+ */
+int pln_set_tv(atom_handle_t atom, const struct truth_value *tv);
+
+/**
+ * Set truth values for a batch of atoms
+ * 
+ * @param atoms Array of atom handles
+ * @param tvs Array of truth values, one per atom
+ * @param count Number of atoms
+ * @return Number of truth values stored (stale handles are skipped),
+ *         negative on error
+ */
+int pln_set_tv_batch(const atom_handle_t *atoms, const struct truth_value *tvs, size_t count);
+
 /**
  * Create inference link between atoms
  * 
@@ -227,6 +1236,193 @@ atom_handle_t cog_link_infer(atom_handle_t premise, atom_handle_t conclusion,
 
 /** @} */
 
+/**
+ * @defgroup embed Embeddings - Per-atom vectors and similarity search
+ * @{
+ */
+
+/**
+ * Largest embedding dimension
+ */
+#define COG_EMBED_MAX_DIM 4096
+
+/**
+ * Storage formats of the embedding matrix
+ */
+enum cog_embed_format {
+    COG_EMBED_F32 = 0,         /**< 32-bit floats */
+    COG_EMBED_I8 = 1           /**< 8-bit integers with a scale per vector */
+};
+
+/**
+ * One similarity search result
+ */
+struct cog_embed_match {
+    atom_handle_t atom;
+    float score;               /**< Cosine similarity to the query (-1.0-1.0) */
+};
+
+/**
+ * Set the dimension and storage format of atom embeddings
+ * 
+ * Every embedding of a context has the same dimension. Vectors are stored
+ * normalized to unit length in one contiguous matrix; COG_EMBED_I8 takes a
+ * quarter of the memory of COG_EMBED_F32 at a cosine error below 0.01.
+ * 
+ * @param dim Vector dimension (1 to COG_EMBED_MAX_DIM)
+ * @param format Storage format
+ * @return 0 on success, negative on error (or if embeddings of another
+ *         dimension or format are stored)
+ */
+int cog_embed_init(uint32_t dim, enum cog_embed_format format);
+
+/**
+ * Attach an embedding to an atom, replacing any it had
+ * 
+ * The vector is normalized before it is stored. An embedding stays with
+ * its atom through reordering and paging and is dropped when the atom is
+ * removed.
+ * 
+ * @param atom Atom handle
+ * @param vec Vector of the configured dimension
+ * @return 0 on success, negative on error (invalid atom, zero vector or
+ *         embeddings not configured)
+ */
+int cog_embed_set(atom_handle_t atom, const float *vec);
+
+/**
+ * Copy the stored (normalized) embedding of an atom
+ * 
+ * @param atom Atom handle
+ * @param vec Array of the configured dimension to receive the vector
+ * @return 0 on success, negative if the atom has no embedding
+ */
+int cog_embed_get(atom_handle_t atom, float *vec);
+
+/**
+ * Remove the embedding of an atom
+ * 
+ * @param atom Atom handle
+ * @return 0 on success, negative if the atom has no embedding
+ */
+int cog_embed_remove(atom_handle_t atom);
+
+/**
+ * Build an approximate search index over the stored embeddings
+ * 
+ * Clusters the vectors with spherical k-means into inverted lists (IVF).
+ * Embeddings set later join the list of their nearest centroid; rebuild
+ * when the data has drifted. Building costs O(atoms * lists * dim).
+ * 
+ * @param lists Number of inverted lists (0 picks the square root of the
+ *        number of embeddings)
+ * @return 0 on success, negative on error
+ */
+int cog_embed_index_build(uint32_t lists);
+
+/**
+ * Find the stored embeddings most similar to a query vector
+ * 
+ * With probes 0, or without an index, every vector is scored (exact).
+ * Otherwise only the vectors in the probes lists whose centroids are
+ * nearest the query are scored, which may miss some true neighbours.
+ * 
+ * @param query Vector of the configured dimension (need not be normalized)
+ * @param k Number of results wanted
+ * @param probes Inverted lists to scan, 0 for an exact search
+ * @param out Array to receive up to k matches, most similar first
+ * @return Number of matches stored, negative on error
+ */
+int cog_embed_search(const float *query, size_t k, uint32_t probes,
+                     struct cog_embed_match *out);
+
+/**
+ * Link an atom to its most similar atoms by embedding
+ * 
+ * Creates an ATOM_SIMILARITY link between the atom and each of its k
+ * nearest neighbours scoring at least min_score, with the similarity
+ * (clamped to 0.0-1.0) as the link's truth value strength. A similarity
+ * link that already joins the pair gets its truth value updated instead.
+ * 
+ * @param atom Atom handle (must have an embedding)
+ * @param k Neighbours to consider
+ * @param probes Inverted lists to scan, 0 for an exact search
+ * @param min_score Smallest cosine similarity that gets a link
+ * @param confidence Truth value confidence of the links
+ * @return Number of links created or updated, negative on error
+ */
+int cog_embed_link_similar(atom_handle_t atom, size_t k, uint32_t probes, float min_score,
+                           float confidence);
+
+/** @} */
+
+/**
+ * @defgroup similar Similarity discovery - Links between overlapping neighbourhoods
+ * @{
+ */
+
+/**
+ * Largest MinHash signature (bands * rows)
+ */
+#define COG_SIMILARITY_MAX_HASHES 256
+
+/**
+ * Similarity discovery parameters
+ * 
+ * An atom's neighbourhood is the set of atoms it is related to: its
+ * members if it is a link, the other members of each link containing it
+ * (ATOM_SIMILARITY links left out) and the far end of each edge. Two atoms
+ * whose neighbourhoods have Jaccard similarity J share at least one band
+ * with probability 1 - (1 - J^rows)^bands, so more bands find weaker
+ * overlaps and more rows per band suppress them.
+ */
+struct cog_similarity_params {
+    uint32_t types;            /**< Atoms to compare (COG_TYPE_BIT mask), 0 for all types
+                                    but ATOM_SIMILARITY */
+    uint32_t bands;            /**< LSH bands, 0 for 16 */
+    uint32_t rows;             /**< Signature rows per band, 0 for 4 */
+    uint32_t window;           /**< Partners of each atom in a bucket, 0 for 32 */
+    float min_jaccard;         /**< Smallest estimated Jaccard similarity that gets a link */
+    float confidence;          /**< Truth value confidence of the links */
+    uint32_t threads;          /**< Worker threads (0 uses every online CPU) */
+};
+
+/**
+ * Similarity discovery statistics
+ */
+struct cog_similarity_stats {
+    size_t atoms;              /**< Atoms with a non-empty neighbourhood */
+    size_t candidates;         /**< Distinct pairs sharing a band */
+    size_t links;              /**< Links created or updated */
+    uint32_t threads;          /**< Threads used */
+    uint64_t elapsed_ns;
+};
+
+/**
+ * Link atoms whose neighbourhoods overlap
+ * 
+ * Computes a MinHash signature of every selected atom's neighbourhood,
+ * buckets the signatures by LSH band and estimates the Jaccard similarity
+ * of each pair that shares a bucket from their signatures. Pairs at or
+ * above min_jaccard get an ATOM_SIMILARITY link with the estimate as its
+ * truth value strength; a similarity link that already joins the pair
+ * gets its truth value updated instead. Cost is linear in atoms and
+ * edges plus the candidate pairs; a bucket larger than the window pairs
+ * each atom with the next window atoms only, so a large group of
+ * near-identical neighbourhoods is linked as a chain rather than all
+ * pairs. Signing and bucketing run on worker threads; links are created
+ * on the calling thread.
+ * 
+ * @param params Discovery parameters (NULL for the defaults, linking at
+ *        an estimated Jaccard of 0.5 with confidence 0.9)
+ * @param stats Pointer to receive discovery statistics (may be NULL)
+ * @return Number of links created or updated, negative on error
+ */
+int cog_similarity_discover(const struct cog_similarity_params *params,
+                            struct cog_similarity_stats *stats);
+
+/** @} */
+
 /**
  * @defgroup cogloop Cognitive Loop - Bootstrap and Event Loop
  * @{
@@ -257,17 +1453,192 @@ int cogloop_boot_stage(enum boot_stage stage);
  */
 int stage1_init_hypergraph_fs(void);
 
+/**
+ * Memory region options
+ */
+enum dtesn_mem_flags {
+    DTESN_MEM_TRANSPARENT_HUGEPAGES = 1 << 0, /**< madvise(MADV_HUGEPAGE) on regions */
+    DTESN_MEM_EXPLICIT_HUGEPAGES = 1 << 1,    /**< MAP_HUGETLB, falls back to THP */
+    DTESN_MEM_PREFAULT = 1 << 2               /**< Fault every page in at init */
+};
+
+/**
+ * Memory region statistics
+ */
+struct dtesn_mem_stats {
+    size_t num_regions;      /**< Regions reserved */
+    size_t region_size;      /**< Bytes per region */
+    size_t bytes_reserved;   /**< Budget held by regions (less any lent to the heap) */
+    size_t bytes_allocated;  /**< Region bytes handed out to subsystems */
+    size_t heap_bytes;       /**< Storage on the heap (no regions, or no page run fit) */
+    uint32_t active_flags;   /**< enum dtesn_mem_flags actually in effect */
+};
+
+/**
+ * Set memory region options for the next dtesn_mem_init_regions() call
+ * 
+ * @param flags Bitwise OR of enum dtesn_mem_flags
+ * @return 0 on success, negative if regions are already initialized
+ */
+int dtesn_mem_set_flags(uint32_t flags);
+
 /**
  * Initialize memory regions
  * 
- * @param num_regions Number of memory regions
+ * Reserves the unused part of the cogkern_init() budget as num_regions
+ * cache-line (and huge page) aligned regions. All kernel tables and
+ * hypergraph arenas allocated afterwards are served from them. The
+ * regions are contiguous, so one table may grow across several of them.
+ * 
+ * @param num_regions Number of memory regions (1-256)
  * @return 0 on success, negative on error
  */
 int dtesn_mem_init_regions(size_t num_regions);
 
+/**
+ * Get memory region statistics
+ * 
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
+ */
+int dtesn_mem_get_stats(struct dtesn_mem_stats *stats);
+
+/**
+ * Maximum atom name length carried by a stimulus event (including NUL)
+ */
+#define COG_EVENT_NAME_MAX 32
+
+/**
+ * Stimulus event types
+ */
+enum cog_event_type {
+    COG_EVENT_NEW_ATOM = 0,        /**< Allocate atom_type/name, STI set to sti if non-zero */
+    COG_EVENT_STI_BOOST = 1,       /**< Add sti to the atom's STI */
+    COG_EVENT_TV_OBSERVATION = 2   /**< Revise the atom's truth value with tv */
+};
+
+/**
+ * Stimulus event
+ */
+struct cog_event {
+    enum cog_event_type type;
+    enum atom_type atom_type;      /**< COG_EVENT_NEW_ATOM */
+    atom_handle_t atom;            /**< COG_EVENT_STI_BOOST, COG_EVENT_TV_OBSERVATION */
+    float sti;
+    struct truth_value tv;         /**< COG_EVENT_TV_OBSERVATION */
+    char name[COG_EVENT_NAME_MAX]; /**< COG_EVENT_NEW_ATOM (empty for no name) */
+};
+
+/**
+ * Event queue statistics
+ */
+struct cog_event_stats {
+    size_t capacity;          /**< Queue slots */
+    size_t depth;             /**< Events waiting to be drained */
+    size_t high_water;        /**< Deepest the queue has been at a drain */
+    uint64_t posted;          /**< Events accepted */
+    uint64_t dropped;         /**< Events rejected because the queue was full */
+    uint64_t backpressured;   /**< Events accepted above the backpressure watermark */
+    uint64_t drained;         /**< Events applied by the loop */
+    uint64_t failed;          /**< Drained events that could not be applied */
+};
+
+/**
+ * Create the stimulus event queue
+ * 
+ * Must be called before producer threads start posting. STAGE3_COGNITIVE
+ * creates a default queue if none exists.
+ * 
+ * @param capacity Queue slots (rounded up to a power of two)
+ * @param drain_batch Maximum events applied per cogloop_tick()
+ * @return 0 on success, negative on error
+ */
+int cog_event_queue_init(size_t capacity, uint32_t drain_batch);
+
+/**
+ * Post a stimulus event from any thread
+ * 
+ * Lock-free; never blocks. Events are applied by the loop thread at the
+ * start of the next cogloop_tick().
+ * 
+ * @param event Event to copy into the queue
+ * @return 0 if queued, 1 if queued but the queue is more than three
+ *         quarters full (producers should slow down), negative if the
+ *         event was dropped
+ */
+int cog_event_post(const struct cog_event *event);
+
+/**
+ * Get event queue statistics
+ * 
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative if no queue exists
+ */
+int cog_event_get_stats(struct cog_event_stats *stats);
+
+/**
+ * Cognitive cycle configuration
+ * 
+ * The stages are off by default (focus_size 0). Once enabled, each tick
+ * runs attention (ECAN) on the loop thread and snapshots the
+ * focus_size highest-STI atoms with their binary links. The snapshot of
+ * tick N is matched for deduction chains during tick N+1 and the
+ * conclusions are ranked and committed at tick N+2. In pipelined mode
+ * the pattern and inference stages run on two worker threads while the
+ * loop thread works on the next tick; results are identical to the
+ * serial mode.
+ */
+struct cogloop_pipeline_params {
+    int pipelined;             /**< Run pattern and inference on worker threads */
+    uint32_t focus_size;       /**< Atoms in the attentional focus (0 disables the stages) */
+    uint32_t max_conclusions;  /**< Conclusions committed per tick */
+};
+
+/**
+ * Cognitive cycle statistics
+ */
+struct cogloop_stats {
+    uint64_t iterations;          /**< Ticks run */
+    uint64_t conclusions_created; /**< Links created by inference */
+    uint64_t conclusions_revised; /**< Existing links given a more confident truth value */
+    uint64_t attention_ns;        /**< Total time in the attention stage */
+    uint64_t pattern_ns;          /**< Total time in the pattern stage */
+    uint64_t inference_ns;        /**< Total time in the inference stage */
+    uint64_t commit_ns;           /**< Total time committing conclusions */
+    uint64_t stall_ns;            /**< Time the loop thread waited for workers */
+    uint64_t tick_ns_max;         /**< Longest tick */
+    uint64_t deadline_misses;     /**< Budgeted ticks that ended past their deadline */
+    uint64_t budget_ns;           /**< Work budget of the last tick (0 if unbudgeted) */
+    uint32_t event_quota;         /**< Events the last budgeted tick could apply */
+    uint32_t task_quota;          /**< Tasks the last budgeted tick could run */
+    uint32_t focus_quota;         /**< Focus atoms the last budgeted tick could snapshot */
+    size_t events_carried;        /**< Events left queued after the last tick */
+    size_t tasks_carried;         /**< Tasks left queued after the last tick */
+};
+
+/**
+ * Configure the cognitive cycle
+ * 
+ * Conclusions still in flight are discarded.
+ * 
+ * @param params Pipeline parameters
+ * @return 0 on success, negative on error
+ */
+int cogloop_set_pipeline(const struct cogloop_pipeline_params *params);
+
+/**
+ * Get cognitive cycle statistics
+ * 
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
+ */
+int cogloop_get_stats(struct cogloop_stats *stats);
+
 /**
  * Run one iteration of the cognitive loop
  * 
+ * Pending stimulus events are applied first.
+ * 
  * @return 0 on success, negative on error
  */
 int cogloop_tick(void);
@@ -275,6 +1646,13 @@ int cogloop_tick(void);
 /**
  * Start the cognitive loop
  * 
+ * With a frequency every cogloop_tick() gets a deadline one period after
+ * the previous one and a work budget for the time left. The budget is
+ * split between stimulus events, cognitive tasks and focus atoms by the
+ * measured cost of earlier ticks; work past a quota stays queued for the
+ * next tick. A tick starting more than a period late starts a fresh
+ * deadline instead of trying to catch up.
+ * 
  * @param hz Frequency in Hz (0 for manual tick mode)
  * @return 0 on success, negative on error
  */
@@ -287,6 +1665,250 @@ void cogloop_stop(void);
 
 /** @} */
 
+/**
+ * @defgroup diag Diagnostics - Tracing and Metrics
+ * @{
+ */
+
+/**
+ * Start recording trace spans
+ * 
+ * Stages of the cognitive loop and the major kernel functions record
+ * spans into per-thread rings while tracing is on. Spans from a previous
+ * session are discarded.
+ * 
+ * @param events_per_thread Ring size per thread, rounded up to a power of
+ *                          two; older spans are overwritten (0 for 65536)
+ * @return 0 on success, negative if tracing is already on or the kernel
+ *         was built without COGKERN_TRACING
+ */
+int cog_trace_start(size_t events_per_thread);
+
+/**
+ * Stop recording trace spans
+ * 
+ * Recorded spans are kept until the next cog_trace_start().
+ */
+void cog_trace_stop(void);
+
+/**
+ * Write recorded spans as Chrome trace event JSON
+ * 
+ * The file loads in chrome://tracing and Perfetto. Call after
+ * cog_trace_stop() or while no other thread records spans.
+ * 
+ * @param path Output file path
+ * @return Number of spans written, negative on error
+ */
+long cog_trace_dump(const char *path);
+
+/**
+ * Latency distribution from the metrics registry
+ * 
+ * Percentiles come from log-linear histograms and are within 1/16 of
+ * the recorded value.
+ */
+struct cogkern_latency {
+    uint64_t count;           /**< Samples recorded */
+    uint64_t mean_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+};
+
+/**
+ * Kernel statistics and metrics
+ */
+struct cogkern_stats {
+    size_t atoms;                 /**< Live atoms, links included */
+    size_t links;                 /**< Live links */
+    size_t edges;                 /**< Live hgfs_edge() edges */
+    size_t link_members;          /**< Handles held in link outgoing sets */
+    size_t attention_values;      /**< Atoms with an attention value */
+    size_t truth_values;          /**< Atoms with a truth value */
+    size_t embeddings;            /**< Atoms with an embedding vector */
+    size_t cold_atoms;            /**< Atoms in the out-of-core tier */
+    size_t packed_atoms;          /**< Atoms with compressed adjacency */
+    size_t snapshots;             /**< Pinned read snapshots */
+    size_t snapshot_versions;     /**< Old values kept for snapshots */
+    size_t mem_used;              /**< Bytes charged against the budget */
+    size_t mem_budget;            /**< cogkern_init() budget */
+    size_t atom_table_bytes;      /**< Atom table storage */
+    size_t edge_table_bytes;      /**< Edge table storage */
+    size_t adjacency_pack_bytes;  /**< Compressed adjacency block */
+    size_t av_table_bytes;        /**< Attention value table storage */
+    size_t tv_table_bytes;        /**< Truth value table storage */
+    size_t embedding_bytes;       /**< Embedding matrix and index storage */
+    size_t tensor_bytes;          /**< Tensor arena chunks */
+    size_t arena_reserved;        /**< Hypergraph arena chunks, all depths */
+    size_t arena_in_use;          /**< Live hypergraph allocations, all depths */
+    size_t event_queue_bytes;     /**< Stimulus event queue storage */
+    size_t task_queue_bytes;      /**< Task heap, batch and deque storage */
+    size_t tier_segment_bytes;    /**< Mapped tier segment (0 if closed) */
+    size_t snapshot_bytes;        /**< Old values and retired tables kept for snapshots */
+    uint64_t atoms_created;       /**< Atoms allocated, links included */
+    uint64_t atoms_removed;       /**< Atoms removed, cascaded links included */
+    uint64_t links_created;
+    uint64_t inferences;          /**< pln_infer() calls */
+    uint64_t tasks_run;           /**< Cognitive tasks run */
+    uint64_t events_applied;      /**< Stimulus events applied by the loop */
+    struct cogkern_latency tick;       /**< cogloop_tick() */
+    struct cogkern_latency sched_tick; /**< dtesn_sched_tick() */
+    struct cogkern_latency task_run;   /**< Cognitive task bodies */
+    struct cogkern_latency task_wait;  /**< Submission to start of a task */
+};
+
+/**
+ * Collect kernel statistics and metrics
+ * 
+ * Gauges are read from each subsystem; counters and latencies come from
+ * the metrics registry, which every thread records into through its own
+ * shard, and cover the time since cogkern_init().
+ * 
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative if the kernel is not initialized
+ */
+int cogkern_stats(struct cogkern_stats *stats);
+
+/**
+ * Append the current statistics to a file as one JSON line
+ * 
+ * @param path Output file path
+ * @return 0 on success, negative on error
+ */
+int cogkern_stats_write(const char *path);
+
+/**
+ * Append statistics to a file every given number of cognitive loop ticks
+ * 
+ * Each dump is one cogkern_stats_write() line. Call from the loop thread
+ * or between ticks.
+ * 
+ * @param path Output file path (NULL to stop)
+ * @param ticks Ticks between dumps (0 to stop)
+ * @return 0 on success, negative on error
+ */
+int cogkern_stats_dump_every(const char *path, uint32_t ticks);
+
+/** @} */
+
+/**
+ * @defgroup cogkern_ctx_api Context Variants
+ * 
+ * Each function behaves like the function of the same name without the
+ * _ctx suffix, applied to ctx instead of the calling thread's current
+ * context (NULL selects the default context). The current context is
+ * restored before returning.
+ * @{
+ */
+
+struct ggml_context *cogkern_get_context_ctx(struct cogkern_ctx *ctx);
+int cogkern_mem_usage_ctx(struct cogkern_ctx *ctx, size_t *used, size_t *budget);
+
+void *hgfs_alloc_ctx(struct cogkern_ctx *ctx, size_t size, uint32_t depth);
+void hgfs_free_ctx(struct cogkern_ctx *ctx, void *ptr);
+void hgfs_release_depth_ctx(struct cogkern_ctx *ctx, uint32_t depth);
+int hgfs_get_stats_ctx(struct cogkern_ctx *ctx, uint32_t depth, struct hgfs_stats *stats);
+atom_handle_t hgfs_edge_ctx(struct cogkern_ctx *ctx, atom_handle_t from, atom_handle_t to,
+                            enum atom_type edge_type);
+int hgfs_edge_remove_ctx(struct cogkern_ctx *ctx, atom_handle_t edge);
+atom_handle_t cog_atom_alloc_ctx(struct cogkern_ctx *ctx, enum atom_type type, const char *name);
+atom_handle_t cog_link_create_ctx(struct cogkern_ctx *ctx, enum atom_type type,
+                                  const atom_handle_t *outgoing, size_t outgoing_count);
+int cog_link_outgoing_ctx(struct cogkern_ctx *ctx, atom_handle_t link, atom_handle_t *out,
+                          size_t max);
+int cog_atom_alloc_batch_ctx(struct cogkern_ctx *ctx, enum atom_type type,
+                             const char *const *names, size_t count, atom_handle_t *out);
+int cog_link_create_batch_ctx(struct cogkern_ctx *ctx, enum atom_type type,
+                              const atom_handle_t *outgoing, size_t arity, size_t count,
+                              atom_handle_t *out);
+int cog_atom_remove_ctx(struct cogkern_ctx *ctx, atom_handle_t atom);
+int cog_atom_valid_ctx(struct cogkern_ctx *ctx, atom_handle_t atom);
+size_t cog_atom_type_count_ctx(struct cogkern_ctx *ctx, enum atom_type type);
+void cog_atom_iter_init_ctx(struct cogkern_ctx *ctx, struct cog_atom_iter *it,
+                            enum atom_type type);
+size_t cog_atom_iter_next_ctx(struct cogkern_ctx *ctx, struct cog_atom_iter *it,
+                              atom_handle_t *out, size_t max);
+int cog_atom_reorder_ctx(struct cogkern_ctx *ctx, enum cog_reorder_method method);
+int cog_adjacency_pack_ctx(struct cogkern_ctx *ctx);
+int cog_values_compact_ctx(struct cogkern_ctx *ctx, int enable);
+int cog_values_compact_get_ctx(struct cogkern_ctx *ctx);
+int cog_traverse_ctx(struct cogkern_ctx *ctx, atom_handle_t start,
+                     const struct cog_traverse_params *params, atom_handle_t *out,
+                     uint32_t *hops, size_t max, struct cog_traverse_stats *stats);
+int cog_tier_open_ctx(struct cogkern_ctx *ctx, const char *path, size_t segment_size);
+int cog_tier_close_ctx(struct cogkern_ctx *ctx);
+int cog_tier_set_params_ctx(struct cogkern_ctx *ctx, const struct cog_tier_params *params);
+int cog_tier_page_out_ctx(struct cogkern_ctx *ctx, atom_handle_t atom);
+int cog_tier_get_stats_ctx(struct cogkern_ctx *ctx, struct cog_tier_stats *stats);
+int cog_snapshot_begin_ctx(struct cogkern_ctx *ctx);
+void cog_snapshot_end_ctx(struct cogkern_ctx *ctx);
+int cog_import_file_ctx(struct cogkern_ctx *ctx, const char *path, uint32_t threads,
+                        struct cog_import_stats *stats);
+
+int dtesn_sched_init_ctx(struct cogkern_ctx *ctx, uint32_t tick_interval_us);
+int dtesn_sched_tick_ctx(struct cogkern_ctx *ctx);
+int dtesn_sched_set_av_ctx(struct cogkern_ctx *ctx, atom_handle_t atom,
+                           const struct attention_value *av);
+int dtesn_sched_set_av_batch_ctx(struct cogkern_ctx *ctx, const atom_handle_t *atoms,
+                                 const struct attention_value *avs, size_t count);
+int dtesn_sched_get_av_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, struct attention_value *av);
+int dtesn_sched_set_forgetting_ctx(struct cogkern_ctx *ctx,
+                                   const struct ecan_forget_params *params);
+int dtesn_sched_get_forget_stats_ctx(struct cogkern_ctx *ctx, struct ecan_forget_stats *stats);
+int dtesn_sched_spread_importance_ctx(struct cogkern_ctx *ctx, atom_handle_t source,
+                                      float diffusion_rate);
+int dtesn_sched_set_workers_ctx(struct cogkern_ctx *ctx, uint32_t workers);
+int dtesn_sched_submit_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, dtesn_task_fn fn,
+                           void *arg);
+int dtesn_sched_get_stats_ctx(struct cogkern_ctx *ctx, struct dtesn_sched_stats *stats);
+
+int pln_eval_tensor_ctx(struct cogkern_ctx *ctx, struct ggml_tensor *expr,
+                        struct truth_value *result);
+int pln_unify_graph_ctx(struct cogkern_ctx *ctx, struct ggml_tensor *pattern,
+                        struct ggml_tensor *target, struct ggml_tensor **result);
+int pln_infer_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, struct truth_value *tv);
+int pln_set_tv_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, const struct truth_value *tv);
+int pln_set_tv_batch_ctx(struct cogkern_ctx *ctx, const atom_handle_t *atoms,
+                         const struct truth_value *tvs, size_t count);
+atom_handle_t cog_link_infer_ctx(struct cogkern_ctx *ctx, atom_handle_t premise,
+                                 atom_handle_t conclusion, const struct truth_value *tv);
+
+int cog_embed_init_ctx(struct cogkern_ctx *ctx, uint32_t dim, enum cog_embed_format format);
+int cog_embed_set_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, const float *vec);
+int cog_embed_get_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, float *vec);
+int cog_embed_remove_ctx(struct cogkern_ctx *ctx, atom_handle_t atom);
+int cog_embed_index_build_ctx(struct cogkern_ctx *ctx, uint32_t lists);
+int cog_embed_search_ctx(struct cogkern_ctx *ctx, const float *query, size_t k, uint32_t probes,
+                         struct cog_embed_match *out);
+int cog_embed_link_similar_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, size_t k,
+                               uint32_t probes, float min_score, float confidence);
+int cog_similarity_discover_ctx(struct cogkern_ctx *ctx,
+                                const struct cog_similarity_params *params,
+                                struct cog_similarity_stats *stats);
+
+int cogloop_boot_stage_ctx(struct cogkern_ctx *ctx, enum boot_stage stage);
+int stage1_init_hypergraph_fs_ctx(struct cogkern_ctx *ctx);
+int dtesn_mem_set_flags_ctx(struct cogkern_ctx *ctx, uint32_t flags);
+int dtesn_mem_init_regions_ctx(struct cogkern_ctx *ctx, size_t num_regions);
+int dtesn_mem_get_stats_ctx(struct cogkern_ctx *ctx, struct dtesn_mem_stats *stats);
+int cog_event_queue_init_ctx(struct cogkern_ctx *ctx, size_t capacity, uint32_t drain_batch);
+int cog_event_post_ctx(struct cogkern_ctx *ctx, const struct cog_event *event);
+int cog_event_get_stats_ctx(struct cogkern_ctx *ctx, struct cog_event_stats *stats);
+int cogloop_set_pipeline_ctx(struct cogkern_ctx *ctx, const struct cogloop_pipeline_params *params);
+int cogloop_get_stats_ctx(struct cogkern_ctx *ctx, struct cogloop_stats *stats);
+int cogloop_tick_ctx(struct cogkern_ctx *ctx);
+int cogloop_start_ctx(struct cogkern_ctx *ctx, uint32_t hz);
+void cogloop_stop_ctx(struct cogkern_ctx *ctx);
+
+int cogkern_stats_ctx(struct cogkern_ctx *ctx, struct cogkern_stats *stats);
+int cogkern_stats_write_ctx(struct cogkern_ctx *ctx, const char *path);
+int cogkern_stats_dump_every_ctx(struct cogkern_ctx *ctx, const char *path, uint32_t ticks);
+
+/** @} */
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,19 +1,72 @@
 /**
  * @file atomspace.c
  * @brief AtomSpace - Hypergraph Tensor Allocator Implementation
- * 
+ *
  * Implements hypergraph-based memory allocation and atom management
  * using GGML tensors as the underlying storage mechanism.
+ *
+ * Atoms and edges live in slot tables. A handle is the slot index plus
+ * one in its low 32 bits and the slot's generation in its high 32 bits;
+ * removing an atom or edge bumps the generation and pushes the slot on a
+ * free list, so stale handles are rejected in O(1) and slots are reused.
+ *
+ * cog_atom_reorder() permutes the atom table (and the attention and truth
+ * value tables indexed like it) so that connected atoms sit close
+ * together. Handles keep their index, which from then on is translated to
+ * the atom's slot through slot_map.
+ *
+ * A link stores its outgoing set inline as one ordered array of handles;
+ * edge records are only created by hgfs_edge(). Every atom keeps an
+ * incidence list with the slots of the edges touching it and of the links
+ * whose outgoing set holds it, so that removal can cascade without
+ * scanning the tables and atomspace_neighbors() still presents each link
+ * membership as an edge.
+ *
+ * cog_adjacency_pack() moves the outgoing sets and incidence lists of
+ * the atoms in memory into one shared byte block. An atom's entry there
+ * holds its member handles as zigzag varint deltas of their indices,
+ * starting from its own, followed by its incidence entries sorted and
+ * delta varint encoded. Reads decode the block in place and incidence
+ * removal edits it in place; any other change unpacks the atom to arena
+ * arrays first, leaving its old bytes dead until the next pack.
+ *
+ * Each atom type has a dense posting list of the slots holding live atoms
+ * of that type. Removal swaps the last entry into the freed position, so
+ * enumerating a type costs O(matches).
+ *
+ * When the out-of-core tier is open, a cold atom keeps its slot, handle,
+ * type, outgoing set and edges in memory while its name, incidence list,
+ * attention and truth value live in a segment record. atomspace_resolve()
+ * faults such atoms back in, so every handle-taking API sees them as
+ * ordinary atoms; removal edits the record in place instead.
  */
 
-#include "cogkern.h"
+#include "cogkern_internal.h"
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /**
  * Maximum number of atoms in the AtomSpace
+ *
+ * Tables grow with the memory budget, so this only keeps slots (and the
+ * low half of handles) within 32 bits, below SLOT_NONE.
  */
-#define MAX_ATOMS 1000000
+#define MAX_ATOMS ((size_t)1 << 31)
+
+/* Packed incidence keys shift a slot left by one */
+_Static_assert(MAX_ATOMS <= (size_t)1 << 31, "slots must fit in 31 bits");
+
+/**
+ * End-of-list marker for slot free lists
+ */
+#define SLOT_NONE UINT32_MAX
+
+/**
+ * Incidence entry flag: the entry is the slot of a link whose outgoing set
+ * holds the atom rather than an edge slot
+ */
+#define INCIDENT_LINK 0x80000000u
 
 /**
  * Atom structure
@@ -21,10 +74,21 @@
 struct atom {
     atom_handle_t handle;
     enum atom_type type;
+    int cold;                /**< Payload lives in the out-of-core tier */
     char *name;
     struct ggml_tensor *tensor;
     uint32_t depth;
     int active;
+    uint32_t arity;          /**< Outgoing set size (0 for nodes) */
+    uint32_t next_free;      /**< Free list link while the slot is unused */
+    atom_handle_t *outgoing; /**< Outgoing set in order, arity handles */
+    uint32_t *incident;      /**< Edge slots and INCIDENT_LINK link slots */
+    uint32_t incident_count;
+    uint32_t incident_cap;
+    uint32_t type_pos;       /**< Position in its type's posting list */
+    uint32_t packed;         /**< 1 + offset of its packed adjacency, 0 if unpacked */
+    uint64_t tier_offset;    /**< Segment record offset while cold */
+    uint64_t born;           /**< Snapshot epoch of the allocation, 0 while free */
 };
 
 /**
@@ -35,124 +99,2161 @@ struct edge {
     atom_handle_t to;
     enum atom_type type;
     int active;
+    uint32_t generation;     /**< Bumped each time the slot is freed */
+    uint32_t next_free;      /**< Free list link while the slot is unused */
+};
+
+/**
+ * AtomSpace state
+ *
+ * The atom and edge tables grow on demand from the kernel memory regions.
+ */
+struct atomspace_state {
+    struct atom *atoms;
+    struct edge *edges;
+    size_t atom_capacity;
+    size_t edge_capacity;
+    size_t atom_slots;       /**< Slots ever used (table high-water mark) */
+    size_t edge_slots;
+    size_t atom_count;       /**< Live atoms */
+    size_t edge_count;       /**< Live edges */
+    size_t link_count;       /**< Live atoms with an outgoing set */
+    size_t member_count;     /**< Handles held in outgoing sets */
+    uint32_t atom_free;      /**< Head of the atom slot free list */
+    uint32_t edge_free;      /**< Head of the edge slot free list */
+    size_t cold_count;       /**< Atoms paged out to the tier */
+    uint64_t lookups;        /**< atomspace_resolve() calls that succeeded */
+    uint32_t *type_slots[ATOM_TYPE_COUNT]; /**< Posting list of each atom type */
+    size_t type_count[ATOM_TYPE_COUNT];
+    size_t type_capacity[ATOM_TYPE_COUNT];
+    uint32_t *slot_map;      /**< Slot of each handle index, NULL until reordered */
+    size_t map_capacity;
+    uint8_t *pack;           /**< Packed adjacency of frozen atoms */
+    size_t pack_capacity;
+    size_t pack_size;        /**< Bytes written by the last cog_adjacency_pack() */
+    size_t pack_dead;        /**< Bytes no longer referenced by any atom */
+    size_t packed_count;     /**< Atoms whose adjacency is packed */
 };
 
 /**
- * AtomSpace global state
- */
-static struct {
-    struct atom atoms[MAX_ATOMS];
-    struct edge edges[MAX_ATOMS];
-    atom_handle_t next_handle;
-    size_t atom_count;
-    size_t edge_count;
-} g_atomspace = {0};
-
-/**
- * Allocate a hypergraph node as a GGML tensor
- * 
- * @param size Size in bytes
- * @param depth Membrane depth (OEIS A000081)
- * @return Pointer to allocated memory or NULL on failure
- */
-void *hgfs_alloc(size_t size, uint32_t depth) {
-    /* In a real implementation with GGML:
-     * struct ggml_context *ctx = cogkern_get_context();
-     * if (!ctx) return NULL;
-     * 
-     * struct ggml_tensor *t = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, size / 4);
-     * if (!t) return NULL;
-     * 
-     * // Store depth as metadata
-     * t->op_params[0] = depth;
-     * 
-     * // Register in hypergraph
-     * register_hypergraph_node(t, depth);
-     * 
-     * return (void *)t->data;
-     */
-    
-    /* Stub implementation */
-    void *mem = malloc(size);
-    if (mem) {
-        memset(mem, 0, size);
-    }
-    return mem;
+ * AtomSpace state of the default context
+ */
+struct atomspace_state atomspace_default = {.atom_free = SLOT_NONE, .edge_free = SLOT_NONE};
+
+/**
+ * AtomSpace state of the calling thread's context
+ */
+#define g_atomspace (*cogkern_ctx_current()->atomspace)
+
+/**
+ * Allocate AtomSpace state for a new context
+ */
+struct atomspace_state *atomspace_state_create(void) {
+    struct atomspace_state *state = cogkern_state_alloc(sizeof(*state));
+
+    if (state) {
+        state->atom_free = SLOT_NONE;
+        state->edge_free = SLOT_NONE;
+    }
+    return state;
+}
+
+/**
+ * Slot of the atom a handle index currently names
+ *
+ * The handle need not be live, but its index must be below atom_slots.
+ */
+static inline uint32_t atom_slot_of(atom_handle_t atom) {
+    uint32_t index = COG_HANDLE_SLOT(atom);
+
+    return g_atomspace.slot_map ? g_atomspace.slot_map[index] : index;
+}
+
+/**
+ * Grow the handle index map, if the atoms were ever reordered
+ *
+ * Must be called inside a write section.
+ */
+static int atom_map_reserve(size_t needed) {
+    if (!g_atomspace.slot_map) {
+        return 0;
+    }
+    return snap_table_reserve((void **)&g_atomspace.slot_map, &g_atomspace.map_capacity,
+                              sizeof(uint32_t), needed);
+}
+
+/**
+ * Find the slot of a live atom handle without faulting it in
+ */
+int atomspace_lookup(atom_handle_t atom, uint32_t *slot) {
+    uint32_t lo = (uint32_t)atom;
+
+    if (lo == 0 || lo > g_atomspace.atom_slots) {
+        return -1;
+    }
+
+    uint32_t s = atom_slot_of(atom);
+    const struct atom *a = &g_atomspace.atoms[s];
+    if (!a->active || a->handle != atom) {
+        return -1; /* Removed, or slot reused by a newer generation */
+    }
+
+    *slot = s;
+    return 0;
+}
+
+/**
+ * Find the slot of an atom visible to a snapshot epoch
+ *
+ * Reads only fields the writer publishes atomically: the slot count, the
+ * table bases, the handle index map and each atom's handle and birth epoch.
+ */
+int atomspace_snapshot_lookup(atom_handle_t atom, uint64_t epoch, uint32_t *slot) {
+    uint32_t lo = (uint32_t)atom;
+
+    if (lo == 0 || lo > __atomic_load_n(&g_atomspace.atom_slots, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+
+    const uint32_t *map = __atomic_load_n(&g_atomspace.slot_map, __ATOMIC_ACQUIRE);
+    uint32_t s = map ? __atomic_load_n(&map[lo - 1], __ATOMIC_RELAXED) : lo - 1;
+    const struct atom *atoms = __atomic_load_n(&g_atomspace.atoms, __ATOMIC_ACQUIRE);
+    uint64_t born = __atomic_load_n(&atoms[s].born, __ATOMIC_ACQUIRE);
+    if (born == 0 || born > epoch ||
+        __atomic_load_n(&atoms[s].handle, __ATOMIC_RELAXED) != atom) {
+        return -1; /* Created after the snapshot, removed, or reused */
+    }
+
+    *slot = s;
+    return 0;
+}
+
+/**
+ * Resolve a live atom handle to its table slot
+ *
+ * Cold atoms are faulted back in, so the caller may touch their payload.
+ */
+int atomspace_resolve(atom_handle_t atom, uint32_t *slot) {
+    if (atomspace_lookup(atom, slot) != 0) {
+        return -1;
+    }
+
+    g_atomspace.lookups++;
+    if (g_atomspace.atoms[*slot].cold) {
+        COG_TRACE_BEGIN(span);
+        int rc = atomspace_fault_in(*slot);
+        COG_TRACE_END(span, "tier_fault_in");
+        if (rc != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Resolve a batch of live atom handles to their table slots
+ */
+size_t atomspace_resolve_batch(const atom_handle_t *atoms, size_t count, uint32_t *slots) {
+    size_t end = 0;
+    uint64_t found = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t slot;
+
+        slots[i] = SLOT_NONE;
+        if (atomspace_lookup(atoms[i], &slot) != 0 ||
+            (g_atomspace.atoms[slot].cold && atomspace_fault_in(slot) != 0)) {
+            continue;
+        }
+        slots[i] = slot;
+        found++;
+        if (slot >= end) {
+            end = (size_t)slot + 1;
+        }
+    }
+
+    g_atomspace.lookups += found;
+    return end;
+}
+
+/**
+ * Number of atom slots ever used (live or free)
+ */
+size_t atomspace_slots(void) {
+    return g_atomspace.atom_slots;
+}
+
+/**
+ * Number of live atoms
+ */
+size_t atomspace_count(void) {
+    return g_atomspace.atom_count;
+}
+
+/**
+ * Handle of the live atom in a slot, or 0 if the slot is free
+ */
+atom_handle_t atomspace_handle_at(uint32_t slot) {
+    if (slot >= g_atomspace.atom_slots || !g_atomspace.atoms[slot].active) {
+        return 0;
+    }
+    return g_atomspace.atoms[slot].handle;
+}
+
+/**
+ * Handle lookups served by atomspace_resolve() since startup
+ */
+uint64_t atomspace_lookups(void) {
+    return g_atomspace.lookups;
+}
+
+/**
+ * Whether the atom in a slot currently lives in the out-of-core tier
+ */
+int atomspace_is_cold(uint32_t slot) {
+    return slot < g_atomspace.atom_slots && g_atomspace.atoms[slot].active &&
+           g_atomspace.atoms[slot].cold;
+}
+
+/**
+ * Number of atoms currently in the out-of-core tier
+ */
+size_t atomspace_cold_count(void) {
+    return g_atomspace.cold_count;
+}
+
+/**
+ * Incidence list of an atom, in memory or in its segment record
+ *
+ * @param a Atom
+ * @param count Pointer to receive the address of the list length
+ * @return First element of the list
+ */
+static uint32_t *atom_incidence(struct atom *a, uint32_t **count) {
+    if (a->cold) {
+        struct tier_record *r = tier_record_ptr(a->tier_offset);
+        *count = &r->incident_count;
+        return (uint32_t *)(r + 1);
+    }
+
+    *count = &a->incident_count;
+    return a->incident;
+}
+
+/**
+ * Read one varint from the packed adjacency
+ */
+static inline uint32_t pack_get(const uint8_t **p) {
+    const uint8_t *q = *p;
+    uint32_t v = *q++;
+
+    if (v >= 0x80) {
+        v &= 0x7f;
+        for (int shift = 7;; shift += 7) {
+            uint32_t b = *q++;
+            v |= (b & 0x7f) << shift;
+            if (b < 0x80) {
+                break;
+            }
+        }
+    }
+
+    *p = q;
+    return v;
+}
+
+/**
+ * Write one varint, returning the byte after it
+ */
+static uint8_t *pack_put(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+/**
+ * Step over a number of varints
+ */
+static const uint8_t *pack_skip(const uint8_t *p, uint32_t n) {
+    while (n > 0) {
+        if (*p++ < 0x80) {
+            n--;
+        }
+    }
+    return p;
+}
+
+/**
+ * Map a signed delta to an unsigned one with small magnitudes kept small
+ */
+static inline uint32_t pack_zigzag(uint32_t delta) {
+    return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+/**
+ * Inverse of pack_zigzag()
+ */
+static inline uint32_t pack_unzigzag(uint32_t z) {
+    return (z >> 1) ^ -(z & 1);
+}
+
+/**
+ * Largest zigzag member delta a packed outgoing set can hold
+ *
+ * The delta gives up its top bit to the generation flag.
+ */
+#define PACK_DELTA_MAX (UINT32_MAX >> 1)
+
+/**
+ * Start of the packed adjacency of an atom
+ */
+static inline const uint8_t *atom_pack(const struct atom *a) {
+    return g_atomspace.pack + a->packed - 1;
+}
+
+/**
+ * Decode the member handle following prev in a packed outgoing set
+ *
+ * Members are stored by handle, not slot, so decoding needs no table
+ * lookup: the zigzag index delta is shifted left by one, with the low bit
+ * set when a nonzero generation follows as a second varint.
+ */
+static inline atom_handle_t pack_member(const uint8_t **p, atom_handle_t prev) {
+    uint32_t z = pack_get(p);
+    uint32_t index = COG_HANDLE_SLOT(prev) + pack_unzigzag(z >> 1);
+
+    return COG_HANDLE_MAKE(index, (z & 1) ? pack_get(p) : 0);
+}
+
+/**
+ * Decode the next packed incidence entry
+ *
+ * Entries are sorted by key, the entry value shifted left by one with the
+ * INCIDENT_LINK flag in the low bit. The first key is stored as a zigzag
+ * delta from the atom's own slot (shifted likewise), later ones as deltas
+ * from their predecessor.
+ *
+ * @param key Previous key, or the atom's slot shifted left by one
+ * @param i Position of the entry
+ */
+static inline uint32_t pack_entry(const uint8_t **p, uint32_t *key, uint32_t i) {
+    uint32_t v = pack_get(p);
+
+    *key += i == 0 ? pack_unzigzag(v) : v;
+    return (*key >> 1) | (*key << 31);
+}
+
+/**
+ * Decode a packed outgoing set
+ *
+ * @param out Array to receive up to max member handles
+ * @return First byte of the atom's packed incidence entries
+ */
+static const uint8_t *pack_outgoing(const struct atom *a, atom_handle_t *out, size_t max) {
+    const uint8_t *p = atom_pack(a);
+    atom_handle_t member = a->handle;
+
+    for (uint32_t k = 0; k < a->arity; k++) {
+        member = pack_member(&p, member);
+        if (k < max) {
+            out[k] = member;
+        }
+    }
+    return p;
+}
+
+/**
+ * First byte of an atom's packed incidence entries
+ */
+static const uint8_t *pack_incidence(const struct atom *a) {
+    return pack_outgoing(a, NULL, 0);
+}
+
+/**
+ * Account for an atom's packed bytes going dead
+ *
+ * The block is freed once no atom references it.
+ */
+static void pack_drop(size_t bytes) {
+    g_atomspace.pack_dead += bytes;
+    if (--g_atomspace.packed_count == 0) {
+        cogkern_table_free((void **)&g_atomspace.pack, &g_atomspace.pack_capacity, 1);
+        g_atomspace.pack_size = 0;
+        g_atomspace.pack_dead = 0;
+    }
+}
+
+/**
+ * Move a packed atom's adjacency back into arena arrays
+ *
+ * @return 0 on success, negative if the arrays could not be allocated
+ */
+static int atom_unpack(struct atom *a) {
+    atom_handle_t *set = NULL;
+    uint32_t *list = NULL;
+    uint32_t cap = 0;
+
+    if (a->arity > 0) {
+        set = hgfs_alloc(a->arity * sizeof(atom_handle_t), 0);
+        if (!set) {
+            return -1;
+        }
+    }
+    if (a->incident_count > 0) {
+        cap = 4;
+        while (cap < a->incident_count) {
+            cap *= 2;
+        }
+        list = hgfs_alloc(cap * sizeof(uint32_t), a->depth);
+        if (!list) {
+            hgfs_free(set);
+            return -1;
+        }
+    }
+
+    const uint8_t *p = pack_outgoing(a, set, a->arity);
+    uint32_t key = (uint32_t)(a - g_atomspace.atoms) << 1;
+    for (uint32_t i = 0; i < a->incident_count; i++) {
+        list[i] = pack_entry(&p, &key, i);
+    }
+
+    size_t bytes = (size_t)(p - atom_pack(a));
+    a->outgoing = set;
+    a->incident = list;
+    a->incident_cap = cap;
+    a->packed = 0;
+    pack_drop(bytes);
+    return 0;
+}
+
+/**
+ * Remove one occurrence of an entry from a packed incidence list in place
+ *
+ * The deltas on either side of the entry merge into one varint, which
+ * never takes more bytes than the two it replaces; the rest of the atom's
+ * bytes shift down and the freed tail goes dead.
+ */
+static void pack_incident_del(struct atom *a, uint32_t entry) {
+    uint8_t *base = g_atomspace.pack;
+    const uint8_t *p = pack_incidence(a);
+    uint32_t first = (uint32_t)(a - g_atomspace.atoms) << 1;
+    uint32_t key = first;
+
+    for (uint32_t i = 0; i < a->incident_count; i++) {
+        uint8_t *at = base + (p - base);
+        uint32_t prev = key;
+        if (pack_entry(&p, &key, i) != entry) {
+            continue;
+        }
+
+        const uint8_t *rest = p;
+        uint8_t *write = at;
+        uint32_t left = a->incident_count - i - 1;
+        if (left > 0) {
+            uint32_t next = key;
+            pack_entry(&rest, &next, i + 1);
+            write = pack_put(at, i == 0 ? pack_zigzag(next - first) : next - prev);
+            left--;
+        }
+        const uint8_t *end = pack_skip(rest, left);
+        memmove(write, rest, (size_t)(end - rest));
+        g_atomspace.pack_dead += (size_t)(rest - write);
+        a->incident_count--;
+        return;
+    }
+}
+
+/**
+ * Append an edge slot or INCIDENT_LINK entry to an atom's incidence list
+ */
+static int atom_incident_add(struct atom *a, uint32_t entry) {
+    if (a->packed && atom_unpack(a) != 0) {
+        return -1;
+    }
+    if (a->incident_count == a->incident_cap) {
+        uint32_t cap = a->incident_cap ? a->incident_cap * 2 : 4;
+        uint32_t *list = hgfs_alloc(cap * sizeof(uint32_t), a->depth);
+        if (!list) {
+            return -1;
+        }
+
+        if (a->incident) {
+            memcpy(list, a->incident, a->incident_count * sizeof(uint32_t));
+            hgfs_free(a->incident);
+        }
+        a->incident = list;
+        a->incident_cap = cap;
+    }
+
+    a->incident[a->incident_count++] = entry;
+    return 0;
+}
+
+/**
+ * Remove one occurrence of an entry from an atom's incidence list
+ *
+ * The remaining entries keep their order, so neighbours and incoming
+ * links are reported in creation order.
+ */
+static void atom_incident_del(struct atom *a, uint32_t entry) {
+    if (a->packed) {
+        pack_incident_del(a, entry);
+        return;
+    }
+
+    uint32_t *count;
+    uint32_t *list = atom_incidence(a, &count);
+
+    for (uint32_t i = 0; i < *count; i++) {
+        if (list[i] == entry) {
+            memmove(&list[i], &list[i + 1], (*count - i - 1) * sizeof(uint32_t));
+            --*count;
+            return;
+        }
+    }
+}
+
+/**
+ * Return an edge slot to the free list
+ */
+static void edge_release(uint32_t slot) {
+    struct edge *e = &g_atomspace.edges[slot];
+
+    e->active = 0;
+    e->generation++;
+    e->next_free = g_atomspace.edge_free;
+    g_atomspace.edge_free = slot;
+    g_atomspace.edge_count--;
+}
+
+/**
+ * Detach an edge from both endpoints and release it
+ */
+static void edge_unlink(uint32_t slot) {
+    struct edge *e = &g_atomspace.edges[slot];
+
+    atom_incident_del(&g_atomspace.atoms[atom_slot_of(e->from)], slot);
+    atom_incident_del(&g_atomspace.atoms[atom_slot_of(e->to)], slot);
+    edge_release(slot);
 }
 
 /**
  * Create a hypergraph edge connecting atoms
- * 
+ *
  * @param from Source atom handle
  * @param to Destination atom handle
  * @param edge_type Type of the edge
  * @return Edge handle or 0 on failure
  */
 atom_handle_t hgfs_edge(atom_handle_t from, atom_handle_t to, enum atom_type edge_type) {
-    if (g_atomspace.edge_count >= MAX_ATOMS) {
+    uint32_t from_slot, to_slot;
+    if (atomspace_resolve(from, &from_slot) != 0 || atomspace_resolve(to, &to_slot) != 0) {
+        return 0;
+    }
+
+    uint32_t slot = g_atomspace.edge_free;
+    if (slot != SLOT_NONE) {
+        g_atomspace.edge_free = g_atomspace.edges[slot].next_free;
+    } else {
+        if (g_atomspace.edge_slots >= MAX_ATOMS) {
+            return 0;
+        }
+        if (cogkern_table_reserve((void **)&g_atomspace.edges, &g_atomspace.edge_capacity,
+                                  sizeof(struct edge), g_atomspace.edge_slots + 1) != 0) {
+            dtesn_mem_pressure_raise();
+            return 0;
+        }
+        slot = (uint32_t)g_atomspace.edge_slots++;
+    }
+
+    struct edge *e = &g_atomspace.edges[slot];
+    e->from = from;
+    e->to = to;
+    e->type = edge_type;
+    e->active = 1;
+    g_atomspace.edge_count++;
+
+    struct atom *src = &g_atomspace.atoms[from_slot];
+    struct atom *dst = &g_atomspace.atoms[to_slot];
+    if (atom_incident_add(src, slot) != 0) {
+        edge_release(slot);
         return 0;
     }
-    
-    size_t idx = g_atomspace.edge_count++;
-    g_atomspace.edges[idx].from = from;
-    g_atomspace.edges[idx].to = to;
-    g_atomspace.edges[idx].type = edge_type;
-    g_atomspace.edges[idx].active = 1;
-    
-    return (atom_handle_t)(idx + 1);
+    if (atom_incident_add(dst, slot) != 0) {
+        atom_incident_del(src, slot);
+        edge_release(slot);
+        return 0;
+    }
+
+    return COG_HANDLE_MAKE(slot, e->generation);
 }
 
 /**
- * Allocate an atom in the AtomSpace
- * 
- * @param type Atom type
- * @param name Atom name (can be NULL for links)
- * @return Atom handle or 0 on failure
+ * Remove a hypergraph edge
+ *
+ * @param edge Edge handle returned by hgfs_edge()
+ * @return 0 on success, negative on error
  */
-atom_handle_t cog_atom_alloc(enum atom_type type, const char *name) {
-    if (g_atomspace.atom_count >= MAX_ATOMS) {
+int hgfs_edge_remove(atom_handle_t edge) {
+    uint32_t lo = (uint32_t)edge;
+
+    if (lo == 0 || lo > g_atomspace.edge_slots) {
+        return -1;
+    }
+
+    const struct edge *e = &g_atomspace.edges[lo - 1];
+    if (!e->active || e->generation != COG_HANDLE_GEN(edge)) {
+        return -1;
+    }
+
+    edge_unlink(lo - 1);
+    return 0;
+}
+
+/**
+ * Make room for atoms about to join a type's posting list
+ *
+ * Types outside enum atom_type are not indexed and need no room.
+ */
+static int type_reserve(enum atom_type type, size_t extra) {
+    if ((unsigned)type >= ATOM_TYPE_COUNT) {
         return 0;
     }
-    
-    size_t idx = g_atomspace.atom_count++;
-    struct atom *a = &g_atomspace.atoms[idx];
-    
-    a->handle = ++g_atomspace.next_handle;
+    return cogkern_table_reserve((void **)&g_atomspace.type_slots[type],
+                                 &g_atomspace.type_capacity[type], sizeof(uint32_t),
+                                 g_atomspace.type_count[type] + extra);
+}
+
+/**
+ * Append a slot to its type's posting list, reserved with type_reserve()
+ */
+static void type_add(uint32_t slot) {
+    struct atom *a = &g_atomspace.atoms[slot];
+
+    if ((unsigned)a->type < ATOM_TYPE_COUNT) {
+        a->type_pos = (uint32_t)g_atomspace.type_count[a->type]++;
+        g_atomspace.type_slots[a->type][a->type_pos] = slot;
+    }
+}
+
+/**
+ * Drop a slot from its type's posting list, moving the last entry into its place
+ */
+static void type_del(uint32_t slot) {
+    const struct atom *a = &g_atomspace.atoms[slot];
+
+    if ((unsigned)a->type < ATOM_TYPE_COUNT) {
+        uint32_t *list = g_atomspace.type_slots[a->type];
+        uint32_t last = list[--g_atomspace.type_count[a->type]];
+
+        list[a->type_pos] = last;
+        g_atomspace.atoms[last].type_pos = a->type_pos;
+    }
+}
+
+/**
+ * Initialize a freshly allocated atom slot and publish it to snapshots
+ *
+ * The slot's handle already carries its current generation, and its
+ * type's posting list has room reserved with type_reserve().
+ */
+static void atom_fill(struct atom *a, enum atom_type type, char *name) {
     a->type = type;
     a->depth = 0;
     a->active = 1;
-    
-    if (name) {
-        a->name = strdup(name);
-    } else {
-        a->name = NULL;
-    }
-    
+    a->arity = 0;
+    a->name = name;
+    a->outgoing = NULL;
+    a->incident = NULL;
+    a->incident_count = 0;
+    a->incident_cap = 0;
+    a->packed = 0;
+    a->cold = 0;
+    type_add((uint32_t)(a - g_atomspace.atoms));
+
     /* In a real implementation, allocate GGML tensor for atom data */
     a->tensor = NULL;
-    
-    return a->handle;
+
+    /* Publish to snapshots pinned from now on */
+    __atomic_store_n(&a->born, snap_write_epoch(), __ATOMIC_RELEASE);
 }
 
 /**
- * Create a link between atoms
- * 
- * @param type Link type
- * @param outgoing Array of outgoing atom handles
- * @param outgoing_count Number of outgoing atoms
- * @return Link handle or 0 on failure
+ * Reserve table space for atoms and edges about to be created
  */
-atom_handle_t cog_link_create(enum atom_type type, const atom_handle_t *outgoing, 
-                               size_t outgoing_count) {
-    atom_handle_t link = cog_atom_alloc(type, NULL);
-    if (!link) {
-        return 0;
+int atomspace_reserve(size_t atoms, size_t edges) {
+    if (g_atomspace.atom_count + atoms > MAX_ATOMS ||
+        g_atomspace.edge_count + edges > MAX_ATOMS) {
+        return -1;
     }
-    
-    /* Create edges to all outgoing atoms */
-    for (size_t i = 0; i < outgoing_count; i++) {
-        hgfs_edge(link, outgoing[i], type);
+
+    /* Free slots are reused first, so this may reserve more than needed */
+    size_t atom_slots = g_atomspace.atom_slots + atoms;
+    size_t edge_slots = g_atomspace.edge_slots + edges;
+    if (atom_slots > MAX_ATOMS) {
+        atom_slots = MAX_ATOMS;
     }
-    
+    if (edge_slots > MAX_ATOMS) {
+        edge_slots = MAX_ATOMS;
+    }
+
+    int rc = 0;
+    snap_write_begin();
+    if (snap_table_reserve((void **)&g_atomspace.atoms, &g_atomspace.atom_capacity,
+                           sizeof(struct atom), atom_slots) != 0 ||
+        atom_map_reserve(atom_slots) != 0 ||
+        cogkern_table_reserve((void **)&g_atomspace.edges, &g_atomspace.edge_capacity,
+                              sizeof(struct edge), edge_slots) != 0) {
+        rc = -1;
+    }
+    snap_write_end();
+
+    return rc;
+}
+
+/**
+ * Allocate an atom whose name is not NUL-terminated
+ */
+atom_handle_t atomspace_alloc_named(enum atom_type type, const char *name, size_t len) {
+    char *name_copy = NULL;
+
+    if (name) {
+        name_copy = hgfs_alloc(len + 1, 0);
+        if (!name_copy) {
+            return 0;
+        }
+        memcpy(name_copy, name, len);
+        name_copy[len] = '\0';
+    }
+
+    if (type_reserve(type, 1) != 0) {
+        dtesn_mem_pressure_raise();
+        hgfs_free(name_copy);
+        return 0;
+    }
+
+    snap_write_begin();
+    uint32_t slot = g_atomspace.atom_free;
+    if (slot != SLOT_NONE) {
+        g_atomspace.atom_free = g_atomspace.atoms[slot].next_free;
+    } else {
+        if (g_atomspace.atom_slots >= MAX_ATOMS) {
+            snap_write_end();
+            hgfs_free(name_copy);
+            return 0;
+        }
+        if (snap_table_reserve((void **)&g_atomspace.atoms, &g_atomspace.atom_capacity,
+                               sizeof(struct atom), g_atomspace.atom_slots + 1) != 0 ||
+            atom_map_reserve(g_atomspace.atom_slots + 1) != 0) {
+            snap_write_end();
+            dtesn_mem_pressure_raise();
+            hgfs_free(name_copy);
+            return 0;
+        }
+        slot = (uint32_t)g_atomspace.atom_slots;
+        __atomic_store_n(&g_atomspace.atoms[slot].handle, COG_HANDLE_MAKE(slot, 0),
+                         __ATOMIC_RELAXED);
+        if (g_atomspace.slot_map) {
+            g_atomspace.slot_map[slot] = slot;
+        }
+    }
+
+    struct atom *a = &g_atomspace.atoms[slot];
+    atom_fill(a, type, name_copy);
+    if (slot == g_atomspace.atom_slots) {
+        __atomic_store_n(&g_atomspace.atom_slots, g_atomspace.atom_slots + 1, __ATOMIC_RELEASE);
+    }
+    snap_write_end();
+
+    g_atomspace.atom_count++;
+    metrics_count(METRIC_ATOMS_CREATED, 1);
+    return a->handle;
+}
+
+/**
+ * Allocate an atom in the AtomSpace
+ *
+ * @param type Atom type
+ * @param name Atom name (can be NULL for links)
+ * @return Atom handle or 0 on failure
+ */
+atom_handle_t cog_atom_alloc(enum atom_type type, const char *name) {
+    return atomspace_alloc_named(type, name, name ? strlen(name) : 0);
+}
+
+/**
+ * Create a link between atoms
+ *
+ * @param type Link type
+ * @param outgoing Array of outgoing atom handles
+ * @param outgoing_count Number of outgoing atoms
+ * @return Link handle or 0 on failure
+ */
+atom_handle_t cog_link_create(enum atom_type type, const atom_handle_t *outgoing,
+                               size_t outgoing_count) {
+    uint32_t slot;
+
+    for (size_t i = 0; i < outgoing_count; i++) {
+        if (atomspace_resolve(outgoing[i], &slot) != 0) {
+            return 0;
+        }
+    }
+
+    if (outgoing_count > MAX_ATOMS) {
+        return 0;
+    }
+
+    atom_handle_t *set = NULL;
+    if (outgoing_count > 0) {
+        set = hgfs_alloc(outgoing_count * sizeof(atom_handle_t), 0);
+        if (!set) {
+            return 0;
+        }
+        memcpy(set, outgoing, outgoing_count * sizeof(atom_handle_t));
+    }
+
+    atom_handle_t link = cog_atom_alloc(type, NULL);
+    if (!link) {
+        hgfs_free(set);
+        return 0;
+    }
+
+    uint32_t link_slot = atom_slot_of(link);
+    struct atom *a = &g_atomspace.atoms[link_slot];
+    a->arity = (uint32_t)outgoing_count;
+    a->outgoing = set;
+    if (outgoing_count > 0) {
+        g_atomspace.link_count++;
+        g_atomspace.member_count += outgoing_count;
+    }
+
+    /* Register the link with each member for incoming lookups and removal */
+    for (size_t i = 0; i < outgoing_count; i++) {
+        struct atom *member = &g_atomspace.atoms[atom_slot_of(outgoing[i])];
+        if (atom_incident_add(member, INCIDENT_LINK | link_slot) != 0) {
+            cog_atom_remove(link);
+            return 0;
+        }
+    }
+
+    metrics_count(METRIC_LINKS_CREATED, 1);
     return link;
 }
+
+/**
+ * Claim a contiguous range of never-used atom slots
+ *
+ * Must be called inside a write section; the slots stay unpublished until
+ * atom_range_publish().
+ *
+ * @return First slot of the range, or SLOT_NONE if the table is full
+ */
+static uint32_t atom_range_claim(size_t count) {
+    size_t first = g_atomspace.atom_slots;
+
+    if (count > MAX_ATOMS - first) {
+        return SLOT_NONE;
+    }
+    if (snap_table_reserve((void **)&g_atomspace.atoms, &g_atomspace.atom_capacity,
+                           sizeof(struct atom), first + count) != 0 ||
+        atom_map_reserve(first + count) != 0) {
+        dtesn_mem_pressure_raise();
+        return SLOT_NONE;
+    }
+    for (size_t i = 0; i < count; i++) {
+        __atomic_store_n(&g_atomspace.atoms[first + i].handle,
+                         COG_HANDLE_MAKE((uint32_t)(first + i), 0), __ATOMIC_RELAXED);
+        if (g_atomspace.slot_map) {
+            g_atomspace.slot_map[first + i] = (uint32_t)(first + i);
+        }
+    }
+    return (uint32_t)first;
+}
+
+/**
+ * Publish a range claimed with atom_range_claim() once its atoms are filled
+ */
+static void atom_range_publish(uint32_t first, size_t count) {
+    __atomic_store_n(&g_atomspace.atom_slots, (size_t)first + count, __ATOMIC_RELEASE);
+    g_atomspace.atom_count += count;
+    metrics_count(METRIC_ATOMS_CREATED, count);
+}
+
+/**
+ * Allocate a batch of atoms of one type
+ *
+ * @param type Atom type
+ * @param names Array of count names (NULL, or NULL entries, for unnamed atoms)
+ * @param count Number of atoms
+ * @param out Array to receive count handles
+ * @return 0 on success, negative on error (no atom is created)
+ */
+int cog_atom_alloc_batch(enum atom_type type, const char *const *names, size_t count,
+                         atom_handle_t *out) {
+    if (!out) {
+        return -1;
+    }
+
+    if (type_reserve(type, count) != 0) {
+        return -1;
+    }
+
+    /* Copy the names first so the batch cannot fail half-way */
+    char **copies = NULL;
+    if (names) {
+        copies = malloc(count * sizeof(char *));
+        if (!copies && count > 0) {
+            return -1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            copies[i] = NULL;
+            if (names[i]) {
+                size_t len = strlen(names[i]) + 1;
+                copies[i] = hgfs_alloc(len, 0);
+                if (!copies[i]) {
+                    while (i-- > 0) {
+                        hgfs_free(copies[i]);
+                    }
+                    free(copies);
+                    return -1;
+                }
+                memcpy(copies[i], names[i], len);
+            }
+        }
+    }
+
+    snap_write_begin();
+    uint32_t first = atom_range_claim(count);
+    if (first == SLOT_NONE) {
+        snap_write_end();
+        for (size_t i = 0; copies && i < count; i++) {
+            hgfs_free(copies[i]);
+        }
+        free(copies);
+        return -1;
+    }
+
+    struct atom *a = &g_atomspace.atoms[first];
+    for (size_t i = 0; i < count; i++, a++) {
+        atom_fill(a, type, copies ? copies[i] : NULL);
+        out[i] = a->handle;
+    }
+    atom_range_publish(first, count);
+    snap_write_end();
+
+    free(copies);
+    return 0;
+}
+
+/**
+ * Create a batch of links of one type and arity
+ *
+ * The links take a contiguous range of atom slots and are written in one
+ * pass together with their outgoing sets.
+ *
+ * @param type Link type
+ * @param outgoing Outgoing sets, arity handles per link, back to back
+ * @param arity Outgoing set size of every link
+ * @param count Number of links
+ * @param out Array to receive count handles
+ * @return 0 on success, negative on error (no link is created)
+ */
+int cog_link_create_batch(enum atom_type type, const atom_handle_t *outgoing, size_t arity,
+                          size_t count, atom_handle_t *out) {
+    size_t total = arity * count;
+    uint32_t slot;
+
+    if (!out || (total > 0 && !outgoing) || (count > 0 && total / count != arity) ||
+        arity > MAX_ATOMS) {
+        return -1;
+    }
+
+    /* Validate every member (faulting cold ones in) before changing anything */
+    for (size_t i = 0; i < total; i++) {
+        if (atomspace_resolve(outgoing[i], &slot) != 0) {
+            return -1;
+        }
+    }
+
+    if (type_reserve(type, count) != 0) {
+        return -1;
+    }
+
+    /* Outgoing sets of the links, allocated up front */
+    atom_handle_t **sets = malloc(count * sizeof(atom_handle_t *));
+    if (!sets && count > 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < count && arity > 0; i++) {
+        sets[i] = hgfs_alloc(arity * sizeof(atom_handle_t), 0);
+        if (!sets[i]) {
+            while (i-- > 0) {
+                hgfs_free(sets[i]);
+            }
+            free(sets);
+            return -1;
+        }
+    }
+
+    snap_write_begin();
+    uint32_t first = atom_range_claim(count);
+    if (first == SLOT_NONE) {
+        snap_write_end();
+        for (size_t i = 0; i < count && arity > 0; i++) {
+            hgfs_free(sets[i]);
+        }
+        free(sets);
+        return -1;
+    }
+
+    const atom_handle_t *members = outgoing;
+    int rc = 0;
+    for (size_t i = 0; i < count; i++, members += arity) {
+        struct atom *a = &g_atomspace.atoms[first + i];
+        uint32_t entry = INCIDENT_LINK | (uint32_t)(first + i);
+
+        atom_fill(a, type, NULL);
+        a->arity = (uint32_t)arity;
+        if (arity > 0) {
+            a->outgoing = sets[i];
+            memcpy(a->outgoing, members, arity * sizeof(atom_handle_t));
+        }
+
+        for (size_t k = 0; k < arity && rc == 0; k++) {
+            if (atom_incident_add(&g_atomspace.atoms[atom_slot_of(members[k])], entry) != 0) {
+                rc = -1; /* Undone below; removal tolerates missing entries */
+            }
+        }
+        out[i] = a->handle;
+    }
+    free(sets);
+
+    if (arity > 0) {
+        g_atomspace.link_count += count;
+        g_atomspace.member_count += total;
+    }
+    atom_range_publish(first, count);
+    snap_write_end();
+
+    if (rc != 0) {
+        for (size_t i = 0; i < count; i++) {
+            cog_atom_remove(out[i]);
+        }
+        return -1;
+    }
+
+    metrics_count(METRIC_LINKS_CREATED, count);
+    return 0;
+}
+
+/**
+ * Check whether a handle refers to a live atom
+ *
+ * @param atom Atom handle
+ * @return 1 if the atom exists, 0 otherwise
+ */
+int cog_atom_valid(atom_handle_t atom) {
+    uint32_t slot;
+    uint64_t epoch;
+
+    if (snap_pinned(&epoch)) {
+        return atomspace_snapshot_lookup(atom, epoch, &slot) == 0;
+    }
+    return atomspace_lookup(atom, &slot) == 0;
+}
+
+/**
+ * Number of live atoms of a type
+ *
+ * @param type Atom type
+ * @return Number of atoms (0 for types outside enum atom_type)
+ */
+size_t cog_atom_type_count(enum atom_type type) {
+    if ((unsigned)type >= ATOM_TYPE_COUNT) {
+        return 0;
+    }
+    return g_atomspace.type_count[type];
+}
+
+/**
+ * Start enumerating the live atoms of a type
+ *
+ * @param it Iterator to initialize
+ * @param type Atom type
+ */
+void cog_atom_iter_init(struct cog_atom_iter *it, enum atom_type type) {
+    it->type = type;
+    it->next = cog_atom_type_count(type);
+}
+
+/**
+ * Fetch the next atoms of an iterator's type
+ *
+ * The posting list is walked from its end, so removing atoms already
+ * returned never makes the iterator skip one.
+ *
+ * @param it Iterator from cog_atom_iter_init()
+ * @param out Array to receive handles
+ * @param max Capacity of out
+ * @return Number of handles stored, 0 once the type is exhausted
+ */
+size_t cog_atom_iter_next(struct cog_atom_iter *it, atom_handle_t *out, size_t max) {
+    size_t count = cog_atom_type_count(it->type);
+    size_t n = 0;
+
+    if (it->next > count) {
+        it->next = count; /* Atoms were removed behind the cursor */
+    }
+    while (n < max && it->next > 0) {
+        uint32_t slot = g_atomspace.type_slots[it->type][--it->next];
+        out[n++] = g_atomspace.atoms[slot].handle;
+    }
+
+    return n;
+}
+
+/**
+ * Remove an atom from the AtomSpace
+ *
+ * Incident edges, attention and truth values are dropped with the atom,
+ * and every link whose outgoing set contains it is removed as well.
+ *
+ * @param atom Atom handle
+ * @return 0 on success, negative on error
+ */
+int cog_atom_remove(atom_handle_t atom) {
+    uint32_t slot;
+    if (atomspace_lookup(atom, &slot) != 0) {
+        return -1;
+    }
+
+    /* Worklist of atoms being removed; marked inactive when queued */
+    uint32_t local[64];
+    uint32_t *pending = local;
+    size_t pending_cap = 64;
+    size_t pending_count = 0;
+
+    g_atomspace.atoms[slot].active = 0;
+    pending[pending_count++] = slot;
+
+    /* One write section for the whole cascade */
+    snap_write_begin();
+    while (pending_count > 0) {
+        uint32_t s = pending[--pending_count];
+        struct atom *a = &g_atomspace.atoms[s];
+        uint32_t *incident_count;
+        uint32_t *incident = atom_incidence(a, &incident_count);
+        const uint8_t *packed = a->packed ? pack_incidence(a) : NULL;
+        uint32_t key = s << 1;
+
+        /* Deletions below only edit other atoms, so a packed list stays put */
+        for (uint32_t i = 0; i < *incident_count; i++) {
+            uint32_t entry = packed ? pack_entry(&packed, &key, i) : incident[i];
+
+            /* A link that loses a member of its outgoing set goes too */
+            if (entry & INCIDENT_LINK) {
+                uint32_t other = entry & ~INCIDENT_LINK;
+                struct atom *o = &g_atomspace.atoms[other];
+
+                if (!o->active) {
+                    continue; /* Already queued through an earlier entry */
+                }
+                if (pending_count == pending_cap) {
+                    size_t cap = pending_cap * 2;
+                    uint32_t *grown = malloc(cap * sizeof(uint32_t));
+                    if (!grown) {
+                        continue; /* Keep the link; its member handle goes stale */
+                    }
+                    memcpy(grown, pending, pending_count * sizeof(uint32_t));
+                    if (pending != local) {
+                        free(pending);
+                    }
+                    pending = grown;
+                    pending_cap = cap;
+                }
+                o->active = 0;
+                pending[pending_count++] = other;
+                continue;
+            }
+
+            struct edge *e = &g_atomspace.edges[entry];
+            if (!e->active) {
+                continue; /* Self-loop already released via its first entry */
+            }
+
+            uint32_t from = atom_slot_of(e->from);
+            uint32_t other = from == s ? atom_slot_of(e->to) : from;
+            if (other != s) {
+                atom_incident_del(&g_atomspace.atoms[other], entry);
+            }
+            edge_release(entry);
+        }
+
+        /* Detach a link from its members' incidence lists */
+        const uint8_t *members = a->packed ? atom_pack(a) : NULL;
+        atom_handle_t member = a->handle;
+        for (uint32_t k = 0; k < a->arity; k++) {
+            member = members ? pack_member(&members, member) : a->outgoing[k];
+            atom_incident_del(&g_atomspace.atoms[atom_slot_of(member)], INCIDENT_LINK | s);
+        }
+        if (a->packed) {
+            size_t bytes = (size_t)(pack_skip(members, a->incident_count) - atom_pack(a));
+            a->packed = 0;
+            pack_drop(bytes);
+        }
+
+        if (a->cold) {
+            tier_record_release(a->tier_offset);
+            a->cold = 0;
+            g_atomspace.cold_count--;
+        }
+        hgfs_free(a->incident);
+        hgfs_free(a->name);
+        hgfs_free(a->outgoing);
+        a->incident = NULL;
+        a->incident_count = 0;
+        a->incident_cap = 0;
+        a->name = NULL;
+        a->outgoing = NULL;
+
+        ecan_forget_atom(s);
+        pln_forget_atom(s);
+        embed_forget_atom(a->handle);
+        type_del(s);
+
+        __atomic_store_n(&a->born, 0, __ATOMIC_RELAXED);
+        /* The slot keeps its handle index, which reordering may have moved */
+        __atomic_store_n(&a->handle, COG_HANDLE_MAKE(COG_HANDLE_SLOT(a->handle),
+                                                     COG_HANDLE_GEN(a->handle) + 1),
+                         __ATOMIC_RELAXED);
+        a->next_free = g_atomspace.atom_free;
+        g_atomspace.atom_free = s;
+        g_atomspace.atom_count--;
+        if (a->arity > 0) {
+            g_atomspace.link_count--;
+            g_atomspace.member_count -= a->arity;
+        }
+        metrics_count(METRIC_ATOMS_REMOVED, 1);
+    }
+    snap_write_end();
+
+    if (pending != local) {
+        free(pending);
+    }
+
+    return 0;
+}
+
+/**
+ * Neighbour named by an incidence entry of the atom in a slot
+ */
+static atom_handle_t atom_incident_other(uint32_t slot, uint32_t entry) {
+    if (entry & INCIDENT_LINK) {
+        return g_atomspace.atoms[entry & ~INCIDENT_LINK].handle;
+    }
+
+    const struct edge *e = &g_atomspace.edges[entry];
+    return e->from == g_atomspace.atoms[slot].handle ? e->to : e->from;
+}
+
+/**
+ * Copy the handles of the atoms sharing an edge with a live atom
+ *
+ * A link's outgoing set comes first, each member counting as one edge,
+ * followed by the edges and incoming links from the incidence list.
+ */
+size_t atomspace_neighbors(uint32_t slot, atom_handle_t *out, size_t max) {
+    struct atom *a = &g_atomspace.atoms[slot];
+    uint32_t *count;
+    uint32_t *list = atom_incidence(a, &count);
+    size_t n = a->arity + *count;
+
+    if (a->packed) {
+        const uint8_t *p = pack_outgoing(a, out, max);
+        uint32_t key = slot << 1;
+        for (size_t i = a->arity; i < n && i < max; i++) {
+            out[i] = atom_incident_other(slot, pack_entry(&p, &key, (uint32_t)(i - a->arity)));
+        }
+        return n;
+    }
+
+    atomspace_outgoing(slot, out, max);
+    for (size_t i = a->arity; i < n && i < max; i++) {
+        out[i] = atom_incident_other(slot, list[i - a->arity]);
+    }
+
+    return n;
+}
+
+/**
+ * Copy the slots of the atoms sharing an edge with a live atom
+ *
+ * Only reads the AtomSpace, so several threads may call it at once while
+ * the owning thread waits for them.
+ */
+size_t atomspace_neighbor_slots(uint32_t slot, uint32_t *out, size_t max) {
+    struct atom *a = &g_atomspace.atoms[slot];
+    uint32_t *count;
+    const uint32_t *list = atom_incidence(a, &count);
+    const uint8_t *p = a->packed ? atom_pack(a) : NULL;
+    atom_handle_t member = a->handle;
+    uint32_t key = slot << 1;
+    size_t n = a->arity + *count;
+
+    for (size_t i = 0; i < n && i < max; i++) {
+        if (i < a->arity) {
+            member = p ? pack_member(&p, member) : a->outgoing[i];
+            out[i] = atom_slot_of(member);
+            continue;
+        }
+
+        uint32_t entry = p ? pack_entry(&p, &key, (uint32_t)(i - a->arity)) : list[i - a->arity];
+        if (entry & INCIDENT_LINK) {
+            out[i] = entry & ~INCIDENT_LINK;
+        } else {
+            const struct edge *e = &g_atomspace.edges[entry];
+            out[i] = atom_slot_of(e->from == a->handle ? e->to : e->from);
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Copy the slots of the atoms a live atom is related to
+ */
+size_t atomspace_related_slots(uint32_t slot, enum atom_type skip, uint32_t *out, size_t max) {
+    struct atom *a = &g_atomspace.atoms[slot];
+    uint32_t *count;
+    const uint32_t *list = atom_incidence(a, &count);
+    const uint8_t *p = a->packed ? atom_pack(a) : NULL;
+    atom_handle_t member = a->handle;
+    uint32_t key = slot << 1;
+    size_t n = 0;
+
+    for (uint32_t i = 0; i < a->arity; i++) {
+        member = p ? pack_member(&p, member) : a->outgoing[i];
+        if (n < max) {
+            out[n] = atom_slot_of(member);
+        }
+        n++;
+    }
+
+    for (uint32_t i = 0; i < *count; i++) {
+        uint32_t entry = p ? pack_entry(&p, &key, i) : list[i];
+        if (!(entry & INCIDENT_LINK)) {
+            const struct edge *e = &g_atomspace.edges[entry];
+            if (n < max) {
+                out[n] = atom_slot_of(e->from == a->handle ? e->to : e->from);
+            }
+            n++;
+            continue;
+        }
+
+        /* The other members of a link containing the atom */
+        const struct atom *l = &g_atomspace.atoms[entry & ~INCIDENT_LINK];
+        if (l->type == skip) {
+            continue;
+        }
+        const uint8_t *members = l->packed ? atom_pack(l) : NULL;
+        atom_handle_t m = l->handle;
+        for (uint32_t k = 0; k < l->arity; k++) {
+            m = members ? pack_member(&members, m) : l->outgoing[k];
+            if (m != a->handle) {
+                if (n < max) {
+                    out[n] = atom_slot_of(m);
+                }
+                n++;
+            }
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Type of the live atom in a slot
+ */
+enum atom_type atomspace_type(uint32_t slot) {
+    return g_atomspace.atoms[slot].type;
+}
+
+/**
+ * Copy the handles of the links whose outgoing set contains an atom
+ */
+size_t atomspace_incoming(uint32_t slot, atom_handle_t *out, size_t max) {
+    struct atom *a = &g_atomspace.atoms[slot];
+    uint32_t *count;
+    uint32_t *list = atom_incidence(a, &count);
+    const uint8_t *p = a->packed ? pack_incidence(a) : NULL;
+    uint32_t key = slot << 1;
+    size_t n = 0;
+
+    for (uint32_t i = 0; i < *count; i++) {
+        uint32_t entry = p ? pack_entry(&p, &key, i) : list[i];
+        if (entry & INCIDENT_LINK) {
+            if (n < max) {
+                out[n] = g_atomspace.atoms[entry & ~INCIDENT_LINK].handle;
+            }
+            n++;
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Find a binary link of a type joining an atom to another
+ */
+atom_handle_t atomspace_find_pair(uint32_t slot, enum atom_type type, atom_handle_t other) {
+    struct atom *a = &g_atomspace.atoms[slot];
+    uint32_t *count;
+    uint32_t *list = atom_incidence(a, &count);
+    const uint8_t *p = a->packed ? pack_incidence(a) : NULL;
+    uint32_t key = slot << 1;
+
+    for (uint32_t i = 0; i < *count; i++) {
+        uint32_t entry = p ? pack_entry(&p, &key, i) : list[i];
+        if (!(entry & INCIDENT_LINK)) {
+            continue;
+        }
+
+        uint32_t link = entry & ~INCIDENT_LINK;
+        atom_handle_t pair[2];
+        if (g_atomspace.atoms[link].type == type && g_atomspace.atoms[link].arity == 2 &&
+            atomspace_outgoing(link, pair, 2) == 2 && (pair[0] == other || pair[1] == other)) {
+            return g_atomspace.atoms[link].handle;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Copy the outgoing set of a link in order
+ */
+size_t atomspace_outgoing(uint32_t slot, atom_handle_t *out, size_t max) {
+    const struct atom *a = &g_atomspace.atoms[slot];
+    size_t n = a->arity < max ? a->arity : max;
+
+    if (a->packed) {
+        pack_outgoing(a, out, max);
+    } else if (n > 0) {
+        memcpy(out, a->outgoing, n * sizeof(atom_handle_t));
+    }
+    return a->arity;
+}
+
+/**
+ * Copy the outgoing set of a link
+ *
+ * Outgoing sets stay in memory while a link is cold, so this never faults
+ * the link in.
+ *
+ * @param link Link handle
+ * @param out Array to receive the member handles in order
+ * @param max Capacity of out
+ * @return Arity of the link (0 for nodes), which may exceed max, or
+ *         negative if the handle is invalid
+ */
+int cog_link_outgoing(atom_handle_t link, atom_handle_t *out, size_t max) {
+    uint32_t slot;
+
+    if (atomspace_lookup(link, &slot) != 0 || (!out && max > 0)) {
+        return -1;
+    }
+    return (int)atomspace_outgoing(slot, out, max);
+}
+
+/**
+ * Working state of a reorder pass
+ */
+struct reorder_state {
+    uint32_t *order;         /**< Slots in their new order */
+    uint32_t *dest;          /**< New slot of each slot, SLOT_NONE until placed */
+    size_t placed;
+    uint64_t *keys;          /**< (degree << 32 | slot) sort keys */
+    size_t key_cap;
+};
+
+/**
+ * Ascending order of 64-bit sort keys
+ */
+static int reorder_key_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Number of atoms sharing a link or edge with a live atom
+ */
+static uint32_t atom_degree(struct atom *a) {
+    uint32_t *count;
+
+    atom_incidence(a, &count);
+    return a->arity + *count;
+}
+
+/**
+ * Give a slot the next position of the new order
+ */
+static void reorder_place(struct reorder_state *r, uint32_t slot) {
+    r->dest[slot] = (uint32_t)r->placed;
+    r->order[r->placed++] = slot;
+}
+
+/**
+ * Place the unplaced neighbours of an atom, lowest degree first if asked
+ *
+ * @return 0 on success, negative if the sort buffer could not grow
+ */
+static int reorder_expand(struct reorder_state *r, uint32_t slot, int by_degree) {
+    struct atom *a = &g_atomspace.atoms[slot];
+    uint32_t *count;
+    uint32_t *list = atom_incidence(a, &count);
+    size_t degree = a->arity + *count;
+    size_t n = 0;
+
+    if (by_degree && degree > r->key_cap) {
+        uint64_t *grown = realloc(r->keys, degree * sizeof(uint64_t));
+        if (!grown) {
+            return -1;
+        }
+        r->keys = grown;
+        r->key_cap = degree;
+    }
+
+    for (size_t i = 0; i < degree; i++) {
+        uint32_t other;
+        if (i < a->arity) {
+            other = atom_slot_of(a->outgoing[i]);
+        } else if (list[i - a->arity] & INCIDENT_LINK) {
+            other = list[i - a->arity] & ~INCIDENT_LINK;
+        } else {
+            const struct edge *e = &g_atomspace.edges[list[i - a->arity]];
+            other = atom_slot_of(e->from == a->handle ? e->to : e->from);
+        }
+
+        if (r->dest[other] != SLOT_NONE || !g_atomspace.atoms[other].active) {
+            continue;
+        }
+        if (by_degree) {
+            /* Mark it now so a repeated neighbour is queued once */
+            r->dest[other] = 0;
+            r->keys[n++] = (uint64_t)atom_degree(&g_atomspace.atoms[other]) << 32 | other;
+        } else {
+            reorder_place(r, other);
+        }
+    }
+
+    if (by_degree && n > 0) {
+        qsort(r->keys, n, sizeof(uint64_t), reorder_key_cmp);
+        for (size_t i = 0; i < n; i++) {
+            reorder_place(r, (uint32_t)r->keys[i]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Compute the new order of the live atoms
+ *
+ * BFS and RCM grow breadth-first trees from seeds taken in slot order and
+ * in ascending degree order respectively; RCM also visits neighbours by
+ * ascending degree and reverses the result. DEGREE puts hubs first.
+ *
+ * @return 0 on success, negative on error
+ */
+static int reorder_compute(struct reorder_state *r, enum cog_reorder_method method,
+                           uint64_t *seeds) {
+    size_t slots = g_atomspace.atom_slots;
+    size_t live = 0;
+
+    for (size_t s = 0; s < slots; s++) {
+        struct atom *a = &g_atomspace.atoms[s];
+        if (!a->active) {
+            continue;
+        }
+        uint64_t degree = atom_degree(a);
+        if (method == COG_REORDER_DEGREE) {
+            degree = UINT32_MAX - degree;
+        }
+        seeds[live++] = degree << 32 | s;
+    }
+    if (method != COG_REORDER_BFS) {
+        qsort(seeds, live, sizeof(uint64_t), reorder_key_cmp);
+    }
+
+    for (size_t i = 0; i < live; i++) {
+        uint32_t seed = (uint32_t)seeds[i];
+        if (r->dest[seed] != SLOT_NONE) {
+            continue;
+        }
+
+        size_t head = r->placed;
+        reorder_place(r, seed);
+        if (method == COG_REORDER_DEGREE) {
+            continue;
+        }
+        while (head < r->placed) {
+            if (reorder_expand(r, r->order[head++], method == COG_REORDER_RCM) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    if (method == COG_REORDER_RCM) {
+        for (size_t i = 0; i < live / 2; i++) {
+            uint32_t t = r->order[i];
+            r->order[i] = r->order[live - 1 - i];
+            r->order[live - 1 - i] = t;
+        }
+        for (size_t i = 0; i < live; i++) {
+            r->dest[r->order[i]] = (uint32_t)i;
+        }
+    }
+
+    /* Free slots go last, keeping their relative order */
+    for (size_t s = 0; s < slots; s++) {
+        if (r->dest[s] == SLOT_NONE) {
+            reorder_place(r, (uint32_t)s);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Rewrite every stored slot number after the tables were permuted
+ */
+static void reorder_remap(const uint32_t *dest, size_t slots) {
+    if (g_atomspace.atom_free != SLOT_NONE) {
+        g_atomspace.atom_free = dest[g_atomspace.atom_free];
+    }
+
+    for (size_t s = 0; s < slots; s++) {
+        struct atom *a = &g_atomspace.atoms[s];
+
+        g_atomspace.slot_map[COG_HANDLE_SLOT(a->handle)] = (uint32_t)s;
+        if (!a->active) {
+            if (a->next_free != SLOT_NONE) {
+                a->next_free = dest[a->next_free];
+            }
+            continue;
+        }
+
+        uint32_t *count;
+        uint32_t *list = atom_incidence(a, &count);
+        for (uint32_t i = 0; i < *count; i++) {
+            if (list[i] & INCIDENT_LINK) {
+                list[i] = INCIDENT_LINK | dest[list[i] & ~INCIDENT_LINK];
+            }
+        }
+    }
+
+    for (int t = 0; t < ATOM_TYPE_COUNT; t++) {
+        for (size_t i = 0; i < g_atomspace.type_count[t]; i++) {
+            g_atomspace.type_slots[t][i] = dest[g_atomspace.type_slots[t][i]];
+        }
+    }
+}
+
+/**
+ * Copy outgoing sets and incidence lists to fresh arena memory in slot order
+ *
+ * All copies are allocated before any old block is freed, so they come
+ * out of the arenas in order instead of refilling scattered holes. Atoms
+ * whose copies cannot be allocated keep their current memory.
+ */
+static void reorder_relocate(size_t slots) {
+    void **fresh = malloc(2 * slots * sizeof(void *));
+    if (!fresh) {
+        return;
+    }
+
+    size_t n = 0;
+    for (; n < slots; n++) {
+        struct atom *a = &g_atomspace.atoms[n];
+        fresh[2 * n] = NULL;
+        fresh[2 * n + 1] = NULL;
+        if (!a->active) {
+            continue;
+        }
+        if (a->arity > 0) {
+            fresh[2 * n] = hgfs_alloc(a->arity * sizeof(atom_handle_t), 0);
+            if (!fresh[2 * n]) {
+                break;
+            }
+        }
+        if (!a->cold && a->incident_cap > 0) {
+            fresh[2 * n + 1] = hgfs_alloc(a->incident_cap * sizeof(uint32_t), a->depth);
+            if (!fresh[2 * n + 1]) {
+                hgfs_free(fresh[2 * n]);
+                break;
+            }
+        }
+    }
+
+    for (size_t s = 0; s < n; s++) {
+        struct atom *a = &g_atomspace.atoms[s];
+        if (fresh[2 * s]) {
+            memcpy(fresh[2 * s], a->outgoing, a->arity * sizeof(atom_handle_t));
+            hgfs_free(a->outgoing);
+            a->outgoing = fresh[2 * s];
+        }
+        if (fresh[2 * s + 1]) {
+            memcpy(fresh[2 * s + 1], a->incident, a->incident_count * sizeof(uint32_t));
+            hgfs_free(a->incident);
+            a->incident = fresh[2 * s + 1];
+        }
+    }
+    free(fresh);
+}
+
+/**
+ * Move the atoms to their new slots inside one write section
+ *
+ * @return 0 on success, negative if snapshots are pinned or a table
+ *         could not grow (nothing is moved)
+ */
+static int reorder_apply(const uint32_t *dest, size_t slots, uint64_t *done) {
+    /* Snapshot readers index the tables by slot, so none may be pinned */
+    if (snap_write_begin()) {
+        snap_write_end();
+        return -1;
+    }
+    if (ecan_reorder_reserve(slots) != 0 || pln_reorder_reserve(slots) != 0 ||
+        snap_table_reserve((void **)&g_atomspace.slot_map, &g_atomspace.map_capacity,
+                           sizeof(uint32_t), slots) != 0) {
+        snap_write_end();
+        return -1;
+    }
+
+    cogkern_table_permute(g_atomspace.atoms, sizeof(struct atom), slots, dest, done);
+    ecan_reorder(dest, slots, done);
+    pln_reorder(dest, slots, done);
+    reorder_remap(dest, slots);
+    snap_write_end();
+
+    return 0;
+}
+
+/**
+ * Renumber atom storage so that connected atoms sit in nearby slots
+ *
+ * @param method Order to lay the atoms out in
+ * @return 0 on success, negative on error (nothing is moved)
+ */
+int cog_atom_reorder(enum cog_reorder_method method) {
+    size_t slots = g_atomspace.atom_slots;
+    struct reorder_state r = {0};
+    int rc = -1;
+
+    if ((unsigned)method > COG_REORDER_DEGREE) {
+        return -1;
+    }
+    if (slots == 0) {
+        return 0;
+    }
+
+    /* Packed adjacency names slots; unpack it and pack again afterwards */
+    int repack = g_atomspace.packed_count > 0;
+    for (size_t s = 0; s < slots && g_atomspace.packed_count > 0; s++) {
+        struct atom *a = &g_atomspace.atoms[s];
+        if (a->packed && atom_unpack(a) != 0) {
+            cog_adjacency_pack();
+            return -1;
+        }
+    }
+
+    r.order = malloc(slots * sizeof(uint32_t));
+    r.dest = malloc(slots * sizeof(uint32_t));
+    uint64_t *seeds = malloc(slots * sizeof(uint64_t));
+    uint64_t *done = malloc((slots + 63) / 64 * sizeof(uint64_t));
+    if (r.order && r.dest && seeds && done) {
+        memset(r.dest, 0xff, slots * sizeof(uint32_t));
+        if (reorder_compute(&r, method, seeds) == 0 && reorder_apply(r.dest, slots, done) == 0) {
+            reorder_relocate(slots);
+            rc = 0;
+        }
+    }
+
+    free(r.order);
+    free(r.dest);
+    free(r.keys);
+    free(seeds);
+    free(done);
+    if (repack) {
+        cog_adjacency_pack();
+    }
+    return rc;
+}
+
+/**
+ * Check that every member of an outgoing set is close enough to pack
+ *
+ * Members 2^30 or more slots from their predecessor would lose the top
+ * bit of their delta, so such an atom stays unpacked.
+ */
+static int pack_fits(const struct atom *a) {
+    atom_handle_t prev = a->handle;
+
+    for (uint32_t k = 0; k < a->arity; k++) {
+        uint32_t delta = COG_HANDLE_SLOT(a->outgoing[k]) - COG_HANDLE_SLOT(prev);
+        if (pack_zigzag(delta) > PACK_DELTA_MAX) {
+            return 0;
+        }
+        prev = a->outgoing[k];
+    }
+    return 1;
+}
+
+/**
+ * Ascending order of incidence entries
+ */
+static int pack_entry_cmp(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Encode the adjacency of every packable atom into a scratch buffer
+ *
+ * Atoms that are already packed are copied as they are; atoms whose
+ * members do not fit the encoding are left unpacked.
+ *
+ * @param offsets Receives 1 + the offset of each slot's bytes, 0 if unpacked
+ * @param buf Scratch buffer, grown with realloc()
+ * @param cap Capacity of *buf
+ * @param size Receives the number of bytes written
+ * @return 0 on success, negative on error
+ */
+static int pack_encode(uint32_t *offsets, uint8_t **buf, size_t *cap, size_t *size) {
+    uint32_t *sorted = NULL;
+    size_t sorted_cap = 0;
+    size_t n = 0;
+    int rc = 0;
+
+    for (size_t s = 0; s < g_atomspace.atom_slots && rc == 0; s++) {
+        const struct atom *a = &g_atomspace.atoms[s];
+        offsets[s] = 0;
+        if (!a->active || a->cold || a->arity + a->incident_count == 0 ||
+            (!a->packed && !pack_fits(a))) {
+            continue;
+        }
+
+        /* A varint of a 32-bit value takes at most five bytes */
+        size_t worst = 5 * (2 * (size_t)a->arity + a->incident_count);
+        if (n + worst > UINT32_MAX - 1) {
+            rc = -1;
+            break;
+        }
+        if (n + worst > *cap) {
+            size_t grown_cap = *cap * 2 > n + worst ? *cap * 2 : n + worst;
+            uint8_t *grown = realloc(*buf, grown_cap);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            *buf = grown;
+            *cap = grown_cap;
+        }
+        offsets[s] = (uint32_t)n + 1;
+
+        if (a->packed) {
+            const uint8_t *p = atom_pack(a);
+            size_t bytes = (size_t)(pack_skip(pack_incidence(a), a->incident_count) - p);
+            memcpy(*buf + n, p, bytes);
+            n += bytes;
+            continue;
+        }
+
+        uint8_t *w = *buf + n;
+        atom_handle_t prev = a->handle;
+        for (uint32_t k = 0; k < a->arity; k++) {
+            atom_handle_t member = a->outgoing[k];
+            uint32_t gen = COG_HANDLE_GEN(member);
+            uint32_t delta = COG_HANDLE_SLOT(member) - COG_HANDLE_SLOT(prev);
+            w = pack_put(w, pack_zigzag(delta) << 1 | (gen != 0));
+            if (gen) {
+                w = pack_put(w, gen);
+            }
+            prev = member;
+        }
+
+        n = (size_t)(w - *buf);
+        if (a->incident_count == 0) {
+            continue;
+        }
+
+        if (a->incident_count > sorted_cap) {
+            uint32_t *grown = realloc(sorted, a->incident_count * sizeof(uint32_t));
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            sorted = grown;
+            sorted_cap = a->incident_count;
+        }
+        /* Keys put the link flag in bit 0 so deltas stay small */
+        for (uint32_t i = 0; i < a->incident_count; i++) {
+            uint32_t e = a->incident[i];
+            sorted[i] = ((e & ~INCIDENT_LINK) << 1) | (e >> 31);
+        }
+        qsort(sorted, a->incident_count, sizeof(uint32_t), pack_entry_cmp);
+        w = pack_put(w, pack_zigzag(sorted[0] - ((uint32_t)s << 1)));
+        for (uint32_t i = 1; i < a->incident_count; i++) {
+            w = pack_put(w, sorted[i] - sorted[i - 1]);
+        }
+        n = (size_t)(w - *buf);
+    }
+
+    free(sorted);
+    *size = n;
+    return rc;
+}
+
+/**
+ * Compress the adjacency of every atom currently in memory
+ *
+ * @return 0 on success, negative on error (nothing is changed)
+ */
+int cog_adjacency_pack(void) {
+    size_t slots = g_atomspace.atom_slots;
+    size_t cap = 4096;
+    size_t size = 0;
+    uint32_t *offsets = malloc((slots ? slots : 1) * sizeof(uint32_t));
+    uint8_t *buf = malloc(cap);
+    uint8_t *pack = NULL;
+    size_t pack_capacity = 0;
+    int rc = -1;
+
+    if (offsets && buf && pack_encode(offsets, &buf, &cap, &size) == 0 &&
+        (size == 0 || cogkern_table_reserve((void **)&pack, &pack_capacity, 1, size) == 0)) {
+        if (size > 0) {
+            memcpy(pack, buf, size);
+        }
+
+        size_t packed = 0;
+        for (size_t s = 0; s < slots; s++) {
+            struct atom *a = &g_atomspace.atoms[s];
+            if (!offsets[s]) {
+                a->packed = 0; /* Packed once, but every entry has been deleted since */
+                continue;
+            }
+            if (!a->packed) {
+                hgfs_free(a->outgoing);
+                hgfs_free(a->incident);
+                a->outgoing = NULL;
+                a->incident = NULL;
+                a->incident_cap = 0;
+            }
+            a->packed = offsets[s];
+            packed++;
+        }
+
+        cogkern_table_free((void **)&g_atomspace.pack, &g_atomspace.pack_capacity, 1);
+        g_atomspace.pack = pack;
+        g_atomspace.pack_capacity = pack_capacity;
+        g_atomspace.pack_size = size;
+        g_atomspace.pack_dead = 0;
+        g_atomspace.packed_count = packed;
+        rc = 0;
+    }
+
+    free(offsets);
+    free(buf);
+    return rc;
+}
+
+/**
+ * Move a live atom's payload to the out-of-core tier
+ *
+ * The name, incidence list, attention value and truth value are written
+ * to one segment record and their memory is returned.
+ */
+int atomspace_page_out(uint32_t slot) {
+    if (slot >= g_atomspace.atom_slots) {
+        return -1;
+    }
+
+    struct atom *a = &g_atomspace.atoms[slot];
+    if (!a->active || a->cold || (a->packed && atom_unpack(a) != 0)) {
+        return -1;
+    }
+
+    size_t name_len = a->name ? strlen(a->name) + 1 : 0;
+    size_t size = sizeof(struct tier_record) + a->incident_count * sizeof(uint32_t) + name_len;
+    size = (size + 7) & ~(size_t)7;
+
+    uint64_t offset;
+    struct tier_record *r = tier_record_alloc(size, &offset);
+    if (!r) {
+        return -1;
+    }
+
+    r->handle = a->handle;
+    r->flags = 0;
+    r->size = (uint32_t)size;
+    r->name_len = (uint32_t)name_len;
+    r->incident_count = a->incident_count;
+    if (ecan_take_av(slot, &r->av) == 0) {
+        r->flags |= TIER_RECORD_AV;
+    }
+    if (pln_take_tv(slot, &r->tv) == 0) {
+        r->flags |= TIER_RECORD_TV;
+    }
+
+    uint32_t *incident = (uint32_t *)(r + 1);
+    if (a->incident_count > 0) {
+        memcpy(incident, a->incident, a->incident_count * sizeof(uint32_t));
+    }
+    if (name_len > 0) {
+        memcpy(incident + a->incident_count, a->name, name_len);
+    }
+
+    hgfs_free(a->incident);
+    hgfs_free(a->name);
+    a->incident = NULL;
+    a->incident_count = 0;
+    a->incident_cap = 0;
+    a->name = NULL;
+    a->cold = 1;
+    a->tier_offset = offset;
+    g_atomspace.cold_count++;
+
+    return 0;
+}
+
+/**
+ * Bring a cold atom's payload back into memory
+ */
+int atomspace_fault_in(uint32_t slot) {
+    struct atom *a = &g_atomspace.atoms[slot];
+    struct timespec t0, t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    const struct tier_record *r = tier_record_ptr(a->tier_offset);
+    const uint32_t *incident = (const uint32_t *)(r + 1);
+    uint32_t cap = 0;
+    uint32_t *list = NULL;
+    char *name = NULL;
+
+    if (r->incident_count > 0) {
+        cap = 4;
+        while (cap < r->incident_count) {
+            cap *= 2;
+        }
+        list = hgfs_alloc(cap * sizeof(uint32_t), a->depth);
+        if (!list) {
+            return -1;
+        }
+    }
+    if (r->name_len > 0) {
+        name = hgfs_alloc(r->name_len, a->depth);
+        if (!name) {
+            hgfs_free(list);
+            return -1;
+        }
+    }
+
+    if ((r->flags & TIER_RECORD_AV) && ecan_restore_av(slot, a->handle, &r->av) != 0) {
+        hgfs_free(list);
+        hgfs_free(name);
+        return -1;
+    }
+    if ((r->flags & TIER_RECORD_TV) && pln_restore_tv(slot, a->handle, &r->tv) != 0) {
+        struct attention_value av;
+        ecan_take_av(slot, &av);
+        hgfs_free(list);
+        hgfs_free(name);
+        return -1;
+    }
+
+    if (list) {
+        memcpy(list, incident, r->incident_count * sizeof(uint32_t));
+    }
+    if (name) {
+        memcpy(name, incident + r->incident_count, r->name_len);
+    }
+
+    a->incident = list;
+    a->incident_count = r->incident_count;
+    a->incident_cap = cap;
+    a->name = name;
+    a->cold = 0;
+    g_atomspace.cold_count--;
+
+    size_t bytes = r->size;
+    tier_record_release(a->tier_offset);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    tier_note_fault((uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL +
+                    (uint64_t)(t1.tv_nsec - t0.tv_nsec), bytes);
+
+    return 0;
+}
+
+/**
+ * Record that a cold atom's segment record moved during compaction
+ */
+void atomspace_tier_moved(uint32_t slot, uint64_t offset) {
+    g_atomspace.atoms[slot].tier_offset = offset;
+}
+
+/**
+ * Fill the AtomSpace part of cogkern_stats()
+ */
+void atomspace_fill_stats(struct cogkern_stats *stats) {
+    stats->atoms = g_atomspace.atom_count;
+    stats->links = g_atomspace.link_count;
+    stats->edges = g_atomspace.edge_count;
+    stats->link_members = g_atomspace.member_count;
+    stats->cold_atoms = g_atomspace.cold_count;
+    stats->packed_atoms = g_atomspace.packed_count;
+    stats->atom_table_bytes = g_atomspace.atom_capacity * sizeof(struct atom);
+    stats->edge_table_bytes = g_atomspace.edge_capacity * sizeof(struct edge);
+    stats->adjacency_pack_bytes = g_atomspace.pack_capacity;
+}
+
+/**
+ * Drop all atoms and edges and free the AtomSpace tables
+ *
+ * Names, outgoing sets and incidence lists live in the hypergraph arenas,
+ * which are released separately at shutdown.
+ */
+void atomspace_reset(void) {
+    cogkern_table_free((void **)&g_atomspace.atoms, &g_atomspace.atom_capacity,
+                       sizeof(struct atom));
+    cogkern_table_free((void **)&g_atomspace.edges, &g_atomspace.edge_capacity,
+                       sizeof(struct edge));
+    cogkern_table_free((void **)&g_atomspace.slot_map, &g_atomspace.map_capacity,
+                       sizeof(uint32_t));
+    cogkern_table_free((void **)&g_atomspace.pack, &g_atomspace.pack_capacity, 1);
+    for (int t = 0; t < ATOM_TYPE_COUNT; t++) {
+        cogkern_table_free((void **)&g_atomspace.type_slots[t], &g_atomspace.type_capacity[t],
+                           sizeof(uint32_t));
+        g_atomspace.type_count[t] = 0;
+    }
+
+    g_atomspace.atom_slots = 0;
+    g_atomspace.edge_slots = 0;
+    g_atomspace.atom_count = 0;
+    g_atomspace.edge_count = 0;
+    g_atomspace.link_count = 0;
+    g_atomspace.member_count = 0;
+    g_atomspace.atom_free = SLOT_NONE;
+    g_atomspace.edge_free = SLOT_NONE;
+    g_atomspace.cold_count = 0;
+    g_atomspace.pack_size = 0;
+    g_atomspace.pack_dead = 0;
+    g_atomspace.packed_count = 0;
+}
@@ -40,6 +40,12 @@ static void print_usage(const char *prog_name) {
     printf("  atom create <type> <name>    Create an atom\n");
     printf("  link create <type> <a1> <a2> Create a link between atoms\n");
     printf("  atom list                    List all created atoms\n");
+    printf("  atom list --type <type>      List every live atom of a type\n");
+    printf("  atom remove <handle>         Remove an atom and the links using it\n");
+    printf("  atom reorder [method]        Renumber storage: bfs, rcm or degree\n");
+    printf("  import <file> [threads]      Bulk-load atoms from a tab-separated file\n");
+    printf("  neighbors <handle> <k> [--type <type>]  List atoms within k hops (0: no limit)\n");
+    printf("  similar [--type <type>] [--min <j>]     Link atoms with overlapping neighbourhoods\n");
     printf("\n");
     printf("ECAN Commands:\n");
     printf("  attention set <atom> <sti> <lti> <vlti>  Set attention values\n");
@@ -54,9 +60,17 @@ static void print_usage(const char *prog_name) {
     printf("  loop tick                Execute one loop iteration\n");
     printf("  loop stop                Stop cognitive loop\n");
     printf("\n");
+    printf("Diagnostics Commands:\n");
+    printf("  trace start              Start recording trace spans\n");
+    printf("  trace stop               Stop recording trace spans\n");
+    printf("  trace dump <file>        Write spans as Chrome trace JSON\n");
+    printf("  stats                    Show kernel statistics and latencies\n");
+    printf("  stats dump <file>        Append statistics to a file as JSON\n");
+    printf("  stats every <ticks> <file>  Dump statistics every N ticks (0 stops)\n");
+    printf("\n");
     printf("Utility Commands:\n");
     printf("  help                     Show this help message\n");
-    printf("  version                  Show version information\n");
+    printf("  version [--features]     Show version (and CPU kernel selection)\n");
     printf("\n");
     printf("Atom Types:\n");
     printf("  node, link, concept, predicate, evaluation, inheritance, similarity\n");
@@ -65,10 +79,43 @@ static void print_usage(const char *prog_name) {
 
 /**
  * Print version information
+ * 
+ * @param features Also print the CPU features and the kernel variant selected
  */
-static void print_version(void) {
+static void print_version(int features) {
+    static const struct {
+        uint32_t flag;
+        const char *name;
+    } cpu_names[] = {
+        {COGKERN_CPU_SSE42, "sse4.2"}, {COGKERN_CPU_AVX, "avx"}, {COGKERN_CPU_AVX2, "avx2"},
+        {COGKERN_CPU_FMA, "fma"}, {COGKERN_CPU_AVX512F, "avx512f"},
+        {COGKERN_CPU_AVX512BW, "avx512bw"}, {COGKERN_CPU_AVX512VL, "avx512vl"}
+    };
+    
     printf("cogpilot-cli version %s\n", VERSION);
     printf("OpenCog Kernel Library v0.1.0\n");
+    if (!features) {
+        return;
+    }
+    
+    uint32_t cpu = cogkern_cpu_features();
+    printf("CPU features:");
+    for (size_t i = 0; i < sizeof(cpu_names) / sizeof(cpu_names[0]); i++) {
+        if (cpu & cpu_names[i].flag) {
+            printf(" %s", cpu_names[i].name);
+        }
+    }
+    printf("%s\n", cpu ? "" : " none detected");
+    
+    const char *forced = getenv("COGKERN_ISA");
+    const char *note = "";
+    if (cogkern_isa_from_env()) {
+        note = ", COGKERN_ISA set";
+    } else if (forced && *forced) {
+        note = ", COGKERN_ISA ignored";
+    }
+    printf("Kernels: %s (best %s%s)\n", cogkern_isa_name(cogkern_isa_get()),
+           cogkern_isa_name(cogkern_isa_best()), note);
 }
 
 /**
@@ -255,18 +302,43 @@ static int cmd_link_create(int argc, char **argv) {
     return 0;
 }
 
+/**
+ * Handle 'atom list --type' through the kernel's per-type posting lists
+ */
+static int cmd_atom_list_type(enum atom_type type) {
+    struct cog_atom_iter it;
+    atom_handle_t batch[256];
+    size_t n;
+    
+    printf("%s atoms (%zu total):\n", get_atom_type_name(type), cog_atom_type_count(type));
+    cog_atom_iter_init(&it, type);
+    while ((n = cog_atom_iter_next(&it, batch, 256)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            printf("  - Handle: %lu\n", batch[i]);
+        }
+    }
+    
+    return 0;
+}
+
 /**
  * Handle 'atom list' command
  */
 static int cmd_atom_list(int argc, char **argv) {
-    (void)argc;
-    (void)argv;
-    
     if (!cli_state.initialized) {
         fprintf(stderr, "Error: kernel not initialized (run 'init' first)\n");
         return 1;
     }
     
+    if (argc >= 4 && strcmp(argv[3], "--type") == 0) {
+        if (argc < 5 || !argv[4]) {
+            fprintf(stderr, "Error: --type requires an atom type\n");
+            fprintf(stderr, "Usage: cogpilot-cli atom list --type <type>\n");
+            return 1;
+        }
+        return cmd_atom_list_type(parse_atom_type(argv[4]));
+    }
+    
     if (cli_state.atom_count == 0) {
         printf("No atoms created yet\n");
         return 0;
@@ -280,6 +352,204 @@ static int cmd_atom_list(int argc, char **argv) {
     return 0;
 }
 
+/**
+ * Handle 'atom remove' command
+ */
+static int cmd_atom_remove(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Error: atom remove requires atom handle\n");
+        fprintf(stderr, "Usage: cogpilot-cli atom remove <handle>\n");
+        return 1;
+    }
+    
+    if (!cli_state.initialized) {
+        fprintf(stderr, "Error: kernel not initialized (run 'init' first)\n");
+        return 1;
+    }
+    
+    atom_handle_t handle = strtoull(argv[3], NULL, 0);
+    
+    if (cog_atom_remove(handle) != 0) {
+        fprintf(stderr, "Error: no atom with handle %lu\n", handle);
+        return 1;
+    }
+    
+    /* Forget the handle and any links removed with it */
+    size_t kept = 0;
+    for (size_t i = 0; i < cli_state.atom_count; i++) {
+        if (cog_atom_valid(cli_state.atoms[i])) {
+            cli_state.atoms[kept++] = cli_state.atoms[i];
+        }
+    }
+    cli_state.atom_count = kept;
+    
+    printf("✓ Removed atom %lu\n", handle);
+    return 0;
+}
+
+/**
+ * Handle 'atom reorder' command
+ */
+static int cmd_atom_reorder(int argc, char **argv) {
+    const char *names[] = {"bfs", "rcm", "degree"};
+    const char *name = argc >= 4 ? argv[3] : "bfs";
+    int method = -1;
+    
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            method = i;
+        }
+    }
+    if (method < 0) {
+        fprintf(stderr, "Error: unknown reorder method '%s'\n", name);
+        fprintf(stderr, "Usage: cogpilot-cli atom reorder [bfs|rcm|degree]\n");
+        return 1;
+    }
+    
+    if (!cli_state.initialized) {
+        fprintf(stderr, "Error: kernel not initialized (run 'init' first)\n");
+        return 1;
+    }
+    
+    if (cog_atom_reorder((enum cog_reorder_method)method) != 0) {
+        fprintf(stderr, "Error: failed to reorder atoms\n");
+        return 1;
+    }
+    
+    printf("✓ Reordered atoms (%s)\n", name);
+    return 0;
+}
+
+/**
+ * Handle 'import' command
+ */
+static int cmd_import(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Error: import requires a file name\n");
+        fprintf(stderr, "Usage: cogpilot-cli import <file> [threads]\n");
+        return 1;
+    }
+    
+    if (!cli_state.initialized) {
+        fprintf(stderr, "Error: kernel not initialized (run 'init' first)\n");
+        return 1;
+    }
+    
+    uint32_t threads = argc >= 4 ? (uint32_t)strtoul(argv[3], NULL, 10) : 0;
+    struct cog_import_stats st;
+    
+    if (cog_import_file(argv[2], threads, &st) != 0) {
+        fprintf(stderr, "Error: failed to import %s: %s (%zu nodes, %zu links created)\n",
+                argv[2], st.error ? st.error : "unknown error", st.nodes, st.links);
+        return 1;
+    }
+    
+    double seconds = (st.parse_ns + st.commit_ns) / 1e9;
+    printf("✓ Imported %zu nodes and %zu links from %zu lines (%zu skipped)\n",
+           st.nodes, st.links, st.lines, st.errors);
+    printf("  parse %.1f ms on %u threads, commit %.1f ms, %.2f M atoms/s\n",
+           st.parse_ns / 1e6, st.threads, st.commit_ns / 1e6,
+           seconds > 0.0 ? (st.nodes + st.links) / seconds / 1e6 : 0.0);
+    return 0;
+}
+
+/**
+ * Handle 'neighbors' command
+ */
+static int cmd_neighbors(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Error: neighbors requires atom handle and hop count\n");
+        fprintf(stderr, "Usage: cogpilot-cli neighbors <handle> <k> [--type <type>]\n");
+        return 1;
+    }
+    
+    if (!cli_state.initialized) {
+        fprintf(stderr, "Error: kernel not initialized (run 'init' first)\n");
+        return 1;
+    }
+    
+    atom_handle_t handle = strtoull(argv[2], NULL, 0);
+    struct cog_traverse_params params = {0};
+    struct cog_traverse_stats st;
+    
+    params.max_hops = (uint32_t)strtoul(argv[3], NULL, 10);
+    if (argc >= 5 && strcmp(argv[4], "--type") == 0) {
+        if (argc < 6 || !argv[5]) {
+            fprintf(stderr, "Error: --type requires an atom type\n");
+            return 1;
+        }
+        params.result_types = COG_TYPE_BIT(parse_atom_type(argv[5]));
+    }
+    
+    int n = cog_traverse(handle, &params, NULL, NULL, 0, NULL);
+    if (n < 0) {
+        fprintf(stderr, "Error: no atom with handle %lu\n", handle);
+        return 1;
+    }
+    
+    atom_handle_t *found = malloc(((size_t)n + 1) * sizeof(atom_handle_t));
+    uint32_t *hops = malloc(((size_t)n + 1) * sizeof(uint32_t));
+    if (!found || !hops || (n = cog_traverse(handle, &params, found, hops, (size_t)n, &st)) < 0) {
+        fprintf(stderr, "Error: traversal failed\n");
+        free(found);
+        free(hops);
+        return 1;
+    }
+    
+    if (params.max_hops > 0) {
+        printf("Atoms within %u hops of %lu", params.max_hops, handle);
+    } else {
+        printf("Atoms reachable from %lu", handle);
+    }
+    printf(" (%d found, %u levels, %.2f ms on %u threads):\n",
+           n, st.levels, st.elapsed_ns / 1e6, st.threads);
+    for (int i = 0; i < n; i++) {
+        printf("  - Handle: %lu (hop %u)\n", found[i], hops[i]);
+    }
+    
+    free(found);
+    free(hops);
+    return 0;
+}
+
+/**
+ * Handle 'similar' command
+ */
+static int cmd_similar(int argc, char **argv) {
+    if (!cli_state.initialized) {
+        fprintf(stderr, "Error: kernel not initialized (run 'init' first)\n");
+        return 1;
+    }
+    
+    struct cog_similarity_params params = {0, 0, 0, 0, 0.5f, 0.9f, 0};
+    struct cog_similarity_stats st;
+    
+    for (int i = 2; i < argc; i += 2) {
+        if (i + 1 >= argc || !argv[i] || !argv[i + 1]) {
+            fprintf(stderr, "Usage: cogpilot-cli similar [--type <type>] [--min <jaccard>]\n");
+            return 1;
+        }
+        if (strcmp(argv[i], "--type") == 0) {
+            params.types = COG_TYPE_BIT(parse_atom_type(argv[i + 1]));
+        } else if (strcmp(argv[i], "--min") == 0) {
+            params.min_jaccard = strtof(argv[i + 1], NULL);
+        } else {
+            fprintf(stderr, "Error: unknown option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    int n = cog_similarity_discover(&params, &st);
+    if (n < 0) {
+        fprintf(stderr, "Error: similarity discovery failed\n");
+        return 1;
+    }
+    
+    printf("Linked %d similar pairs (%zu atoms, %zu candidates, %.2f ms on %u threads)\n",
+           n, st.atoms, st.candidates, st.elapsed_ns / 1e6, st.threads);
+    return 0;
+}
+
 /**
  * Handle 'attention set' command
  */
@@ -464,6 +734,144 @@ static int cmd_loop_stop(int argc, char **argv) {
     return 0;
 }
 
+/**
+ * Handle 'trace start|stop|dump' commands
+ */
+static int cmd_trace(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Error: trace requires a subcommand\n");
+        fprintf(stderr, "Usage: cogpilot-cli trace start|stop|dump <file>\n");
+        return 1;
+    }
+    
+    if (strcmp(argv[2], "start") == 0) {
+        if (cog_trace_start(0) != 0) {
+            fprintf(stderr, "Error: tracing already started or not compiled in\n");
+            return 1;
+        }
+        printf("✓ Tracing started\n");
+        return 0;
+    }
+    
+    if (strcmp(argv[2], "stop") == 0) {
+        cog_trace_stop();
+        printf("✓ Tracing stopped\n");
+        return 0;
+    }
+    
+    if (strcmp(argv[2], "dump") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Error: trace dump requires a file name\n");
+            return 1;
+        }
+        
+        long spans = cog_trace_dump(argv[3]);
+        if (spans < 0) {
+            fprintf(stderr, "Error: failed to write %s\n", argv[3]);
+            return 1;
+        }
+        printf("✓ Wrote %ld spans to %s\n", spans, argv[3]);
+        return 0;
+    }
+    
+    fprintf(stderr, "Error: unknown trace subcommand '%s'\n", argv[2]);
+    return 1;
+}
+
+/**
+ * Print one latency summary
+ */
+static void print_latency(const char *name, const struct cogkern_latency *l) {
+    printf("  %-12s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+           (unsigned long long)l->count, l->p50_ns / 1e3, l->p90_ns / 1e3,
+           l->p99_ns / 1e3, l->p999_ns / 1e3, l->max_ns / 1e3);
+}
+
+/**
+ * Handle 'stats [dump <file>|every <ticks> <file>]' commands
+ */
+static int cmd_stats(int argc, char **argv) {
+    if (!cli_state.initialized) {
+        fprintf(stderr, "Error: kernel not initialized (run 'init' first)\n");
+        return 1;
+    }
+    
+    if (argc >= 3 && strcmp(argv[2], "dump") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "Error: stats dump requires a file name\n");
+            return 1;
+        }
+        if (cogkern_stats_write(argv[3]) != 0) {
+            fprintf(stderr, "Error: failed to write %s\n", argv[3]);
+            return 1;
+        }
+        printf("✓ Appended statistics to %s\n", argv[3]);
+        return 0;
+    }
+    
+    if (argc >= 3 && strcmp(argv[2], "every") == 0) {
+        if (argc < 5) {
+            fprintf(stderr, "Error: stats every requires a tick count and a file name\n");
+            return 1;
+        }
+        uint32_t ticks = (uint32_t)strtoul(argv[3], NULL, 10);
+        if (cogkern_stats_dump_every(argv[4], ticks) != 0) {
+            fprintf(stderr, "Error: failed to set periodic statistics dump\n");
+            return 1;
+        }
+        if (ticks > 0) {
+            printf("✓ Dumping statistics to %s every %u ticks\n", argv[4], ticks);
+        } else {
+            printf("✓ Periodic statistics dump stopped\n");
+        }
+        return 0;
+    }
+    
+    if (argc >= 3) {
+        fprintf(stderr, "Error: unknown stats subcommand '%s'\n", argv[2]);
+        return 1;
+    }
+    
+    struct cogkern_stats s;
+    if (cogkern_stats(&s) != 0) {
+        fprintf(stderr, "Error: failed to collect statistics\n");
+        return 1;
+    }
+    
+    printf("Contents:\n");
+    printf("  atoms %zu (links %zu, cold %zu, packed %zu), edges %zu, link members %zu\n",
+           s.atoms, s.links, s.cold_atoms, s.packed_atoms, s.edges, s.link_members);
+    printf("  attention values %zu, truth values %zu, embeddings %zu\n",
+           s.attention_values, s.truth_values, s.embeddings);
+    printf("  snapshots %zu, old versions kept %zu\n", s.snapshots, s.snapshot_versions);
+    printf("Memory (KB):\n");
+    printf("  budget %zu used %zu\n", s.mem_budget / 1024, s.mem_used / 1024);
+    printf("  atom table %zu, edge table %zu, AV table %zu, TV table %zu, packed adjacency %zu\n",
+           s.atom_table_bytes / 1024, s.edge_table_bytes / 1024,
+           s.av_table_bytes / 1024, s.tv_table_bytes / 1024, s.adjacency_pack_bytes / 1024);
+    printf("  arenas %zu reserved, %zu in use\n", s.arena_reserved / 1024, s.arena_in_use / 1024);
+    printf("  event queue %zu, task queues %zu, tier segment %zu, snapshots %zu\n",
+           s.event_queue_bytes / 1024, s.task_queue_bytes / 1024, s.tier_segment_bytes / 1024,
+           s.snapshot_bytes / 1024);
+    printf("  embeddings %zu, tensors %zu\n", s.embedding_bytes / 1024, s.tensor_bytes / 1024);
+    printf("Counters:\n");
+    printf("  atoms created %llu removed %llu, links created %llu\n",
+           (unsigned long long)s.atoms_created, (unsigned long long)s.atoms_removed,
+           (unsigned long long)s.links_created);
+    printf("  inferences %llu, tasks run %llu, events applied %llu\n",
+           (unsigned long long)s.inferences, (unsigned long long)s.tasks_run,
+           (unsigned long long)s.events_applied);
+    printf("Latency (us):\n");
+    printf("  %-12s %10s %10s %10s %10s %10s %10s\n",
+           "", "count", "p50", "p90", "p99", "p99.9", "max");
+    print_latency("tick", &s.tick);
+    print_latency("sched_tick", &s.sched_tick);
+    print_latency("task_run", &s.task_run);
+    print_latency("task_wait", &s.task_wait);
+    
+    return 0;
+}
+
 /**
  * Parse command line and dispatch to appropriate handler
  */
@@ -481,7 +889,7 @@ static int dispatch_command(int argc, char **argv) {
     }
     
     if (strcmp(cmd, "version") == 0) {
-        print_version();
+        print_version(argc > 1 && strcmp(argv[1], "--features") == 0);
         return 0;
     }
     
@@ -512,8 +920,15 @@ static int dispatch_command(int argc, char **argv) {
                                 argc >= 3 ? argv[2] : NULL, argc >= 4 ? argv[3] : NULL};
             return cmd_atom_create(argc >= 4 ? 5 : argc + 2, fake_argv);
         } else if (strcmp(argv[1], "list") == 0) {
-            char *fake_argv[] = {"cogpilot-cli", "atom", "list"};
-            return cmd_atom_list(3, fake_argv);
+            char *fake_argv[] = {"cogpilot-cli", "atom", "list",
+                                argc >= 3 ? argv[2] : NULL, argc >= 4 ? argv[3] : NULL};
+            return cmd_atom_list(argc + 1 < 5 ? argc + 1 : 5, fake_argv);
+        } else if (strcmp(argv[1], "remove") == 0) {
+            char *fake_argv[] = {"cogpilot-cli", "atom", "remove", argc >= 3 ? argv[2] : NULL};
+            return cmd_atom_remove(argc >= 3 ? 4 : argc + 1, fake_argv);
+        } else if (strcmp(argv[1], "reorder") == 0) {
+            char *fake_argv[] = {"cogpilot-cli", "atom", "reorder", argc >= 3 ? argv[2] : NULL};
+            return cmd_atom_reorder(argc >= 3 ? 4 : argc + 1, fake_argv);
         }
     }
     
@@ -524,6 +939,26 @@ static int dispatch_command(int argc, char **argv) {
         return cmd_link_create(argc >= 5 ? 6 : argc + 1, fake_argv);
     }
     
+    if (strcmp(cmd, "import") == 0) {
+        char *fake_argv[] = {"cogpilot-cli", "import", argc >= 2 ? argv[1] : NULL,
+                            argc >= 3 ? argv[2] : NULL};
+        return cmd_import(argc + 1, fake_argv);
+    }
+    
+    if (strcmp(cmd, "neighbors") == 0) {
+        char *fake_argv[] = {"cogpilot-cli", "neighbors", argc >= 2 ? argv[1] : NULL,
+                            argc >= 3 ? argv[2] : NULL, argc >= 4 ? argv[3] : NULL,
+                            argc >= 5 ? argv[4] : NULL};
+        return cmd_neighbors(argc >= 5 ? 6 : argc + 1, fake_argv);
+    }
+    
+    if (strcmp(cmd, "similar") == 0) {
+        char *fake_argv[] = {"cogpilot-cli", "similar", argc >= 2 ? argv[1] : NULL,
+                            argc >= 3 ? argv[2] : NULL, argc >= 4 ? argv[3] : NULL,
+                            argc >= 5 ? argv[4] : NULL};
+        return cmd_similar(argc >= 5 ? 6 : argc + 1, fake_argv);
+    }
+    
     /* ECAN commands */
     if (strcmp(cmd, "attention") == 0 && argc >= 2) {
         if (strcmp(argv[1], "set") == 0) {
@@ -561,6 +996,18 @@ static int dispatch_command(int argc, char **argv) {
         }
     }
     
+    /* Diagnostics commands */
+    if (strcmp(cmd, "trace") == 0) {
+        char *fake_argv[] = {"cogpilot-cli", "trace", argc >= 2 ? argv[1] : NULL,
+                            argc >= 3 ? argv[2] : NULL};
+        return cmd_trace(argc + 1, fake_argv);
+    }
+    if (strcmp(cmd, "stats") == 0) {
+        char *fake_argv[] = {"cogpilot-cli", "stats", argc >= 2 ? argv[1] : NULL,
+                            argc >= 3 ? argv[2] : NULL, argc >= 4 ? argv[3] : NULL};
+        return cmd_stats(argc + 1, fake_argv);
+    }
+    
     fprintf(stderr, "Error: unknown command '%s'\n", cmd);
     fprintf(stderr, "Type 'help' for usage information\n");
     return 1;
@@ -641,7 +1088,7 @@ int main(int argc, char **argv) {
     }
     
     if (strcmp(cmd, "version") == 0 || strcmp(cmd, "--version") == 0 || strcmp(cmd, "-v") == 0) {
-        print_version();
+        print_version(argc > 2 && strcmp(argv[2], "--features") == 0);
         return 0;
     }
     
@@ -664,6 +1111,10 @@ int main(int argc, char **argv) {
             return cmd_atom_create(argc, argv);
         } else if (strcmp(argv[2], "list") == 0) {
             return cmd_atom_list(argc, argv);
+        } else if (strcmp(argv[2], "remove") == 0) {
+            return cmd_atom_remove(argc, argv);
+        } else if (strcmp(argv[2], "reorder") == 0) {
+            return cmd_atom_reorder(argc, argv);
         }
     }
     
@@ -671,6 +1122,18 @@ int main(int argc, char **argv) {
         return cmd_link_create(argc, argv);
     }
     
+    if (strcmp(cmd, "import") == 0) {
+        return cmd_import(argc, argv);
+    }
+    
+    if (strcmp(cmd, "neighbors") == 0) {
+        return cmd_neighbors(argc, argv);
+    }
+    
+    if (strcmp(cmd, "similar") == 0) {
+        return cmd_similar(argc, argv);
+    }
+    
     /* ECAN commands */
     if (strcmp(cmd, "attention") == 0 && argc >= 3) {
         if (strcmp(argv[2], "set") == 0) {
@@ -698,6 +1161,14 @@ int main(int argc, char **argv) {
         }
     }
     
+    /* Diagnostics commands */
+    if (strcmp(cmd, "trace") == 0) {
+        return cmd_trace(argc, argv);
+    }
+    if (strcmp(cmd, "stats") == 0) {
+        return cmd_stats(argc, argv);
+    }
+    
     fprintf(stderr, "Error: unknown command '%s'\n", cmd);
     fprintf(stderr, "Run '%s help' for usage information\n", argv[0]);
     return 1;
@@ -0,0 +1,240 @@
+/**
+ * @file cogcpu.c
+ * @brief Runtime CPU dispatch - Instruction set selection for numeric kernels
+ *
+ * The hot numeric kernels (embedding dot products, tensor reductions,
+ * MinHash signing, PLN formulas) are compiled several times from the
+ * same source, cogcpu_kernels.h: once for the build's baseline target
+ * and, on x86, once each for AVX2 and AVX-512. The first cogkern_init()
+ * asks the CPU (via CPUID) what it supports and picks the widest variant
+ * it can run, so one binary serves hosts from SSE4.2 to AVX-512. The
+ * COGKERN_ISA environment variable or cogkern_isa_force() pins a variant
+ * for testing. The choice is process-wide, like tracing; callers read
+ * the table once per operation, so switching never tears a running one.
+ */
+
+#include "cogkern_internal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#else
+#define CPU_X86 0
+#endif
+
+#define KERNEL(name) name##_scalar
+#define KERNEL_BYTES 32
+#define KERNEL_TARGET
+#include "cogcpu_kernels.h"
+#undef KERNEL
+#undef KERNEL_BYTES
+#undef KERNEL_TARGET
+
+#if CPU_X86
+#define KERNEL(name) name##_avx2
+#define KERNEL_BYTES 32
+#define KERNEL_TARGET __attribute__((target("avx2,fma")))
+#include "cogcpu_kernels.h"
+#undef KERNEL
+#undef KERNEL_BYTES
+#undef KERNEL_TARGET
+
+#define KERNEL(name) name##_avx512
+#define KERNEL_BYTES 64
+#define KERNEL_TARGET __attribute__((target("avx512f,avx512bw,avx512vl,avx2,fma")))
+#include "cogcpu_kernels.h"
+#undef KERNEL
+#undef KERNEL_BYTES
+#undef KERNEL_TARGET
+#endif
+
+/**
+ * Kernel table of each instruction set (NULL where not built)
+ */
+static const struct cog_kernels *const cpu_tables[] = {
+    &kernels_scalar,
+#if CPU_X86
+    &kernels_avx2,
+    &kernels_avx512
+#else
+    NULL,
+    NULL
+#endif
+};
+
+/**
+ * Names of the instruction sets, as accepted by COGKERN_ISA
+ */
+static const char *const cpu_isa_names[] = {"scalar", "avx2", "avx512"};
+
+/**
+ * Kernels in use (the baseline until the first cogkern_init())
+ */
+const struct cog_kernels *cpu_kernels_active = &kernels_scalar;
+
+/**
+ * Selected instruction set
+ */
+static enum cogkern_isa cpu_isa = COGKERN_ISA_SCALAR;
+
+/**
+ * Whether COGKERN_ISA chose the selected instruction set
+ */
+static int cpu_isa_from_env;
+
+/**
+ * One-time detection and default selection
+ */
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Install the kernels of an instruction set
+ */
+static void cpu_install(enum cogkern_isa isa) {
+    __atomic_store_n(&cpu_isa, isa, __ATOMIC_RELAXED);
+    __atomic_store_n(&cpu_kernels_active, cpu_tables[isa], __ATOMIC_RELEASE);
+}
+
+/**
+ * Parse an instruction set name
+ *
+ * @return Instruction set, or negative if the name is unknown
+ */
+static int cpu_parse_isa(const char *name) {
+    for (int isa = 0; isa <= COGKERN_ISA_AVX512; isa++) {
+        if (strcmp(name, cpu_isa_names[isa]) == 0) {
+            return isa;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Select the best instruction set, or the one COGKERN_ISA names
+ */
+static void cpu_select_default(void) {
+    enum cogkern_isa isa = cogkern_isa_best();
+    const char *forced = getenv("COGKERN_ISA");
+
+    if (forced && *forced) {
+        int parsed = cpu_parse_isa(forced);
+        if (parsed < 0) {
+            fprintf(stderr, "cogkern: ignoring COGKERN_ISA=%s (expected scalar, avx2 or avx512)\n",
+                    forced);
+        } else if ((enum cogkern_isa)parsed > isa) {
+            fprintf(stderr, "cogkern: ignoring COGKERN_ISA=%s (this host runs up to %s)\n",
+                    forced, cpu_isa_names[isa]);
+        } else {
+            isa = (enum cogkern_isa)parsed;
+            __atomic_store_n(&cpu_isa_from_env, 1, __ATOMIC_RELAXED);
+        }
+    }
+    cpu_install(isa);
+}
+
+/**
+ * Pick the kernel variants for this host (once per process)
+ */
+void cpu_dispatch_init(void) {
+    pthread_once(&cpu_once, cpu_select_default);
+}
+
+/**
+ * Query the instruction set extensions of the host
+ */
+uint32_t cogkern_cpu_features(void) {
+    uint32_t features = 0;
+
+#if CPU_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        features |= COGKERN_CPU_SSE42;
+    }
+    if (__builtin_cpu_supports("avx")) {
+        features |= COGKERN_CPU_AVX;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        features |= COGKERN_CPU_AVX2;
+    }
+    if (__builtin_cpu_supports("fma")) {
+        features |= COGKERN_CPU_FMA;
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        features |= COGKERN_CPU_AVX512F;
+    }
+    if (__builtin_cpu_supports("avx512bw")) {
+        features |= COGKERN_CPU_AVX512BW;
+    }
+    if (__builtin_cpu_supports("avx512vl")) {
+        features |= COGKERN_CPU_AVX512VL;
+    }
+#endif
+
+    return features;
+}
+
+/**
+ * Widest kernel variant the host can run
+ */
+enum cogkern_isa cogkern_isa_best(void) {
+    uint32_t features = cogkern_cpu_features();
+    uint32_t avx2 = COGKERN_CPU_AVX2 | COGKERN_CPU_FMA;
+    uint32_t avx512 = avx2 | COGKERN_CPU_AVX512F | COGKERN_CPU_AVX512BW | COGKERN_CPU_AVX512VL;
+
+    if (CPU_X86 && (features & avx512) == avx512) {
+        return COGKERN_ISA_AVX512;
+    }
+    if (CPU_X86 && (features & avx2) == avx2) {
+        return COGKERN_ISA_AVX2;
+    }
+    return COGKERN_ISA_SCALAR;
+}
+
+/**
+ * Kernel variant in use
+ */
+enum cogkern_isa cogkern_isa_get(void) {
+    cpu_dispatch_init();
+    return __atomic_load_n(&cpu_isa, __ATOMIC_RELAXED);
+}
+
+/**
+ * Pin the kernel variant, or return to automatic selection
+ */
+int cogkern_isa_force(int isa) {
+    cpu_dispatch_init();
+
+    if (isa == COGKERN_ISA_AUTO) {
+        __atomic_store_n(&cpu_isa_from_env, 0, __ATOMIC_RELAXED);
+        cpu_install(cogkern_isa_best());
+        return 0;
+    }
+    if (isa < COGKERN_ISA_SCALAR || isa > (int)cogkern_isa_best()) {
+        return -1;
+    }
+
+    __atomic_store_n(&cpu_isa_from_env, 0, __ATOMIC_RELAXED);
+    cpu_install((enum cogkern_isa)isa);
+    return 0;
+}
+
+/**
+ * Whether COGKERN_ISA chose the kernel variant in use
+ */
+int cogkern_isa_from_env(void) {
+    cpu_dispatch_init();
+    return __atomic_load_n(&cpu_isa_from_env, __ATOMIC_RELAXED);
+}
+
+/**
+ * Name of a kernel variant
+ */
+const char *cogkern_isa_name(enum cogkern_isa isa) {
+    if ((unsigned)isa > COGKERN_ISA_AVX512) {
+        return "unknown";
+    }
+    return cpu_isa_names[isa];
+}
@@ -0,0 +1,241 @@
+/**
+ * @file cogcpu_kernels.h
+ * @brief Numeric kernel bodies, compiled by cogcpu.c once per instruction set
+ *
+ * Each inclusion defines KERNEL(name) to name its variant of every
+ * function, KERNEL_BYTES to the vector width and KERNEL_TARGET to the
+ * target attribute of the variant. The kernels use GCC vector extensions,
+ * so each inclusion gets the widest registers its target allows, and end
+ * with the variant's dispatch table. There is no include guard: the file
+ * is included once per variant and nowhere else.
+ */
+
+/**
+ * Lanes of a 32-bit vector
+ */
+#define KERNEL_LANES (KERNEL_BYTES / 4)
+
+/**
+ * Vectors of the variant (unaligned loads allowed)
+ */
+typedef float KERNEL(vf) __attribute__((vector_size(KERNEL_BYTES), aligned(4), may_alias));
+typedef int32_t KERNEL(vi) __attribute__((vector_size(KERNEL_BYTES), aligned(4), may_alias));
+typedef uint32_t KERNEL(vu) __attribute__((vector_size(KERNEL_BYTES), aligned(4), may_alias));
+typedef int16_t KERNEL(vs) __attribute__((vector_size(KERNEL_BYTES), aligned(2), may_alias));
+
+/**
+ * Sum of the lanes of a vector, folding halves so the adds form a tree
+ */
+KERNEL_TARGET static inline float KERNEL(hsum)(const KERNEL(vf) *v) {
+    float f[KERNEL_LANES];
+
+    memcpy(f, v, sizeof(f));
+    for (int width = KERNEL_LANES / 2; width > 0; width /= 2) {
+        for (int lane = 0; lane < width; lane++) {
+            f[lane] += f[lane + width];
+        }
+    }
+    return f[0];
+}
+
+/**
+ * Dot product of n floats
+ */
+KERNEL_TARGET static float KERNEL(dot_f32)(const float *x, const float *y, size_t n) {
+    KERNEL(vf) acc0 = {0};
+    KERNEL(vf) acc1 = {0};
+    size_t i = 0;
+
+    for (; i + 2 * KERNEL_LANES <= n; i += 2 * KERNEL_LANES) {
+        acc0 += *(const KERNEL(vf) *)(x + i) * *(const KERNEL(vf) *)(y + i);
+        acc1 += *(const KERNEL(vf) *)(x + i + KERNEL_LANES) *
+                *(const KERNEL(vf) *)(y + i + KERNEL_LANES);
+    }
+    for (; i + KERNEL_LANES <= n; i += KERNEL_LANES) {
+        acc0 += *(const KERNEL(vf) *)(x + i) * *(const KERNEL(vf) *)(y + i);
+    }
+    acc0 += acc1;
+
+    float sum = KERNEL(hsum)(&acc0);
+    for (; i < n; i++) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+/**
+ * Dot product of a 16-bit vector with an int8 vector
+ *
+ * Plain integer code on purpose: the compiler turns it into the
+ * multiply-add instructions of the target.
+ */
+KERNEL_TARGET static int32_t KERNEL(dot_i8)(const int16_t *x, const int8_t *y, size_t n) {
+    int32_t acc = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        acc += x[i] * y[i];
+    }
+    return acc;
+}
+
+/**
+ * Sum of n floats
+ */
+KERNEL_TARGET static float KERNEL(sum_f32)(const float *x, size_t n) {
+    KERNEL(vf) acc0 = {0};
+    KERNEL(vf) acc1 = {0};
+    size_t i = 0;
+
+    for (; i + 2 * KERNEL_LANES <= n; i += 2 * KERNEL_LANES) {
+        acc0 += *(const KERNEL(vf) *)(x + i);
+        acc1 += *(const KERNEL(vf) *)(x + i + KERNEL_LANES);
+    }
+    acc0 += acc1;
+
+    float sum = KERNEL(hsum)(&acc0);
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+/**
+ * Minimum of each hash function over a set of keys
+ *
+ * Hash function h is the MurmurHash3 32-bit finalizer of seeds[h] ^ key.
+ * Each vector of hash functions stays in a register while the keys
+ * stream past it.
+ */
+KERNEL_TARGET static void KERNEL(minhash)(uint32_t *sig, const uint32_t *seeds, uint32_t hashes,
+                                          const uint32_t *keys, size_t n) {
+    for (uint32_t v = 0; v < hashes; v += KERNEL_LANES) {
+        KERNEL(vu) seed = *(const KERNEL(vu) *)(seeds + v);
+        KERNEL(vu) acc = (KERNEL(vu)){0} + UINT32_MAX;
+
+        for (size_t k = 0; k < n; k++) {
+            KERNEL(vu) h = seed ^ keys[k];
+            h ^= h >> 16;
+            h *= 0x85ebca6bu;
+            h ^= h >> 13;
+            h *= 0xc2b2ae35u;
+            h ^= h >> 16;
+            KERNEL(vu) less = (KERNEL(vu))(h < acc);
+            acc = (h & less) | (acc & ~less);
+        }
+        *(KERNEL(vu) *)(sig + v) = acc;
+    }
+}
+
+/**
+ * Conjunction of (strength, confidence) pairs: product and minimum
+ *
+ * Pairs are interleaved, so the even lanes of a vector carry strengths
+ * and the odd lanes confidences; both reductions run over every lane and
+ * each keeps only its own half at the end.
+ */
+KERNEL_TARGET static void KERNEL(tv_conjunction)(const float *premises, size_t n,
+                                                 float *strength, float *confidence) {
+    KERNEL(vf) product = (KERNEL(vf)){0} + 1.0f;
+    KERNEL(vf) product1 = product;
+    KERNEL(vf) lowest = product;
+    size_t floats = 2 * n;
+    size_t i = 0;
+
+    for (; i + 2 * KERNEL_LANES <= floats; i += 2 * KERNEL_LANES) {
+        KERNEL(vf) v = *(const KERNEL(vf) *)(premises + i);
+        KERNEL(vf) v1 = *(const KERNEL(vf) *)(premises + i + KERNEL_LANES);
+        KERNEL(vi) less = v1 < v;
+        KERNEL(vf) low = (KERNEL(vf))(((KERNEL(vi))v1 & less) | ((KERNEL(vi))v & ~less));
+
+        product *= v;
+        product1 *= v1;
+        less = low < lowest;
+        lowest = (KERNEL(vf))(((KERNEL(vi))low & less) | ((KERNEL(vi))lowest & ~less));
+    }
+    product *= product1;
+
+    const float *p = (const float *)&product;
+    const float *l = (const float *)&lowest;
+    float s = 1.0f;
+    float c = 1.0f;
+    for (int lane = 0; lane < KERNEL_LANES; lane += 2) {
+        s *= p[lane];
+        c = l[lane + 1] < c ? l[lane + 1] : c;
+    }
+    /* Fewer than two vectors left: finish pair by pair */
+    for (; i < floats; i += 2) {
+        s *= premises[i];
+        c = premises[i + 1] < c ? premises[i + 1] : c;
+    }
+
+    *strength = s;
+    *confidence = c;
+}
+
+/**
+ * Largest of n int16 values (n a multiple of 32)
+ */
+KERNEL_TARGET static int32_t KERNEL(max_i16)(const int16_t *x, size_t n) {
+    KERNEL(vs) acc = *(const KERNEL(vs) *)x;
+
+    for (size_t i = KERNEL_BYTES / 2; i < n; i += KERNEL_BYTES / 2) {
+        KERNEL(vs) v = *(const KERNEL(vs) *)(x + i);
+        KERNEL(vs) less = acc < v;
+        acc = (v & less) | (acc & ~less);
+    }
+
+    int16_t lanes[KERNEL_BYTES / 2];
+    memcpy(lanes, &acc, sizeof(lanes));
+    for (int width = KERNEL_BYTES / 4; width > 0; width /= 2) {
+        for (int lane = 0; lane < width; lane++) {
+            if (lanes[lane + width] > lanes[lane]) {
+                lanes[lane] = lanes[lane + width];
+            }
+        }
+    }
+    return lanes[0];
+}
+
+/**
+ * Scale n int16 values by a factor of at most 1, rounding half away from zero
+ *
+ * The product is formed in double, where it is exact, so every variant
+ * rounds the same way. Plain loops over 32 values the compiler unrolls
+ * into the vector instructions of the target; n is a multiple of 32.
+ */
+KERNEL_TARGET static void KERNEL(requant_i16)(int16_t *x, size_t n, float factor) {
+    for (size_t i = 0; i < n; i += 32) {
+        for (size_t j = i; j < i + 32; j++) {
+            double p = x[j] * (double)factor;
+            x[j] = (int16_t)(p < 0.0 ? p - 0.5 : p + 0.5);
+        }
+    }
+}
+
+/**
+ * Scale n int8 values like requant_i16()
+ */
+KERNEL_TARGET static void KERNEL(requant_i8)(int8_t *x, size_t n, float factor) {
+    for (size_t i = 0; i < n; i += 32) {
+        for (size_t j = i; j < i + 32; j++) {
+            double p = x[j] * (double)factor;
+            x[j] = (int8_t)(p < 0.0 ? p - 0.5 : p + 0.5);
+        }
+    }
+}
+
+/**
+ * Dispatch table of the variant
+ */
+static const struct cog_kernels KERNEL(kernels) = {
+    KERNEL(dot_f32),
+    KERNEL(dot_i8),
+    KERNEL(sum_f32),
+    KERNEL(minhash),
+    KERNEL(tv_conjunction),
+    KERNEL(max_i16),
+    KERNEL(requant_i16),
+    KERNEL(requant_i8)
+};
+
+#undef KERNEL_LANES
@@ -0,0 +1,344 @@
+/**
+ * @file cogctx.c
+ * @brief Kernel contexts - Context-taking variants of the public API
+ *
+ * Every kernel function works on the calling thread's current context.
+ * The variants here make the given context current for the duration of
+ * one call and restore the previous one, so a thread can drive several
+ * contexts without rebinding by hand.
+ */
+
+#include "cogkern_internal.h"
+
+/**
+ * Call a function with a context made current, returning its result
+ */
+#define CTX_CALL(ctx, call) \
+    do { \
+        struct cogkern_ctx *prev_ = cogkern_ctx_bind(ctx); \
+        __typeof__(call) ret_ = (call); \
+        cogkern_ctx_bind(prev_); \
+        return ret_; \
+    } while (0)
+
+/**
+ * Call a function returning void with a context made current
+ */
+#define CTX_CALL_VOID(ctx, call) \
+    do { \
+        struct cogkern_ctx *prev_ = cogkern_ctx_bind(ctx); \
+        (call); \
+        cogkern_ctx_bind(prev_); \
+    } while (0)
+
+struct ggml_context *cogkern_get_context_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL(ctx, cogkern_get_context());
+}
+
+int cogkern_mem_usage_ctx(struct cogkern_ctx *ctx, size_t *used, size_t *budget) {
+    CTX_CALL(ctx, cogkern_mem_usage(used, budget));
+}
+
+void *hgfs_alloc_ctx(struct cogkern_ctx *ctx, size_t size, uint32_t depth) {
+    CTX_CALL(ctx, hgfs_alloc(size, depth));
+}
+
+void hgfs_free_ctx(struct cogkern_ctx *ctx, void *ptr) {
+    CTX_CALL_VOID(ctx, hgfs_free(ptr));
+}
+
+void hgfs_release_depth_ctx(struct cogkern_ctx *ctx, uint32_t depth) {
+    CTX_CALL_VOID(ctx, hgfs_release_depth(depth));
+}
+
+int hgfs_get_stats_ctx(struct cogkern_ctx *ctx, uint32_t depth, struct hgfs_stats *stats) {
+    CTX_CALL(ctx, hgfs_get_stats(depth, stats));
+}
+
+atom_handle_t hgfs_edge_ctx(struct cogkern_ctx *ctx, atom_handle_t from, atom_handle_t to,
+                            enum atom_type edge_type) {
+    CTX_CALL(ctx, hgfs_edge(from, to, edge_type));
+}
+
+int hgfs_edge_remove_ctx(struct cogkern_ctx *ctx, atom_handle_t edge) {
+    CTX_CALL(ctx, hgfs_edge_remove(edge));
+}
+
+atom_handle_t cog_atom_alloc_ctx(struct cogkern_ctx *ctx, enum atom_type type, const char *name) {
+    CTX_CALL(ctx, cog_atom_alloc(type, name));
+}
+
+atom_handle_t cog_link_create_ctx(struct cogkern_ctx *ctx, enum atom_type type,
+                                  const atom_handle_t *outgoing, size_t outgoing_count) {
+    CTX_CALL(ctx, cog_link_create(type, outgoing, outgoing_count));
+}
+
+int cog_atom_alloc_batch_ctx(struct cogkern_ctx *ctx, enum atom_type type,
+                             const char *const *names, size_t count, atom_handle_t *out) {
+    CTX_CALL(ctx, cog_atom_alloc_batch(type, names, count, out));
+}
+
+int cog_link_outgoing_ctx(struct cogkern_ctx *ctx, atom_handle_t link, atom_handle_t *out,
+                          size_t max) {
+    CTX_CALL(ctx, cog_link_outgoing(link, out, max));
+}
+
+int cog_link_create_batch_ctx(struct cogkern_ctx *ctx, enum atom_type type,
+                              const atom_handle_t *outgoing, size_t arity, size_t count,
+                              atom_handle_t *out) {
+    CTX_CALL(ctx, cog_link_create_batch(type, outgoing, arity, count, out));
+}
+
+int cog_atom_remove_ctx(struct cogkern_ctx *ctx, atom_handle_t atom) {
+    CTX_CALL(ctx, cog_atom_remove(atom));
+}
+
+int cog_atom_valid_ctx(struct cogkern_ctx *ctx, atom_handle_t atom) {
+    CTX_CALL(ctx, cog_atom_valid(atom));
+}
+
+size_t cog_atom_type_count_ctx(struct cogkern_ctx *ctx, enum atom_type type) {
+    CTX_CALL(ctx, cog_atom_type_count(type));
+}
+
+void cog_atom_iter_init_ctx(struct cogkern_ctx *ctx, struct cog_atom_iter *it,
+                            enum atom_type type) {
+    CTX_CALL_VOID(ctx, cog_atom_iter_init(it, type));
+}
+
+size_t cog_atom_iter_next_ctx(struct cogkern_ctx *ctx, struct cog_atom_iter *it,
+                              atom_handle_t *out, size_t max) {
+    CTX_CALL(ctx, cog_atom_iter_next(it, out, max));
+}
+
+int cog_atom_reorder_ctx(struct cogkern_ctx *ctx, enum cog_reorder_method method) {
+    CTX_CALL(ctx, cog_atom_reorder(method));
+}
+
+int cog_adjacency_pack_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL(ctx, cog_adjacency_pack());
+}
+
+int cog_values_compact_ctx(struct cogkern_ctx *ctx, int enable) {
+    CTX_CALL(ctx, cog_values_compact(enable));
+}
+
+int cog_values_compact_get_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL(ctx, cog_values_compact_get());
+}
+
+int cog_traverse_ctx(struct cogkern_ctx *ctx, atom_handle_t start,
+                     const struct cog_traverse_params *params, atom_handle_t *out,
+                     uint32_t *hops, size_t max, struct cog_traverse_stats *stats) {
+    CTX_CALL(ctx, cog_traverse(start, params, out, hops, max, stats));
+}
+
+int cog_tier_open_ctx(struct cogkern_ctx *ctx, const char *path, size_t segment_size) {
+    CTX_CALL(ctx, cog_tier_open(path, segment_size));
+}
+
+int cog_tier_close_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL(ctx, cog_tier_close());
+}
+
+int cog_tier_set_params_ctx(struct cogkern_ctx *ctx, const struct cog_tier_params *params) {
+    CTX_CALL(ctx, cog_tier_set_params(params));
+}
+
+int cog_tier_page_out_ctx(struct cogkern_ctx *ctx, atom_handle_t atom) {
+    CTX_CALL(ctx, cog_tier_page_out(atom));
+}
+
+int cog_tier_get_stats_ctx(struct cogkern_ctx *ctx, struct cog_tier_stats *stats) {
+    CTX_CALL(ctx, cog_tier_get_stats(stats));
+}
+
+int cog_snapshot_begin_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL(ctx, cog_snapshot_begin());
+}
+
+void cog_snapshot_end_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL_VOID(ctx, cog_snapshot_end());
+}
+
+int cog_import_file_ctx(struct cogkern_ctx *ctx, const char *path, uint32_t threads,
+                        struct cog_import_stats *stats) {
+    CTX_CALL(ctx, cog_import_file(path, threads, stats));
+}
+
+int dtesn_sched_init_ctx(struct cogkern_ctx *ctx, uint32_t tick_interval_us) {
+    CTX_CALL(ctx, dtesn_sched_init(tick_interval_us));
+}
+
+int dtesn_sched_tick_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL(ctx, dtesn_sched_tick());
+}
+
+int dtesn_sched_set_av_ctx(struct cogkern_ctx *ctx, atom_handle_t atom,
+                           const struct attention_value *av) {
+    CTX_CALL(ctx, dtesn_sched_set_av(atom, av));
+}
+
+int dtesn_sched_set_av_batch_ctx(struct cogkern_ctx *ctx, const atom_handle_t *atoms,
+                                 const struct attention_value *avs, size_t count) {
+    CTX_CALL(ctx, dtesn_sched_set_av_batch(atoms, avs, count));
+}
+
+int dtesn_sched_get_av_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, struct attention_value *av) {
+    CTX_CALL(ctx, dtesn_sched_get_av(atom, av));
+}
+
+int dtesn_sched_set_forgetting_ctx(struct cogkern_ctx *ctx,
+                                   const struct ecan_forget_params *params) {
+    CTX_CALL(ctx, dtesn_sched_set_forgetting(params));
+}
+
+int dtesn_sched_get_forget_stats_ctx(struct cogkern_ctx *ctx, struct ecan_forget_stats *stats) {
+    CTX_CALL(ctx, dtesn_sched_get_forget_stats(stats));
+}
+
+int dtesn_sched_spread_importance_ctx(struct cogkern_ctx *ctx, atom_handle_t source,
+                                      float diffusion_rate) {
+    CTX_CALL(ctx, dtesn_sched_spread_importance(source, diffusion_rate));
+}
+
+int dtesn_sched_set_workers_ctx(struct cogkern_ctx *ctx, uint32_t workers) {
+    CTX_CALL(ctx, dtesn_sched_set_workers(workers));
+}
+
+int dtesn_sched_submit_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, dtesn_task_fn fn,
+                           void *arg) {
+    CTX_CALL(ctx, dtesn_sched_submit(atom, fn, arg));
+}
+
+int dtesn_sched_get_stats_ctx(struct cogkern_ctx *ctx, struct dtesn_sched_stats *stats) {
+    CTX_CALL(ctx, dtesn_sched_get_stats(stats));
+}
+
+int pln_eval_tensor_ctx(struct cogkern_ctx *ctx, struct ggml_tensor *expr,
+                        struct truth_value *result) {
+    CTX_CALL(ctx, pln_eval_tensor(expr, result));
+}
+
+int pln_unify_graph_ctx(struct cogkern_ctx *ctx, struct ggml_tensor *pattern,
+                        struct ggml_tensor *target, struct ggml_tensor **result) {
+    CTX_CALL(ctx, pln_unify_graph(pattern, target, result));
+}
+
+int pln_infer_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, struct truth_value *tv) {
+    CTX_CALL(ctx, pln_infer(atom, tv));
+}
+
+int pln_set_tv_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, const struct truth_value *tv) {
+    CTX_CALL(ctx, pln_set_tv(atom, tv));
+}
+
+int pln_set_tv_batch_ctx(struct cogkern_ctx *ctx, const atom_handle_t *atoms,
+                         const struct truth_value *tvs, size_t count) {
+    CTX_CALL(ctx, pln_set_tv_batch(atoms, tvs, count));
+}
+
+atom_handle_t cog_link_infer_ctx(struct cogkern_ctx *ctx, atom_handle_t premise,
+                                 atom_handle_t conclusion, const struct truth_value *tv) {
+    CTX_CALL(ctx, cog_link_infer(premise, conclusion, tv));
+}
+
+int cog_embed_init_ctx(struct cogkern_ctx *ctx, uint32_t dim, enum cog_embed_format format) {
+    CTX_CALL(ctx, cog_embed_init(dim, format));
+}
+
+int cog_embed_set_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, const float *vec) {
+    CTX_CALL(ctx, cog_embed_set(atom, vec));
+}
+
+int cog_embed_get_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, float *vec) {
+    CTX_CALL(ctx, cog_embed_get(atom, vec));
+}
+
+int cog_embed_remove_ctx(struct cogkern_ctx *ctx, atom_handle_t atom) {
+    CTX_CALL(ctx, cog_embed_remove(atom));
+}
+
+int cog_embed_index_build_ctx(struct cogkern_ctx *ctx, uint32_t lists) {
+    CTX_CALL(ctx, cog_embed_index_build(lists));
+}
+
+int cog_embed_search_ctx(struct cogkern_ctx *ctx, const float *query, size_t k, uint32_t probes,
+                         struct cog_embed_match *out) {
+    CTX_CALL(ctx, cog_embed_search(query, k, probes, out));
+}
+
+int cog_embed_link_similar_ctx(struct cogkern_ctx *ctx, atom_handle_t atom, size_t k,
+                               uint32_t probes, float min_score, float confidence) {
+    CTX_CALL(ctx, cog_embed_link_similar(atom, k, probes, min_score, confidence));
+}
+
+int cog_similarity_discover_ctx(struct cogkern_ctx *ctx,
+                                const struct cog_similarity_params *params,
+                                struct cog_similarity_stats *stats) {
+    CTX_CALL(ctx, cog_similarity_discover(params, stats));
+}
+
+int cogloop_boot_stage_ctx(struct cogkern_ctx *ctx, enum boot_stage stage) {
+    CTX_CALL(ctx, cogloop_boot_stage(stage));
+}
+
+int stage1_init_hypergraph_fs_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL(ctx, stage1_init_hypergraph_fs());
+}
+
+int dtesn_mem_set_flags_ctx(struct cogkern_ctx *ctx, uint32_t flags) {
+    CTX_CALL(ctx, dtesn_mem_set_flags(flags));
+}
+
+int dtesn_mem_init_regions_ctx(struct cogkern_ctx *ctx, size_t num_regions) {
+    CTX_CALL(ctx, dtesn_mem_init_regions(num_regions));
+}
+
+int dtesn_mem_get_stats_ctx(struct cogkern_ctx *ctx, struct dtesn_mem_stats *stats) {
+    CTX_CALL(ctx, dtesn_mem_get_stats(stats));
+}
+
+int cog_event_queue_init_ctx(struct cogkern_ctx *ctx, size_t capacity, uint32_t drain_batch) {
+    CTX_CALL(ctx, cog_event_queue_init(capacity, drain_batch));
+}
+
+int cog_event_post_ctx(struct cogkern_ctx *ctx, const struct cog_event *event) {
+    CTX_CALL(ctx, cog_event_post(event));
+}
+
+int cog_event_get_stats_ctx(struct cogkern_ctx *ctx, struct cog_event_stats *stats) {
+    CTX_CALL(ctx, cog_event_get_stats(stats));
+}
+
+int cogloop_set_pipeline_ctx(struct cogkern_ctx *ctx, const struct cogloop_pipeline_params *params) {
+    CTX_CALL(ctx, cogloop_set_pipeline(params));
+}
+
+int cogloop_get_stats_ctx(struct cogkern_ctx *ctx, struct cogloop_stats *stats) {
+    CTX_CALL(ctx, cogloop_get_stats(stats));
+}
+
+int cogloop_tick_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL(ctx, cogloop_tick());
+}
+
+int cogloop_start_ctx(struct cogkern_ctx *ctx, uint32_t hz) {
+    CTX_CALL(ctx, cogloop_start(hz));
+}
+
+void cogloop_stop_ctx(struct cogkern_ctx *ctx) {
+    CTX_CALL_VOID(ctx, cogloop_stop());
+}
+
+int cogkern_stats_ctx(struct cogkern_ctx *ctx, struct cogkern_stats *stats) {
+    CTX_CALL(ctx, cogkern_stats(stats));
+}
+
+int cogkern_stats_write_ctx(struct cogkern_ctx *ctx, const char *path) {
+    CTX_CALL(ctx, cogkern_stats_write(path));
+}
+
+int cogkern_stats_dump_every_ctx(struct cogkern_ctx *ctx, const char *path, uint32_t ticks) {
+    CTX_CALL(ctx, cogkern_stats_dump_every(path, ticks));
+}
@@ -0,0 +1,832 @@
+/**
+ * @file cogembed.c
+ * @brief Embeddings - Per-atom vectors and similarity search
+ *
+ * Embeddings live in one dense matrix per context, a row per atom that
+ * has one, each row padded to whole cache lines. Rows are normalized when
+ * stored, so cosine similarity is a plain dot product. A handle-indexed
+ * table maps atoms to rows; handle indices survive reordering and paging,
+ * so neither has to touch the matrix. Removing a row moves the last row
+ * into its place, which keeps the matrix dense for brute-force scans.
+ *
+ * Rows are scored with the dot product kernels picked for the host CPU
+ * (cogcpu.c). Int8 rows are scored in integer arithmetic against a
+ * 16-bit copy of the query, so they cost a quarter of the memory traffic
+ * of float rows.
+ *
+ * The approximate index is an inverted file: spherical k-means centroids,
+ * each with the list of rows nearest to it. A query scores the centroids,
+ * then only the rows in the lists of the nearest few.
+ */
+
+#include "cogkern_internal.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Rows are padded to this many bytes
+ */
+#define EMBED_ROW_ALIGN 64
+
+/**
+ * Training sample size per list and k-means iterations of an index build
+ */
+#define EMBED_TRAIN_PER_LIST 32
+#define EMBED_TRAIN_ITERS 8
+
+/**
+ * Per-row metadata
+ */
+struct embed_row {
+    atom_handle_t atom;
+    float scale;               /**< Int8 dequantization scale (1.0 for floats) */
+    uint32_t list;             /**< Inverted list holding the row */
+    uint32_t pos;              /**< Position of the row in that list */
+    uint32_t pad;
+};
+
+/**
+ * Inverted list of the approximate index
+ */
+struct embed_list {
+    uint32_t *rows;
+    uint32_t count;
+    uint32_t cap;
+};
+
+/**
+ * Scored row or list, as kept in a top-k heap
+ */
+struct embed_hit {
+    float score;
+    uint32_t id;
+};
+
+/**
+ * Query prepared for scoring
+ */
+struct embed_query {
+    const struct cog_kernels *kern;
+    const float *unit;         /**< Unit vector, stride floats */
+    float scale;               /**< Value of one step of the 16-bit copy */
+    int16_t fixed[COG_EMBED_MAX_DIM]; /**< 16-bit copy, for int8 rows */
+};
+
+/**
+ * Embedding state
+ */
+struct embed_state {
+    uint32_t dim;              /**< Vector dimension, 0 until cog_embed_init() */
+    uint32_t stride;           /**< Elements per row, dim rounded up to EMBED_ROW_ALIGN bytes */
+    enum cog_embed_format format;
+    size_t row_bytes;
+    uint8_t *data;             /**< Row matrix */
+    size_t data_capacity;      /**< Rows */
+    struct embed_row *rows;
+    size_t row_capacity;
+    uint32_t *row_of;          /**< 1 + row of each handle index, 0 if none */
+    size_t row_of_capacity;
+    size_t count;              /**< Rows in use */
+    uint32_t lists;            /**< Inverted lists, 0 while no index is built */
+    float *centroids;          /**< lists unit vectors of stride floats */
+    struct embed_list *list;
+};
+
+/**
+ * Embedding state of the default context
+ */
+struct embed_state embed_default = {0};
+
+/**
+ * Embedding state of the calling thread's context
+ */
+#define g_embed (*cogkern_ctx_current()->embed)
+
+/**
+ * Allocate embedding state for a new context
+ */
+struct embed_state *embed_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct embed_state));
+}
+
+/**
+ * Fill in the 16-bit copy of a query used against int8 rows
+ *
+ * The step is chosen so no dot product can overflow 32 bits: by
+ * Cauchy-Schwarz it is at most the largest step count times 127 times
+ * the stride.
+ */
+static void embed_query_prepare(struct embed_query *q, const float *unit) {
+    q->kern = cpu_kernels();
+    q->unit = unit;
+    if (g_embed.format == COG_EMBED_F32) {
+        return;
+    }
+
+    float max = 0.0f;
+    for (uint32_t i = 0; i < g_embed.dim; i++) {
+        max = fmaxf(max, fabsf(unit[i]));
+    }
+    int32_t steps = INT32_MAX / (127 * (int32_t)g_embed.stride);
+    if (steps > INT16_MAX) {
+        steps = INT16_MAX;
+    }
+    q->scale = max / (float)steps;
+    for (uint32_t i = 0; i < g_embed.stride; i++) {
+        q->fixed[i] = (int16_t)lrintf(unit[i] / q->scale);
+    }
+}
+
+/**
+ * Cosine similarity of a prepared query with a stored row
+ */
+static inline float embed_score(const struct embed_query *q, uint32_t row) {
+    const uint8_t *p = g_embed.data + (size_t)row * g_embed.row_bytes;
+
+    if (g_embed.format == COG_EMBED_F32) {
+        return q->kern->dot_f32(q->unit, (const float *)p, g_embed.stride);
+    }
+    return g_embed.rows[row].scale * q->scale *
+           (float)q->kern->dot_i8(q->fixed, (const int8_t *)p, g_embed.stride);
+}
+
+/**
+ * Normalize a vector into stride floats, zero padded
+ *
+ * @return 0 on success, negative for a zero or non-finite vector
+ */
+static int embed_normalize(const float *vec, float *out) {
+    double sum = 0.0;
+
+    for (uint32_t i = 0; i < g_embed.dim; i++) {
+        sum += (double)vec[i] * vec[i];
+    }
+    if (!(sum > 0.0) || !isfinite(sum)) {
+        return -1;
+    }
+
+    float inv = (float)(1.0 / sqrt(sum));
+    for (uint32_t i = 0; i < g_embed.dim; i++) {
+        out[i] = vec[i] * inv;
+    }
+    memset(out + g_embed.dim, 0, (g_embed.stride - g_embed.dim) * sizeof(float));
+    return 0;
+}
+
+/**
+ * Write a unit vector (stride floats) into a row
+ */
+static void embed_store(uint32_t row, const float *unit) {
+    uint8_t *p = g_embed.data + (size_t)row * g_embed.row_bytes;
+
+    if (g_embed.format == COG_EMBED_F32) {
+        memcpy(p, unit, g_embed.row_bytes);
+        g_embed.rows[row].scale = 1.0f;
+        return;
+    }
+
+    float max = 0.0f;
+    for (uint32_t i = 0; i < g_embed.dim; i++) {
+        max = fmaxf(max, fabsf(unit[i]));
+    }
+    float scale = max / 127.0f;
+    int8_t *q = (int8_t *)p;
+    for (uint32_t i = 0; i < g_embed.stride; i++) {
+        q[i] = (int8_t)lrintf(unit[i] / scale);
+    }
+    g_embed.rows[row].scale = scale;
+}
+
+/**
+ * Read a row back as stride floats
+ */
+static void embed_load(uint32_t row, float *out) {
+    const uint8_t *p = g_embed.data + (size_t)row * g_embed.row_bytes;
+
+    if (g_embed.format == COG_EMBED_F32) {
+        memcpy(out, p, g_embed.row_bytes);
+        return;
+    }
+
+    const int8_t *q = (const int8_t *)p;
+    for (uint32_t i = 0; i < g_embed.stride; i++) {
+        out[i] = q[i] * g_embed.rows[row].scale;
+    }
+}
+
+/**
+ * Row of an atom's embedding
+ *
+ * @return 0 on success, negative if the atom has none
+ */
+static int embed_row_of(atom_handle_t atom, uint32_t *row) {
+    uint32_t index = COG_HANDLE_SLOT(atom);
+
+    if (!atom || index >= g_embed.row_of_capacity || g_embed.row_of[index] == 0) {
+        return -1;
+    }
+    *row = g_embed.row_of[index] - 1;
+    return g_embed.rows[*row].atom == atom ? 0 : -1;
+}
+
+/**
+ * Nearest of a set of centroids to a unit vector
+ */
+static uint32_t embed_nearest(const float *centroids, uint32_t lists, const float *unit) {
+    const struct cog_kernels *kern = cpu_kernels();
+    uint32_t best = 0;
+    float best_score = -INFINITY;
+
+    for (uint32_t c = 0; c < lists; c++) {
+        float score = kern->dot_f32(unit, centroids + (size_t)c * g_embed.stride, g_embed.stride);
+        if (score > best_score) {
+            best_score = score;
+            best = c;
+        }
+    }
+    return best;
+}
+
+/**
+ * Make room for one more row in an inverted list
+ *
+ * @return 0 on success, negative on error
+ */
+static int embed_list_reserve(struct embed_list *l) {
+    if (l->count < l->cap) {
+        return 0;
+    }
+
+    uint32_t cap = l->cap ? l->cap * 2 : 16;
+    uint32_t *grown = realloc(l->rows, cap * sizeof(uint32_t));
+    if (!grown) {
+        return -1;
+    }
+    l->rows = grown;
+    l->cap = cap;
+    return 0;
+}
+
+/**
+ * Append a row to an inverted list with room for it
+ */
+static void embed_list_add(uint32_t list, uint32_t row) {
+    struct embed_list *l = &g_embed.list[list];
+
+    g_embed.rows[row].list = list;
+    g_embed.rows[row].pos = l->count;
+    l->rows[l->count++] = row;
+}
+
+/**
+ * Take a row out of its inverted list
+ */
+static void embed_list_del(uint32_t row) {
+    struct embed_list *l = &g_embed.list[g_embed.rows[row].list];
+    uint32_t pos = g_embed.rows[row].pos;
+    uint32_t last = l->rows[--l->count];
+
+    l->rows[pos] = last;
+    g_embed.rows[last].pos = pos;
+}
+
+/**
+ * Free a row, moving the last row into its place
+ */
+static void embed_row_drop(uint32_t row) {
+    uint32_t last = (uint32_t)g_embed.count - 1;
+
+    if (g_embed.lists) {
+        embed_list_del(row);
+    }
+    g_embed.row_of[COG_HANDLE_SLOT(g_embed.rows[row].atom)] = 0;
+
+    if (row != last) {
+        memcpy(g_embed.data + (size_t)row * g_embed.row_bytes,
+               g_embed.data + (size_t)last * g_embed.row_bytes, g_embed.row_bytes);
+        g_embed.rows[row] = g_embed.rows[last];
+        g_embed.row_of[COG_HANDLE_SLOT(g_embed.rows[row].atom)] = row + 1;
+        if (g_embed.lists) {
+            g_embed.list[g_embed.rows[row].list].rows[g_embed.rows[row].pos] = row;
+        }
+    }
+    g_embed.count--;
+}
+
+/**
+ * Free the approximate index
+ */
+static void embed_index_free(void) {
+    for (uint32_t c = 0; c < g_embed.lists; c++) {
+        free(g_embed.list[c].rows);
+    }
+    free(g_embed.list);
+    free(g_embed.centroids);
+    g_embed.list = NULL;
+    g_embed.centroids = NULL;
+    g_embed.lists = 0;
+}
+
+/**
+ * Offer a scored id to a min-heap of the k best seen so far
+ */
+static inline void embed_offer(struct embed_hit *heap, size_t *n, size_t k, float score,
+                               uint32_t id) {
+    size_t i;
+
+    if (*n < k) {
+        /* Sift up from the new leaf */
+        i = (*n)++;
+        while (i > 0 && heap[(i - 1) / 2].score > score) {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+    } else if (score > heap[0].score) {
+        /* Replace the worst and sift down */
+        i = 0;
+        for (;;) {
+            size_t child = 2 * i + 1;
+            if (child >= k) {
+                break;
+            }
+            if (child + 1 < k && heap[child + 1].score < heap[child].score) {
+                child++;
+            }
+            if (heap[child].score >= score) {
+                break;
+            }
+            heap[i] = heap[child];
+            i = child;
+        }
+    } else {
+        return;
+    }
+    heap[i].score = score;
+    heap[i].id = id;
+}
+
+/**
+ * Best score first, ties by id
+ */
+static int embed_hit_cmp(const void *a, const void *b) {
+    const struct embed_hit *x = a;
+    const struct embed_hit *y = b;
+
+    if (x->score != y->score) {
+        return x->score > y->score ? -1 : 1;
+    }
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+/**
+ * Find the k rows most similar to a unit query (stride floats)
+ *
+ * @param hits Array of k entries to receive rows, best first
+ * @return Number of hits, negative on error
+ */
+static long embed_search_unit(const float *unit, size_t k, uint32_t probes,
+                              struct embed_hit *hits) {
+    struct embed_query q;
+    size_t n = 0;
+
+    embed_query_prepare(&q, unit);
+
+    if (probes == 0 || g_embed.lists == 0) {
+        for (uint32_t r = 0; r < g_embed.count; r++) {
+            embed_offer(hits, &n, k, embed_score(&q, r), r);
+        }
+    } else {
+        if (probes > g_embed.lists) {
+            probes = g_embed.lists;
+        }
+        struct embed_hit *near = malloc(probes * sizeof(*near));
+        if (!near) {
+            return -1;
+        }
+
+        size_t probed = 0;
+        for (uint32_t c = 0; c < g_embed.lists; c++) {
+            const float *centroid = g_embed.centroids + (size_t)c * g_embed.stride;
+            embed_offer(near, &probed, probes, q.kern->dot_f32(unit, centroid, g_embed.stride), c);
+        }
+        for (size_t i = 0; i < probed; i++) {
+            const struct embed_list *l = &g_embed.list[near[i].id];
+            for (uint32_t j = 0; j < l->count; j++) {
+                embed_offer(hits, &n, k, embed_score(&q, l->rows[j]), l->rows[j]);
+            }
+        }
+        free(near);
+    }
+
+    qsort(hits, n, sizeof(*hits), embed_hit_cmp);
+    return (long)n;
+}
+
+/**
+ * Set the dimension and storage format of atom embeddings
+ *
+ * @param dim Vector dimension (1 to COG_EMBED_MAX_DIM)
+ * @param format Storage format
+ * @return 0 on success, negative on error
+ */
+int cog_embed_init(uint32_t dim, enum cog_embed_format format) {
+    if (dim == 0 || dim > COG_EMBED_MAX_DIM ||
+        (format != COG_EMBED_F32 && format != COG_EMBED_I8)) {
+        return -1;
+    }
+    if (g_embed.count > 0) {
+        return dim == g_embed.dim && format == g_embed.format ? 0 : -1;
+    }
+
+    /* The row size may change, so start from empty tables */
+    embed_index_free();
+    cogkern_table_free((void **)&g_embed.data, &g_embed.data_capacity, g_embed.row_bytes);
+
+    size_t elem = format == COG_EMBED_F32 ? sizeof(float) : sizeof(int8_t);
+    size_t per_align = EMBED_ROW_ALIGN / elem;
+    g_embed.dim = dim;
+    g_embed.format = format;
+    g_embed.stride = (uint32_t)((dim + per_align - 1) / per_align * per_align);
+    g_embed.row_bytes = g_embed.stride * elem;
+    return 0;
+}
+
+/**
+ * Attach an embedding to an atom, replacing any it had
+ *
+ * @param atom Atom handle
+ * @param vec Vector of the configured dimension
+ * @return 0 on success, negative on error
+ */
+int cog_embed_set(atom_handle_t atom, const float *vec) {
+    float unit[COG_EMBED_MAX_DIM];
+    uint32_t slot;
+    uint32_t row = 0;
+
+    if (g_embed.dim == 0 || !vec || atomspace_lookup(atom, &slot) != 0 ||
+        embed_normalize(vec, unit) != 0) {
+        return -1;
+    }
+
+    /* Reserve everything first so a failure changes nothing */
+    uint32_t index = COG_HANDLE_SLOT(atom);
+    int existing = embed_row_of(atom, &row) == 0;
+    if (cogkern_table_reserve((void **)&g_embed.row_of, &g_embed.row_of_capacity,
+                              sizeof(uint32_t), (size_t)index + 1) != 0 ||
+        cogkern_table_reserve((void **)&g_embed.data, &g_embed.data_capacity,
+                              g_embed.row_bytes, g_embed.count + 1) != 0 ||
+        cogkern_table_reserve((void **)&g_embed.rows, &g_embed.row_capacity,
+                              sizeof(struct embed_row), g_embed.count + 1) != 0) {
+        return -1;
+    }
+    uint32_t list = 0;
+    if (g_embed.lists) {
+        list = embed_nearest(g_embed.centroids, g_embed.lists, unit);
+        if (embed_list_reserve(&g_embed.list[list]) != 0) {
+            return -1;
+        }
+    }
+
+    if (existing) {
+        if (g_embed.lists) {
+            embed_list_del(row);
+        }
+    } else {
+        row = (uint32_t)g_embed.count++;
+        g_embed.rows[row].atom = atom;
+        g_embed.row_of[index] = row + 1;
+    }
+    embed_store(row, unit);
+    if (g_embed.lists) {
+        embed_list_add(list, row);
+    }
+    return 0;
+}
+
+/**
+ * Copy the stored (normalized) embedding of an atom
+ *
+ * @param atom Atom handle
+ * @param vec Array of the configured dimension to receive the vector
+ * @return 0 on success, negative if the atom has no embedding
+ */
+int cog_embed_get(atom_handle_t atom, float *vec) {
+    float unit[COG_EMBED_MAX_DIM];
+    uint32_t row;
+
+    if (!vec || embed_row_of(atom, &row) != 0) {
+        return -1;
+    }
+
+    embed_load(row, unit);
+    memcpy(vec, unit, g_embed.dim * sizeof(float));
+    return 0;
+}
+
+/**
+ * Remove the embedding of an atom
+ *
+ * @param atom Atom handle
+ * @return 0 on success, negative if the atom has no embedding
+ */
+int cog_embed_remove(atom_handle_t atom) {
+    uint32_t row;
+
+    if (embed_row_of(atom, &row) != 0) {
+        return -1;
+    }
+
+    embed_row_drop(row);
+    return 0;
+}
+
+/**
+ * Drop the embedding of an atom being removed, if it has one
+ */
+void embed_forget_atom(atom_handle_t atom) {
+    uint32_t row;
+
+    if (embed_row_of(atom, &row) == 0) {
+        embed_row_drop(row);
+    }
+}
+
+/**
+ * Regroup rows so each inverted list is contiguous in the matrix
+ *
+ * Scanning a list then streams through memory instead of hopping across
+ * it. The order is left alone if the copy cannot be allocated.
+ *
+ * @param assign List of each row, rewritten to match the new order
+ * @param members Rows in each list
+ */
+static void embed_cluster_rows(uint32_t *assign, const uint32_t *members, uint32_t lists) {
+    size_t count = g_embed.count;
+    size_t row_bytes = g_embed.row_bytes;
+    uint8_t *data = NULL;
+    size_t data_capacity = 0;
+    struct embed_row *rows = NULL;
+    size_t row_capacity = 0;
+    uint32_t *next = malloc(lists * sizeof(uint32_t));
+
+    if (!next ||
+        cogkern_table_reserve((void **)&data, &data_capacity, row_bytes, count) != 0 ||
+        cogkern_table_reserve((void **)&rows, &row_capacity, sizeof(struct embed_row),
+                              count) != 0) {
+        cogkern_table_free((void **)&data, &data_capacity, row_bytes);
+        free(next);
+        return;
+    }
+
+    uint32_t start = 0;
+    for (uint32_t c = 0; c < lists; c++) {
+        next[c] = start;
+        start += members[c];
+    }
+    for (size_t r = 0; r < count; r++) {
+        uint32_t to = next[assign[r]]++;
+        memcpy(data + (size_t)to * row_bytes, g_embed.data + r * row_bytes, row_bytes);
+        rows[to] = g_embed.rows[r];
+        g_embed.row_of[COG_HANDLE_SLOT(rows[to].atom)] = to + 1;
+    }
+
+    size_t r = 0;
+    for (uint32_t c = 0; c < lists; c++) {
+        for (uint32_t i = 0; i < members[c]; i++) {
+            assign[r++] = c;
+        }
+    }
+
+    cogkern_table_free((void **)&g_embed.data, &g_embed.data_capacity, row_bytes);
+    cogkern_table_free((void **)&g_embed.rows, &g_embed.row_capacity, sizeof(struct embed_row));
+    g_embed.data = data;
+    g_embed.data_capacity = data_capacity;
+    g_embed.rows = rows;
+    g_embed.row_capacity = row_capacity;
+    free(next);
+}
+
+/**
+ * Build an approximate search index over the stored embeddings
+ *
+ * @param lists Number of inverted lists (0 picks the square root of the
+ *        number of embeddings)
+ * @return 0 on success, negative on error
+ */
+int cog_embed_index_build(uint32_t lists) {
+    size_t count = g_embed.count;
+    uint32_t stride = g_embed.stride;
+
+    if (g_embed.dim == 0 || count == 0) {
+        return -1;
+    }
+    if (lists == 0) {
+        lists = (uint32_t)sqrt((double)count);
+    }
+    if (lists == 0 || lists > count) {
+        lists = lists == 0 ? 1 : (uint32_t)count;
+    }
+
+    float *centroids = malloc((size_t)lists * stride * sizeof(float));
+    float *sums = malloc((size_t)lists * stride * sizeof(float));
+    uint32_t *members = malloc(lists * sizeof(uint32_t));
+    uint32_t *assign = malloc(count * sizeof(uint32_t));
+    struct embed_list *list = calloc(lists, sizeof(*list));
+    float *v = malloc(stride * sizeof(float));
+    int rc = centroids && sums && members && assign && list && v ? 0 : -1;
+
+    /* Spherical k-means on an evenly spaced sample, seeded from it too */
+    size_t sample = count < (size_t)EMBED_TRAIN_PER_LIST * lists
+                        ? count : (size_t)EMBED_TRAIN_PER_LIST * lists;
+    for (uint32_t c = 0; c < lists && rc == 0; c++) {
+        embed_load((uint32_t)((size_t)c * count / lists), centroids + (size_t)c * stride);
+    }
+    for (int it = 0; it < EMBED_TRAIN_ITERS && rc == 0; it++) {
+        memset(sums, 0, (size_t)lists * stride * sizeof(float));
+        memset(members, 0, lists * sizeof(uint32_t));
+        for (size_t i = 0; i < sample; i++) {
+            embed_load((uint32_t)(i * count / sample), v);
+            uint32_t c = embed_nearest(centroids, lists, v);
+            float *sum = sums + (size_t)c * stride;
+            for (uint32_t d = 0; d < stride; d++) {
+                sum[d] += v[d];
+            }
+            members[c]++;
+        }
+
+        /* A centroid that attracted nothing stays where it was */
+        for (uint32_t c = 0; c < lists; c++) {
+            float *sum = sums + (size_t)c * stride;
+            double norm = 0.0;
+            for (uint32_t d = 0; d < stride; d++) {
+                norm += (double)sum[d] * sum[d];
+            }
+            if (members[c] > 0 && norm > 0.0) {
+                float inv = (float)(1.0 / sqrt(norm));
+                for (uint32_t d = 0; d < stride; d++) {
+                    centroids[(size_t)c * stride + d] = sum[d] * inv;
+                }
+            }
+        }
+    }
+
+    /* Assign every row, then size each list exactly */
+    if (rc == 0) {
+        memset(members, 0, lists * sizeof(uint32_t));
+        for (size_t r = 0; r < count; r++) {
+            embed_load((uint32_t)r, v);
+            assign[r] = embed_nearest(centroids, lists, v);
+            members[assign[r]]++;
+        }
+    }
+    for (uint32_t c = 0; c < lists && rc == 0; c++) {
+        list[c].cap = members[c] > 0 ? members[c] : 1;
+        list[c].rows = malloc(list[c].cap * sizeof(uint32_t));
+        if (!list[c].rows) {
+            rc = -1;
+        }
+    }
+
+    if (rc == 0) {
+        embed_index_free();
+        g_embed.lists = lists;
+        g_embed.centroids = centroids;
+        g_embed.list = list;
+        embed_cluster_rows(assign, members, lists);
+        for (size_t r = 0; r < count; r++) {
+            embed_list_add(assign[r], (uint32_t)r);
+        }
+        centroids = NULL;
+        list = NULL;
+    }
+
+    if (list) {
+        for (uint32_t c = 0; c < lists; c++) {
+            free(list[c].rows);
+        }
+        free(list);
+    }
+    free(centroids);
+    free(sums);
+    free(members);
+    free(assign);
+    free(v);
+    return rc;
+}
+
+/**
+ * Find the stored embeddings most similar to a query vector
+ *
+ * @param query Vector of the configured dimension
+ * @param k Number of results wanted
+ * @param probes Inverted lists to scan, 0 for an exact search
+ * @param out Array to receive up to k matches, most similar first
+ * @return Number of matches stored, negative on error
+ */
+int cog_embed_search(const float *query, size_t k, uint32_t probes,
+                     struct cog_embed_match *out) {
+    float q[COG_EMBED_MAX_DIM];
+
+    if (g_embed.dim == 0 || !query || (!out && k > 0) || embed_normalize(query, q) != 0) {
+        return -1;
+    }
+    if (k > g_embed.count) {
+        k = g_embed.count;
+    }
+    if (k == 0) {
+        return 0;
+    }
+
+    struct embed_hit *hits = malloc(k * sizeof(*hits));
+    long n = hits ? embed_search_unit(q, k, probes, hits) : -1;
+    for (long i = 0; i < n; i++) {
+        out[i].atom = g_embed.rows[hits[i].id].atom;
+        out[i].score = hits[i].score;
+    }
+    free(hits);
+    return (int)n;
+}
+
+/**
+ * Link an atom to its most similar atoms by embedding
+ *
+ * @param atom Atom handle (must have an embedding)
+ * @param k Neighbours to consider
+ * @param probes Inverted lists to scan, 0 for an exact search
+ * @param min_score Smallest cosine similarity that gets a link
+ * @param confidence Truth value confidence of the links
+ * @return Number of links created or updated, negative on error
+ */
+int cog_embed_link_similar(atom_handle_t atom, size_t k, uint32_t probes, float min_score,
+                           float confidence) {
+    float q[COG_EMBED_MAX_DIM];
+    uint32_t row;
+    uint32_t slot;
+
+    if (embed_row_of(atom, &row) != 0 || atomspace_lookup(atom, &slot) != 0) {
+        return -1;
+    }
+
+    /* One extra, as the atom finds itself */
+    size_t want = k + 1 < g_embed.count ? k + 1 : g_embed.count;
+    struct embed_hit *hits = malloc(want * sizeof(*hits));
+    if (!hits) {
+        return -1;
+    }
+    embed_load(row, q);
+    long n = embed_search_unit(q, want, probes, hits);
+
+    /* Creating links never moves embedding rows, so the hits stay valid */
+    int linked = 0;
+    for (long i = 0; i < n; i++) {
+        atom_handle_t other = g_embed.rows[hits[i].id].atom;
+        if (hits[i].id == row || hits[i].score < min_score) {
+            continue;
+        }
+
+        struct truth_value tv = {fminf(fmaxf(hits[i].score, 0.0f), 1.0f), confidence};
+        atom_handle_t pair[2] = {atom, other};
+        atom_handle_t link = atomspace_find_pair(slot, ATOM_SIMILARITY, other);
+        if (!link) {
+            link = cog_link_create(ATOM_SIMILARITY, pair, 2);
+        }
+        if (link && pln_set_tv(link, &tv) == 0) {
+            linked++;
+        }
+    }
+
+    free(hits);
+    return n < 0 ? -1 : linked;
+}
+
+/**
+ * Fill the embedding part of cogkern_stats()
+ */
+void embed_fill_stats(struct cogkern_stats *stats) {
+    size_t bytes = g_embed.data_capacity * g_embed.row_bytes +
+                   g_embed.row_capacity * sizeof(struct embed_row) +
+                   g_embed.row_of_capacity * sizeof(uint32_t) +
+                   (size_t)g_embed.lists *
+                       (g_embed.stride * sizeof(float) + sizeof(struct embed_list));
+
+    for (uint32_t c = 0; c < g_embed.lists; c++) {
+        bytes += g_embed.list[c].cap * sizeof(uint32_t);
+    }
+    stats->embeddings = g_embed.count;
+    stats->embedding_bytes = bytes;
+}
+
+/**
+ * Drop all embeddings and the similarity index
+ */
+void embed_reset(void) {
+    embed_index_free();
+    cogkern_table_free((void **)&g_embed.data, &g_embed.data_capacity, g_embed.row_bytes);
+    cogkern_table_free((void **)&g_embed.rows, &g_embed.row_capacity, sizeof(struct embed_row));
+    cogkern_table_free((void **)&g_embed.row_of, &g_embed.row_of_capacity, sizeof(uint32_t));
+    g_embed.count = 0;
+    g_embed.dim = 0;
+    g_embed.stride = 0;
+    g_embed.row_bytes = 0;
+}
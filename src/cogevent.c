@@ -0,0 +1,312 @@
+/**
+ * @file cogevent.c
+ * @brief Stimulus event queue - Lock-free MPSC input to the cognitive loop
+ *
+ * A bounded ring of cells, each carrying a sequence number (Vyukov's
+ * bounded queue). A producer claims a position with one compare-and-swap
+ * on the enqueue cursor, copies its event into the cell and publishes it
+ * by storing the next sequence number; a full queue is detected from the
+ * cell's sequence without ever waiting. The loop thread is the only
+ * consumer, so dequeuing needs no atomic read-modify-write at all.
+ *
+ * Sensor threads therefore never touch the AtomSpace: cogloop_tick()
+ * drains a bounded batch of events before running the scheduler and
+ * applies them on the loop thread.
+ */
+
+#include "cogkern_internal.h"
+#include <string.h>
+
+/**
+ * Queue defaults used by STAGE3_COGNITIVE
+ */
+#define COG_EVENT_DEFAULT_CAPACITY 4096
+#define COG_EVENT_DEFAULT_BATCH 1024
+
+/**
+ * One queue slot
+ */
+struct event_cell {
+    uint64_t seq;              /**< Position this cell is ready for */
+    struct cog_event event;
+};
+
+/**
+ * Event queue state
+ *
+ * The producer and consumer cursors sit on separate cache lines so that
+ * posting does not invalidate the line the loop thread reads.
+ */
+struct event_state {
+    uint64_t enqueue_pos;
+    char pad0[COGKERN_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t dequeue_pos;
+    char pad1[COGKERN_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t posted;
+    uint64_t dropped;
+    uint64_t backpressured;
+    char pad2[COGKERN_CACHE_LINE - 3 * sizeof(uint64_t)];
+    struct event_cell *cells;
+    size_t capacity;
+    size_t mask;
+    size_t bytes;
+    uint32_t drain_batch;
+    size_t high_water;
+    uint64_t drained;
+    uint64_t failed;
+    int initialized;
+};
+
+/**
+ * Event queue state of the default context
+ */
+struct event_state event_default = {0};
+
+/**
+ * Event queue state of the calling thread's context
+ */
+#define g_events (*cogkern_ctx_current()->events)
+
+/**
+ * Allocate Event queue state for a new context
+ */
+struct event_state *event_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct event_state));
+}
+
+/**
+ * Create the stimulus event queue
+ *
+ * @param capacity Queue slots (rounded up to a power of two)
+ * @param drain_batch Maximum events applied per cogloop_tick()
+ * @return 0 on success, negative on error
+ */
+int cog_event_queue_init(size_t capacity, uint32_t drain_batch) {
+    if (g_events.initialized || capacity == 0 || drain_batch == 0) {
+        return -1;
+    }
+
+    size_t cap = 2;
+    while (cap < capacity) {
+        cap *= 2;
+    }
+
+    size_t bytes = cap * sizeof(struct event_cell);
+    struct event_cell *cells = cogkern_pages_alloc(bytes);
+    if (!cells) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < cap; i++) {
+        cells[i].seq = i;
+    }
+
+    memset(&g_events, 0, sizeof(g_events));
+    g_events.cells = cells;
+    g_events.capacity = cap;
+    g_events.mask = cap - 1;
+    g_events.bytes = bytes;
+    g_events.drain_batch = drain_batch;
+    g_events.initialized = 1;
+
+    return 0;
+}
+
+/**
+ * Post a stimulus event from any thread
+ *
+ * @param event Event to copy into the queue
+ * @return 0 if queued, 1 if queued above the backpressure watermark,
+ *         negative if the event was dropped
+ */
+int cog_event_post(const struct cog_event *event) {
+    if (!g_events.initialized || !event) {
+        return -1;
+    }
+
+    uint64_t pos = __atomic_load_n(&g_events.enqueue_pos, __ATOMIC_RELAXED);
+    struct event_cell *cell;
+
+    for (;;) {
+        cell = &g_events.cells[pos & g_events.mask];
+        uint64_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&g_events.enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+            /* pos was reloaded by the failed exchange */
+        } else if (diff < 0) {
+            __atomic_fetch_add(&g_events.dropped, 1, __ATOMIC_RELAXED);
+            return -1; /* Full: the consumer has not freed this cell yet */
+        } else {
+            pos = __atomic_load_n(&g_events.enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->event = *event;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&g_events.posted, 1, __ATOMIC_RELAXED);
+
+    /* Depth seen by this producer, including its own event */
+    uint64_t depth = pos + 1 - __atomic_load_n(&g_events.dequeue_pos, __ATOMIC_RELAXED);
+    if (depth > g_events.capacity - g_events.capacity / 4) {
+        __atomic_fetch_add(&g_events.backpressured, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Apply one event on the loop thread
+ */
+static int event_apply(const struct cog_event *ev) {
+    struct attention_value av;
+    uint32_t slot;
+
+    switch (ev->type) {
+        case COG_EVENT_NEW_ATOM: {
+            char name[COG_EVENT_NAME_MAX];
+            memcpy(name, ev->name, sizeof(name));
+            name[sizeof(name) - 1] = '\0';
+
+            atom_handle_t atom = cog_atom_alloc(ev->atom_type, name[0] ? name : NULL);
+            if (!atom) {
+                return -1;
+            }
+            if (ev->sti != 0.0f) {
+                memset(&av, 0, sizeof(av));
+                av.sti = ev->sti;
+                return dtesn_sched_set_av(atom, &av);
+            }
+            return 0;
+        }
+
+        case COG_EVENT_STI_BOOST:
+            if (atomspace_resolve(ev->atom, &slot) != 0) {
+                return -1;
+            }
+            if (ecan_peek_av(slot, &av) != 0) {
+                memset(&av, 0, sizeof(av));
+            }
+            av.sti += ev->sti;
+            return ecan_restore_av(slot, ev->atom, &av);
+
+        case COG_EVENT_TV_OBSERVATION:
+            if (atomspace_resolve(ev->atom, &slot) != 0) {
+                return -1;
+            }
+            return pln_observe_tv(slot, ev->atom, &ev->tv);
+    }
+
+    return -1;
+}
+
+/**
+ * Apply up to the configured batch of pending stimulus events
+ */
+int cog_event_drain(uint32_t limit) {
+    if (!g_events.initialized) {
+        return 0;
+    }
+
+    COG_TRACE_BEGIN(span);
+    uint64_t pos = g_events.dequeue_pos;
+    size_t depth = (size_t)(__atomic_load_n(&g_events.enqueue_pos, __ATOMIC_RELAXED) - pos);
+    if (depth > g_events.high_water) {
+        g_events.high_water = depth;
+    }
+
+    if (limit > g_events.drain_batch) {
+        limit = g_events.drain_batch;
+    }
+
+    /* One write section for the batch, not one per event */
+    int drained = 0;
+    uint64_t applied = 0;
+    snap_write_begin();
+    while ((uint32_t)drained < limit) {
+        struct event_cell *cell = &g_events.cells[pos & g_events.mask];
+        if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+            break; /* Empty, or the next producer has not published yet */
+        }
+
+        if (event_apply(&cell->event) != 0) {
+            g_events.failed++;
+        } else {
+            applied++;
+        }
+
+        /* Hand the cell back to producers one lap ahead */
+        __atomic_store_n(&cell->seq, pos + g_events.capacity, __ATOMIC_RELEASE);
+        pos++;
+        drained++;
+    }
+    snap_write_end();
+
+    __atomic_store_n(&g_events.dequeue_pos, pos, __ATOMIC_RELAXED);
+    g_events.drained += (uint64_t)drained;
+    if (applied > 0) {
+        metrics_count(METRIC_EVENTS_APPLIED, applied);
+    }
+
+    COG_TRACE_END(span, "cog_event_drain");
+    return drained;
+}
+
+/**
+ * Get event queue statistics
+ *
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative if no queue exists
+ */
+int cog_event_get_stats(struct cog_event_stats *stats) {
+    if (!g_events.initialized || !stats) {
+        return -1;
+    }
+
+    uint64_t head = __atomic_load_n(&g_events.enqueue_pos, __ATOMIC_RELAXED);
+    uint64_t tail = __atomic_load_n(&g_events.dequeue_pos, __ATOMIC_RELAXED);
+
+    stats->capacity = g_events.capacity;
+    stats->depth = (size_t)(head - tail);
+    stats->high_water = g_events.high_water;
+    stats->posted = __atomic_load_n(&g_events.posted, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&g_events.dropped, __ATOMIC_RELAXED);
+    stats->backpressured = __atomic_load_n(&g_events.backpressured, __ATOMIC_RELAXED);
+    stats->drained = g_events.drained;
+    stats->failed = g_events.failed;
+
+    return 0;
+}
+
+/**
+ * Fill the stimulus event queue part of cogkern_stats()
+ */
+void cog_event_fill_stats(struct cogkern_stats *stats) {
+    stats->event_queue_bytes = g_events.initialized ? g_events.bytes : 0;
+}
+
+/**
+ * Free the stimulus event queue (used at shutdown)
+ */
+void cog_event_reset(void) {
+    if (g_events.initialized) {
+        cogkern_pages_free(g_events.cells, g_events.bytes);
+    }
+
+    memset(&g_events, 0, sizeof(g_events));
+}
+
+/**
+ * Create the default queue if the application has not made one
+ */
+int cog_event_queue_default(void) {
+    if (g_events.initialized) {
+        return 0;
+    }
+    return cog_event_queue_init(COG_EVENT_DEFAULT_CAPACITY, COG_EVENT_DEFAULT_BATCH);
+}
@@ -0,0 +1,704 @@
+/**
+ * @file cogimport.c
+ * @brief Bulk import - Build an AtomSpace from a tab-separated file
+ *
+ * Each line of the file is a type keyword followed by tab-separated
+ * names. A node type declares one named node; a link type creates a link
+ * whose outgoing set is the named nodes, in order. Names stand for the
+ * same node throughout the file, whichever line mentions them first, and
+ * a name used only inside links becomes a concept node. Blank lines and
+ * lines starting with '#' are skipped.
+ *
+ *     concept      cat
+ *     concept      animal
+ *     inheritance  cat     animal
+ *
+ * The file is mapped rather than read. It is cut into one chunk per
+ * parser thread at line boundaries; the threads tokenize their chunks
+ * into compact line records and intern every name in a shared lock-free
+ * table, so each distinct name is hashed and compared once per mention
+ * and stored once. The calling thread then reserves the atom table for
+ * the whole file and creates the atoms in file order inside one write
+ * section, links through cog_link_create_batch(). Parser threads never
+ * touch the kernel context.
+ */
+
+#include "cogkern_internal.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Parser thread limits
+ */
+#define IMPORT_MAX_THREADS 64
+#define IMPORT_MIN_CHUNK (1u << 20)
+
+/**
+ * Expected input bytes per distinct name, sizing the first intern table
+ */
+#define IMPORT_BYTES_PER_NAME 128
+
+/**
+ * Most links created by one batch call
+ */
+#define IMPORT_RUN_LINKS 4096
+
+/**
+ * Node type of a name that is only used inside links
+ */
+#define IMPORT_DEFAULT_TYPE ATOM_CONCEPT
+
+/**
+ * Interned name
+ *
+ * The entry is claimed by a CAS on its tag and published by a release
+ * store of its length, so a reader that matches the tag waits for the
+ * length before comparing bytes.
+ */
+struct import_name {
+    uint64_t tag;              /**< Name hash with bit 0 set, 0 while free */
+    uint64_t offset;           /**< Name position in the file */
+    uint32_t len;              /**< Name length, 0 until published */
+    uint32_t pad;
+    uint64_t decl;             /**< (line offset + 1) << 8 | type of the first declaration */
+    atom_handle_t handle;      /**< Node created for the name (commit phase) */
+};
+
+/**
+ * Parsed line: a type and the names that follow it
+ */
+struct import_line {
+    uint32_t type;
+    uint32_t count;            /**< Names in the chunk's ref array */
+};
+
+/**
+ * Parser thread input and output
+ */
+struct import_chunk {
+    pthread_t thread;
+    const char *base;          /**< Start of the file */
+    size_t begin;              /**< First byte of the chunk */
+    size_t end;                /**< One past the last byte */
+    struct import_line *lines;
+    size_t line_count;
+    size_t line_cap;
+    uint32_t *refs;            /**< Intern table index of each name */
+    size_t ref_count;
+    size_t ref_cap;
+    size_t lines_read;
+    size_t nodes;              /**< Node declarations */
+    size_t links;
+    size_t errors;
+    int failed;                /**< Out of memory */
+};
+
+/**
+ * Shared intern table
+ */
+struct import_table {
+    struct import_name *names;
+    size_t capacity;           /**< Power of two */
+    size_t bytes;
+    size_t count;              /**< Entries claimed */
+    int overflow;              /**< Set when the table got too full */
+};
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+static uint64_t import_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Atom type named by a type keyword
+ *
+ * @return 0 on success, negative if the keyword is unknown
+ */
+static int import_type(const char *s, size_t len, enum atom_type *type) {
+    static const struct {
+        const char *name;
+        enum atom_type type;
+    } types[] = {
+        {"node", ATOM_NODE},
+        {"link", ATOM_LINK},
+        {"concept", ATOM_CONCEPT},
+        {"predicate", ATOM_PREDICATE},
+        {"evaluation", ATOM_EVALUATION},
+        {"inheritance", ATOM_INHERITANCE},
+        {"similarity", ATOM_SIMILARITY},
+    };
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (strlen(types[i].name) == len && memcmp(types[i].name, s, len) == 0) {
+            *type = types[i].type;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Whether atoms of a type are named nodes rather than links
+ */
+static int import_is_node(enum atom_type type) {
+    return type == ATOM_NODE || type == ATOM_CONCEPT || type == ATOM_PREDICATE;
+}
+
+/**
+ * FNV-1a hash of a name
+ */
+static uint64_t import_hash(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * Find or insert a name in the intern table
+ *
+ * @param table Intern table
+ * @param base Start of the file
+ * @param offset Position of the name in the file
+ * @param len Name length
+ * @param index Pointer to receive the entry index
+ * @return 0 on success, negative if the table is too full
+ */
+static int import_intern(struct import_table *table, const char *base, size_t offset,
+                         size_t len, uint32_t *index) {
+    uint64_t tag = import_hash(base + offset, len) | 1;
+    size_t mask = table->capacity - 1;
+
+    for (size_t i = tag >> 1 & mask;; i = (i + 1) & mask) {
+        struct import_name *n = &table->names[i];
+        uint64_t seen = __atomic_load_n(&n->tag, __ATOMIC_ACQUIRE);
+
+        if (seen == 0) {
+            size_t claimed = __atomic_add_fetch(&table->count, 1, __ATOMIC_RELAXED);
+            if (claimed > table->capacity / 4 * 3) {
+                __atomic_store_n(&table->overflow, 1, __ATOMIC_RELAXED);
+                return -1;
+            }
+            if (__atomic_compare_exchange_n(&n->tag, &seen, tag, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                n->offset = offset;
+                __atomic_store_n(&n->len, (uint32_t)len, __ATOMIC_RELEASE);
+                *index = (uint32_t)i;
+                return 0;
+            }
+            __atomic_sub_fetch(&table->count, 1, __ATOMIC_RELAXED);
+        }
+
+        if (seen == tag) {
+            uint32_t seen_len;
+            while ((seen_len = __atomic_load_n(&n->len, __ATOMIC_ACQUIRE)) == 0) {
+                sched_yield(); /* Claimed by another thread, not yet published */
+            }
+            if (seen_len == len && memcmp(base + n->offset, base + offset, len) == 0) {
+                *index = (uint32_t)i;
+                return 0;
+            }
+        }
+    }
+}
+
+/**
+ * Record the declaration of a node, keeping the earliest one in the file
+ */
+static void import_declare(struct import_table *table, uint32_t index, size_t line,
+                           enum atom_type type) {
+    uint64_t decl = ((uint64_t)line + 1) << 8 | (uint64_t)type;
+    uint64_t *slot = &table->names[index].decl;
+    uint64_t seen = __atomic_load_n(slot, __ATOMIC_RELAXED);
+
+    while ((seen == 0 || decl < seen) &&
+           !__atomic_compare_exchange_n(slot, &seen, decl, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Append a parsed line and its names to a chunk's records
+ */
+static int import_emit(struct import_chunk *c, enum atom_type type, const uint32_t *refs,
+                       uint32_t count) {
+    if (c->line_count == c->line_cap) {
+        size_t cap = c->line_cap ? c->line_cap * 2 : 1024;
+        struct import_line *lines = realloc(c->lines, cap * sizeof(*lines));
+        if (!lines) {
+            return -1;
+        }
+        c->lines = lines;
+        c->line_cap = cap;
+    }
+    if (c->ref_count + count > c->ref_cap) {
+        size_t cap = c->ref_cap ? c->ref_cap * 2 : 4096;
+        while (cap < c->ref_count + count) {
+            cap *= 2;
+        }
+        uint32_t *list = realloc(c->refs, cap * sizeof(*list));
+        if (!list) {
+            return -1;
+        }
+        c->refs = list;
+        c->ref_cap = cap;
+    }
+
+    c->lines[c->line_count].type = (uint32_t)type;
+    c->lines[c->line_count].count = count;
+    c->line_count++;
+    memcpy(&c->refs[c->ref_count], refs, count * sizeof(uint32_t));
+    c->ref_count += count;
+    return 0;
+}
+
+/**
+ * Tokenize one chunk and intern its names
+ */
+static void import_parse(struct import_chunk *c, struct import_table *table) {
+    const char *base = c->base;
+    uint32_t local[64];
+    uint32_t *refs = local;
+    size_t refs_cap = 64;
+    size_t pos = c->begin;
+
+    while (pos < c->end && !c->failed) {
+        if (__atomic_load_n(&table->overflow, __ATOMIC_RELAXED)) {
+            break;
+        }
+
+        const char *nl = memchr(base + pos, '\n', c->end - pos);
+        size_t line = pos;
+        size_t stop = nl ? (size_t)(nl - base) : c->end;
+        size_t end = stop;
+        pos = stop + 1;
+        c->lines_read++;
+
+        if (end > line && base[end - 1] == '\r') {
+            end--;
+        }
+        if (end == line || base[line] == '#') {
+            continue;
+        }
+
+        /* Type keyword */
+        const char *tab = memchr(base + line, '\t', end - line);
+        size_t field = tab ? (size_t)(tab - base) : end;
+        enum atom_type type;
+        if (import_type(base + line, field - line, &type) != 0) {
+            c->errors++;
+            continue;
+        }
+
+        /* Names */
+        uint32_t count = 0;
+        int bad = 0;
+        while (field < end && !bad) {
+            size_t name = field + 1;
+            tab = memchr(base + name, '\t', end - name);
+            field = tab ? (size_t)(tab - base) : end;
+
+            if (field == name || field - name > UINT32_MAX) {
+                bad = 1;
+                break;
+            }
+            if (count == refs_cap) {
+                size_t cap = refs_cap * 2;
+                uint32_t *grown = malloc(cap * sizeof(uint32_t));
+                if (!grown) {
+                    c->failed = 1;
+                    break;
+                }
+                memcpy(grown, refs, count * sizeof(uint32_t));
+                if (refs != local) {
+                    free(refs);
+                }
+                refs = grown;
+                refs_cap = cap;
+            }
+            if (import_intern(table, base, name, field - name, &refs[count]) != 0) {
+                bad = 1;
+                break;
+            }
+            count++;
+        }
+        if (c->failed || __atomic_load_n(&table->overflow, __ATOMIC_RELAXED)) {
+            break;
+        }
+
+        if (bad || count == 0 || (import_is_node(type) && count != 1)) {
+            c->errors++;
+            continue;
+        }
+        if (import_is_node(type)) {
+            import_declare(table, refs[0], line, type);
+            c->nodes++;
+        } else {
+            c->links++;
+        }
+        if (import_emit(c, type, refs, count) != 0) {
+            c->failed = 1;
+        }
+    }
+
+    if (refs != local) {
+        free(refs);
+    }
+}
+
+/**
+ * Parser thread context: a chunk and the table it interns into
+ */
+struct import_worker {
+    struct import_chunk *chunk;
+    struct import_table *table;
+};
+
+/**
+ * Parser thread entry point
+ */
+static void *import_worker_main(void *arg) {
+    struct import_worker *w = arg;
+
+    import_parse(w->chunk, w->table);
+    return NULL;
+}
+
+/**
+ * Drop a chunk's parse results so it can be parsed again
+ */
+static void import_chunk_clear(struct import_chunk *c) {
+    c->line_count = 0;
+    c->ref_count = 0;
+    c->lines_read = 0;
+    c->nodes = 0;
+    c->links = 0;
+    c->errors = 0;
+    c->failed = 0;
+}
+
+/**
+ * Parse every chunk into the intern table, one thread per chunk
+ *
+ * @return 0 on success, negative if any thread failed
+ */
+static int import_parse_all(struct import_chunk *chunks, uint32_t count,
+                            struct import_table *table) {
+    struct import_worker workers[IMPORT_MAX_THREADS];
+    uint32_t started = 0;
+
+    for (uint32_t i = 1; i < count; i++) {
+        workers[i].chunk = &chunks[i];
+        workers[i].table = table;
+        if (pthread_create(&chunks[i].thread, NULL, import_worker_main, &workers[i]) != 0) {
+            break;
+        }
+        started = i;
+    }
+
+    /* The calling thread parses the first chunk, and any left unstarted */
+    import_parse(&chunks[0], table);
+    for (uint32_t i = started + 1; i < count; i++) {
+        import_parse(&chunks[i], table);
+    }
+    for (uint32_t i = 1; i <= started; i++) {
+        pthread_join(chunks[i].thread, NULL);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (chunks[i].failed) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Node for an interned name, created on first use
+ */
+static atom_handle_t import_node(struct import_table *table, const char *base, uint32_t index,
+                                 size_t *nodes) {
+    struct import_name *n = &table->names[index];
+
+    if (!n->handle) {
+        enum atom_type type = n->decl ? (enum atom_type)(n->decl & 0xff) : IMPORT_DEFAULT_TYPE;
+        n->handle = atomspace_alloc_named(type, base + n->offset, n->len);
+        if (n->handle) {
+            (*nodes)++;
+        }
+    }
+    return n->handle;
+}
+
+/**
+ * Consecutive links of one type and arity, created with one batch call
+ */
+struct import_run {
+    enum atom_type type;
+    uint32_t arity;
+    size_t count;
+    atom_handle_t *outgoing;   /**< arity handles per link */
+    size_t cap;                /**< Capacity of outgoing in handles */
+    atom_handle_t *out;        /**< Handles of the created links */
+    size_t out_cap;
+};
+
+/**
+ * Create the links gathered in a run
+ */
+static int import_flush(struct import_run *run, struct cog_import_stats *stats) {
+    if (run->count == 0) {
+        return 0;
+    }
+    if (run->count > run->out_cap) {
+        atom_handle_t *out = realloc(run->out, run->count * sizeof(atom_handle_t));
+        if (!out) {
+            return -1;
+        }
+        run->out = out;
+        run->out_cap = run->count;
+    }
+
+    int rc = cog_link_create_batch(run->type, run->outgoing, run->arity, run->count, run->out);
+    if (rc == 0) {
+        stats->links += run->count;
+    }
+    run->count = 0;
+    return rc;
+}
+
+/**
+ * Create the parsed atoms, in file order
+ *
+ * Nodes are created at their first mention; runs of links sharing a type
+ * and arity are created in batches of up to IMPORT_RUN_LINKS.
+ */
+static int import_commit(struct import_chunk *chunks, uint32_t count,
+                         struct import_table *table, struct cog_import_stats *stats) {
+    struct import_run run = {0};
+    size_t links = 0;
+    int rc = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        links += chunks[i].links;
+    }
+    if (atomspace_reserve(table->count + links, 0) != 0) {
+        stats->error = "the AtomSpace cannot hold the file's atoms within the memory budget";
+        return -1;
+    }
+
+    snap_write_begin();
+    for (uint32_t i = 0; i < count && rc == 0; i++) {
+        const struct import_chunk *c = &chunks[i];
+        const uint32_t *refs = c->refs;
+
+        for (size_t l = 0; l < c->line_count && rc == 0; l++) {
+            const struct import_line *line = &c->lines[l];
+            enum atom_type type = (enum atom_type)line->type;
+
+            if (import_is_node(type)) {
+                if (!import_node(table, c->base, refs[0], &stats->nodes)) {
+                    rc = -1;
+                }
+                refs += line->count;
+                continue;
+            }
+
+            if (run.count > 0 && (run.type != type || run.arity != line->count ||
+                                  run.count == IMPORT_RUN_LINKS)) {
+                rc = import_flush(&run, stats);
+                if (rc != 0) {
+                    break;
+                }
+            }
+            size_t needed = (run.count + 1) * line->count;
+            if (needed > run.cap) {
+                size_t cap = run.cap ? run.cap * 2 : 4096;
+                while (cap < needed) {
+                    cap *= 2;
+                }
+                atom_handle_t *grown = realloc(run.outgoing, cap * sizeof(atom_handle_t));
+                if (!grown) {
+                    rc = -1;
+                    break;
+                }
+                run.outgoing = grown;
+                run.cap = cap;
+            }
+
+            atom_handle_t *members = &run.outgoing[run.count * line->count];
+            for (uint32_t k = 0; k < line->count && rc == 0; k++) {
+                members[k] = import_node(table, c->base, refs[k], &stats->nodes);
+                if (!members[k]) {
+                    rc = -1;
+                }
+            }
+            run.type = type;
+            run.arity = line->count;
+            run.count++;
+            refs += line->count;
+        }
+    }
+    if (rc == 0) {
+        rc = import_flush(&run, stats);
+    }
+    if (rc != 0) {
+        stats->error = "creating atoms failed, the memory budget ran out";
+    }
+    snap_write_end();
+
+    free(run.outgoing);
+    free(run.out);
+    return rc;
+}
+
+/**
+ * Import atoms from a tab-separated file
+ *
+ * @param path File to import
+ * @param threads Parser threads (0 uses every online CPU)
+ * @param stats Pointer to receive import statistics (may be NULL)
+ * @return 0 on success, negative on error
+ */
+int cog_import_file(const char *path, uint32_t threads, struct cog_import_stats *stats) {
+    struct cog_import_stats local_stats;
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    if (!path) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        stats->error = "cannot open the file";
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        stats->error = "cannot open the file";
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        return 0;
+    }
+    char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        stats->error = "cannot map the file";
+        return -1;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+
+    uint64_t t0 = import_now();
+
+    /* One chunk per thread, cut after a newline */
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint32_t)online : 1;
+    }
+    if (threads > IMPORT_MAX_THREADS) {
+        threads = IMPORT_MAX_THREADS;
+    }
+    if (threads > size / IMPORT_MIN_CHUNK + 1) {
+        threads = (uint32_t)(size / IMPORT_MIN_CHUNK + 1);
+    }
+
+    struct import_chunk chunks[IMPORT_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    uint32_t count = 0;
+    for (size_t begin = 0; begin < size && count < threads; count++) {
+        size_t end = count + 1 == threads ? size : size / threads * (count + 1);
+        if (end < begin) {
+            end = begin;
+        }
+        const char *nl = end < size ? memchr(base + end, '\n', size - end) : NULL;
+        end = nl ? (size_t)(nl - base) + 1 : size;
+
+        chunks[count].base = base;
+        chunks[count].begin = begin;
+        chunks[count].end = end;
+        begin = end;
+    }
+    stats->threads = count;
+
+    /* Parse, restarting with a larger table if names outgrow it */
+    struct import_table table = {0};
+    size_t capacity = 1024;
+    while (capacity < size / IMPORT_BYTES_PER_NAME * 2) {
+        capacity *= 2;
+    }
+    int rc;
+    for (;;) {
+        table.capacity = capacity;
+        table.bytes = capacity * sizeof(struct import_name);
+        table.count = 0;
+        table.overflow = 0;
+        table.names = capacity <= UINT32_MAX ? cogkern_pages_alloc(table.bytes) : NULL;
+        if (!table.names) {
+            stats->error = "the name table does not fit the memory budget";
+            rc = -1;
+            break;
+        }
+        memset(table.names, 0, table.bytes);
+
+        rc = import_parse_all(chunks, count, &table);
+        if (rc != 0) {
+            stats->error = "out of memory while parsing";
+        }
+        if (rc != 0 || !table.overflow) {
+            break;
+        }
+        cogkern_pages_free(table.names, table.bytes);
+        table.names = NULL;
+        for (uint32_t i = 0; i < count; i++) {
+            import_chunk_clear(&chunks[i]);
+        }
+        capacity *= 2;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        stats->lines += chunks[i].lines_read;
+        stats->errors += chunks[i].errors;
+    }
+
+    uint64_t t1 = import_now();
+    stats->parse_ns = t1 - t0;
+
+    if (rc == 0) {
+        COG_TRACE_BEGIN(span);
+        rc = import_commit(chunks, count, &table, stats);
+        COG_TRACE_END(span, "import_commit");
+        stats->commit_ns = import_now() - t1;
+    }
+
+    if (table.names) {
+        cogkern_pages_free(table.names, table.bytes);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        free(chunks[i].lines);
+        free(chunks[i].refs);
+    }
+    munmap(base, size);
+
+    return rc;
+}
@@ -3,24 +3,70 @@
  * @brief OpenCog Kernel - Core implementation
  * 
  * Core initialization and management functions for the cognitive kernel.
- * Provides GGML context management and global state.
+ * Provides GGML context management and the kernel contexts that hold
+ * every subsystem's state.
  */
 
-#include "cogkern.h"
+#include "cogkern_internal.h"
 #include <stdlib.h>
 #include <string.h>
 
-/* Note: In a real implementation, this would include ggml.h */
-/* For now, we provide stub implementations */
-
 /**
- * Global kernel state
+ * Kernel state
  */
-static struct {
+struct kernel_state {
     struct ggml_context *ctx;
     size_t mem_size;
+    size_t mem_used;
     int initialized;
-} g_kernel = {0};
+};
+
+/**
+ * Kernel state of the default context
+ */
+struct kernel_state kernel_default = {0};
+
+/**
+ * Kernel state of the calling thread's context
+ */
+#define g_kernel (*cogkern_ctx_current()->kernel)
+
+/**
+ * Context used by threads that never bound one
+ */
+struct cogkern_ctx cogkern_default_ctx = {
+    &kernel_default, &mem_default, &hgfs_default, &atomspace_default, &tier_default,
+    &ecan_default, &pln_default, &cogloop_default, &event_default, &task_default,
+    &metrics_default, &snap_default, &embed_default
+};
+
+/**
+ * Context the calling thread works on
+ */
+__thread struct cogkern_ctx *cogkern_ctx_tls __attribute__((tls_model("initial-exec"))) =
+    &cogkern_default_ctx;
+
+/**
+ * Allocate zeroed, cache-line aligned subsystem state for a new context
+ */
+void *cogkern_state_alloc(size_t size) {
+    void *state;
+    
+    size = (size + COGKERN_CACHE_LINE - 1) & ~(size_t)(COGKERN_CACHE_LINE - 1);
+    if (posix_memalign(&state, COGKERN_CACHE_LINE, size) != 0) {
+        return NULL;
+    }
+    
+    memset(state, 0, size);
+    return state;
+}
+
+/**
+ * Allocate kernel state for a new context
+ */
+struct kernel_state *kernel_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct kernel_state));
+}
 
 /**
  * Initialize the cognitive kernel subsystem
@@ -30,16 +76,16 @@ int cogkern_init(size_t mem_size) {
         return -1; /* Already initialized */
     }
     
-    /* In a real implementation, this would initialize GGML context:
-     * struct ggml_init_params params = {
-     *     .mem_size = mem_size,
-     *     .mem_buffer = NULL,
-     *     .no_alloc = false,
-     * };
-     * g_kernel.ctx = ggml_init(params);
-     */
+    cpu_dispatch_init();
+    
+    /* Tensor arena chunks are taken lazily and charged against mem_size */
+    g_kernel.ctx = tensor_context_create();
+    if (!g_kernel.ctx) {
+        return -1;
+    }
     
     g_kernel.mem_size = mem_size;
+    g_kernel.mem_used = 0;
     g_kernel.initialized = 1;
     
     return 0;
@@ -53,17 +99,201 @@ void cogkern_shutdown(void) {
         return;
     }
     
-    /* In a real implementation:
-     * ggml_free(g_kernel.ctx);
-     */
+    task_reset();
+    tier_reset();
+    atomspace_reset();
+    ecan_reset();
+    pln_reset();
+    embed_reset();
+    snap_reset();
+    cogloop_reset();
+    cog_event_reset();
+    tensor_context_free(g_kernel.ctx);
+    hgfs_release_all();
+    dtesn_mem_shutdown();
+    metrics_reset();
     
     g_kernel.ctx = NULL;
     g_kernel.initialized = 0;
 }
 
 /**
- * Get the global GGML context
+ * Get the tensor context of the current kernel context
  */
 struct ggml_context *cogkern_get_context(void) {
     return g_kernel.ctx;
 }
+
+/**
+ * Switch attention and truth values between float and compact storage
+ */
+int cog_values_compact(int enable) {
+    if (!g_kernel.initialized) {
+        return -1;
+    }
+    
+    /* Snapshot readers decode entries in the layout of their epoch */
+    if (snap_write_begin()) {
+        snap_write_end();
+        return -1;
+    }
+    if (ecan_compact_reserve(enable) != 0 || pln_compact_reserve(enable) != 0) {
+        ecan_compact_apply(0);
+        pln_compact_apply(0);
+        snap_write_end();
+        return -1;
+    }
+    
+    ecan_compact_apply(1);
+    pln_compact_apply(1);
+    snap_write_end();
+    
+    return 0;
+}
+
+/**
+ * Whether attention and truth values are stored compact
+ */
+int cog_values_compact_get(void) {
+    return ecan_is_compact();
+}
+
+/**
+ * Charge bytes against the cogkern_init() memory budget
+ */
+int cogkern_mem_charge(size_t bytes) {
+    if (!g_kernel.initialized) {
+        return -1;
+    }
+    
+    if (bytes > g_kernel.mem_size - g_kernel.mem_used) {
+        return -1; /* Budget exhausted */
+    }
+    
+    g_kernel.mem_used += bytes;
+    return 0;
+}
+
+/**
+ * Return bytes previously charged with cogkern_mem_charge()
+ */
+void cogkern_mem_uncharge(size_t bytes) {
+    if (bytes > g_kernel.mem_used) {
+        bytes = g_kernel.mem_used;
+    }
+    g_kernel.mem_used -= bytes;
+}
+
+/**
+ * Query memory accounted against the cogkern_init() budget
+ */
+int cogkern_mem_usage(size_t *used, size_t *budget) {
+    if (!g_kernel.initialized) {
+        return -1;
+    }
+    
+    if (used) {
+        *used = g_kernel.mem_used;
+    }
+    if (budget) {
+        *budget = g_kernel.mem_size;
+    }
+    
+    return 0;
+}
+
+/**
+ * Free the subsystem state blocks of a context
+ */
+static void cogkern_ctx_free(struct cogkern_ctx *ctx) {
+    free(ctx->kernel);
+    free(ctx->mem);
+    free(ctx->hgfs);
+    free(ctx->atomspace);
+    free(ctx->tier);
+    free(ctx->ecan);
+    free(ctx->pln);
+    free(ctx->cogloop);
+    free(ctx->events);
+    free(ctx->tasks);
+    free(ctx->metrics);
+    free(ctx->snap);
+    free(ctx->embed);
+    free(ctx);
+}
+
+/**
+ * Create an independent kernel context
+ */
+struct cogkern_ctx *cogkern_ctx_create(size_t mem_size) {
+    struct cogkern_ctx *ctx = cogkern_state_alloc(sizeof(*ctx));
+    if (!ctx) {
+        return NULL;
+    }
+    
+    ctx->kernel = kernel_state_create();
+    ctx->mem = mem_state_create();
+    ctx->hgfs = hgfs_state_create();
+    ctx->atomspace = atomspace_state_create();
+    ctx->tier = tier_state_create();
+    ctx->ecan = ecan_state_create();
+    ctx->pln = pln_state_create();
+    ctx->cogloop = cogloop_state_create();
+    ctx->events = event_state_create();
+    ctx->tasks = task_state_create();
+    ctx->metrics = metrics_state_create();
+    ctx->snap = snap_state_create();
+    ctx->embed = embed_state_create();
+    
+    if (!ctx->kernel || !ctx->mem || !ctx->hgfs || !ctx->atomspace || !ctx->tier ||
+        !ctx->ecan || !ctx->pln || !ctx->cogloop || !ctx->events || !ctx->tasks ||
+        !ctx->metrics || !ctx->snap || !ctx->embed) {
+        cogkern_ctx_free(ctx);
+        return NULL;
+    }
+    
+    struct cogkern_ctx *prev = cogkern_ctx_bind(ctx);
+    int rc = cogkern_init(mem_size);
+    cogkern_ctx_bind(prev);
+    
+    if (rc != 0) {
+        cogkern_ctx_free(ctx);
+        return NULL;
+    }
+    
+    return ctx;
+}
+
+/**
+ * Shut down a kernel context and free it
+ */
+void cogkern_ctx_destroy(struct cogkern_ctx *ctx) {
+    if (!ctx) {
+        return;
+    }
+    
+    struct cogkern_ctx *prev = cogkern_ctx_bind(ctx);
+    cogkern_shutdown();
+    cogkern_ctx_bind(prev == ctx ? NULL : prev);
+    
+    if (ctx != &cogkern_default_ctx) {
+        cogkern_ctx_free(ctx);
+    }
+}
+
+/**
+ * Make a context current for the calling thread
+ */
+struct cogkern_ctx *cogkern_ctx_bind(struct cogkern_ctx *ctx) {
+    struct cogkern_ctx *prev = cogkern_ctx_tls;
+    
+    cogkern_ctx_tls = ctx ? ctx : &cogkern_default_ctx;
+    return prev;
+}
+
+/**
+ * Default kernel context
+ */
+struct cogkern_ctx *cogkern_ctx_default(void) {
+    return &cogkern_default_ctx;
+}
@@ -0,0 +1,1087 @@
+/**
+ * @file cogkern_internal.h
+ * @brief OpenCog Kernel - Internal interfaces shared between subsystems
+ *
+ * Declarations used across the kernel translation units that are not
+ * part of the public API in cogkern.h.
+ */
+
+#ifndef COGKERN_INTERNAL_H
+#define COGKERN_INTERNAL_H
+
+#include "cogkern.h"
+
+/**
+ * Cache line size assumed for alignment of hot structures
+ */
+#define COGKERN_CACHE_LINE 64
+
+/**
+ * Handle layout: slot index + 1 in the low 32 bits, generation above
+ *
+ * After cog_atom_reorder() an atom's index no longer matches its slot;
+ * atom handles are turned into slots with atomspace_lookup().
+ */
+#define COG_HANDLE_MAKE(slot, gen) \
+    (((atom_handle_t)(uint32_t)(gen) << 32) | ((atom_handle_t)(slot) + 1))
+#define COG_HANDLE_SLOT(handle) ((uint32_t)(handle) - 1)
+#define COG_HANDLE_GEN(handle) ((uint32_t)((handle) >> 32))
+
+/**
+ * Per-subsystem state of a kernel context, private to each subsystem
+ */
+struct kernel_state;
+struct mem_state;
+struct hgfs_state;
+struct atomspace_state;
+struct tier_state;
+struct ecan_state;
+struct pln_state;
+struct cogloop_state;
+struct event_state;
+struct task_state;
+struct metrics_state;
+struct snap_state;
+struct embed_state;
+
+/**
+ * Kernel context: one independent knowledge base and its subsystems
+ *
+ * Each subsystem keeps its former global state in a block of its own,
+ * cache-line aligned so contexts driven from different cores share no
+ * lines. Kernel functions work on the calling thread's current context.
+ */
+struct cogkern_ctx {
+    struct kernel_state *kernel;
+    struct mem_state *mem;
+    struct hgfs_state *hgfs;
+    struct atomspace_state *atomspace;
+    struct tier_state *tier;
+    struct ecan_state *ecan;
+    struct pln_state *pln;
+    struct cogloop_state *cogloop;
+    struct event_state *events;
+    struct task_state *tasks;
+    struct metrics_state *metrics;
+    struct snap_state *snap;
+    struct embed_state *embed;
+};
+
+/**
+ * Context the calling thread works on (the default context until bound)
+ */
+extern __thread struct cogkern_ctx *cogkern_ctx_tls __attribute__((tls_model("initial-exec")));
+
+/**
+ * Current context of the calling thread
+ */
+static inline struct cogkern_ctx *cogkern_ctx_current(void) {
+    return cogkern_ctx_tls;
+}
+
+/**
+ * Context used by threads that never bound one
+ */
+extern struct cogkern_ctx cogkern_default_ctx;
+
+/**
+ * Subsystem state of the default context
+ */
+extern struct kernel_state kernel_default;
+extern struct mem_state mem_default;
+extern struct hgfs_state hgfs_default;
+extern struct atomspace_state atomspace_default;
+extern struct tier_state tier_default;
+extern struct ecan_state ecan_default;
+extern struct pln_state pln_default;
+extern struct cogloop_state cogloop_default;
+extern struct event_state event_default;
+extern struct task_state task_default;
+extern struct metrics_state metrics_default;
+extern struct snap_state snap_default;
+extern struct embed_state embed_default;
+
+/**
+ * Allocate zeroed, cache-line aligned subsystem state for a new context
+ *
+ * @param size State size in bytes
+ * @return Pointer to state or NULL on failure (release with free())
+ */
+void *cogkern_state_alloc(size_t size);
+
+/**
+ * Allocate the subsystem state of a new context in its initial condition
+ *
+ * @return Pointer to state or NULL on failure (release with free())
+ */
+struct kernel_state *kernel_state_create(void);
+struct mem_state *mem_state_create(void);
+struct hgfs_state *hgfs_state_create(void);
+struct atomspace_state *atomspace_state_create(void);
+struct tier_state *tier_state_create(void);
+struct ecan_state *ecan_state_create(void);
+struct pln_state *pln_state_create(void);
+struct cogloop_state *cogloop_state_create(void);
+struct event_state *event_state_create(void);
+struct task_state *task_state_create(void);
+struct metrics_state *metrics_state_create(void);
+struct snap_state *snap_state_create(void);
+struct embed_state *embed_state_create(void);
+
+/**
+ * Charge bytes against the cogkern_init() memory budget
+ *
+ * @param bytes Number of bytes to reserve
+ * @return 0 on success, negative if the budget would be exceeded
+ */
+int cogkern_mem_charge(size_t bytes);
+
+/**
+ * Return bytes previously charged with cogkern_mem_charge()
+ *
+ * @param bytes Number of bytes to release
+ */
+void cogkern_mem_uncharge(size_t bytes);
+
+/**
+ * Granularity of kernel page allocations (also the hypergraph chunk size)
+ */
+#define DTESN_MEM_PAGE_SIZE (64 * 1024)
+
+/**
+ * Allocate page-granular kernel storage
+ *
+ * Served from the dtesn_mem_init_regions() regions once they exist,
+ * otherwise from aligned heap memory charged against the budget.
+ * The result is aligned to DTESN_MEM_PAGE_SIZE.
+ *
+ * @param size Size in bytes (rounded up to whole pages)
+ * @return Pointer to storage or NULL on failure
+ */
+void *cogkern_pages_alloc(size_t size);
+
+/**
+ * Free storage returned by cogkern_pages_alloc()
+ *
+ * @param ptr Pointer to free (NULL is ignored)
+ * @param size Size passed to cogkern_pages_alloc()
+ */
+void cogkern_pages_free(void *ptr, size_t size);
+
+/**
+ * Grow a kernel table to hold at least the requested number of entries
+ *
+ * Existing entries are preserved and new entries are zeroed.
+ *
+ * @param table Pointer to the table base pointer
+ * @param capacity Pointer to the table capacity in entries
+ * @param elem_size Entry size in bytes
+ * @param needed Minimum number of entries required
+ * @return 0 on success, negative on error
+ */
+int cogkern_table_reserve(void **table, size_t *capacity, size_t elem_size, size_t needed);
+
+/**
+ * Grow a kernel table like cogkern_table_reserve() but keep the old storage
+ *
+ * Used where lock-free readers may still hold the old base pointer; the
+ * caller frees the old storage with cogkern_pages_free() once they are gone.
+ *
+ * @param old Pointer to receive the old storage (NULL if it did not move)
+ * @param old_bytes Pointer to receive the size of the old storage
+ * @return 0 on success, negative on error
+ */
+int cogkern_table_grow(void **table, size_t *capacity, size_t elem_size, size_t needed,
+                       void **old, size_t *old_bytes);
+
+/**
+ * Release a table grown with cogkern_table_reserve()
+ */
+void cogkern_table_free(void **table, size_t *capacity, size_t elem_size);
+
+/**
+ * Move every entry of a kernel table to a new index in place
+ *
+ * @param table Table base
+ * @param elem_size Entry size in bytes
+ * @param count Number of entries to move
+ * @param dest New index of each entry, a permutation of 0..count-1
+ * @param done Scratch bitmap of (count + 63) / 64 words
+ */
+void cogkern_table_permute(void *table, size_t elem_size, size_t count, const uint32_t *dest,
+                           uint64_t *done);
+
+/**
+ * Fraction of the memory budget holding live kernel data (0.0-1.0)
+ *
+ * Region pages that are reserved but not handed out count as free. Once
+ * dtesn_mem_pressure_raise() has been called the result is 1.0, since a
+ * table that must grow by copying fails well before the budget is full,
+ * until dtesn_mem_pressure_clear() is called.
+ */
+float dtesn_mem_pressure(void);
+
+/**
+ * Record that an atom, edge, attention or truth value table could not grow
+ *
+ * Only growth that atoms need to be created or valued raises pressure;
+ * other storage (tensors, embeddings, up-front reservations) fails
+ * without making forgetting evict atoms.
+ */
+void dtesn_mem_pressure_raise(void);
+
+/**
+ * Clear the failed growth recorded for dtesn_mem_pressure()
+ */
+void dtesn_mem_pressure_clear(void);
+
+/**
+ * Unmap every memory region (used at shutdown)
+ */
+void dtesn_mem_shutdown(void);
+
+/**
+ * Release every hypergraph arena and cached chunk (used at shutdown)
+ */
+void hgfs_release_all(void);
+
+/**
+ * Find the table slot of a live atom handle without faulting it in
+ *
+ * @param atom Atom handle
+ * @param slot Pointer to receive the slot index
+ * @return 0 on success, negative if the handle is invalid or stale
+ */
+int atomspace_lookup(atom_handle_t atom, uint32_t *slot);
+
+/**
+ * Resolve a live atom handle to its table slot
+ *
+ * @param atom Atom handle
+ * @param slot Pointer to receive the slot index
+ * @return 0 on success, negative if the handle is invalid or stale
+ */
+int atomspace_resolve(atom_handle_t atom, uint32_t *slot);
+
+/**
+ * Resolve a batch of live atom handles to their table slots
+ *
+ * @param atoms Atom handles
+ * @param count Number of handles
+ * @param slots Array to receive the slots (UINT32_MAX for invalid or stale
+ *              handles)
+ * @return One past the highest slot resolved (0 if none was)
+ */
+size_t atomspace_resolve_batch(const atom_handle_t *atoms, size_t count, uint32_t *slots);
+
+/**
+ * Number of atom slots ever used (live or free)
+ */
+size_t atomspace_slots(void);
+
+/**
+ * Number of live atoms
+ */
+size_t atomspace_count(void);
+
+/**
+ * Handle of the live atom in a slot, or 0 if the slot is free
+ */
+atom_handle_t atomspace_handle_at(uint32_t slot);
+
+/**
+ * Allocate an atom from a name that is not NUL-terminated
+ *
+ * @param type Atom type
+ * @param name Name bytes (NULL for links)
+ * @param len Name length in bytes
+ * @return Atom handle or 0 on failure
+ */
+atom_handle_t atomspace_alloc_named(enum atom_type type, const char *name, size_t len);
+
+/**
+ * Grow the atom and edge tables ahead of a batch of creations
+ *
+ * @param atoms Number of atoms about to be created
+ * @param edges Number of edges about to be created
+ * @return 0 on success, negative if the batch would not fit (memory
+ *         pressure is left as it was)
+ */
+int atomspace_reserve(size_t atoms, size_t edges);
+
+/**
+ * Drop all atoms and edges and free the AtomSpace tables
+ */
+void atomspace_reset(void);
+
+/**
+ * Copy the handles of the atoms sharing an edge with a live atom
+ *
+ * @param slot Atom slot
+ * A link's members count as edges and come first.
+ *
+ * @param out Array to receive neighbour handles (one per incident edge)
+ * @param max Capacity of out
+ * @return Number of neighbours, which may exceed max
+ */
+size_t atomspace_neighbors(uint32_t slot, atom_handle_t *out, size_t max);
+
+/**
+ * Copy the slots of the atoms sharing an edge with a live atom
+ *
+ * Same order as atomspace_neighbors(). Safe to call from several threads
+ * bound to the context while its own thread waits and nothing changes.
+ *
+ * @param slot Atom slot
+ * @param out Array to receive neighbour slots
+ * @param max Capacity of out
+ * @return Number of neighbours, which may exceed max
+ */
+size_t atomspace_neighbor_slots(uint32_t slot, uint32_t *out, size_t max);
+
+/**
+ * Copy the slots of the atoms a live atom is related to
+ *
+ * These are its members if it is a link, the other members of each link
+ * containing it and the far end of each of its edges, with repeats. Same
+ * threading rules as atomspace_neighbor_slots().
+ *
+ * @param slot Atom slot
+ * @param skip Type of containing links to leave out
+ * @param out Array to receive related slots
+ * @param max Capacity of out
+ * @return Number of related atoms, which may exceed max
+ */
+size_t atomspace_related_slots(uint32_t slot, enum atom_type skip, uint32_t *out, size_t max);
+
+/**
+ * Type of the live atom in a slot
+ */
+enum atom_type atomspace_type(uint32_t slot);
+
+/**
+ * Copy the handles of the links whose outgoing set contains an atom
+ *
+ * @return Number of such links, which may exceed max
+ */
+size_t atomspace_incoming(uint32_t slot, atom_handle_t *out, size_t max);
+
+/**
+ * Copy the outgoing set of a link in order
+ *
+ * @return Arity of the link (0 for nodes), which may exceed max
+ */
+size_t atomspace_outgoing(uint32_t slot, atom_handle_t *out, size_t max);
+
+/**
+ * Find a binary link of a type joining a live atom to another atom
+ *
+ * @return Link handle, or 0 if there is none
+ */
+atom_handle_t atomspace_find_pair(uint32_t slot, enum atom_type type, atom_handle_t other);
+
+/**
+ * Handle lookups served by atomspace_resolve() since startup
+ */
+uint64_t atomspace_lookups(void);
+
+/**
+ * Whether the atom in a slot currently lives in the out-of-core tier
+ */
+int atomspace_is_cold(uint32_t slot);
+
+/**
+ * Number of atoms currently in the out-of-core tier
+ */
+size_t atomspace_cold_count(void);
+
+/**
+ * Move a live atom's payload to the out-of-core tier
+ *
+ * @return 0 on success, negative on error
+ */
+int atomspace_page_out(uint32_t slot);
+
+/**
+ * Bring a cold atom's payload back into memory
+ *
+ * @return 0 on success, negative on error
+ */
+int atomspace_fault_in(uint32_t slot);
+
+/**
+ * Record that a cold atom's segment record moved during compaction
+ */
+void atomspace_tier_moved(uint32_t slot, uint64_t offset);
+
+/**
+ * Segment record of a cold atom
+ *
+ * Followed by incident_count incidence entries and then name_len name bytes.
+ */
+struct tier_record {
+    atom_handle_t handle;
+    struct attention_value av;
+    struct truth_value tv;
+    uint32_t flags;           /**< TIER_RECORD_* */
+    uint32_t size;            /**< Record size including this header */
+    uint32_t name_len;        /**< Name bytes including the NUL, 0 if none */
+    uint32_t incident_count;
+};
+
+#define TIER_RECORD_AV (1u << 0)    /**< av holds the atom's attention value */
+#define TIER_RECORD_TV (1u << 1)    /**< tv holds the atom's truth value */
+#define TIER_RECORD_DEAD (1u << 2)  /**< Atom was faulted in or removed */
+
+/**
+ * Allocate a record in the tier segment, compacting it if full
+ *
+ * @param size Record size in bytes
+ * @param offset Pointer to receive the record offset
+ * @return Pointer to the record or NULL if the segment is full or closed
+ */
+struct tier_record *tier_record_alloc(size_t size, uint64_t *offset);
+
+/**
+ * Record at a segment offset
+ */
+struct tier_record *tier_record_ptr(uint64_t offset);
+
+/**
+ * Mark a record dead once its atom is back in memory or removed
+ */
+void tier_record_release(uint64_t offset);
+
+/**
+ * Account one fault-in (time taken and record bytes read)
+ */
+void tier_note_fault(uint64_t ns, size_t bytes);
+
+/**
+ * Run one increment of automatic paging
+ *
+ * @return Number of atoms paged out
+ */
+int tier_step(void);
+
+/**
+ * Close the segment without faulting atoms back in (used at shutdown)
+ */
+void tier_reset(void);
+
+/**
+ * Find the slot of an atom visible to a snapshot epoch
+ *
+ * Safe against a concurrent writer; never faults the atom in.
+ *
+ * @return 0 on success, negative if the atom did not exist at the epoch
+ *         or has been removed since
+ */
+int atomspace_snapshot_lookup(atom_handle_t atom, uint64_t epoch, uint32_t *slot);
+
+/**
+ * Drop the attention value stored for an atom slot
+ */
+void ecan_forget_atom(uint32_t slot);
+
+/**
+ * Copy the attention value stored for an atom slot
+ *
+ * @return 0 if the slot has one, negative otherwise
+ */
+int ecan_peek_av(uint32_t slot, struct attention_value *av);
+
+/**
+ * Remove and return the attention value stored for an atom slot
+ *
+ * The entry keeps a copy for snapshots pinned before the removal.
+ *
+ * @return 0 if the slot had one, negative otherwise
+ */
+int ecan_take_av(uint32_t slot, struct attention_value *av);
+
+/**
+ * Store an attention value for an atom slot without resolving the handle
+ *
+ * @return 0 on success, negative on error
+ */
+int ecan_restore_av(uint32_t slot, atom_handle_t atom, const struct attention_value *av);
+
+/**
+ * Copy the attention value an atom slot had at a snapshot epoch
+ *
+ * @return 0 if the slot had one, negative otherwise
+ */
+int ecan_snapshot_av(uint32_t slot, atom_handle_t atom, uint64_t epoch,
+                     struct attention_value *av);
+
+/**
+ * Free old attention value versions no epoch at or after keep can reach
+ */
+void ecan_snapshot_trim(uint64_t keep);
+
+/**
+ * Make room for an attention value entry per atom slot before a reorder
+ *
+ * Must be called inside a write section.
+ *
+ * @return 0 on success, negative on error
+ */
+int ecan_reorder_reserve(size_t slots);
+
+/**
+ * Move attention values along with their atoms to new slots
+ *
+ * @param dest New slot of each of the first slots entries
+ * @param done Scratch bitmap for cogkern_table_permute()
+ */
+void ecan_reorder(const uint32_t *dest, size_t slots, uint64_t *done);
+
+/**
+ * Allocate the attention value table of a storage layout
+ *
+ * First half of cog_values_compact(), called inside a write section that
+ * found no snapshot pinned. Does nothing if the layout is already in use.
+ *
+ * @param compact Nonzero for the compact layout, zero for floats
+ * @return 0 on success, negative on error
+ */
+int ecan_compact_reserve(int compact);
+
+/**
+ * Move the attention values into the table ecan_compact_reserve() made
+ *
+ * @param commit Nonzero to switch layouts, zero to drop the new table
+ */
+void ecan_compact_apply(int commit);
+
+/**
+ * Whether attention and truth values are stored compact
+ */
+int ecan_is_compact(void);
+
+/**
+ * Select the atoms with the highest STI
+ *
+ * Ties are broken by lower handle index, so the result is deterministic.
+ *
+ * @param k Maximum number of atoms
+ * @param atoms Array of k entries to receive handles, highest STI first
+ * @param sti Array of k entries to receive the matching STI values
+ * @return Number of atoms selected
+ */
+size_t ecan_top_sti(size_t k, atom_handle_t *atoms, float *sti);
+
+/**
+ * Run every cognitive task submitted since the last call
+ *
+ * @return Number of tasks run, negative on error
+ */
+int task_dispatch(void);
+
+/**
+ * Cap the number of tasks the next task_dispatch() runs
+ *
+ * Tasks past the cap stay queued, in priority order, for the following
+ * dispatch. The cap applies to one dispatch only.
+ *
+ * @param limit Maximum tasks to run (0 for no cap)
+ */
+void task_set_limit(size_t limit);
+
+/**
+ * Stop the task workers and drop queued tasks (used at shutdown)
+ */
+void task_reset(void);
+
+/**
+ * Drop all attention values and reset the scheduler
+ */
+void ecan_reset(void);
+
+/**
+ * Drop the truth value stored for an atom slot
+ */
+void pln_forget_atom(uint32_t slot);
+
+/**
+ * Copy the truth value stored for an atom slot
+ *
+ * @return 0 if the slot has one, negative otherwise
+ */
+int pln_peek_tv(uint32_t slot, struct truth_value *tv);
+
+/**
+ * Remove and return the truth value stored for an atom slot
+ *
+ * The entry keeps a copy for snapshots pinned before the removal.
+ *
+ * @return 0 if the slot had one, negative otherwise
+ */
+int pln_take_tv(uint32_t slot, struct truth_value *tv);
+
+/**
+ * Store a truth value for an atom slot without resolving the handle
+ *
+ * @return 0 on success, negative on error
+ */
+int pln_restore_tv(uint32_t slot, atom_handle_t atom, const struct truth_value *tv);
+
+/**
+ * Copy the truth value an atom slot had at a snapshot epoch
+ *
+ * @return 0 if the slot had one, negative otherwise
+ */
+int pln_snapshot_tv(uint32_t slot, atom_handle_t atom, uint64_t epoch, struct truth_value *tv);
+
+/**
+ * Free old truth value versions no epoch at or after keep can reach
+ */
+void pln_snapshot_trim(uint64_t keep);
+
+/**
+ * Make room for a truth value entry per atom slot before a reorder
+ *
+ * Must be called inside a write section.
+ *
+ * @return 0 on success, negative on error
+ */
+int pln_reorder_reserve(size_t slots);
+
+/**
+ * Move truth values along with their atoms to new slots
+ *
+ * @param dest New slot of each of the first slots entries
+ * @param done Scratch bitmap for cogkern_table_permute()
+ */
+void pln_reorder(const uint32_t *dest, size_t slots, uint64_t *done);
+
+/**
+ * Allocate the truth value table of a storage layout
+ *
+ * Same contract as ecan_compact_reserve().
+ */
+int pln_compact_reserve(int compact);
+
+/**
+ * Move the truth values into the table pln_compact_reserve() made
+ */
+void pln_compact_apply(int commit);
+
+/**
+ * Revise the truth value of an atom slot with an observation
+ *
+ * Strengths are averaged weighted by confidence and the confidences are
+ * combined as independent evidence.
+ *
+ * @return 0 on success, negative on error
+ */
+int pln_observe_tv(uint32_t slot, atom_handle_t atom, const struct truth_value *obs);
+
+/**
+ * Drop all truth values
+ */
+void pln_reset(void);
+
+/**
+ * Drop the embedding of an atom being removed, if it has one
+ */
+void embed_forget_atom(atom_handle_t atom);
+
+/**
+ * Fill the embedding part of cogkern_stats()
+ */
+void embed_fill_stats(struct cogkern_stats *stats);
+
+/**
+ * Drop all embeddings and the similarity index
+ */
+void embed_reset(void);
+
+/**
+ * Numeric kernels, one table per instruction set (see cogcpu.c)
+ */
+struct cog_kernels {
+    /** Dot product of n floats */
+    float (*dot_f32)(const float *x, const float *y, size_t n);
+    /** Dot product of a 16-bit vector with an int8 vector */
+    int32_t (*dot_i8)(const int16_t *x, const int8_t *y, size_t n);
+    /** Sum of n floats */
+    float (*sum_f32)(const float *x, size_t n);
+    /** MinHash signature of n keys; hashes must be a multiple of 16 */
+    void (*minhash)(uint32_t *sig, const uint32_t *seeds, uint32_t hashes,
+                    const uint32_t *keys, size_t n);
+    /** Product of the strengths and least confidence of n interleaved pairs */
+    void (*tv_conjunction)(const float *premises, size_t n, float *strength,
+                           float *confidence);
+    /** Largest of n int16 values; n must be a multiple of 32 */
+    int32_t (*max_i16)(const int16_t *x, size_t n);
+    /** Scale n int16 values by factor <= 1, rounding half away from zero */
+    void (*requant_i16)(int16_t *x, size_t n, float factor);
+    /** Scale n int8 values by factor <= 1, rounding half away from zero */
+    void (*requant_i8)(int8_t *x, size_t n, float factor);
+};
+
+/**
+ * Kernels of the selected instruction set
+ */
+extern const struct cog_kernels *cpu_kernels_active;
+
+/**
+ * Kernels to use for one operation
+ *
+ * Read once per operation: cogkern_isa_force() may switch tables at any
+ * time, and every table gives the same results up to rounding.
+ */
+static inline const struct cog_kernels *cpu_kernels(void) {
+    return __atomic_load_n(&cpu_kernels_active, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Pick the kernel variants for this host (once per process)
+ */
+void cpu_dispatch_init(void);
+
+/**
+ * Create the tensor context of the current kernel context
+ *
+ * Arena chunks are taken on demand and charged to the context that was
+ * current at creation, whichever thread allocates tensors.
+ *
+ * @return Context or NULL on failure (release with tensor_context_free())
+ */
+struct ggml_context *tensor_context_create(void);
+
+/**
+ * Free a tensor context and its arena
+ */
+void tensor_context_free(struct ggml_context *ctx);
+
+/**
+ * Fill the tensor part of cogkern_stats()
+ */
+void tensor_fill_stats(struct cogkern_stats *stats);
+
+/**
+ * Create the default stimulus event queue unless one already exists
+ *
+ * @return 0 on success, negative on error
+ */
+int cog_event_queue_default(void);
+
+/**
+ * Apply up to the configured batch of pending stimulus events
+ *
+ * Must only be called from the loop thread.
+ *
+ * @param limit Maximum events to apply (capped at the drain batch)
+ * @return Number of events drained
+ */
+int cog_event_drain(uint32_t limit);
+
+/**
+ * Free the stimulus event queue (used at shutdown)
+ */
+void cog_event_reset(void);
+
+/**
+ * Stop pipeline workers and free the cognitive cycle buffers (used at shutdown)
+ */
+void cogloop_reset(void);
+
+/**
+ * Monotonic clock in nanoseconds used for trace spans and metrics
+ */
+uint64_t trace_clock_ns(void);
+
+/**
+ * Record a completed span on the calling thread's trace ring
+ *
+ * @param name Span name (must outlive the trace session)
+ * @param start_ns trace_clock_ns() at the start of the span
+ */
+void trace_record(const char *name, uint64_t start_ns);
+
+/**
+ * Non-zero while cog_trace_start() is recording spans
+ */
+extern int g_trace_active;
+
+/**
+ * Trace span around a stage or kernel function
+ *
+ *     COG_TRACE_BEGIN(span);
+ *     ...
+ *     COG_TRACE_END(span, "stage_name");
+ *
+ * Spans cost a relaxed load and a branch while tracing is off and are
+ * compiled out without COGKERN_TRACING.
+ */
+#ifdef COGKERN_TRACING
+#define COG_TRACE_BEGIN(span) \
+    uint64_t span = __builtin_expect(__atomic_load_n(&g_trace_active, __ATOMIC_RELAXED), 0) ? \
+        trace_clock_ns() : 0
+#define COG_TRACE_END(span, name) \
+    do { \
+        if (__builtin_expect((span) != 0, 0)) { \
+            trace_record((name), (span)); \
+        } \
+    } while (0)
+#else
+#define COG_TRACE_BEGIN(span) do { } while (0)
+#define COG_TRACE_END(span, name) do { } while (0)
+#endif
+
+/**
+ * Kernel event counters kept by the metrics registry
+ */
+enum metric_counter {
+    METRIC_ATOMS_CREATED,
+    METRIC_ATOMS_REMOVED,
+    METRIC_LINKS_CREATED,
+    METRIC_INFERENCES,
+    METRIC_TASKS_RUN,
+    METRIC_EVENTS_APPLIED,
+    METRIC_COUNTERS
+};
+
+/**
+ * Latency histograms kept by the metrics registry
+ */
+enum metric_latency {
+    METRIC_TICK_NS,
+    METRIC_SCHED_TICK_NS,
+    METRIC_TASK_RUN_NS,
+    METRIC_TASK_WAIT_NS,
+    METRIC_HISTOGRAMS
+};
+
+/**
+ * Add to a counter in the calling thread's metrics shard
+ */
+void metrics_count(enum metric_counter counter, uint64_t n);
+
+/**
+ * Record a latency sample in the calling thread's metrics shard
+ */
+void metrics_record(enum metric_latency histogram, uint64_t ns);
+
+/**
+ * Count a cognitive loop tick toward the periodic statistics dump
+ */
+void metrics_tick(void);
+
+/**
+ * Free the metrics shards and stop the periodic dump (used at shutdown)
+ */
+void metrics_reset(void);
+
+/**
+ * Version stamp and older versions of a snapshot-readable table entry
+ *
+ * An entry embeds the cell as its first member, followed directly by the
+ * payload snapshots read. Older versions are immutable copies of the
+ * whole entry, newest first.
+ */
+struct snap_cell {
+    uint64_t version;          /**< Epoch of the write that produced the payload */
+    struct snap_cell *older;   /**< Previous version, kept while snapshots need it */
+};
+
+/**
+ * Snapshot the calling thread is pinned to (NULL if none), and its epoch
+ */
+extern __thread struct snap_state *snap_tls_state __attribute__((tls_model("initial-exec")));
+extern __thread uint64_t snap_tls_epoch __attribute__((tls_model("initial-exec")));
+
+/**
+ * Whether the calling thread reads the current context through a snapshot
+ *
+ * @param epoch Pointer to receive the pinned epoch
+ * @return Non-zero if a snapshot is pinned
+ */
+static inline int snap_pinned(uint64_t *epoch) {
+    if (__builtin_expect(snap_tls_state == NULL, 1) ||
+        snap_tls_state != cogkern_ctx_current()->snap) {
+        return 0;
+    }
+    *epoch = snap_tls_epoch;
+    return 1;
+}
+
+/**
+ * Part of a context's snapshot state used by the write fast paths
+ *
+ * First member of the private snap_state, so that opening and closing a
+ * write section can be inlined into the subsystems.
+ */
+struct snap_writer {
+    uint32_t depth;            /**< Nesting of the open write section */
+    int versioning;            /**< The open section keeps old versions */
+    uint64_t epoch;            /**< Epoch stamped by the open section */
+    int reclaim;               /**< Old versions or retired tables wait to be freed */
+
+    /* Shared with readers */
+    uint64_t next_epoch __attribute__((aligned(COGKERN_CACHE_LINE))); /**< Epoch the next snapshot pins */
+    uint32_t readers;          /**< Pinned snapshots */
+    uint64_t write_seq;        /**< Odd while a write section is open */
+};
+
+/**
+ * Set once readers issue expedited membarriers, sparing writers a fence
+ */
+extern int snap_membarrier;
+
+/**
+ * Snapshot writer state of the calling thread's context
+ */
+static inline struct snap_writer *snap_writer(void) {
+    return (struct snap_writer *)cogkern_ctx_current()->snap;
+}
+
+/**
+ * Fence a section open when readers cannot issue membarriers
+ */
+void snap_section_fence(void);
+
+/**
+ * Free old versions and retired tables no pinned snapshot can reach
+ */
+void snap_reclaim(void);
+
+/**
+ * Open a write section around changes to snapshot-readable state
+ *
+ * Sections nest; only the outermost one synchronizes with readers. It
+ * marks the section open, then reads the epoch and reader count: a
+ * beginning reader either is counted or waits for the section to close.
+ *
+ * @return Non-zero if snapshots are pinned and old versions must be kept
+ */
+static inline int snap_write_begin(void) {
+    struct snap_writer *w = snap_writer();
+
+    if (w->depth++ == 0) {
+        __atomic_store_n(&w->write_seq, w->write_seq + 1, __ATOMIC_RELAXED);
+        if (__builtin_expect(__atomic_load_n(&snap_membarrier, __ATOMIC_RELAXED), 1)) {
+            __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        } else {
+            snap_section_fence();
+        }
+        w->epoch = __atomic_load_n(&w->next_epoch, __ATOMIC_ACQUIRE);
+        w->versioning = __atomic_load_n(&w->readers, __ATOMIC_ACQUIRE) > 0;
+    }
+    return w->versioning;
+}
+
+/**
+ * Close a write section
+ *
+ * Closing a section that found no snapshot pinned while old versions are
+ * still kept frees them right away, so a kernel without a running loop
+ * does not hold them until the next tick.
+ */
+static inline void snap_write_end(void) {
+    struct snap_writer *w = snap_writer();
+
+    if (--w->depth == 0) {
+        __atomic_store_n(&w->write_seq, w->write_seq + 1, __ATOMIC_RELEASE);
+        if (__builtin_expect(w->reclaim, 0) && !w->versioning) {
+            snap_reclaim();
+        }
+    }
+}
+
+/**
+ * Epoch stamped by the open write section
+ */
+static inline uint64_t snap_write_epoch(void) {
+    return snap_writer()->epoch;
+}
+
+/**
+ * Store a new payload into an entry, keeping the old one for snapshots
+ */
+int snap_cell_store_version(struct snap_cell *cell, const struct snap_cell *next, size_t size);
+
+/**
+ * Store a new payload into a snapshot-readable entry
+ *
+ * Must be called inside a write section.
+ *
+ * @param cell Cell of the entry to overwrite
+ * @param next Cell of an entry holding the new payload
+ * @param size Entry size in bytes (a multiple of 4)
+ * @return 0 on success, negative if the old version could not be kept
+ *         (the new payload is stored regardless)
+ */
+static inline int snap_cell_store(struct snap_cell *cell, const struct snap_cell *next,
+                                  size_t size) {
+    if (__builtin_expect(!snap_writer()->versioning, 1)) {
+        __builtin_memcpy(cell + 1, next + 1, size - sizeof(struct snap_cell));
+        return 0;
+    }
+    return snap_cell_store_version(cell, next, size);
+}
+
+/**
+ * Copy the payload an entry had at a snapshot epoch
+ *
+ * @param cell Cell of the entry to read
+ * @param out Cell of an entry to receive the payload
+ * @param size Entry size in bytes
+ * @param epoch Snapshot epoch
+ * @return 0 on success, negative if the entry has no version that old
+ */
+int snap_cell_load(const struct snap_cell *cell, struct snap_cell *out, size_t size,
+                   uint64_t epoch);
+
+/**
+ * Free the versions of an entry that no epoch at or after keep can reach
+ */
+void snap_cell_trim(struct snap_cell *cell, size_t size, uint64_t keep);
+
+/**
+ * Grow a snapshot-readable table inside a write section
+ *
+ * Same contract as cogkern_table_reserve(); while snapshots are pinned
+ * the old storage is retired until their readers are gone.
+ */
+int snap_table_reserve(void **table, size_t *capacity, size_t elem_size, size_t needed);
+
+/**
+ * Free retired tables and forget pinned readers (used at shutdown)
+ */
+void snap_reset(void);
+
+/**
+ * Fill the snapshot part of cogkern_stats()
+ */
+void snap_fill_stats(struct cogkern_stats *stats);
+
+/**
+ * Fill the AtomSpace part of cogkern_stats()
+ */
+void atomspace_fill_stats(struct cogkern_stats *stats);
+
+/**
+ * Fill the attention value part of cogkern_stats()
+ */
+void ecan_fill_stats(struct cogkern_stats *stats);
+
+/**
+ * Fill the truth value part of cogkern_stats()
+ */
+void pln_fill_stats(struct cogkern_stats *stats);
+
+/**
+ * Fill the stimulus event queue part of cogkern_stats()
+ */
+void cog_event_fill_stats(struct cogkern_stats *stats);
+
+/**
+ * Fill the task scheduler part of cogkern_stats()
+ */
+void task_fill_stats(struct cogkern_stats *stats);
+
+#endif /* COGKERN_INTERNAL_H */
@@ -4,22 +4,202 @@
  * 
  * Implements the cognitive loop orchestration layer with multi-stage
  * bootstrap (Stage0-Stage3) and event-driven processing.
+ * 
+ * The cognitive cycle is a three-deep pipeline over rotating slots:
+ * 
+ *   tick N     attention: ECAN tick, snapshot the focus into slot N % 3
+ *   tick N+1   pattern: find deduction chains A->B->C in the snapshot
+ *   tick N+2   inference: compute and rank conclusions, then commit them
+ * 
+ * Pattern and inference only read and write their own slot, never the
+ * AtomSpace, so in pipelined mode they run on worker threads while the
+ * loop thread does the next attention stage. Conclusions are committed by
+ * the loop thread at a fixed point of each tick, so serial and pipelined
+ * runs produce the same AtomSpace.
  */
 
-#include "cogkern.h"
+#include "cogkern_internal.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+/**
+ * Pipeline defaults: the stages stay off until cogloop_set_pipeline()
+ * asks for a focus, so plain cogloop_tick() callers never get links
+ * they did not ask for
+ */
+#define PIPELINE_FOCUS_SIZE 0
+#define PIPELINE_MAX_CONCLUSIONS 8
+
+/**
+ * Candidate chains examined per committed conclusion
+ */
+#define PIPELINE_CANDIDATE_FACTOR 16
+
+/**
+ * Links of one focus atom considered by the pattern stage
+ */
+#define PIPELINE_LINKS_PER_ATOM 64
+
+/**
+ * Confidence discount applied by deduction
+ */
+#define DEDUCTION_DISCOUNT 0.9f
+
+/**
+ * Number of pipeline slots (one per stage)
+ */
+#define PIPELINE_SLOTS 3
+
+/**
+ * Share of the time left to a tick's deadline handed out as work budget;
+ * the rest absorbs cost estimation error
+ */
+#define BUDGET_PERIOD_SHARE 0.8
+
+/**
+ * Weight of the latest tick in the per-unit cost averages
+ */
+#define BUDGET_EWMA_WEIGHT 0.25
+
+/**
+ * Assumed per-unit cost before a stage has been measured
+ */
+#define BUDGET_PRIOR_NS 1000.0
+
+/**
+ * Budgeted stages
+ */
+enum budget_stage {
+    BUDGET_EVENTS = 0,
+    BUDGET_TASKS,
+    BUDGET_FOCUS,
+    BUDGET_STAGES
+};
+
+/**
+ * Pipeline slot states
+ */
+enum slot_state {
+    SLOT_EMPTY = 0,
+    SLOT_FOCUSED,     /**< Attention snapshot taken */
+    SLOT_MATCHED,     /**< Deduction candidates found */
+    SLOT_INFERRED     /**< Conclusions ranked, ready to commit */
+};
+
+/**
+ * Focus atom in a snapshot
+ */
+struct focus_atom {
+    atom_handle_t atom;
+    float sti;
+    uint32_t first_link;     /**< Index of its first link in the slot */
+    uint32_t link_count;
+};
+
+/**
+ * Binary link touching a focus atom
+ */
+struct focus_link {
+    atom_handle_t src;
+    atom_handle_t dst;
+    enum atom_type type;
+    struct truth_value tv;
+};
+
+/**
+ * Deduction candidate / conclusion: src->mid, mid->dst gives src->dst
+ */
+struct deduction {
+    atom_handle_t src;
+    atom_handle_t dst;
+    enum atom_type type;
+    struct truth_value first;
+    struct truth_value second;
+    struct truth_value tv;   /**< Concluded truth value */
+    float score;
+};
+
+/**
+ * State handed from one stage to the next
+ */
+struct pipeline_slot {
+    enum slot_state state;
+    struct focus_atom *focus;
+    size_t focus_cap;
+    size_t focus_count;
+    struct focus_link *links;
+    size_t link_cap;
+    size_t link_count;
+    struct deduction *cands;
+    size_t cand_cap;
+    size_t cand_count;
+    uint32_t max_conclusions;
+    uint64_t pattern_ns;
+    uint64_t inference_ns;
+};
+
+/**
+ * Stage worker thread
+ */
+struct stage_worker {
+    pthread_t thread;
+    struct cogkern_ctx *ctx;          /**< Context the worker serves */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct pipeline_slot *slot;
+    void (*run)(struct pipeline_slot *slot);
+    int busy;
+    int quit;
+};
+
+/**
+ * Per-tick work budget
+ * 
+ * Unit costs are running averages over previous ticks, so quotas follow
+ * the measured load.
+ */
+struct tick_budget {
+    uint64_t deadline_ns;             /**< End of the current tick period */
+    double overhead_ns;               /**< Decay, forgetting and tiering per tick */
+    double unit_ns[BUDGET_STAGES];    /**< Cost per event, task and focus atom */
+    uint32_t quota[BUDGET_STAGES];
+};
 
 /**
  * Cognitive loop state
  */
-static struct {
+struct cogloop_state {
     enum boot_stage current_stage;
     int running;
     uint32_t frequency_hz;
     uint64_t iteration_count;
-    size_t num_regions;
-} g_cogloop = {0};
+    struct cogloop_pipeline_params params;
+    int params_set;
+    struct pipeline_slot slots[PIPELINE_SLOTS];
+    struct stage_worker workers[2];   /**< Pattern, inference */
+    int workers_started;
+    struct tick_budget budget;
+    struct cogloop_stats stats;
+};
+
+/**
+ * Cognitive loop state of the default context
+ */
+struct cogloop_state cogloop_default = {0};
+
+/**
+ * Cognitive loop state of the calling thread's context
+ */
+#define g_cogloop (*cogkern_ctx_current()->cogloop)
+
+/**
+ * Allocate Cognitive loop state for a new context
+ */
+struct cogloop_state *cogloop_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct cogloop_state));
+}
 
 /**
  * Initialize bootstrap stage
@@ -50,10 +230,11 @@ int cogloop_boot_stage(enum boot_stage stage) {
             break;
             
         case STAGE3_COGNITIVE:
-            /* Initialize cognitive loop */
+            /* Initialize cognitive loop and its stimulus queue */
             g_cogloop.running = 0;
             g_cogloop.frequency_hz = 0;
             g_cogloop.iteration_count = 0;
+            result = cog_event_queue_default();
             break;
     }
     
@@ -80,25 +261,593 @@ int stage1_init_hypergraph_fs(void) {
 }
 
 /**
- * Initialize memory regions
+ * Monotonic clock in nanoseconds
+ */
+static uint64_t pipeline_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Attention stage: snapshot the focus atoms and their binary links
+ * 
+ * Runs on the loop thread, the only thread that touches the AtomSpace.
+ */
+static int pipeline_focus(struct pipeline_slot *ps, size_t k, uint32_t max_conclusions) {
+    atom_handle_t incoming[PIPELINE_LINKS_PER_ATOM];
+    
+    ps->focus_count = 0;
+    ps->link_count = 0;
+    
+    if (cogkern_table_reserve((void **)&ps->focus, &ps->focus_cap,
+                              sizeof(struct focus_atom), k) != 0) {
+        return -1;
+    }
+    
+    atom_handle_t *atoms = malloc(k * (sizeof(atom_handle_t) + sizeof(float)));
+    if (!atoms) {
+        return -1;
+    }
+    float *sti = (float *)(atoms + k);
+    size_t n = ecan_top_sti(k, atoms, sti);
+    
+    for (size_t i = 0; i < n; i++) {
+        struct focus_atom *f = &ps->focus[ps->focus_count++];
+        uint32_t slot;
+        
+        f->atom = atoms[i];
+        f->sti = sti[i];
+        f->first_link = (uint32_t)ps->link_count;
+        f->link_count = 0;
+        
+        if (atomspace_resolve(f->atom, &slot) != 0) {
+            continue;
+        }
+        
+        size_t m = atomspace_incoming(slot, incoming, PIPELINE_LINKS_PER_ATOM);
+        if (m > PIPELINE_LINKS_PER_ATOM) {
+            m = PIPELINE_LINKS_PER_ATOM;
+        }
+        
+        for (size_t j = 0; j < m; j++) {
+            atom_handle_t pair[2];
+            uint32_t link_slot;
+            struct focus_link *l;
+            
+            if (atomspace_resolve(incoming[j], &link_slot) != 0 ||
+                atomspace_outgoing(link_slot, pair, 2) != 2) {
+                continue;
+            }
+            if (cogkern_table_reserve((void **)&ps->links, &ps->link_cap,
+                                      sizeof(struct focus_link), ps->link_count + 1) != 0) {
+                break;
+            }
+            
+            l = &ps->links[ps->link_count++];
+            l->src = pair[0];
+            l->dst = pair[1];
+            l->type = atomspace_type(link_slot);
+            if (pln_peek_tv(link_slot, &l->tv) != 0) {
+                l->tv.strength = 0.5f;
+                l->tv.confidence = 0.0f;
+            }
+            f->link_count++;
+        }
+    }
+    
+    free(atoms);
+    ps->max_conclusions = max_conclusions;
+    ps->state = SLOT_FOCUSED;
+    return 0;
+}
+
+/**
+ * Pattern stage: find chains src->mid->dst through each focus atom
+ */
+static void pipeline_match(struct pipeline_slot *ps) {
+    uint64_t t0 = pipeline_now();
+    COG_TRACE_BEGIN(span);
+    
+    ps->cand_count = 0;
+    
+    for (size_t i = 0; i < ps->focus_count && ps->cand_count < ps->cand_cap; i++) {
+        const struct focus_atom *f = &ps->focus[i];
+        const struct focus_link *links = &ps->links[f->first_link];
+        
+        for (uint32_t a = 0; a < f->link_count && ps->cand_count < ps->cand_cap; a++) {
+            if (links[a].dst != f->atom || links[a].tv.confidence <= 0.0f) {
+                continue; /* Need an evidenced src->mid */
+            }
+            
+            for (uint32_t b = 0; b < f->link_count && ps->cand_count < ps->cand_cap; b++) {
+                if (links[b].src != f->atom || links[b].type != links[a].type ||
+                    links[b].dst == links[a].src || links[b].dst == f->atom ||
+                    links[b].tv.confidence <= 0.0f) {
+                    continue;
+                }
+                
+                struct deduction *d = &ps->cands[ps->cand_count++];
+                d->src = links[a].src;
+                d->dst = links[b].dst;
+                d->type = links[a].type;
+                d->first = links[a].tv;
+                d->second = links[b].tv;
+            }
+        }
+    }
+    
+    ps->state = SLOT_MATCHED;
+    ps->pattern_ns = pipeline_now() - t0;
+    COG_TRACE_END(span, "pattern_match");
+}
+
+/**
+ * Inference and action selection: deduce, rank, keep the best
+ */
+static void pipeline_infer(struct pipeline_slot *ps) {
+    uint64_t t0 = pipeline_now();
+    COG_TRACE_BEGIN(span);
+    
+    for (size_t i = 0; i < ps->cand_count; i++) {
+        struct deduction *d = &ps->cands[i];
+        d->tv.strength = d->first.strength * d->second.strength;
+        d->tv.confidence = d->first.confidence * d->second.confidence * DEDUCTION_DISCOUNT;
+        d->score = d->tv.strength * d->tv.confidence;
+    }
+    
+    /* Partial selection sort: the first max_conclusions become the best */
+    size_t keep = ps->cand_count < ps->max_conclusions ? ps->cand_count : ps->max_conclusions;
+    for (size_t i = 0; i < keep; i++) {
+        size_t best = i;
+        for (size_t j = i + 1; j < ps->cand_count; j++) {
+            if (ps->cands[j].score > ps->cands[best].score) {
+                best = j;
+            }
+        }
+        if (best != i) {
+            struct deduction t = ps->cands[i];
+            ps->cands[i] = ps->cands[best];
+            ps->cands[best] = t;
+        }
+    }
+    ps->cand_count = keep;
+    
+    ps->state = SLOT_INFERRED;
+    ps->inference_ns = pipeline_now() - t0;
+    COG_TRACE_END(span, "inference");
+}
+
+/**
+ * Commit a slot's conclusions to the AtomSpace (loop thread)
+ * 
+ * An existing link of the same type and outgoing set gets the concluded
+ * truth value if it is more confident; otherwise a new link is created.
+ */
+static void pipeline_commit(struct pipeline_slot *ps) {
+    atom_handle_t incoming[PIPELINE_LINKS_PER_ATOM];
+    
+    for (size_t i = 0; i < ps->cand_count; i++) {
+        const struct deduction *d = &ps->cands[i];
+        uint32_t src_slot, dst_slot;
+        int found = 0;
+        
+        if (atomspace_resolve(d->src, &src_slot) != 0 ||
+            atomspace_resolve(d->dst, &dst_slot) != 0) {
+            continue; /* Removed since the snapshot */
+        }
+        
+        size_t m = atomspace_incoming(src_slot, incoming, PIPELINE_LINKS_PER_ATOM);
+        if (m > PIPELINE_LINKS_PER_ATOM) {
+            m = PIPELINE_LINKS_PER_ATOM;
+        }
+        
+        for (size_t j = 0; j < m && !found; j++) {
+            atom_handle_t pair[2];
+            uint32_t link_slot;
+            struct truth_value tv;
+            
+            if (atomspace_resolve(incoming[j], &link_slot) != 0 ||
+                atomspace_type(link_slot) != d->type ||
+                atomspace_outgoing(link_slot, pair, 2) != 2 ||
+                pair[0] != d->src || pair[1] != d->dst) {
+                continue;
+            }
+            
+            found = 1;
+            if (pln_peek_tv(link_slot, &tv) != 0 || tv.confidence < d->tv.confidence) {
+                pln_restore_tv(link_slot, incoming[j], &d->tv);
+                g_cogloop.stats.conclusions_revised++;
+            }
+        }
+        
+        if (!found) {
+            atom_handle_t pair[2] = {d->src, d->dst};
+            atom_handle_t link = cog_link_create(d->type, pair, 2);
+            uint32_t link_slot;
+            if (link && atomspace_lookup(link, &link_slot) == 0) {
+                pln_restore_tv(link_slot, link, &d->tv);
+                g_cogloop.stats.conclusions_created++;
+            }
+        }
+    }
+    
+    ps->cand_count = 0;
+    ps->state = SLOT_EMPTY;
+}
+
+/**
+ * Stage functions, indexed like g_cogloop.workers
+ */
+static void (*const stage_runs[2])(struct pipeline_slot *) = {pipeline_match, pipeline_infer};
+
+/**
+ * Stage worker thread body
+ */
+static void *stage_worker_main(void *arg) {
+    struct stage_worker *w = arg;
+    
+    cogkern_ctx_bind(w->ctx);
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->busy && !w->quit) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if (w->quit) {
+            break;
+        }
+        
+        struct pipeline_slot *ps = w->slot;
+        pthread_mutex_unlock(&w->lock);
+        w->run(ps);
+        pthread_mutex_lock(&w->lock);
+        
+        w->busy = 0;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    
+    return NULL;
+}
+
+/**
+ * Hand a slot to a worker (or run it inline in serial mode)
+ */
+static void stage_launch(int stage, struct pipeline_slot *ps) {
+    struct stage_worker *w = &g_cogloop.workers[stage];
+    
+    if (!g_cogloop.workers_started) {
+        stage_runs[stage](ps);
+        return;
+    }
+    
+    pthread_mutex_lock(&w->lock);
+    w->slot = ps;
+    w->busy = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * Wait until a worker has finished its slot
+ */
+static void stage_wait(struct stage_worker *w) {
+    if (!g_cogloop.workers_started) {
+        return;
+    }
+    
+    pthread_mutex_lock(&w->lock);
+    while (w->busy) {
+        pthread_cond_wait(&w->cond, &w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * Tell a worker to exit and join it
+ */
+static void stage_worker_join(struct stage_worker *w) {
+    pthread_mutex_lock(&w->lock);
+    w->quit = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    
+    pthread_join(w->thread, NULL);
+    pthread_cond_destroy(&w->cond);
+    pthread_mutex_destroy(&w->lock);
+}
+
+/**
+ * Stop and join the worker threads
+ */
+static void pipeline_stop_workers(void) {
+    if (!g_cogloop.workers_started) {
+        return;
+    }
+    
+    for (int i = 0; i < 2; i++) {
+        stage_wait(&g_cogloop.workers[i]);
+        stage_worker_join(&g_cogloop.workers[i]);
+    }
+    
+    g_cogloop.workers_started = 0;
+}
+
+/**
+ * Start the pattern and inference worker threads
+ */
+static int pipeline_start_workers(void) {
+    for (int i = 0; i < 2; i++) {
+        struct stage_worker *w = &g_cogloop.workers[i];
+        memset(w, 0, sizeof(*w));
+        w->run = stage_runs[i];
+        w->ctx = cogkern_ctx_current();
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->cond, NULL);
+        
+        if (pthread_create(&w->thread, NULL, stage_worker_main, w) != 0) {
+            pthread_cond_destroy(&w->cond);
+            pthread_mutex_destroy(&w->lock);
+            while (--i >= 0) {
+                stage_worker_join(&g_cogloop.workers[i]);
+            }
+            return -1;
+        }
+    }
+    
+    g_cogloop.workers_started = 1;
+    return 0;
+}
+
+/**
+ * Apply the default pipeline parameters on first use
+ */
+static void pipeline_defaults(void) {
+    if (!g_cogloop.params_set) {
+        g_cogloop.params.pipelined = 0;
+        g_cogloop.params.focus_size = PIPELINE_FOCUS_SIZE;
+        g_cogloop.params.max_conclusions = PIPELINE_MAX_CONCLUSIONS;
+        g_cogloop.params_set = 1;
+    }
+}
+
+/**
+ * Configure the cognitive cycle
  * 
- * Performance target: ≤100ns per memory op
+ * @param params Pipeline parameters
+ * @return 0 on success, negative on error
+ */
+int cogloop_set_pipeline(const struct cogloop_pipeline_params *params) {
+    if (!params || (params->focus_size > 0 && params->max_conclusions == 0)) {
+        return -1;
+    }
+    
+    pipeline_stop_workers();
+    
+    /* Candidate buffers are written by workers, so size them up front */
+    size_t cand_cap = (size_t)params->max_conclusions * PIPELINE_CANDIDATE_FACTOR;
+    for (int i = 0; i < PIPELINE_SLOTS; i++) {
+        struct pipeline_slot *ps = &g_cogloop.slots[i];
+        if (cogkern_table_reserve((void **)&ps->cands, &ps->cand_cap,
+                                  sizeof(struct deduction), cand_cap) != 0) {
+            return -1;
+        }
+        ps->state = SLOT_EMPTY;
+        ps->cand_count = 0;
+    }
+    
+    g_cogloop.params = *params;
+    g_cogloop.params_set = 1;
+    
+    if (params->pipelined && params->focus_size > 0) {
+        return pipeline_start_workers();
+    }
+    
+    return 0;
+}
+
+/**
+ * Get cognitive cycle statistics
  * 
- * @param num_regions Number of memory regions
+ * @param stats Pointer to structure to receive statistics
  * @return 0 on success, negative on error
  */
-int dtesn_mem_init_regions(size_t num_regions) {
-    if (num_regions == 0 || num_regions > 256) {
+int cogloop_get_stats(struct cogloop_stats *stats) {
+    if (!stats) {
         return -1;
     }
     
-    g_cogloop.num_regions = num_regions;
+    *stats = g_cogloop.stats;
+    stats->iterations = g_cogloop.iteration_count;
     
-    /* In a real implementation:
-     * - Allocate GGML tensor regions
-     * - Set up membrane-aware memory management
-     * - Configure cache-aligned structures for performance
-     */
+    return 0;
+}
+
+/**
+ * Split a time budget between stages, water-filling: stages needing less
+ * than an even share get what they need and the rest is shared out again
+ */
+static void budget_split(double avail, const double *need, double *grant) {
+    int settled[BUDGET_STAGES] = {0};
+    int open = 0;
+    
+    for (int i = 0; i < BUDGET_STAGES; i++) {
+        grant[i] = 0.0;
+        if (need[i] > 0.0) {
+            open++;
+        } else {
+            settled[i] = 1;
+        }
+    }
+    
+    while (open > 0 && avail > 0.0) {
+        double share = avail / open;
+        int progress = 0;
+        
+        for (int i = 0; i < BUDGET_STAGES; i++) {
+            if (!settled[i] && need[i] <= share) {
+                grant[i] = need[i];
+                avail -= need[i];
+                settled[i] = 1;
+                open--;
+                progress = 1;
+            }
+        }
+        
+        if (!progress) {
+            for (int i = 0; i < BUDGET_STAGES; i++) {
+                if (!settled[i]) {
+                    grant[i] = share;
+                }
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Advance the tick deadline and set this tick's quotas
+ * 
+ * @return Non-zero if the tick is budgeted (loop running at a frequency)
+ */
+static int budget_plan(uint64_t now) {
+    struct tick_budget *b = &g_cogloop.budget;
+    struct cog_event_stats es;
+    struct dtesn_sched_stats ss;
+    double demand[BUDGET_STAGES], need[BUDGET_STAGES], grant[BUDGET_STAGES];
+    
+    if (!g_cogloop.running || g_cogloop.frequency_hz == 0) {
+        g_cogloop.stats.budget_ns = 0;
+        return 0;
+    }
+    
+    /* A tick starting a whole period late resynchronises instead of
+     * trying to catch up, so lateness never accumulates */
+    uint64_t period = 1000000000ULL / g_cogloop.frequency_hz;
+    if (b->deadline_ns == 0 || now < b->deadline_ns || now >= b->deadline_ns + period) {
+        b->deadline_ns = now + period;
+    } else {
+        b->deadline_ns += period;
+    }
+    
+    double budget = (double)(b->deadline_ns - now) * BUDGET_PERIOD_SHARE;
+    g_cogloop.stats.budget_ns = (uint64_t)budget;
+    
+    demand[BUDGET_EVENTS] = cog_event_get_stats(&es) == 0 ? (double)es.depth : 0.0;
+    demand[BUDGET_TASKS] = dtesn_sched_get_stats(&ss) == 0 ? (double)ss.tasks_pending : 0.0;
+    demand[BUDGET_FOCUS] = g_cogloop.params.focus_size;
+    
+    for (int i = 0; i < BUDGET_STAGES; i++) {
+        if (b->unit_ns[i] <= 0.0) {
+            b->unit_ns[i] = BUDGET_PRIOR_NS;
+        }
+        need[i] = demand[i] * b->unit_ns[i];
+    }
+    
+    budget_split(budget - b->overhead_ns, need, grant);
+    
+    /* Every stage with work makes some progress, however late the tick */
+    for (int i = 0; i < BUDGET_STAGES; i++) {
+        double units = grant[i] / b->unit_ns[i];
+        if (units > demand[i]) {
+            units = demand[i];
+        }
+        if (units < 1.0 && demand[i] > 0.0) {
+            units = 1.0;
+        }
+        b->quota[i] = units > (double)UINT32_MAX ? UINT32_MAX : (uint32_t)units;
+    }
+    
+    g_cogloop.stats.event_quota = b->quota[BUDGET_EVENTS];
+    g_cogloop.stats.task_quota = b->quota[BUDGET_TASKS];
+    g_cogloop.stats.focus_quota = b->quota[BUDGET_FOCUS];
+    
+    return 1;
+}
+
+/**
+ * Fold one measurement into a running per-unit cost
+ */
+static void budget_learn(double *avg, double total_ns, double units) {
+    if (units <= 0.0) {
+        return;
+    }
+    
+    double sample = total_ns / units;
+    *avg = *avg > 0.0 ? *avg + BUDGET_EWMA_WEIGHT * (sample - *avg) : sample;
+}
+
+/**
+ * Run the cognitive cycle stages for one tick
+ * 
+ * @return Number of atoms in this tick's focus snapshot, negative on error
+ */
+static int pipeline_step(uint64_t tick, int budgeted) {
+    uint64_t t0 = pipeline_now();
+    
+    pipeline_defaults();
+    if (g_cogloop.params.focus_size == 0) {
+        return 0;
+    }
+    if (!g_cogloop.slots[0].cands) {
+        struct cogloop_pipeline_params p = g_cogloop.params;
+        if (cogloop_set_pipeline(&p) != 0) {
+            return -1;
+        }
+    }
+    
+    /* A trimmed focus yields proportionally fewer conclusions */
+    size_t k = g_cogloop.params.focus_size;
+    uint32_t max_conclusions = g_cogloop.params.max_conclusions;
+    if (budgeted && g_cogloop.budget.quota[BUDGET_FOCUS] < k) {
+        k = g_cogloop.budget.quota[BUDGET_FOCUS];
+        max_conclusions = (uint32_t)((uint64_t)max_conclusions * k / g_cogloop.params.focus_size);
+        if (max_conclusions == 0) {
+            max_conclusions = 1;
+        }
+    }
+    
+    struct pipeline_slot *focus = &g_cogloop.slots[tick % PIPELINE_SLOTS];
+    struct pipeline_slot *match = &g_cogloop.slots[(tick + 2) % PIPELINE_SLOTS];
+    struct pipeline_slot *infer = &g_cogloop.slots[(tick + 1) % PIPELINE_SLOTS];
+    
+    /* The focus slot was committed two ticks ago, so no worker holds it */
+    COG_TRACE_BEGIN(focus_span);
+    if (pipeline_focus(focus, k, max_conclusions) != 0) {
+        focus->state = SLOT_EMPTY;
+    }
+    COG_TRACE_END(focus_span, "attention_focus");
+    uint64_t t1 = pipeline_now();
+    g_cogloop.stats.attention_ns += t1 - t0;
+    
+    /* Barrier: pattern (tick-1) and inference (tick-2) must be done */
+    stage_wait(&g_cogloop.workers[0]);
+    stage_wait(&g_cogloop.workers[1]);
+    uint64_t t2 = pipeline_now();
+    if (g_cogloop.workers_started) {
+        g_cogloop.stats.stall_ns += t2 - t1;
+    }
+    
+    /* 4. Action selection: commit what tick-2's inference chose */
+    if (infer->state == SLOT_INFERRED) {
+        COG_TRACE_BEGIN(commit_span);
+        g_cogloop.stats.inference_ns += infer->inference_ns;
+        pipeline_commit(infer);
+        COG_TRACE_END(commit_span, "commit");
+    }
+    if (match->state == SLOT_MATCHED) {
+        g_cogloop.stats.pattern_ns += match->pattern_ns;
+    }
+    g_cogloop.stats.commit_ns += pipeline_now() - t2;
+    
+    /* 2./3. Pattern recognition on this tick, inference on the previous */
+    if (match->state == SLOT_MATCHED) {
+        stage_launch(1, match);
+    }
+    if (focus->state == SLOT_FOCUSED) {
+        stage_launch(0, focus);
+        return (int)focus->focus_count;
+    }
     
     return 0;
 }
@@ -109,32 +858,83 @@ int dtesn_mem_init_regions(size_t num_regions) {
  * @return 0 on success, negative on error
  */
 int cogloop_tick(void) {
-    g_cogloop.iteration_count++;
+    struct tick_budget *b = &g_cogloop.budget;
+    struct dtesn_sched_stats before, after;
+    struct cog_event_stats es;
+    uint64_t tick = g_cogloop.iteration_count++;
+    uint64_t t0 = pipeline_now();
+    COG_TRACE_BEGIN(span);
+    int budgeted = budget_plan(t0);
     
-    /* Execute cognitive cycle:
-     * 1. Attention allocation (ECAN)
-     * 2. Pattern recognition (AtomSpace queries)
-     * 3. Inference (PLN)
-     * 4. Action selection
-     */
+    /* Apply stimulus events posted by sensor threads since the last tick */
+    int events = cog_event_drain(budgeted ? b->quota[BUDGET_EVENTS] : UINT32_MAX);
+    uint64_t t1 = pipeline_now();
     
-    /* Run scheduler tick */
+    /* 1. Attention allocation (ECAN) and cognitive tasks */
+    dtesn_sched_get_stats(&before);
+    task_set_limit(budgeted ? b->quota[BUDGET_TASKS] : 0);
     int tasks = dtesn_sched_tick();
     if (tasks < 0) {
+        COG_TRACE_END(span, "cogloop_tick");
         return tasks;
     }
+    dtesn_sched_get_stats(&after);
+    uint64_t t2 = pipeline_now();
+    g_cogloop.stats.attention_ns += t2 - t0;
     
-    /* In a real implementation:
-     * - Process sensory input
-     * - Update working memory
-     * - Run inference chains
-     * - Select and execute actions
-     * - Update long-term memory
-     */
+    int focused = pipeline_step(tick, budgeted);
+    if (focused < 0) {
+        COG_TRACE_END(span, "cogloop_tick");
+        return focused;
+    }
+    uint64_t t3 = pipeline_now();
+    
+    /* Learn this tick's costs for the next tick's split */
+    double dispatch_ns = (double)(after.dispatch_ns_total - before.dispatch_ns_total);
+    double sched_ns = (double)(t2 - t1);
+    budget_learn(&b->unit_ns[BUDGET_EVENTS], (double)(t1 - t0), events);
+    budget_learn(&b->unit_ns[BUDGET_TASKS], dispatch_ns,
+                 (double)(after.tasks_run - before.tasks_run));
+    budget_learn(&b->unit_ns[BUDGET_FOCUS], (double)(t3 - t2), focused);
+    budget_learn(&b->overhead_ns, sched_ns > dispatch_ns ? sched_ns - dispatch_ns : 0.0, 1.0);
+    
+    if (t3 - t0 > g_cogloop.stats.tick_ns_max) {
+        g_cogloop.stats.tick_ns_max = t3 - t0;
+    }
+    if (budgeted && t3 > b->deadline_ns) {
+        g_cogloop.stats.deadline_misses++;
+    }
+    g_cogloop.stats.events_carried = cog_event_get_stats(&es) == 0 ? es.depth : 0;
+    g_cogloop.stats.tasks_carried = after.tasks_pending;
     
+    /* Free snapshot versions no pinned reader can reach any more */
+    snap_reclaim();
+    
+    metrics_record(METRIC_TICK_NS, t3 - t0);
+    metrics_tick();
+    COG_TRACE_END(span, "cogloop_tick");
     return 0;
 }
 
+/**
+ * Stop pipeline workers and free the cognitive cycle buffers
+ */
+void cogloop_reset(void) {
+    pipeline_stop_workers();
+    
+    for (int i = 0; i < PIPELINE_SLOTS; i++) {
+        struct pipeline_slot *ps = &g_cogloop.slots[i];
+        cogkern_table_free((void **)&ps->focus, &ps->focus_cap, sizeof(struct focus_atom));
+        cogkern_table_free((void **)&ps->links, &ps->link_cap, sizeof(struct focus_link));
+        cogkern_table_free((void **)&ps->cands, &ps->cand_cap, sizeof(struct deduction));
+        memset(ps, 0, sizeof(*ps));
+    }
+    
+    g_cogloop.params_set = 0;
+    memset(&g_cogloop.budget, 0, sizeof(g_cogloop.budget));
+    memset(&g_cogloop.stats, 0, sizeof(g_cogloop.stats));
+}
+
 /**
  * Start the cognitive loop
  * 
@@ -148,6 +948,7 @@ int cogloop_start(uint32_t hz) {
     
     g_cogloop.frequency_hz = hz;
     g_cogloop.running = 1;
+    g_cogloop.budget.deadline_ns = 0;
     
     /* In a real implementation with hz > 0:
      * - Create timer thread
@@ -0,0 +1,454 @@
+/**
+ * @file cogmetrics.c
+ * @brief Kernel metrics - Per-thread counters and latency histograms
+ *
+ * Every thread that records a metric gets its own shard, allocated and
+ * registered on first use, so counting an event or a latency is a store
+ * to a line no other thread writes. cogkern_stats() sums the shards and
+ * combines them with gauges read from each subsystem.
+ *
+ * Latencies go into log-linear histograms in the style of HdrHistogram:
+ * 16 linear sub-buckets per power of two, so every reported percentile
+ * is within 1/16 of the recorded value for the whole 64-bit range.
+ */
+
+#include "cogkern_internal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Linear sub-buckets per power of two (log2)
+ */
+#define METRIC_SUB_BITS 4
+#define METRIC_SUB_COUNT (1u << METRIC_SUB_BITS)
+
+/**
+ * Buckets covering every uint64_t value
+ */
+#define METRIC_BUCKETS ((64 - METRIC_SUB_BITS + 1) * METRIC_SUB_COUNT)
+
+/**
+ * Maximum number of threads with their own shard
+ */
+#define METRIC_MAX_SHARDS 64
+
+/**
+ * Latency histogram
+ */
+struct metric_histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[METRIC_BUCKETS];
+};
+
+/**
+ * Metrics of one thread
+ *
+ * Written only by its thread; readers load the fields while it records,
+ * so every update is a single relaxed atomic store.
+ */
+struct metric_shard {
+    const void *owner;         /**< Thread-local address identifying the thread */
+    uint64_t counters[METRIC_COUNTERS];
+    struct metric_histogram histograms[METRIC_HISTOGRAMS];
+};
+
+/**
+ * Metrics state
+ */
+struct metrics_state {
+    pthread_mutex_t lock;      /**< Guards the shard list */
+    struct metric_shard *shards[METRIC_MAX_SHARDS];
+    uint32_t shard_count;
+    uint32_t generation;       /**< Process-unique, renewed when the shards are freed */
+    struct metric_shard shared; /**< Threads without a shard, updated atomically */
+    char *dump_path;
+    uint32_t dump_every;
+    uint32_t dump_countdown;
+};
+
+/**
+ * Metrics state of the default context
+ */
+struct metrics_state metrics_default = {PTHREAD_MUTEX_INITIALIZER, {NULL}, 0, 0,
+                                       {NULL, {0}, {{0, 0, 0, {0}}}}, NULL, 0, 0};
+
+/**
+ * Metrics state of the calling thread's context
+ */
+#define g_metrics (*cogkern_ctx_current()->metrics)
+
+/**
+ * Last generation handed out; the default context owns generation 0
+ */
+static uint32_t g_metrics_generations;
+
+/**
+ * Allocate metrics state for a new context
+ */
+struct metrics_state *metrics_state_create(void) {
+    struct metrics_state *state = cogkern_state_alloc(sizeof(*state));
+
+    if (state) {
+        pthread_mutex_init(&state->lock, NULL);
+        state->generation = __atomic_add_fetch(&g_metrics_generations, 1, __ATOMIC_RELAXED);
+    }
+    return state;
+}
+
+/**
+ * Shard of the current thread, valid while its generation is current
+ *
+ * Generations are unique across contexts, so a thread moving between
+ * contexts never writes into another context's shard.
+ */
+static __thread struct metric_shard *t_shard;
+static __thread uint32_t t_shard_generation;
+
+/**
+ * Shard of the calling thread, or NULL to use the shared one
+ */
+static struct metric_shard *metrics_shard(void) {
+    uint32_t generation = __atomic_load_n(&g_metrics.generation, __ATOMIC_ACQUIRE);
+
+    if (__builtin_expect(t_shard != NULL && t_shard_generation == generation, 1)) {
+        return t_shard;
+    }
+
+    struct metric_shard *shard = NULL;
+
+    pthread_mutex_lock(&g_metrics.lock);
+    for (uint32_t i = 0; i < g_metrics.shard_count && !shard; i++) {
+        if (g_metrics.shards[i]->owner == &t_shard) {
+            shard = g_metrics.shards[i]; /* Registered before switching contexts */
+        }
+    }
+    if (!shard && g_metrics.shard_count < METRIC_MAX_SHARDS) {
+        shard = calloc(1, sizeof(*shard));
+        if (shard) {
+            shard->owner = &t_shard;
+            g_metrics.shards[g_metrics.shard_count++] = shard;
+        }
+    }
+    generation = g_metrics.generation;
+    pthread_mutex_unlock(&g_metrics.lock);
+
+    t_shard = shard;
+    t_shard_generation = generation;
+    return shard;
+}
+
+/**
+ * Histogram bucket of a value
+ */
+static uint32_t metrics_bucket(uint64_t v) {
+    if (v < METRIC_SUB_COUNT) {
+        return (uint32_t)v;
+    }
+
+    uint32_t shift = 63 - (uint32_t)__builtin_clzll(v) - METRIC_SUB_BITS;
+    return (shift + 1) * METRIC_SUB_COUNT + (uint32_t)((v >> shift) & (METRIC_SUB_COUNT - 1));
+}
+
+/**
+ * Largest value that falls in a histogram bucket
+ */
+static uint64_t metrics_bucket_max(uint32_t bucket) {
+    if (bucket < METRIC_SUB_COUNT) {
+        return bucket;
+    }
+
+    uint32_t shift = bucket / METRIC_SUB_COUNT - 1;
+    uint64_t sub = METRIC_SUB_COUNT + bucket % METRIC_SUB_COUNT;
+    return (sub << shift) + ((1ULL << shift) - 1);
+}
+
+/**
+ * Add to a counter owned by the calling thread
+ */
+static inline void metrics_bump(uint64_t *field, uint64_t n, int owned) {
+    if (owned) {
+        __atomic_store_n(field, __atomic_load_n(field, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(field, n, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Count kernel events
+ */
+void metrics_count(enum metric_counter counter, uint64_t n) {
+    struct metric_shard *shard = metrics_shard();
+    int owned = shard != NULL;
+
+    metrics_bump(&(owned ? shard : &g_metrics.shared)->counters[counter], n, owned);
+}
+
+/**
+ * Record one latency sample
+ */
+void metrics_record(enum metric_latency histogram, uint64_t ns) {
+    struct metric_shard *shard = metrics_shard();
+    int owned = shard != NULL;
+    struct metric_histogram *h = &(owned ? shard : &g_metrics.shared)->histograms[histogram];
+
+    metrics_bump(&h->buckets[metrics_bucket(ns)], 1, owned);
+    metrics_bump(&h->sum, ns, owned);
+    metrics_bump(&h->count, 1, owned);
+
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (ns > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Add one shard's histogram into a sum
+ */
+static void metrics_merge(struct metric_histogram *sum, struct metric_histogram *h) {
+    for (uint32_t i = 0; i < METRIC_BUCKETS; i++) {
+        sum->buckets[i] += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+    }
+    sum->count += __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+    sum->sum += __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    if (max > sum->max) {
+        sum->max = max;
+    }
+}
+
+/**
+ * Summarise a histogram as percentiles
+ */
+static void metrics_summarise(const struct metric_histogram *h, struct cogkern_latency *out) {
+    static const double quantiles[4] = {0.50, 0.90, 0.99, 0.999};
+    uint64_t *targets[4] = {&out->p50_ns, &out->p90_ns, &out->p99_ns, &out->p999_ns};
+    uint64_t total = 0;
+    uint32_t q = 0;
+
+    memset(out, 0, sizeof(*out));
+
+    /* Buckets may be summed while threads record; trust their total */
+    for (uint32_t i = 0; i < METRIC_BUCKETS; i++) {
+        total += h->buckets[i];
+    }
+    if (total == 0) {
+        return;
+    }
+
+    out->count = total;
+    out->mean_ns = h->count ? h->sum / h->count : 0;
+    out->max_ns = h->max;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < METRIC_BUCKETS && q < 4; i++) {
+        seen += h->buckets[i];
+        while (q < 4 && (double)seen >= quantiles[q] * (double)total) {
+            uint64_t v = metrics_bucket_max(i);
+            *targets[q++] = v < h->max ? v : h->max;
+        }
+    }
+}
+
+/**
+ * Collect kernel statistics and metrics
+ *
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative if the kernel is not initialized
+ */
+int cogkern_stats(struct cogkern_stats *stats) {
+    if (!stats) {
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    if (cogkern_mem_usage(&stats->mem_used, &stats->mem_budget) != 0) {
+        return -1;
+    }
+
+    atomspace_fill_stats(stats);
+    ecan_fill_stats(stats);
+    pln_fill_stats(stats);
+    embed_fill_stats(stats);
+    tensor_fill_stats(stats);
+    cog_event_fill_stats(stats);
+    task_fill_stats(stats);
+    snap_fill_stats(stats);
+
+    for (uint32_t depth = 0; depth < HGFS_MAX_DEPTH; depth++) {
+        struct hgfs_stats hs;
+        if (hgfs_get_stats(depth, &hs) == 0) {
+            stats->arena_reserved += hs.bytes_reserved;
+            stats->arena_in_use += hs.bytes_in_use;
+        }
+    }
+
+    struct cog_tier_stats ts;
+    if (cog_tier_get_stats(&ts) == 0) {
+        stats->tier_segment_bytes = ts.segment_size;
+    }
+
+    /* Histograms are large; merge them one at a time */
+    struct metric_histogram *sum = malloc(sizeof(*sum));
+    if (!sum) {
+        return -1;
+    }
+    struct cogkern_latency *latencies[METRIC_HISTOGRAMS] = {
+        [METRIC_TICK_NS] = &stats->tick,
+        [METRIC_SCHED_TICK_NS] = &stats->sched_tick,
+        [METRIC_TASK_RUN_NS] = &stats->task_run,
+        [METRIC_TASK_WAIT_NS] = &stats->task_wait,
+    };
+    uint64_t counters[METRIC_COUNTERS] = {0};
+
+    pthread_mutex_lock(&g_metrics.lock);
+    for (uint32_t c = 0; c < METRIC_COUNTERS; c++) {
+        counters[c] = __atomic_load_n(&g_metrics.shared.counters[c], __ATOMIC_RELAXED);
+        for (uint32_t i = 0; i < g_metrics.shard_count; i++) {
+            counters[c] += __atomic_load_n(&g_metrics.shards[i]->counters[c], __ATOMIC_RELAXED);
+        }
+    }
+    for (uint32_t m = 0; m < METRIC_HISTOGRAMS; m++) {
+        memset(sum, 0, sizeof(*sum));
+        metrics_merge(sum, &g_metrics.shared.histograms[m]);
+        for (uint32_t i = 0; i < g_metrics.shard_count; i++) {
+            metrics_merge(sum, &g_metrics.shards[i]->histograms[m]);
+        }
+        metrics_summarise(sum, latencies[m]);
+    }
+    pthread_mutex_unlock(&g_metrics.lock);
+    free(sum);
+
+    stats->atoms_created = counters[METRIC_ATOMS_CREATED];
+    stats->atoms_removed = counters[METRIC_ATOMS_REMOVED];
+    stats->links_created = counters[METRIC_LINKS_CREATED];
+    stats->inferences = counters[METRIC_INFERENCES];
+    stats->tasks_run = counters[METRIC_TASKS_RUN];
+    stats->events_applied = counters[METRIC_EVENTS_APPLIED];
+
+    return 0;
+}
+
+/**
+ * Write one latency summary as a JSON object member
+ */
+static void metrics_write_latency(FILE *f, const char *name, const struct cogkern_latency *l) {
+    fprintf(f, ",\"%s\":{\"count\":%llu,\"mean_ns\":%llu,\"p50_ns\":%llu,\"p90_ns\":%llu,"
+            "\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}", name,
+            (unsigned long long)l->count, (unsigned long long)l->mean_ns,
+            (unsigned long long)l->p50_ns, (unsigned long long)l->p90_ns,
+            (unsigned long long)l->p99_ns, (unsigned long long)l->p999_ns,
+            (unsigned long long)l->max_ns);
+}
+
+/**
+ * Append the current statistics to a file as one JSON line
+ *
+ * @param path Output file path
+ * @return 0 on success, negative on error
+ */
+int cogkern_stats_write(const char *path) {
+    struct cogkern_stats s;
+
+    if (!path || cogkern_stats(&s) != 0) {
+        return -1;
+    }
+
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        return -1;
+    }
+
+    fprintf(f, "{\"time_ns\":%llu", (unsigned long long)trace_clock_ns());
+    fprintf(f, ",\"atoms\":%zu,\"links\":%zu,\"edges\":%zu,\"link_members\":%zu,"
+            "\"attention_values\":%zu,\"truth_values\":%zu,\"embeddings\":%zu,"
+            "\"cold_atoms\":%zu,\"packed_atoms\":%zu,\"snapshots\":%zu,\"snapshot_versions\":%zu",
+            s.atoms, s.links, s.edges, s.link_members, s.attention_values, s.truth_values,
+            s.embeddings, s.cold_atoms, s.packed_atoms, s.snapshots, s.snapshot_versions);
+    fprintf(f, ",\"mem_used\":%zu,\"mem_budget\":%zu,\"atom_table_bytes\":%zu,"
+            "\"edge_table_bytes\":%zu,\"adjacency_pack_bytes\":%zu,\"av_table_bytes\":%zu,"
+            "\"tv_table_bytes\":%zu,\"arena_reserved\":%zu,\"arena_in_use\":%zu,"
+            "\"event_queue_bytes\":%zu,\"task_queue_bytes\":%zu,\"tier_segment_bytes\":%zu,"
+            "\"snapshot_bytes\":%zu,\"embedding_bytes\":%zu,\"tensor_bytes\":%zu",
+            s.mem_used, s.mem_budget, s.atom_table_bytes, s.edge_table_bytes,
+            s.adjacency_pack_bytes, s.av_table_bytes, s.tv_table_bytes, s.arena_reserved,
+            s.arena_in_use, s.event_queue_bytes, s.task_queue_bytes, s.tier_segment_bytes,
+            s.snapshot_bytes, s.embedding_bytes, s.tensor_bytes);
+    fprintf(f, ",\"atoms_created\":%llu,\"atoms_removed\":%llu,\"links_created\":%llu,"
+            "\"inferences\":%llu,\"tasks_run\":%llu,\"events_applied\":%llu",
+            (unsigned long long)s.atoms_created, (unsigned long long)s.atoms_removed,
+            (unsigned long long)s.links_created, (unsigned long long)s.inferences,
+            (unsigned long long)s.tasks_run, (unsigned long long)s.events_applied);
+    metrics_write_latency(f, "tick", &s.tick);
+    metrics_write_latency(f, "sched_tick", &s.sched_tick);
+    metrics_write_latency(f, "task_run", &s.task_run);
+    metrics_write_latency(f, "task_wait", &s.task_wait);
+    fprintf(f, "}\n");
+
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/**
+ * Append statistics to a file every given number of cognitive loop ticks
+ *
+ * Call from the loop thread or between ticks.
+ *
+ * @param path Output file path (NULL to stop)
+ * @param ticks Ticks between dumps (0 to stop)
+ * @return 0 on success, negative on error
+ */
+int cogkern_stats_dump_every(const char *path, uint32_t ticks) {
+    char *copy = NULL;
+
+    if (path && ticks > 0) {
+        copy = strdup(path);
+        if (!copy) {
+            return -1;
+        }
+    }
+
+    free(g_metrics.dump_path);
+    g_metrics.dump_path = copy;
+    g_metrics.dump_every = copy ? ticks : 0;
+    g_metrics.dump_countdown = g_metrics.dump_every;
+
+    return 0;
+}
+
+/**
+ * Count a cognitive loop tick toward the periodic dump
+ */
+void metrics_tick(void) {
+    if (g_metrics.dump_every == 0 || --g_metrics.dump_countdown > 0) {
+        return;
+    }
+
+    g_metrics.dump_countdown = g_metrics.dump_every;
+    cogkern_stats_write(g_metrics.dump_path);
+}
+
+/**
+ * Free every shard and stop the periodic dump
+ *
+ * No other thread may be recording metrics.
+ */
+void metrics_reset(void) {
+    pthread_mutex_lock(&g_metrics.lock);
+    for (uint32_t i = 0; i < g_metrics.shard_count; i++) {
+        free(g_metrics.shards[i]);
+        g_metrics.shards[i] = NULL;
+    }
+    g_metrics.shard_count = 0;
+    memset(&g_metrics.shared, 0, sizeof(g_metrics.shared));
+    free(g_metrics.dump_path);
+    g_metrics.dump_path = NULL;
+    g_metrics.dump_every = 0;
+    __atomic_store_n(&g_metrics.generation,
+                     __atomic_add_fetch(&g_metrics_generations, 1, __ATOMIC_RELAXED),
+                     __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_metrics.lock);
+}
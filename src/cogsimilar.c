@@ -0,0 +1,552 @@
+/**
+ * @file cogsimilar.c
+ * @brief Similarity discovery - MinHash signatures and LSH banding
+ *
+ * cog_similarity_discover() runs in three phases:
+ *
+ * - signing: each selected atom's neighbourhood, the atoms it is related
+ *   to, is reduced to a MinHash signature: the minimum of each of
+ *   bands * rows hash functions over the handle indices of those atoms.
+ *   The hash functions are one 32-bit mixer applied to the index XORed
+ *   with a per-function seed, a vector of functions at a time (the
+ *   MinHash kernel of cogcpu.c);
+ * - banding: each band of rows hashes to a key per atom, and the atoms
+ *   are bucket-sorted by key. Atoms with equal keys and equal rows are
+ *   candidate pairs. A pair is only taken up in the first band it shares,
+ *   so pairs need no global deduplication, and its Jaccard similarity is
+ *   estimated as the fraction of equal signature entries;
+ * - linking: the pairs that pass the threshold become ATOM_SIMILARITY
+ *   links, in atom order, on the calling thread.
+ *
+ * Signing runs over chunks of atoms and banding over whole bands, both on
+ * threads bound to the caller's context while the AtomSpace is only read.
+ */
+
+#include "cogkern_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Worker thread limit
+ */
+#define SIMILAR_MAX_THREADS 64
+
+/**
+ * Atoms signed per grab
+ */
+#define SIMILAR_CHUNK_ATOMS 256
+
+/**
+ * Defaults for zero parameters
+ */
+#define SIMILAR_BANDS 16
+#define SIMILAR_ROWS 4
+#define SIMILAR_WINDOW 32
+
+/**
+ * Signature entries are rounded up to a multiple of this, as the MinHash
+ * kernel requires
+ */
+#define SIMILAR_LANES 16
+
+/**
+ * Pair whose estimated similarity passed the threshold
+ */
+struct similar_pair {
+    uint32_t a;                /**< Index into the atom list, a < b */
+    uint32_t b;
+    float jaccard;
+};
+
+/**
+ * Work shared by the threads of one discovery
+ */
+struct similar_job {
+    const uint32_t *slots;
+    size_t count;              /**< Atoms selected */
+    uint32_t *sig;             /**< count signatures of stride entries */
+    uint8_t *empty;            /**< Whether each atom's neighbourhood is empty */
+    uint32_t stride;
+    uint32_t hashes;           /**< bands * rows */
+    uint32_t bands;
+    uint32_t rows;
+    uint32_t window;
+    float min_jaccard;
+    uint32_t seeds[COG_SIMILARITY_MAX_HASHES] __attribute__((aligned(32)));
+    size_t cursor;             /**< Next chunk or band to hand out */
+    int banding;               /**< Phase being run */
+};
+
+/**
+ * Per-thread state
+ */
+struct similar_worker {
+    pthread_t thread;
+    struct cogkern_ctx *ctx;
+    struct similar_job *job;
+    uint32_t *buf;             /**< Neighbour slots of the atom in hand */
+    size_t cap;
+    uint64_t *keys;            /**< Band key of each atom */
+    uint32_t *order;           /**< Atoms sorted by band key */
+    uint32_t *heads;           /**< Bucket ends of the key sort */
+    size_t table;              /**< Buckets of the key sort, a power of two */
+    struct similar_pair *pairs;
+    size_t pair_count;
+    size_t pair_cap;
+    size_t candidates;
+    int failed;                /**< Out of memory */
+};
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+static uint64_t similar_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * 32-bit finalizer of MurmurHash3
+ */
+static inline uint32_t similar_mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+/**
+ * Sign one atom: minimum of each hash function over its neighbourhood
+ *
+ * @return 1 if the neighbourhood is non-empty, 0 if empty, -1 if out of
+ *         memory
+ */
+static int similar_sign(struct similar_worker *w, size_t i) {
+    struct similar_job *j = w->job;
+    uint32_t slot = j->slots[i];
+    size_t n = atomspace_related_slots(slot, ATOM_SIMILARITY, w->buf, w->cap);
+
+    if (n > w->cap) {
+        uint32_t *grown = realloc(w->buf, n * sizeof(uint32_t));
+        if (!grown) {
+            w->failed = 1;
+            return -1;
+        }
+        w->buf = grown;
+        w->cap = n;
+        n = atomspace_related_slots(slot, ATOM_SIMILARITY, w->buf, w->cap);
+    }
+
+    /* Handle indices, unlike slots, do not change with reordering */
+    for (size_t k = 0; k < n; k++) {
+        w->buf[k] = COG_HANDLE_SLOT(atomspace_handle_at(w->buf[k]));
+    }
+    cpu_kernels()->minhash(j->sig + i * j->stride, j->seeds, j->stride, w->buf, n);
+    return n > 0;
+}
+
+/**
+ * Sign chunks of atoms until none are left
+ */
+static void similar_sign_chunks(struct similar_worker *w) {
+    struct similar_job *j = w->job;
+
+    for (;;) {
+        size_t begin = __atomic_fetch_add(&j->cursor, SIMILAR_CHUNK_ATOMS, __ATOMIC_RELAXED);
+        if (begin >= j->count) {
+            return;
+        }
+        size_t end = begin + SIMILAR_CHUNK_ATOMS;
+        if (end > j->count) {
+            end = j->count;
+        }
+
+        for (size_t i = begin; i < end; i++) {
+            int signed_atom = similar_sign(w, i);
+            if (signed_atom < 0) {
+                return;
+            }
+            j->empty[i] = !signed_atom;
+        }
+    }
+}
+
+/**
+ * Key of one band of a signature
+ */
+static uint64_t similar_band_key(const uint32_t *sig, uint32_t band, uint32_t rows) {
+    uint64_t key = 0x9e3779b97f4a7c15ULL * (band + 1);
+
+    for (uint32_t r = 0; r < rows; r++) {
+        key = (key ^ sig[band * rows + r]) * 0xff51afd7ed558ccdULL;
+        key ^= key >> 32;
+    }
+    return key;
+}
+
+/**
+ * Whether two signatures agree on every row of a band
+ */
+static int similar_band_equal(const uint32_t *x, const uint32_t *y, uint32_t band,
+                              uint32_t rows) {
+    return memcmp(x + band * rows, y + band * rows, rows * sizeof(uint32_t)) == 0;
+}
+
+/**
+ * Estimate the Jaccard similarity of two atoms, or skip the pair if it
+ * already met in an earlier band
+ */
+static void similar_consider(struct similar_worker *w, uint32_t band, uint32_t a, uint32_t b) {
+    struct similar_job *j = w->job;
+    const uint32_t *x = j->sig + (size_t)a * j->stride;
+    const uint32_t *y = j->sig + (size_t)b * j->stride;
+
+    if (!similar_band_equal(x, y, band, j->rows)) {
+        return;
+    }
+    for (uint32_t e = 0; e < band; e++) {
+        if (similar_band_equal(x, y, e, j->rows)) {
+            return;
+        }
+    }
+    w->candidates++;
+
+    uint32_t same = 0;
+    for (uint32_t h = 0; h < j->hashes; h++) {
+        same += x[h] == y[h];
+    }
+    float jaccard = (float)same / (float)j->hashes;
+    if (jaccard < j->min_jaccard) {
+        return;
+    }
+
+    if (w->pair_count == w->pair_cap) {
+        size_t cap = w->pair_cap ? w->pair_cap * 2 : 256;
+        struct similar_pair *grown = realloc(w->pairs, cap * sizeof(*grown));
+        if (!grown) {
+            w->failed = 1;
+            return;
+        }
+        w->pairs = grown;
+        w->pair_cap = cap;
+    }
+    w->pairs[w->pair_count].a = a < b ? a : b;
+    w->pairs[w->pair_count].b = a < b ? b : a;
+    w->pairs[w->pair_count].jaccard = jaccard;
+    w->pair_count++;
+}
+
+/**
+ * Bucket one band's keys and consider the pairs in each bucket
+ */
+static void similar_band(struct similar_worker *w, uint32_t band) {
+    struct similar_job *j = w->job;
+    int shift = 64 - __builtin_ctzll(w->table);
+
+    /* Counting sort on the top key bits, stable in atom order */
+    memset(w->heads, 0, w->table * sizeof(uint32_t));
+    for (size_t i = 0; i < j->count; i++) {
+        w->keys[i] = similar_band_key(j->sig + i * j->stride, band, j->rows);
+        w->heads[w->keys[i] >> shift]++;
+    }
+    uint32_t sum = 0;
+    for (size_t t = 0; t < w->table; t++) {
+        sum += w->heads[t];
+        w->heads[t] = sum - w->heads[t];
+    }
+    for (size_t i = 0; i < j->count; i++) {
+        w->order[w->heads[w->keys[i] >> shift]++] = (uint32_t)i;
+    }
+
+    /* heads[t] now ends bucket t; sort each (small) bucket by full key */
+    size_t begin = 0;
+    for (size_t t = 0; t < w->table && !w->failed; t++) {
+        size_t end = w->heads[t];
+        for (size_t p = begin + 1; p < end; p++) {
+            uint32_t atom = w->order[p];
+            size_t q = p;
+            while (q > begin && w->keys[w->order[q - 1]] > w->keys[atom]) {
+                w->order[q] = w->order[q - 1];
+                q--;
+            }
+            w->order[q] = atom;
+        }
+
+        for (size_t p = begin; p < end; p++) {
+            for (size_t q = p + 1; q < end && q <= p + j->window; q++) {
+                if (w->keys[w->order[q]] != w->keys[w->order[p]]) {
+                    break;
+                }
+                similar_consider(w, band, w->order[p], w->order[q]);
+            }
+        }
+        begin = end;
+    }
+}
+
+/**
+ * Bucket bands until none are left
+ */
+static void similar_bands(struct similar_worker *w) {
+    struct similar_job *j = w->job;
+
+    if (!w->keys) {
+        w->table = 1;
+        while (w->table < j->count) {
+            w->table <<= 1;
+        }
+        w->keys = malloc(j->count * sizeof(uint64_t));
+        w->order = malloc(j->count * sizeof(uint32_t));
+        w->heads = malloc(w->table * sizeof(uint32_t));
+        if (!w->keys || !w->order || !w->heads) {
+            w->failed = 1;
+            return;
+        }
+    }
+
+    for (;;) {
+        size_t band = __atomic_fetch_add(&j->cursor, 1, __ATOMIC_RELAXED);
+        if (band >= j->bands || w->failed) {
+            return;
+        }
+        similar_band(w, (uint32_t)band);
+    }
+}
+
+/**
+ * Worker thread entry point
+ */
+static void *similar_worker_main(void *arg) {
+    struct similar_worker *w = arg;
+
+    cogkern_ctx_bind(w->ctx);
+    if (w->job->banding) {
+        similar_bands(w);
+    } else {
+        similar_sign_chunks(w);
+    }
+    return NULL;
+}
+
+/**
+ * Run a phase on up to threads threads, the caller being one of them
+ *
+ * @param chunks Units of work in the phase
+ * @return Threads used
+ */
+static uint32_t similar_run(struct similar_job *j, struct similar_worker *workers,
+                            uint32_t threads, size_t chunks) {
+    uint32_t count = threads < chunks ? threads : (uint32_t)chunks;
+    uint32_t started = 0;
+
+    j->cursor = 0;
+    for (uint32_t i = 1; i < count; i++) {
+        if (pthread_create(&workers[i].thread, NULL, similar_worker_main, &workers[i]) != 0) {
+            break;
+        }
+        started = i;
+    }
+
+    /* The calling thread takes work too, and finishes any left over */
+    if (j->banding) {
+        similar_bands(&workers[0]);
+    } else {
+        similar_sign_chunks(&workers[0]);
+    }
+    for (uint32_t i = 1; i <= started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    return started + 1;
+}
+
+/**
+ * Ascending order of atom pairs
+ */
+static int similar_pair_cmp(const void *x, const void *y) {
+    const struct similar_pair *p = x;
+    const struct similar_pair *q = y;
+
+    if (p->a != q->a) {
+        return p->a < q->a ? -1 : 1;
+    }
+    return p->b < q->b ? -1 : p->b > q->b;
+}
+
+/**
+ * Link atoms whose neighbourhoods overlap
+ *
+ * @param params Discovery parameters (NULL for the defaults)
+ * @param stats Pointer to receive discovery statistics (may be NULL)
+ * @return Number of links created or updated, negative on error
+ */
+int cog_similarity_discover(const struct cog_similarity_params *params,
+                            struct cog_similarity_stats *stats) {
+    struct cog_similarity_params p = {0, 0, 0, 0, 0.5f, 0.9f, 0};
+    struct cog_similarity_stats local_stats;
+
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (params) {
+        p = *params;
+    }
+    p.bands = p.bands ? p.bands : SIMILAR_BANDS;
+    p.rows = p.rows ? p.rows : SIMILAR_ROWS;
+    p.window = p.window ? p.window : SIMILAR_WINDOW;
+    if (p.bands > COG_SIMILARITY_MAX_HASHES || p.rows > COG_SIMILARITY_MAX_HASHES ||
+        p.bands * p.rows > COG_SIMILARITY_MAX_HASHES) {
+        return -1;
+    }
+
+    uint64_t t0 = similar_now();
+    uint32_t threads = p.threads;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint32_t)online : 1;
+    }
+    if (threads > SIMILAR_MAX_THREADS) {
+        threads = SIMILAR_MAX_THREADS;
+    }
+
+    struct similar_job *j = calloc(1, sizeof(*j));
+    size_t slots = atomspace_slots();
+    atom_handle_t *atoms = malloc((slots ? slots : 1) * sizeof(atom_handle_t));
+    uint32_t *slot_list = malloc((slots ? slots : 1) * sizeof(uint32_t));
+    struct similar_worker workers[SIMILAR_MAX_THREADS];
+    int failed = !j || !atoms || !slot_list;
+    int linked = 0;
+
+    memset(workers, 0, sizeof(workers));
+    COG_TRACE_BEGIN(span);
+
+    /* Select atoms in slot order */
+    size_t count = 0;
+    for (uint32_t s = 0; s < slots && !failed; s++) {
+        atom_handle_t h = atomspace_handle_at(s);
+        enum atom_type type = atomspace_type(s);
+        if (h && (p.types ? (p.types & COG_TYPE_BIT(type)) != 0 : type != ATOM_SIMILARITY)) {
+            atoms[count] = h;
+            slot_list[count++] = s;
+        }
+    }
+
+    if (!failed) {
+        j->slots = slot_list;
+        j->count = count;
+        j->bands = p.bands;
+        j->rows = p.rows;
+        j->hashes = p.bands * p.rows;
+        j->stride = (j->hashes + SIMILAR_LANES - 1) / SIMILAR_LANES * SIMILAR_LANES;
+        j->window = p.window;
+        j->min_jaccard = p.min_jaccard;
+        for (uint32_t h = 0; h < j->stride; h++) {
+            j->seeds[h] = similar_mix(0x9e3779b9u * (h + 1));
+        }
+        j->sig = malloc((count ? count : 1) * j->stride * sizeof(uint32_t));
+        j->empty = malloc(count ? count : 1);
+        failed = !j->sig || !j->empty;
+        for (uint32_t i = 0; i < threads; i++) {
+            workers[i].ctx = cogkern_ctx_current();
+            workers[i].job = j;
+        }
+    }
+
+    if (!failed && count > 0) {
+        stats->threads = similar_run(j, workers, threads,
+                                     (count + SIMILAR_CHUNK_ATOMS - 1) / SIMILAR_CHUNK_ATOMS);
+        for (uint32_t i = 0; i < threads; i++) {
+            failed |= workers[i].failed;
+        }
+    }
+
+    /* An empty neighbourhood is similar to nothing */
+    if (!failed) {
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t *sig = j->sig + i * j->stride;
+            if (j->empty[i]) {
+                continue;
+            }
+            atoms[kept] = atoms[i];
+            slot_list[kept] = slot_list[i];
+            memmove(j->sig + kept * j->stride, sig, j->stride * sizeof(uint32_t));
+            kept++;
+        }
+        j->count = count = kept;
+        stats->atoms = count;
+    }
+
+    if (!failed && count > 1) {
+        j->banding = 1;
+        uint32_t used = similar_run(j, workers, threads, p.bands);
+        if (used > stats->threads) {
+            stats->threads = used;
+        }
+        for (uint32_t i = 0; i < threads; i++) {
+            failed |= workers[i].failed;
+        }
+    }
+
+    /* Gather the pairs and link them in a fixed order */
+    size_t total = 0;
+    for (uint32_t i = 0; i < threads; i++) {
+        total += workers[i].pair_count;
+        stats->candidates += workers[i].candidates;
+    }
+    struct similar_pair *pairs = failed ? NULL : malloc((total ? total : 1) * sizeof(*pairs));
+    failed |= !pairs;
+    if (!failed) {
+        size_t n = 0;
+        for (uint32_t i = 0; i < threads; i++) {
+            if (workers[i].pair_count > 0) {
+                memcpy(pairs + n, workers[i].pairs, workers[i].pair_count * sizeof(*pairs));
+                n += workers[i].pair_count;
+            }
+        }
+        qsort(pairs, total, sizeof(*pairs), similar_pair_cmp);
+
+        for (size_t i = 0; i < total; i++) {
+            atom_handle_t pair[2] = {atoms[pairs[i].a], atoms[pairs[i].b]};
+            struct truth_value tv = {pairs[i].jaccard, p.confidence};
+            uint32_t slot;
+            if (atomspace_lookup(pair[0], &slot) != 0) {
+                continue;
+            }
+            atom_handle_t link = atomspace_find_pair(slot, ATOM_SIMILARITY, pair[1]);
+            if (!link) {
+                link = cog_link_create(ATOM_SIMILARITY, pair, 2);
+            }
+            if (link && pln_set_tv(link, &tv) == 0) {
+                linked++;
+            }
+        }
+        stats->links = (size_t)linked;
+    }
+    COG_TRACE_END(span, "similarity_discover");
+
+    for (uint32_t i = 0; i < threads; i++) {
+        free(workers[i].buf);
+        free(workers[i].keys);
+        free(workers[i].order);
+        free(workers[i].heads);
+        free(workers[i].pairs);
+    }
+    free(pairs);
+    if (j) {
+        free(j->sig);
+        free(j->empty);
+    }
+    free(j);
+    free(slot_list);
+    free(atoms);
+    stats->elapsed_ns = similar_now() - t0;
+
+    return failed ? -1 : linked;
+}
@@ -0,0 +1,444 @@
+/**
+ * @file cogsnap.c
+ * @brief Read snapshots - Epoch-pinned views of the AtomSpace without locks
+ *
+ * cog_snapshot_begin() pins the calling thread to a read epoch. While it
+ * is pinned, cog_atom_valid(), dtesn_sched_get_av() and pln_infer() on
+ * that thread see the atoms, attention values and truth values as they
+ * were when the epoch was pinned, however long the reader runs and
+ * whatever writers do in the meantime.
+ *
+ * Writers open a write section around every change to snapshot-readable
+ * state. A section that finds snapshots pinned stamps each entry it
+ * changes with the current epoch and, on the first change of an entry
+ * since the newest snapshot began, keeps the old payload as an immutable
+ * version behind the entry (copy-on-write). Readers take the entry when
+ * its stamp is within their epoch, validating the copy against the stamp
+ * the way a seqlock does, and otherwise walk to the newest old version
+ * within it. Sections that find no snapshot pinned skip all of this.
+ *
+ * Opening a section costs the writer no fence: a beginning reader issues
+ * a process-wide memory barrier instead, then waits out any section the
+ * writer had already opened, so that every section either sees the
+ * reader or finishes before the reader looks at anything.
+ *
+ * Reclamation is epoch based. The writer drops versions no pinned epoch
+ * can reach and frees tables retired by growth once every reader that
+ * could hold the old base pointer has ended. Writes must come from one
+ * thread at a time, as for every other mutating kernel call.
+ */
+
+#include "cogkern_internal.h"
+#include <linux/membarrier.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Maximum number of threads pinned to a snapshot at once, per context
+ */
+#define SNAP_MAX_READERS 64
+
+/**
+ * Stamp of an entry whose payload is being rewritten
+ */
+#define SNAP_WRITING UINT64_MAX
+
+/**
+ * Pinned epoch of one reader (0 while the slot is free)
+ */
+struct snap_reader {
+    uint64_t epoch;
+} __attribute__((aligned(COGKERN_CACHE_LINE)));
+
+/**
+ * Table storage waiting for the readers that may still use it
+ */
+struct snap_retired {
+    void *block;
+    size_t bytes;
+    uint64_t epoch;            /**< Write epoch of the section that retired it */
+};
+
+/**
+ * Snapshot state
+ */
+struct snap_state {
+    struct snap_writer writer; /**< Must stay first, see snap_writer() */
+    size_t versions;           /**< Old versions kept */
+    size_t version_bytes;
+    struct snap_retired *retired;
+    size_t retired_count;
+    size_t retired_cap;
+    size_t retired_bytes;
+
+    struct snap_reader slots[SNAP_MAX_READERS];
+};
+
+/**
+ * Snapshot state of the default context
+ */
+struct snap_state snap_default = {.writer.next_epoch = 1};
+
+/**
+ * Snapshot state of the calling thread's context
+ */
+#define g_snap (*cogkern_ctx_current()->snap)
+
+/**
+ * Snapshot the calling thread is pinned to, and its epoch
+ */
+__thread struct snap_state *snap_tls_state __attribute__((tls_model("initial-exec")));
+__thread uint64_t snap_tls_epoch __attribute__((tls_model("initial-exec")));
+static __thread uint32_t t_slot;
+
+/**
+ * Whether readers can rely on the expedited membarrier
+ */
+int snap_membarrier;
+static pthread_once_t snap_membarrier_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Allocate snapshot state for a new context
+ */
+struct snap_state *snap_state_create(void) {
+    struct snap_state *state = cogkern_state_alloc(sizeof(*state));
+
+    if (state) {
+        state->writer.next_epoch = 1;
+    }
+    return state;
+}
+
+/**
+ * Register the process for expedited membarriers
+ */
+static void snap_membarrier_register(void) {
+    if (syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0) {
+        __atomic_store_n(&snap_membarrier, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Order every thread's earlier stores before the caller's later loads
+ */
+static void snap_barrier(void) {
+    pthread_once(&snap_membarrier_once, snap_membarrier_register);
+    if (!__atomic_load_n(&snap_membarrier, __ATOMIC_ACQUIRE) ||
+        syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) != 0) {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * Fence a section open until readers are known to issue membarriers
+ */
+void snap_section_fence(void) {
+    pthread_once(&snap_membarrier_once, snap_membarrier_register);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * Store a new payload into an entry, keeping the old one for snapshots
+ *
+ * Called by snap_cell_store() inside a section that found snapshots
+ * pinned. The entry's payload is the part of the entry after its cell.
+ */
+int snap_cell_store_version(struct snap_cell *cell, const struct snap_cell *next, size_t size) {
+    struct snap_state *s = &g_snap;
+    size_t payload = size - sizeof(struct snap_cell);
+    int rc = 0;
+
+    if (cell->version < s->writer.epoch) {
+        /* First change since the newest snapshot: keep the old payload */
+        struct snap_cell *old = hgfs_alloc(size, 0);
+        if (old) {
+            memcpy(old, cell, size);
+            __atomic_store_n(&cell->older, old, __ATOMIC_RELEASE);
+            s->versions++;
+            s->writer.reclaim = 1;
+            s->version_bytes += size;
+        } else {
+            rc = -1; /* Older snapshots lose this entry */
+        }
+    }
+
+    __atomic_store_n(&cell->version, SNAP_WRITING, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    uint32_t *dst = (uint32_t *)(cell + 1);
+    const uint32_t *src = (const uint32_t *)(next + 1);
+    for (size_t i = 0; i < payload / sizeof(uint32_t); i++) {
+        __atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&cell->version, s->writer.epoch, __ATOMIC_RELEASE);
+    return rc;
+}
+
+/**
+ * Copy the payload an entry had at a snapshot epoch
+ *
+ * @return 0 on success, negative if the entry has no version that old
+ */
+int snap_cell_load(const struct snap_cell *cell, struct snap_cell *out, size_t size,
+                   uint64_t epoch) {
+    size_t payload = size - sizeof(struct snap_cell);
+    uint32_t *dst = (uint32_t *)(out + 1);
+    const uint32_t *src = (const uint32_t *)(cell + 1);
+
+    for (;;) {
+        uint64_t version = __atomic_load_n(&cell->version, __ATOMIC_ACQUIRE);
+        if (version == SNAP_WRITING) {
+            sched_yield();
+            continue;
+        }
+        if (version > epoch) {
+            break;
+        }
+
+        for (size_t i = 0; i < payload / sizeof(uint32_t); i++) {
+            dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&cell->version, __ATOMIC_RELAXED) == version) {
+            return 0;
+        }
+    }
+
+    /* Old versions are immutable once published */
+    for (const struct snap_cell *v = __atomic_load_n(&cell->older, __ATOMIC_ACQUIRE); v;
+         v = __atomic_load_n(&v->older, __ATOMIC_ACQUIRE)) {
+        if (v->version <= epoch) {
+            memcpy(out + 1, v + 1, payload);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Free the versions of an entry that no epoch at or after keep can reach
+ *
+ * A reader stops at the newest version within its epoch, so versions past
+ * the newest one within keep are unreachable once every pinned epoch is
+ * at least keep, and can be freed at once.
+ */
+void snap_cell_trim(struct snap_cell *cell, size_t size, uint64_t keep) {
+    struct snap_cell *v = cell->older;
+
+    if (!v) {
+        return;
+    }
+
+    struct snap_cell *last = cell;
+    while (last->version > keep && v) {
+        last = v;
+        v = v->older;
+    }
+    if (!v) {
+        return;
+    }
+
+    __atomic_store_n(&last->older, NULL, __ATOMIC_RELAXED);
+    while (v) {
+        struct snap_cell *older = v->older;
+        g_snap.versions--;
+        g_snap.version_bytes -= size;
+        hgfs_free(v);
+        v = older;
+    }
+}
+
+/**
+ * Grow a snapshot-readable table
+ *
+ * Must be called inside a write section. While snapshots are pinned the
+ * old storage is retired instead of freed.
+ */
+int snap_table_reserve(void **table, size_t *capacity, size_t elem_size, size_t needed) {
+    struct snap_state *s = &g_snap;
+
+    if (!s->writer.versioning || needed <= *capacity) {
+        return cogkern_table_reserve(table, capacity, elem_size, needed);
+    }
+
+    if (s->retired_count == s->retired_cap) {
+        size_t cap = s->retired_cap ? s->retired_cap * 2 : 8;
+        struct snap_retired *list = realloc(s->retired, cap * sizeof(*list));
+        if (!list) {
+            return -1;
+        }
+        s->retired = list;
+        s->retired_cap = cap;
+    }
+
+    void *old;
+    size_t old_bytes;
+    if (cogkern_table_grow(table, capacity, elem_size, needed, &old, &old_bytes) != 0) {
+        return -1;
+    }
+
+    if (old) {
+        s->retired[s->retired_count].block = old;
+        s->retired[s->retired_count].bytes = old_bytes;
+        s->retired[s->retired_count].epoch = s->writer.epoch;
+        s->retired_count++;
+        s->writer.reclaim = 1;
+        s->retired_bytes += old_bytes;
+    }
+    return 0;
+}
+
+/**
+ * Free old versions and retired tables no pinned snapshot can reach
+ *
+ * Called by the writer, from the cognitive loop tick.
+ */
+void snap_reclaim(void) {
+    struct snap_state *s = &g_snap;
+
+    if (s->versions == 0 && s->retired_count == 0) {
+        return;
+    }
+
+    /* A section of its own, closed without re-entering reclamation */
+    snap_write_begin();
+
+    /* Oldest epoch any reader is or may become pinned to */
+    uint64_t keep = __atomic_load_n(&s->writer.next_epoch, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < SNAP_MAX_READERS; i++) {
+        uint64_t pinned = __atomic_load_n(&s->slots[i].epoch, __ATOMIC_ACQUIRE);
+        if (pinned != 0 && pinned < keep) {
+            keep = pinned;
+        }
+    }
+
+    if (s->versions > 0) {
+        ecan_snapshot_trim(keep);
+        pln_snapshot_trim(keep);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < s->retired_count; i++) {
+        struct snap_retired *r = &s->retired[i];
+        if (r->epoch <= keep) {
+            cogkern_pages_free(r->block, r->bytes);
+            s->retired_bytes -= r->bytes;
+        } else {
+            s->retired[kept++] = *r;
+        }
+    }
+    s->retired_count = kept;
+    s->writer.reclaim = s->versions > 0 || s->retired_count > 0;
+
+    __atomic_store_n(&s->writer.write_seq, s->writer.write_seq + 1, __ATOMIC_RELEASE);
+    s->writer.depth--;
+}
+
+/**
+ * Pin a read snapshot on the calling thread
+ *
+ * Until cog_snapshot_end(), cog_atom_valid(), dtesn_sched_get_av() and
+ * pln_infer() on this thread read the context as it is now: atoms created
+ * later are invisible, and attention and truth values keep their current
+ * values while writers change them. Removed atoms disappear at once.
+ * Reads take no lock; beginning waits at most for one write section.
+ *
+ * @return 0 on success, negative if the thread is already pinned or too
+ *         many threads are
+ */
+int cog_snapshot_begin(void) {
+    struct snap_state *s = &g_snap;
+
+    if (snap_tls_state) {
+        return -1;
+    }
+
+    /* Claim a reader slot at a provisional epoch no later than ours */
+    uint32_t slot = SNAP_MAX_READERS;
+    for (uint32_t i = 0; i < SNAP_MAX_READERS; i++) {
+        uint64_t expected = 0;
+        uint64_t provisional = __atomic_load_n(&s->writer.next_epoch, __ATOMIC_ACQUIRE);
+        if (__atomic_compare_exchange_n(&s->slots[i].epoch, &expected, provisional, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == SNAP_MAX_READERS) {
+        return -1;
+    }
+
+    __atomic_add_fetch(&s->writer.readers, 1, __ATOMIC_SEQ_CST);
+    uint64_t epoch = __atomic_fetch_add(&s->writer.next_epoch, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&s->slots[slot].epoch, epoch, __ATOMIC_SEQ_CST);
+
+    /* Either the writer sees this reader or we wait for its section */
+    snap_barrier();
+    uint64_t seq = __atomic_load_n(&s->writer.write_seq, __ATOMIC_ACQUIRE);
+    while ((seq & 1) && __atomic_load_n(&s->writer.write_seq, __ATOMIC_ACQUIRE) == seq) {
+        sched_yield();
+    }
+
+    snap_tls_state = s;
+    snap_tls_epoch = epoch;
+    t_slot = slot;
+    return 0;
+}
+
+/**
+ * Release the calling thread's read snapshot
+ */
+void cog_snapshot_end(void) {
+    struct snap_state *s = snap_tls_state;
+
+    if (!s) {
+        return;
+    }
+
+    __atomic_store_n(&s->slots[t_slot].epoch, 0, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&s->writer.readers, 1, __ATOMIC_RELEASE);
+    snap_tls_state = NULL;
+}
+
+/**
+ * Fill the snapshot part of cogkern_stats()
+ */
+void snap_fill_stats(struct cogkern_stats *stats) {
+    stats->snapshots = __atomic_load_n(&g_snap.writer.readers, __ATOMIC_RELAXED);
+    stats->snapshot_versions = g_snap.versions;
+    stats->snapshot_bytes = g_snap.version_bytes + g_snap.retired_bytes;
+}
+
+/**
+ * Free retired tables and forget pinned readers (used at shutdown)
+ *
+ * Runs after the attention and truth value tables dropped their versions.
+ */
+void snap_reset(void) {
+    struct snap_state *s = &g_snap;
+
+    for (size_t i = 0; i < s->retired_count; i++) {
+        cogkern_pages_free(s->retired[i].block, s->retired[i].bytes);
+    }
+    free(s->retired);
+    s->retired = NULL;
+    s->retired_count = 0;
+    s->retired_cap = 0;
+    s->retired_bytes = 0;
+
+    for (uint32_t i = 0; i < SNAP_MAX_READERS; i++) {
+        __atomic_store_n(&s->slots[i].epoch, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&s->writer.readers, 0, __ATOMIC_RELAXED);
+    s->versions = 0;
+    s->version_bytes = 0;
+    s->writer.depth = 0;
+    s->writer.reclaim = 0;
+    s->writer.versioning = 0;
+}
@@ -0,0 +1,620 @@
+/**
+ * @file cogtask.c
+ * @brief Cognitive task scheduler - Work-stealing pool ranked by attention
+ *
+ * A task is a function run against an atom, and its priority is that
+ * atom's STI at submission. Queued tasks wait in a binary heap;
+ * dtesn_sched_tick() takes them off it highest priority first (all of
+ * them, or up to the tick's quota) and deals them round-robin onto one
+ * deque per worker with the highest priority at the owner's end, so the
+ * top tasks overall are the first ones started. A worker pops from its
+ * own end and, once its deque is empty, steals from the far end of the
+ * others (Chase-Lev). Tasks submitted by a running task go onto the
+ * running worker's deque and still run within the same tick.
+ *
+ * The loop thread is worker 0, so a pool of one worker runs every task
+ * inline without starting any thread.
+ */
+
+#include "cogkern_internal.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Deque room per worker for tasks submitted by running tasks
+ */
+#define TASK_DEQUE_SPARE 256
+
+/**
+ * Queued task
+ */
+struct task {
+    dtesn_task_fn fn;
+    void *arg;
+    atom_handle_t atom;
+    float priority;            /**< STI of the atom at submission */
+    uint64_t seq;              /**< Submission order, breaks priority ties */
+    uint64_t submit_ns;
+};
+
+/**
+ * Worker and its deque
+ *
+ * Thieves only write top, the owner only writes bottom; they sit on
+ * separate cache lines. The counters are written by the owner alone and
+ * read by the loop thread between ticks.
+ */
+struct task_worker {
+    int64_t top;
+    char pad0[COGKERN_CACHE_LINE - sizeof(int64_t)];
+    int64_t bottom;
+    char pad1[COGKERN_CACHE_LINE - sizeof(int64_t)];
+    struct task *deque;
+    size_t deque_cap;
+    pthread_t thread;
+    struct cogkern_ctx *ctx;   /**< Context the worker thread serves */
+    uint64_t round_seen;       /**< Last dispatch generation taken part in */
+    uint64_t rng;              /**< xorshift state for picking victims */
+    uint64_t run;
+    uint64_t stolen;
+    uint64_t latency_ns_total;
+    uint64_t latency_ns_max;
+    uint64_t run_ns_total;
+    char pad2[COGKERN_CACHE_LINE];
+};
+
+/**
+ * Task scheduler state
+ */
+struct task_state {
+    struct task_worker workers[DTESN_SCHED_MAX_WORKERS];
+    uint32_t worker_count;     /**< Workers including the loop thread */
+    int threads_started;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint64_t round;            /**< Dispatch generation workers wait on */
+    uint32_t checked_out;      /**< Threads done with the current round */
+    int quit;
+    int64_t outstanding;       /**< Tasks queued or running this round */
+    struct task *pending;      /**< Max-heap of queued tasks */
+    size_t pending_cap;
+    size_t pending_count;
+    struct task *batch;        /**< Tasks taken for the current dispatch */
+    size_t batch_cap;
+    size_t limit;              /**< Cap on tasks run by the next dispatch */
+    uint64_t seq;
+    uint64_t submitted;
+    uint64_t cancelled;
+    uint64_t round_ns_total;
+};
+
+/**
+ * Task scheduler state of the default context
+ */
+struct task_state task_default = {0};
+
+/**
+ * Task scheduler state of the calling thread's context
+ */
+#define g_tasks (*cogkern_ctx_current()->tasks)
+
+/**
+ * Allocate Task scheduler state for a new context
+ */
+struct task_state *task_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct task_state));
+}
+
+/**
+ * Worker the current thread is running tasks for, NULL outside a round
+ */
+static __thread struct task_worker *t_worker;
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+static uint64_t task_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Push onto the owner's end of a deque
+ *
+ * @return 0 on success, negative if the deque is full
+ */
+static int deque_push(struct task_worker *w, const struct task *t) {
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+
+    if ((size_t)b >= w->deque_cap) {
+        return -1;
+    }
+
+    w->deque[b] = *t;
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Pop from the owner's end of a deque
+ *
+ * @return 0 on success, negative if the deque is empty
+ */
+static int deque_pop(struct task_worker *w, struct task *t) {
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+
+    __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+
+    if (top > b) {
+        __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    *t = w->deque[b];
+    if (top == b) {
+        /* Last task: race the thieves for it */
+        int won = __atomic_compare_exchange_n(&w->top, &top, top + 1, 0,
+                                              __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+        return won ? 0 : -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Steal from the far end of another worker's deque
+ *
+ * @return 0 on success, negative if nothing could be taken
+ */
+static int deque_steal(struct task_worker *w, struct task *t) {
+    int64_t top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= b) {
+        return -1;
+    }
+
+    *t = w->deque[top];
+    return __atomic_compare_exchange_n(&w->top, &top, top + 1, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED) ? 0 : -1;
+}
+
+/**
+ * Run one task and account it to a worker
+ */
+static void task_run(struct task_worker *w, const struct task *t) {
+    uint64_t t0 = task_now();
+    uint64_t latency = t0 - t->submit_ns;
+    COG_TRACE_BEGIN(span);
+
+    t->fn(t->atom, t->arg);
+    COG_TRACE_END(span, "task");
+
+    uint64_t ran = task_now() - t0;
+    w->run++;
+    w->run_ns_total += ran;
+    w->latency_ns_total += latency;
+    if (latency > w->latency_ns_max) {
+        w->latency_ns_max = latency;
+    }
+    metrics_count(METRIC_TASKS_RUN, 1);
+    metrics_record(METRIC_TASK_RUN_NS, ran);
+    metrics_record(METRIC_TASK_WAIT_NS, latency);
+
+    __atomic_sub_fetch(&g_tasks.outstanding, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Take the next task for a worker: its own first, then a victim's
+ */
+static int task_next(struct task_worker *w, struct task *t) {
+    if (deque_pop(w, t) == 0) {
+        return 0;
+    }
+
+    uint32_t n = g_tasks.worker_count;
+    if (n < 2) {
+        return -1;
+    }
+
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 7;
+    w->rng ^= w->rng << 17;
+
+    uint32_t start = (uint32_t)(w->rng % n);
+    for (uint32_t i = 0; i < n; i++) {
+        struct task_worker *victim = &g_tasks.workers[(start + i) % n];
+        if (victim != w && deque_steal(victim, t) == 0) {
+            w->stolen++;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Run tasks until every task of the round has finished
+ */
+static void task_round(struct task_worker *w) {
+    struct task t;
+
+    t_worker = w;
+    while (__atomic_load_n(&g_tasks.outstanding, __ATOMIC_ACQUIRE) > 0) {
+        if (task_next(w, &t) == 0) {
+            task_run(w, &t);
+        } else {
+            sched_yield(); /* Remaining tasks are running elsewhere */
+        }
+    }
+    t_worker = NULL;
+}
+
+/**
+ * Worker thread body
+ */
+static void *task_worker_main(void *arg) {
+    struct task_worker *w = arg;
+
+    cogkern_ctx_bind(w->ctx);
+    pthread_mutex_lock(&g_tasks.lock);
+    for (;;) {
+        while (g_tasks.round == w->round_seen && !g_tasks.quit) {
+            pthread_cond_wait(&g_tasks.cond, &g_tasks.lock);
+        }
+        if (g_tasks.quit) {
+            break;
+        }
+        w->round_seen = g_tasks.round;
+        pthread_mutex_unlock(&g_tasks.lock);
+
+        task_round(w);
+
+        pthread_mutex_lock(&g_tasks.lock);
+        g_tasks.checked_out++;
+        pthread_cond_broadcast(&g_tasks.cond);
+    }
+    pthread_mutex_unlock(&g_tasks.lock);
+
+    return NULL;
+}
+
+/**
+ * Stop and join the worker threads
+ */
+static void task_stop_threads(void) {
+    if (!g_tasks.threads_started) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_tasks.lock);
+    g_tasks.quit = 1;
+    pthread_cond_broadcast(&g_tasks.cond);
+    pthread_mutex_unlock(&g_tasks.lock);
+
+    for (uint32_t i = 1; i < g_tasks.worker_count; i++) {
+        pthread_join(g_tasks.workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&g_tasks.cond);
+    pthread_mutex_destroy(&g_tasks.lock);
+    g_tasks.threads_started = 0;
+    g_tasks.quit = 0;
+}
+
+/**
+ * Start threads for workers 1..count-1
+ */
+static int task_start_threads(uint32_t count) {
+    pthread_mutex_init(&g_tasks.lock, NULL);
+    pthread_cond_init(&g_tasks.cond, NULL);
+    g_tasks.threads_started = 1;
+    g_tasks.worker_count = 1;
+
+    for (uint32_t i = 1; i < count; i++) {
+        g_tasks.workers[i].round_seen = g_tasks.round;
+        g_tasks.workers[i].ctx = cogkern_ctx_current();
+        if (pthread_create(&g_tasks.workers[i].thread, NULL, task_worker_main,
+                           &g_tasks.workers[i]) != 0) {
+            task_stop_threads();
+            g_tasks.worker_count = 1;
+            return -1;
+        }
+        g_tasks.worker_count = i + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Set the number of task workers
+ *
+ * Concurrent tasks must read through a snapshot: atomspace_resolve()
+ * counts lookups and faults cold atoms in without a lock.
+ *
+ * @param workers Worker count including the calling loop thread
+ *                (1 runs every task inline)
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_set_workers(uint32_t workers) {
+    if (workers == 0 || workers > DTESN_SCHED_MAX_WORKERS || t_worker) {
+        return -1;
+    }
+    if (workers == g_tasks.worker_count) {
+        return 0;
+    }
+
+    task_stop_threads();
+    g_tasks.worker_count = 1;
+
+    for (uint32_t i = 0; i < workers; i++) {
+        g_tasks.workers[i].rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+    }
+
+    return workers > 1 ? task_start_threads(workers) : 0;
+}
+
+/**
+ * Whether a task runs before another: higher priority, then earlier
+ */
+static inline int task_before(const struct task *x, const struct task *y) {
+    if (x->priority != y->priority) {
+        return x->priority > y->priority;
+    }
+    return x->seq < y->seq;
+}
+
+/**
+ * Add a task to the pending heap (capacity already reserved)
+ */
+static void task_heap_push(const struct task *t) {
+    struct task *heap = g_tasks.pending;
+    size_t i = g_tasks.pending_count++;
+
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!task_before(t, &heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = *t;
+}
+
+/**
+ * Remove the first task to run from the pending heap
+ */
+static void task_heap_pop(struct task *out) {
+    struct task *heap = g_tasks.pending;
+    size_t n = --g_tasks.pending_count;
+    struct task last = heap[n];
+    size_t i = 0;
+
+    *out = heap[0];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && task_before(&heap[child + 1], &heap[child])) {
+            child++;
+        }
+        if (!task_before(&heap[child], &last)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+}
+
+/**
+ * Submit a cognitive task
+ *
+ * @param atom Atom the task works on (0 for none, priority 0)
+ * @param fn Task function
+ * @param arg Argument passed to fn
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_submit(atom_handle_t atom, dtesn_task_fn fn, void *arg) {
+    struct attention_value av = {0.0f, 0.0f, 0.0f};
+    uint32_t slot;
+
+    if (!fn || (atom != 0 && atomspace_lookup(atom, &slot) != 0)) {
+        return -1;
+    }
+    if (atom != 0) {
+        ecan_peek_av(slot, &av);
+    }
+
+    struct task t = {fn, arg, atom, av.sti, 0, task_now()};
+    struct task_worker *w = t_worker;
+
+    if (w) {
+        /* Spawned by a running task: run it in this round */
+        __atomic_add_fetch(&g_tasks.outstanding, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&g_tasks.submitted, 1, __ATOMIC_RELAXED);
+        if (deque_push(w, &t) != 0) {
+            task_run(w, &t);
+        }
+        return 0;
+    }
+
+    if (cogkern_table_reserve((void **)&g_tasks.pending, &g_tasks.pending_cap,
+                              sizeof(struct task), g_tasks.pending_count + 1) != 0) {
+        return -1;
+    }
+
+    t.seq = g_tasks.seq++;
+    task_heap_push(&t);
+    g_tasks.submitted++;
+
+    return 0;
+}
+
+/**
+ * Cap the number of tasks the next task_dispatch() runs
+ */
+void task_set_limit(size_t limit) {
+    g_tasks.limit = limit;
+}
+
+/**
+ * Run every task submitted since the last call
+ */
+int task_dispatch(void) {
+    size_t n = 0, limit = g_tasks.limit;
+
+    g_tasks.limit = 0;
+    if (g_tasks.pending_count == 0 || t_worker) {
+        return 0;
+    }
+    if (g_tasks.worker_count == 0) {
+        g_tasks.worker_count = 1;
+    }
+
+    size_t run = limit > 0 && limit < g_tasks.pending_count ? limit : g_tasks.pending_count;
+    if (cogkern_table_reserve((void **)&g_tasks.batch, &g_tasks.batch_cap,
+                              sizeof(struct task), run) != 0) {
+        return -1;
+    }
+
+    /* Take the best tasks; the rest wait for the next dispatch */
+    while (n < run && g_tasks.pending_count > 0) {
+        struct task *t = &g_tasks.batch[n];
+        task_heap_pop(t);
+        uint32_t slot;
+        if (t->atom != 0 && atomspace_lookup(t->atom, &slot) != 0) {
+            g_tasks.cancelled++; /* Atom removed after submission */
+            continue;
+        }
+        n++;
+    }
+
+    uint32_t workers = g_tasks.worker_count;
+    size_t per_worker = (n + workers - 1) / workers + TASK_DEQUE_SPARE;
+    uint64_t run_before = 0;
+
+    for (uint32_t i = 0; i < workers; i++) {
+        struct task_worker *w = &g_tasks.workers[i];
+        if (cogkern_table_reserve((void **)&w->deque, &w->deque_cap,
+                                  sizeof(struct task), per_worker) != 0) {
+            return -1;
+        }
+        w->top = 0;
+        w->bottom = 0;
+        run_before += w->run;
+    }
+
+    /* Lowest priority first, so each owner's end holds its best task */
+    for (size_t i = n; i-- > 0;) {
+        deque_push(&g_tasks.workers[i % workers], &g_tasks.batch[i]);
+    }
+    g_tasks.outstanding = (int64_t)n;
+
+    uint64_t t0 = task_now();
+
+    if (g_tasks.threads_started) {
+        pthread_mutex_lock(&g_tasks.lock);
+        g_tasks.checked_out = 0;
+        g_tasks.round++;
+        pthread_cond_broadcast(&g_tasks.cond);
+        pthread_mutex_unlock(&g_tasks.lock);
+    }
+
+    task_round(&g_tasks.workers[0]);
+
+    if (g_tasks.threads_started) {
+        pthread_mutex_lock(&g_tasks.lock);
+        while (g_tasks.checked_out < workers - 1) {
+            pthread_cond_wait(&g_tasks.cond, &g_tasks.lock);
+        }
+        pthread_mutex_unlock(&g_tasks.lock);
+    }
+
+    g_tasks.round_ns_total += task_now() - t0;
+
+    uint64_t run_after = 0;
+    for (uint32_t i = 0; i < workers; i++) {
+        run_after += g_tasks.workers[i].run;
+    }
+
+    return (int)(run_after - run_before);
+}
+
+/**
+ * Get task scheduler statistics
+ *
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_get_stats(struct dtesn_sched_stats *stats) {
+    if (!stats || t_worker) {
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->workers = g_tasks.worker_count ? g_tasks.worker_count : 1;
+    stats->tasks_submitted = g_tasks.submitted;
+    stats->tasks_pending = g_tasks.pending_count;
+    stats->tasks_cancelled = g_tasks.cancelled;
+    stats->dispatch_ns_total = g_tasks.round_ns_total;
+
+    for (uint32_t i = 0; i < stats->workers; i++) {
+        const struct task_worker *w = &g_tasks.workers[i];
+
+        stats->tasks_run += w->run;
+        stats->tasks_stolen += w->stolen;
+        stats->latency_ns_total += w->latency_ns_total;
+        if (w->latency_ns_max > stats->latency_ns_max) {
+            stats->latency_ns_max = w->latency_ns_max;
+        }
+        stats->run_ns_total += w->run_ns_total;
+        stats->utilization[i] = g_tasks.round_ns_total > 0 ?
+            (float)w->run_ns_total / (float)g_tasks.round_ns_total : 0.0f;
+    }
+
+    return 0;
+}
+
+/**
+ * Fill the task scheduler part of cogkern_stats()
+ */
+void task_fill_stats(struct cogkern_stats *stats) {
+    size_t slots = g_tasks.pending_cap + g_tasks.batch_cap;
+
+    for (uint32_t i = 0; i < DTESN_SCHED_MAX_WORKERS; i++) {
+        slots += g_tasks.workers[i].deque_cap;
+    }
+    stats->task_queue_bytes = slots * sizeof(struct task);
+}
+
+/**
+ * Stop the task workers and drop queued tasks (used at shutdown)
+ */
+void task_reset(void) {
+    task_stop_threads();
+
+    for (uint32_t i = 0; i < DTESN_SCHED_MAX_WORKERS; i++) {
+        struct task_worker *w = &g_tasks.workers[i];
+        if (w->deque) {
+            cogkern_table_free((void **)&w->deque, &w->deque_cap, sizeof(struct task));
+        }
+    }
+    if (g_tasks.pending) {
+        cogkern_table_free((void **)&g_tasks.pending, &g_tasks.pending_cap, sizeof(struct task));
+    }
+    if (g_tasks.batch) {
+        cogkern_table_free((void **)&g_tasks.batch, &g_tasks.batch_cap, sizeof(struct task));
+    }
+
+    memset(&g_tasks, 0, sizeof(g_tasks));
+}
@@ -0,0 +1,625 @@
+/**
+ * @file cogtensor.c
+ * @brief Tensors - Built-in CPU tensor backend
+ *
+ * A small stand-in for GGML: one- and two-dimensional float tensors
+ * allocated from an arena, and a set of operations that mirror GGML ops
+ * by name and shape rules. Each kernel context owns one tensor context,
+ * the one cogkern_get_context() returns. Its arena is a list of chunks
+ * taken with cogkern_pages_alloc(), so tensor storage is charged against
+ * the cogkern_init() budget like every other kernel table.
+ *
+ * Unlike GGML, which records a graph and computes it later, operations
+ * run eagerly: the result tensor is allocated and filled before the call
+ * returns. Arena positions are linear across chunks, so a caller can
+ * take a mark, run a chain of operations for scratch results and release
+ * everything allocated since the mark in one step.
+ *
+ * The GGML structure names are defined here and nowhere else; swapping in
+ * a vendored GGML means replacing this file with one that forwards each
+ * cog_tensor_ function to the GGML op named in its documentation.
+ */
+
+#include "cogkern_internal.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Smallest arena chunk
+ */
+#define TENSOR_CHUNK_SIZE (16 * DTESN_MEM_PAGE_SIZE)
+
+/**
+ * Tensor data alignment, also the space reserved for the tensor header
+ */
+#define TENSOR_ALIGN COGKERN_CACHE_LINE
+
+/**
+ * Largest element count of one tensor
+ */
+#define TENSOR_MAX_ELEMENTS ((int64_t)1 << 40)
+
+/**
+ * Tensor: ne[0] contiguous elements per row, ne[1] rows
+ */
+struct ggml_tensor {
+    int64_t ne[2];
+    float *data;
+};
+
+/**
+ * Arena chunk, followed by its storage
+ */
+struct tensor_chunk {
+    struct tensor_chunk *prev;
+    size_t size;               /**< Bytes, header included */
+    size_t base;               /**< Arena position of the first byte */
+};
+
+/**
+ * Tensor context: an arena of chunks, newest first
+ */
+struct ggml_context {
+    struct cogkern_ctx *owner; /**< Kernel context charged for the chunks */
+    struct tensor_chunk *chunk;
+    size_t used;               /**< Arena position of the next allocation */
+    size_t reserved;           /**< Bytes held in chunks */
+};
+
+/**
+ * Round up to a multiple of the tensor alignment
+ */
+static inline size_t tensor_align(size_t n) {
+    return (n + TENSOR_ALIGN - 1) & ~(size_t)(TENSOR_ALIGN - 1);
+}
+
+/**
+ * Take a chunk from the owning kernel context's pages
+ */
+static struct tensor_chunk *tensor_chunk_alloc(struct ggml_context *ctx, size_t size) {
+    struct cogkern_ctx *prev = cogkern_ctx_bind(ctx->owner);
+    struct tensor_chunk *chunk = cogkern_pages_alloc(size);
+
+    cogkern_ctx_bind(prev);
+    return chunk;
+}
+
+/**
+ * Return a chunk to the owning kernel context
+ */
+static void tensor_chunk_free(struct ggml_context *ctx, struct tensor_chunk *chunk) {
+    struct cogkern_ctx *prev = cogkern_ctx_bind(ctx->owner);
+
+    ctx->reserved -= chunk->size;
+    cogkern_pages_free(chunk, chunk->size);
+    cogkern_ctx_bind(prev);
+}
+
+/**
+ * Allocate a tensor with uninitialized data
+ */
+static struct ggml_tensor *tensor_new(struct ggml_context *ctx, int64_t ne0, int64_t ne1) {
+    if (!ctx || ne0 <= 0 || ne1 <= 0 || ne0 > TENSOR_MAX_ELEMENTS / ne1) {
+        return NULL;
+    }
+
+    size_t need = TENSOR_ALIGN + tensor_align((size_t)(ne0 * ne1) * sizeof(float));
+    struct tensor_chunk *chunk = ctx->chunk;
+
+    if (!chunk || ctx->used + need > chunk->base + chunk->size) {
+        size_t header = tensor_align(sizeof(struct tensor_chunk));
+        size_t size = header + need;
+
+        if (size < TENSOR_CHUNK_SIZE) {
+            size = TENSOR_CHUNK_SIZE;
+        }
+        size = (size + DTESN_MEM_PAGE_SIZE - 1) & ~(size_t)(DTESN_MEM_PAGE_SIZE - 1);
+
+        struct tensor_chunk *fresh = tensor_chunk_alloc(ctx, size);
+        if (!fresh) {
+            return NULL;
+        }
+
+        fresh->prev = chunk;
+        fresh->size = size;
+        fresh->base = chunk ? chunk->base + chunk->size : 0;
+        ctx->chunk = fresh;
+        ctx->used = fresh->base + header;
+        ctx->reserved += size;
+        chunk = fresh;
+    }
+
+    char *p = (char *)chunk + (ctx->used - chunk->base);
+    struct ggml_tensor *t = (struct ggml_tensor *)p;
+
+    t->ne[0] = ne0;
+    t->ne[1] = ne1;
+    t->data = (float *)(p + TENSOR_ALIGN);
+    ctx->used += need;
+    return t;
+}
+
+/**
+ * Allocate a result tensor shaped like a
+ */
+static struct ggml_tensor *tensor_like(struct ggml_context *ctx, const struct ggml_tensor *a) {
+    return a ? tensor_new(ctx, a->ne[0], a->ne[1]) : NULL;
+}
+
+/**
+ * Number of elements of a tensor
+ */
+static inline size_t tensor_count(const struct ggml_tensor *t) {
+    return (size_t)(t->ne[0] * t->ne[1]);
+}
+
+/**
+ * Create the tensor context of the current kernel context
+ */
+struct ggml_context *tensor_context_create(void) {
+    struct ggml_context *ctx = calloc(1, sizeof(*ctx));
+
+    if (ctx) {
+        ctx->owner = cogkern_ctx_current();
+    }
+    return ctx;
+}
+
+/**
+ * Free a tensor context and its arena
+ */
+void tensor_context_free(struct ggml_context *ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    cog_tensor_release(ctx, 0);
+    free(ctx);
+}
+
+/**
+ * Fill the tensor part of cogkern_stats()
+ */
+void tensor_fill_stats(struct cogkern_stats *stats) {
+    struct ggml_context *ctx = cogkern_get_context();
+
+    stats->tensor_bytes = ctx ? ctx->reserved : 0;
+}
+
+/**
+ * Allocate a one-dimensional tensor
+ */
+struct ggml_tensor *cog_tensor_new_1d(struct ggml_context *ctx, int64_t ne0) {
+    return tensor_new(ctx, ne0, 1);
+}
+
+/**
+ * Allocate a two-dimensional tensor
+ */
+struct ggml_tensor *cog_tensor_new_2d(struct ggml_context *ctx, int64_t ne0, int64_t ne1) {
+    return tensor_new(ctx, ne0, ne1);
+}
+
+/**
+ * Element storage of a tensor
+ */
+float *cog_tensor_data(const struct ggml_tensor *t) {
+    return t ? t->data : NULL;
+}
+
+/**
+ * Size of a tensor along one dimension
+ */
+int64_t cog_tensor_ne(const struct ggml_tensor *t, int dim) {
+    if (!t || dim < 0) {
+        return 0;
+    }
+    return dim < 2 ? t->ne[dim] : 1;
+}
+
+/**
+ * Number of elements of a tensor
+ */
+int64_t cog_tensor_nelements(const struct ggml_tensor *t) {
+    return t ? t->ne[0] * t->ne[1] : 0;
+}
+
+/**
+ * Set every element of a tensor
+ */
+struct ggml_tensor *cog_tensor_fill(struct ggml_tensor *t, float value) {
+    if (!t) {
+        return NULL;
+    }
+
+    size_t n = tensor_count(t);
+    for (size_t i = 0; i < n; i++) {
+        t->data[i] = value;
+    }
+    return t;
+}
+
+/**
+ * Current arena position
+ */
+size_t cog_tensor_mark(struct ggml_context *ctx) {
+    return ctx ? ctx->used : 0;
+}
+
+/**
+ * Free every tensor allocated since a mark
+ */
+void cog_tensor_release(struct ggml_context *ctx, size_t mark) {
+    if (!ctx || mark > ctx->used) {
+        return;
+    }
+
+    while (ctx->chunk && ctx->chunk->base >= mark) {
+        struct tensor_chunk *chunk = ctx->chunk;
+
+        ctx->chunk = chunk->prev;
+        tensor_chunk_free(ctx, chunk);
+    }
+    ctx->used = ctx->chunk ? mark : 0;
+}
+
+/**
+ * Elementwise binary operators
+ */
+enum tensor_binary {
+    TENSOR_ADD,
+    TENSOR_SUB,
+    TENSOR_MUL,
+    TENSOR_DIV
+};
+
+/**
+ * Apply a binary operator to one row, b repeated along it
+ */
+static void tensor_binary_row(enum tensor_binary op, float *dst, const float *a,
+                              const float *b, size_t n, size_t nb) {
+    if (nb == 1) {
+        float s = b[0];
+
+        switch (op) {
+            case TENSOR_ADD:
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] = a[i] + s;
+                }
+                break;
+            case TENSOR_SUB:
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] = a[i] - s;
+                }
+                break;
+            case TENSOR_MUL:
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] = a[i] * s;
+                }
+                break;
+            case TENSOR_DIV:
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] = a[i] / s;
+                }
+                break;
+        }
+        return;
+    }
+
+    for (size_t start = 0; start < n; start += nb) {
+        float *d = dst + start;
+        const float *x = a + start;
+
+        switch (op) {
+            case TENSOR_ADD:
+                for (size_t i = 0; i < nb; i++) {
+                    d[i] = x[i] + b[i];
+                }
+                break;
+            case TENSOR_SUB:
+                for (size_t i = 0; i < nb; i++) {
+                    d[i] = x[i] - b[i];
+                }
+                break;
+            case TENSOR_MUL:
+                for (size_t i = 0; i < nb; i++) {
+                    d[i] = x[i] * b[i];
+                }
+                break;
+            case TENSOR_DIV:
+                for (size_t i = 0; i < nb; i++) {
+                    d[i] = x[i] / b[i];
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * Apply a binary operator, b repeated to the shape of a as GGML does
+ */
+static struct ggml_tensor *tensor_binary(struct ggml_context *ctx, enum tensor_binary op,
+                                         const struct ggml_tensor *a,
+                                         const struct ggml_tensor *b) {
+    if (!a || !b || a->ne[0] % b->ne[0] != 0 || a->ne[1] % b->ne[1] != 0) {
+        return NULL;
+    }
+
+    struct ggml_tensor *r = tensor_like(ctx, a);
+    if (!r) {
+        return NULL;
+    }
+
+    size_t n = (size_t)a->ne[0];
+    for (int64_t row = 0; row < a->ne[1]; row++) {
+        const float *brow = b->data + (size_t)(row % b->ne[1]) * (size_t)b->ne[0];
+
+        tensor_binary_row(op, r->data + (size_t)row * n, a->data + (size_t)row * n,
+                          brow, n, (size_t)b->ne[0]);
+    }
+    return r;
+}
+
+/**
+ * Elementwise sum
+ */
+struct ggml_tensor *cog_tensor_add(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   struct ggml_tensor *b) {
+    return tensor_binary(ctx, TENSOR_ADD, a, b);
+}
+
+/**
+ * Elementwise difference
+ */
+struct ggml_tensor *cog_tensor_sub(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   struct ggml_tensor *b) {
+    return tensor_binary(ctx, TENSOR_SUB, a, b);
+}
+
+/**
+ * Elementwise product
+ */
+struct ggml_tensor *cog_tensor_mul(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   struct ggml_tensor *b) {
+    return tensor_binary(ctx, TENSOR_MUL, a, b);
+}
+
+/**
+ * Elementwise quotient
+ */
+struct ggml_tensor *cog_tensor_div(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   struct ggml_tensor *b) {
+    return tensor_binary(ctx, TENSOR_DIV, a, b);
+}
+
+/**
+ * Multiply every element by a constant
+ */
+struct ggml_tensor *cog_tensor_scale(struct ggml_context *ctx, struct ggml_tensor *a,
+                                     float s) {
+    struct ggml_tensor *r = tensor_like(ctx, a);
+    if (!r) {
+        return NULL;
+    }
+
+    size_t n = tensor_count(a);
+    for (size_t i = 0; i < n; i++) {
+        r->data[i] = a->data[i] * s;
+    }
+    return r;
+}
+
+/**
+ * Clamp every element to a range
+ */
+struct ggml_tensor *cog_tensor_clamp(struct ggml_context *ctx, struct ggml_tensor *a,
+                                     float min, float max) {
+    struct ggml_tensor *r = tensor_like(ctx, a);
+    if (!r) {
+        return NULL;
+    }
+
+    size_t n = tensor_count(a);
+    for (size_t i = 0; i < n; i++) {
+        float v = a->data[i];
+
+        v = v < min ? min : v;
+        r->data[i] = v > max ? max : v;
+    }
+    return r;
+}
+
+/**
+ * Apply a unary function to every element
+ */
+struct ggml_tensor *cog_tensor_map(struct ggml_context *ctx, struct ggml_tensor *a,
+                                   enum cog_tensor_unary op) {
+    if ((unsigned)op > COG_TENSOR_SIGMOID) {
+        return NULL;
+    }
+
+    struct ggml_tensor *r = tensor_like(ctx, a);
+    if (!r) {
+        return NULL;
+    }
+
+    size_t n = tensor_count(a);
+    const float *x = a->data;
+    float *y = r->data;
+
+    switch (op) {
+        case COG_TENSOR_NEG:
+            for (size_t i = 0; i < n; i++) {
+                y[i] = -x[i];
+            }
+            break;
+        case COG_TENSOR_ABS:
+            for (size_t i = 0; i < n; i++) {
+                y[i] = fabsf(x[i]);
+            }
+            break;
+        case COG_TENSOR_SQR:
+            for (size_t i = 0; i < n; i++) {
+                y[i] = x[i] * x[i];
+            }
+            break;
+        case COG_TENSOR_SQRT:
+            for (size_t i = 0; i < n; i++) {
+                y[i] = sqrtf(x[i]);
+            }
+            break;
+        case COG_TENSOR_EXP:
+            for (size_t i = 0; i < n; i++) {
+                y[i] = expf(x[i]);
+            }
+            break;
+        case COG_TENSOR_LOG:
+            for (size_t i = 0; i < n; i++) {
+                y[i] = logf(x[i]);
+            }
+            break;
+        case COG_TENSOR_RELU:
+            for (size_t i = 0; i < n; i++) {
+                y[i] = x[i] > 0.0f ? x[i] : 0.0f;
+            }
+            break;
+        case COG_TENSOR_SIGMOID:
+            for (size_t i = 0; i < n; i++) {
+                y[i] = 1.0f / (1.0f + expf(-x[i]));
+            }
+            break;
+        default:
+            break;
+    }
+    return r;
+}
+
+/**
+ * Sum of all elements
+ */
+struct ggml_tensor *cog_tensor_sum(struct ggml_context *ctx, struct ggml_tensor *a) {
+    if (!a) {
+        return NULL;
+    }
+
+    struct ggml_tensor *r = tensor_new(ctx, 1, 1);
+    if (r) {
+        r->data[0] = cpu_kernels()->sum_f32(a->data, tensor_count(a));
+    }
+    return r;
+}
+
+/**
+ * Sum of each row
+ */
+struct ggml_tensor *cog_tensor_sum_rows(struct ggml_context *ctx, struct ggml_tensor *a) {
+    if (!a) {
+        return NULL;
+    }
+
+    struct ggml_tensor *r = tensor_new(ctx, 1, a->ne[1]);
+    if (!r) {
+        return NULL;
+    }
+
+    const struct cog_kernels *kern = cpu_kernels();
+    size_t n = (size_t)a->ne[0];
+    for (int64_t row = 0; row < a->ne[1]; row++) {
+        r->data[row] = kern->sum_f32(a->data + (size_t)row * n, n);
+    }
+    return r;
+}
+
+/**
+ * Mean of each row
+ */
+struct ggml_tensor *cog_tensor_mean(struct ggml_context *ctx, struct ggml_tensor *a) {
+    struct ggml_tensor *r = cog_tensor_sum_rows(ctx, a);
+
+    if (r) {
+        float inv = 1.0f / (float)a->ne[0];
+
+        for (int64_t row = 0; row < a->ne[1]; row++) {
+            r->data[row] *= inv;
+        }
+    }
+    return r;
+}
+
+/**
+ * Largest element
+ */
+struct ggml_tensor *cog_tensor_max(struct ggml_context *ctx, struct ggml_tensor *a) {
+    if (!a) {
+        return NULL;
+    }
+
+    struct ggml_tensor *r = tensor_new(ctx, 1, 1);
+    if (!r) {
+        return NULL;
+    }
+
+    size_t n = tensor_count(a);
+    float best = a->data[0];
+    for (size_t i = 1; i < n; i++) {
+        best = a->data[i] > best ? a->data[i] : best;
+    }
+    r->data[0] = best;
+    return r;
+}
+
+/**
+ * Matrix product in GGML orientation
+ */
+struct ggml_tensor *cog_tensor_mul_mat(struct ggml_context *ctx, struct ggml_tensor *a,
+                                       struct ggml_tensor *b) {
+    if (!a || !b || a->ne[0] != b->ne[0]) {
+        return NULL;
+    }
+
+    struct ggml_tensor *r = tensor_new(ctx, a->ne[1], b->ne[1]);
+    if (!r) {
+        return NULL;
+    }
+
+    const struct cog_kernels *kern = cpu_kernels();
+    size_t k = (size_t)a->ne[0];
+    size_t m = (size_t)a->ne[1];
+    for (int64_t col = 0; col < b->ne[1]; col++) {
+        const float *y = b->data + (size_t)col * k;
+        float *out = r->data + (size_t)col * m;
+
+        for (size_t row = 0; row < m; row++) {
+            out[row] = kern->dot_f32(a->data + row * k, y, k);
+        }
+    }
+    return r;
+}
+
+/**
+ * Sparse matrix times dense vector
+ */
+struct ggml_tensor *cog_tensor_spmv(struct ggml_context *ctx, const struct cog_tensor_csr *m,
+                                    struct ggml_tensor *x) {
+    if (!m || !x || m->rows <= 0 || m->cols != cog_tensor_nelements(x) ||
+        !m->row_start || (m->row_start[m->rows] > 0 && (!m->col || !m->value))) {
+        return NULL;
+    }
+
+    struct ggml_tensor *r = tensor_new(ctx, m->rows, 1);
+    if (!r) {
+        return NULL;
+    }
+
+    const float *v = x->data;
+    for (int64_t row = 0; row < m->rows; row++) {
+        float sum = 0.0f;
+
+        for (uint32_t e = m->row_start[row]; e < m->row_start[row + 1]; e++) {
+            sum += m->value[e] * v[m->col[e]];
+        }
+        r->data[row] = sum;
+    }
+    return r;
+}
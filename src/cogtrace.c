@@ -0,0 +1,254 @@
+/**
+ * @file cogtrace.c
+ * @brief Kernel tracing - Per-thread span rings exported as Chrome trace JSON
+ *
+ * Spans are recorded by the COG_TRACE_BEGIN/COG_TRACE_END macros in
+ * cogkern_internal.h. While tracing is off a span costs one relaxed load
+ * and a predicted branch; building without COGKERN_TRACING removes the
+ * spans entirely.
+ *
+ * Each thread writes completed spans into its own ring buffer, allocated
+ * and registered the first time the thread records while tracing is on,
+ * so recording takes no lock and shares no cache line with other threads.
+ * A full ring overwrites its oldest spans. A new session retires the
+ * previous session's rings instead of freeing them, since a thread that
+ * read the old generation just before the switch may still be writing
+ * one; they are freed when the session after that starts.
+ * cog_trace_dump() writes every ring in the Chrome trace event format,
+ * which chrome://tracing and Perfetto load directly.
+ */
+
+#include "cogkern_internal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Default ring size per thread
+ */
+#define TRACE_DEFAULT_EVENTS 65536
+
+/**
+ * Maximum number of threads with a ring
+ */
+#define TRACE_MAX_THREADS 64
+
+/**
+ * Completed span
+ */
+struct trace_event {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t dur_ns;
+};
+
+/**
+ * Ring of one thread
+ */
+struct trace_ring {
+    uint64_t head;             /**< Spans ever written (next position) */
+    size_t mask;
+    uint32_t tid;              /**< Registration order, the tid in the export */
+    uint32_t generation;       /**< Trace session the ring belongs to */
+    struct trace_event events[];
+};
+
+/**
+ * Non-zero while spans are being recorded
+ */
+int g_trace_active = 0;
+
+/**
+ * Tracing state
+ */
+static struct {
+    pthread_mutex_t lock;      /**< Guards ring registration */
+    struct trace_ring *rings[TRACE_MAX_THREADS];
+    uint32_t ring_count;
+    struct trace_ring *retired[TRACE_MAX_THREADS]; /**< Rings of the previous session */
+    uint32_t retired_count;
+    size_t ring_events;
+    uint32_t generation;
+    uint64_t origin_ns;        /**< Timestamp zero of the export */
+    uint64_t dropped;          /**< Spans lost because no ring was available */
+} g_trace = {PTHREAD_MUTEX_INITIALIZER, {NULL}, 0, {NULL}, 0, 0, 0, 0, 0};
+
+/**
+ * Ring of the current thread, valid while its generation is current
+ */
+static __thread struct trace_ring *t_ring;
+static __thread uint32_t t_ring_generation;
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+uint64_t trace_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Register a ring for the calling thread
+ */
+static struct trace_ring *trace_ring_create(void) {
+    struct trace_ring *ring = NULL;
+
+    pthread_mutex_lock(&g_trace.lock);
+    if (g_trace.ring_count < TRACE_MAX_THREADS) {
+        ring = calloc(1, sizeof(*ring) + g_trace.ring_events * sizeof(struct trace_event));
+        if (ring) {
+            ring->mask = g_trace.ring_events - 1;
+            ring->tid = g_trace.ring_count;
+            ring->generation = g_trace.generation;
+            g_trace.rings[g_trace.ring_count++] = ring;
+        }
+    }
+    pthread_mutex_unlock(&g_trace.lock);
+
+    return ring;
+}
+
+/**
+ * Record a completed span on the calling thread's ring
+ */
+void trace_record(const char *name, uint64_t start_ns) {
+    uint64_t end = trace_clock_ns();
+    struct trace_ring *ring = t_ring;
+
+    if (!ring || t_ring_generation != __atomic_load_n(&g_trace.generation, __ATOMIC_ACQUIRE)) {
+        ring = trace_ring_create();
+        t_ring = ring;
+        t_ring_generation = ring ? ring->generation : 0;
+        if (!ring) {
+            __atomic_add_fetch(&g_trace.dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+
+    struct trace_event *ev = &ring->events[ring->head & ring->mask];
+    ev->name = name;
+    ev->start_ns = start_ns;
+    ev->dur_ns = end - start_ns;
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+#ifdef COGKERN_TRACING
+/**
+ * Free the rings retired two sessions ago and retire the current ones
+ *
+ * Called with the lock held, after the generation moved on, so no thread
+ * picks a retired ring up again.
+ */
+static void trace_retire_rings(void) {
+    for (uint32_t i = 0; i < g_trace.retired_count; i++) {
+        free(g_trace.retired[i]);
+    }
+    for (uint32_t i = 0; i < g_trace.ring_count; i++) {
+        g_trace.retired[i] = g_trace.rings[i];
+        g_trace.rings[i] = NULL;
+    }
+    g_trace.retired_count = g_trace.ring_count;
+    g_trace.ring_count = 0;
+}
+#endif
+
+/**
+ * Start recording trace spans
+ *
+ * Spans from a previous session are discarded.
+ *
+ * @param events_per_thread Ring size per thread, rounded up to a power
+ *                          of two (0 for the default)
+ * @return 0 on success, negative if tracing is already on or was
+ *         compiled out
+ */
+int cog_trace_start(size_t events_per_thread) {
+#ifdef COGKERN_TRACING
+    if (__atomic_load_n(&g_trace_active, __ATOMIC_RELAXED)) {
+        return -1;
+    }
+
+    size_t events = 2;
+    while (events < (events_per_thread ? events_per_thread : TRACE_DEFAULT_EVENTS)) {
+        events *= 2;
+    }
+
+    pthread_mutex_lock(&g_trace.lock);
+    __atomic_add_fetch(&g_trace.generation, 1, __ATOMIC_RELEASE);
+    trace_retire_rings();
+    g_trace.ring_events = events;
+    g_trace.origin_ns = trace_clock_ns();
+    g_trace.dropped = 0;
+    pthread_mutex_unlock(&g_trace.lock);
+
+    __atomic_store_n(&g_trace_active, 1, __ATOMIC_RELEASE);
+    return 0;
+#else
+    (void)events_per_thread;
+    return -1;
+#endif
+}
+
+/**
+ * Stop recording trace spans
+ *
+ * Recorded spans are kept until the next cog_trace_start().
+ */
+void cog_trace_stop(void) {
+    __atomic_store_n(&g_trace_active, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Write recorded spans as Chrome trace event JSON
+ *
+ * Call after cog_trace_stop() or while no other thread records spans.
+ *
+ * @param path Output file path
+ * @return Number of spans written, negative on error
+ */
+long cog_trace_dump(const char *path) {
+    if (!path) {
+        return -1;
+    }
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+
+    long written = 0;
+    const char *sep = "";
+
+    fprintf(f, "{\"traceEvents\":[\n");
+
+    pthread_mutex_lock(&g_trace.lock);
+    for (uint32_t i = 0; i < g_trace.ring_count; i++) {
+        const struct trace_ring *ring = g_trace.rings[i];
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > ring->mask + 1 ? head - (ring->mask + 1) : 0;
+
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"name\":\"thread-%u\"}}", sep, ring->tid, ring->tid);
+        sep = ",\n";
+
+        for (uint64_t n = first; n < head; n++) {
+            const struct trace_event *ev = &ring->events[n & ring->mask];
+            uint64_t ts = ev->start_ns > g_trace.origin_ns ? ev->start_ns - g_trace.origin_ns : 0;
+
+            fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"cogkern\",\"ph\":\"X\",\"pid\":1,"
+                    "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", sep, ev->name, ring->tid,
+                    ts / 1e3, ev->dur_ns / 1e3);
+            written++;
+        }
+    }
+    pthread_mutex_unlock(&g_trace.lock);
+
+    fprintf(f, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    if (fclose(f) != 0) {
+        return -1;
+    }
+    return written;
+}
@@ -0,0 +1,524 @@
+/**
+ * @file cogtraverse.c
+ * @brief Neighbourhood traversal - Parallel k-hop breadth-first search
+ *
+ * cog_traverse() expands one level at a time. The atoms reached so far
+ * are a visited bitset over atom slots; the atoms first reached on the
+ * current level are collected in a second bitset and sorted into slot
+ * order, by scanning the bitset or, when only a few were reached, by
+ * sorting the threads' own lists of them. They become the results and
+ * the next frontier, so the output never depends on how a level was
+ * split between threads.
+ *
+ * A level runs in one of two directions:
+ *
+ * - top-down: each frontier atom claims its unvisited neighbours with an
+ *   atomic OR on the visited bitset, so a neighbour shared by several
+ *   frontier atoms is reached once;
+ * - bottom-up: each unvisited atom looks for a neighbour in the frontier
+ *   bitset and stops at the first one found. Neighbour relations are
+ *   symmetric, so this reaches the same atoms. It pays off once the
+ *   frontier is large, when most top-down probes would hit atoms that
+ *   are already visited.
+ *
+ * Levels with enough work are split across threads bound to the caller's
+ * context: top-down over chunks of the frontier list, bottom-up over
+ * ranges of bitset words, which each thread then owns. The AtomSpace is
+ * only read while they run.
+ */
+
+#include "cogkern_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Worker thread limit
+ */
+#define TRAVERSE_MAX_THREADS 64
+
+/**
+ * Frontier atoms (top-down) or bitset words (bottom-up) taken per grab
+ */
+#define TRAVERSE_CHUNK_ATOMS 256
+#define TRAVERSE_CHUNK_WORDS 16
+
+/**
+ * Chunks a level needs per thread before another thread is started
+ */
+#define TRAVERSE_CHUNKS_PER_THREAD 4
+
+/**
+ * Go bottom-up once the frontier holds more than 1/ALPHA of the atoms
+ * not yet reached
+ */
+#define TRAVERSE_ALPHA 14
+
+/**
+ * Neighbours a bottom-up probe reads before fetching the whole list
+ */
+#define TRAVERSE_PROBE 16
+
+/**
+ * Sort a top-down level's claim lists instead of scanning its bitset
+ * while they hold fewer atoms than 1/SPARSE of the bitset words
+ */
+#define TRAVERSE_SPARSE 8
+
+/**
+ * Work shared by the threads expanding one level
+ */
+struct traverse_level {
+    const uint32_t *frontier;  /**< Atoms to expand (top-down) */
+    size_t frontier_count;
+    const uint64_t *expand;    /**< Frontier bitset (bottom-up) */
+    uint64_t *visited;
+    uint64_t *next;            /**< Atoms first reached on this level */
+    size_t words;              /**< Words in each bitset */
+    size_t slots;              /**< Atom slots covered by the bitsets */
+    size_t cursor;             /**< Next chunk to hand out */
+    int bottom_up;
+};
+
+/**
+ * Per-thread state
+ */
+struct traverse_worker {
+    pthread_t thread;
+    struct cogkern_ctx *ctx;
+    struct traverse_level *level;
+    uint32_t *buf;             /**< Neighbour slots of the atom in hand */
+    size_t cap;
+    uint32_t *claimed;         /**< Atoms this thread reached top-down */
+    size_t claimed_count;
+    size_t claimed_cap;
+    int failed;                /**< Out of memory */
+};
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+static uint64_t traverse_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Fetch up to limit neighbour slots of an atom into the worker's buffer
+ *
+ * @return Number of neighbours (which may exceed limit), or -1 if the
+ *         buffer could not grow to limit
+ */
+static long traverse_fetch(struct traverse_worker *w, uint32_t slot, size_t limit) {
+    size_t n = atomspace_neighbor_slots(slot, w->buf, w->cap < limit ? w->cap : limit);
+
+    if (n > w->cap && limit > w->cap) {
+        size_t cap = w->cap * 2 > n ? w->cap * 2 : n;
+        uint32_t *grown = realloc(w->buf, cap * sizeof(uint32_t));
+        if (!grown) {
+            w->failed = 1;
+            return -1;
+        }
+        w->buf = grown;
+        w->cap = cap;
+        n = atomspace_neighbor_slots(slot, w->buf, cap < limit ? cap : limit);
+    }
+    return (long)n;
+}
+
+/**
+ * Record an atom reached by a worker on a top-down level
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+static int traverse_claim(struct traverse_worker *w, uint32_t slot) {
+    if (w->claimed_count == w->claimed_cap) {
+        size_t cap = w->claimed_cap ? w->claimed_cap * 2 : 64;
+        uint32_t *grown = realloc(w->claimed, cap * sizeof(uint32_t));
+        if (!grown) {
+            w->failed = 1;
+            return -1;
+        }
+        w->claimed = grown;
+        w->claimed_cap = cap;
+    }
+    w->claimed[w->claimed_count++] = slot;
+    return 0;
+}
+
+/**
+ * Expand chunks of the frontier list until none are left
+ */
+static void traverse_top_down(struct traverse_worker *w) {
+    struct traverse_level *l = w->level;
+
+    for (;;) {
+        size_t begin = __atomic_fetch_add(&l->cursor, TRAVERSE_CHUNK_ATOMS, __ATOMIC_RELAXED);
+        if (begin >= l->frontier_count) {
+            return;
+        }
+        size_t end = begin + TRAVERSE_CHUNK_ATOMS;
+        if (end > l->frontier_count) {
+            end = l->frontier_count;
+        }
+
+        for (size_t i = begin; i < end; i++) {
+            long n = traverse_fetch(w, l->frontier[i], SIZE_MAX);
+            if (n < 0) {
+                return;
+            }
+            for (long k = 0; k < n; k++) {
+                uint32_t v = w->buf[k];
+                uint64_t bit = 1ULL << (v & 63);
+                if (__atomic_load_n(&l->visited[v >> 6], __ATOMIC_RELAXED) & bit) {
+                    continue;
+                }
+                /* Whoever sets the visited bit first owns the atom */
+                if (!(__atomic_fetch_or(&l->visited[v >> 6], bit, __ATOMIC_RELAXED) & bit)) {
+                    __atomic_fetch_or(&l->next[v >> 6], bit, __ATOMIC_RELAXED);
+                    if (traverse_claim(w, v) != 0) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Whether any neighbour of an atom is in the frontier bitset
+ *
+ * @return 1 if so, 0 if not, -1 if out of memory
+ */
+static int traverse_has_parent(struct traverse_worker *w, uint32_t slot) {
+    const uint64_t *expand = w->level->expand;
+    long n = traverse_fetch(w, slot, TRAVERSE_PROBE);
+    long seen = n < TRAVERSE_PROBE ? n : TRAVERSE_PROBE;
+
+    if (n < 0) {
+        return -1;
+    }
+    for (long k = 0; k < seen; k++) {
+        if (expand[w->buf[k] >> 6] & (1ULL << (w->buf[k] & 63))) {
+            return 1;
+        }
+    }
+    if (n <= TRAVERSE_PROBE) {
+        return 0;
+    }
+
+    n = traverse_fetch(w, slot, SIZE_MAX);
+    if (n < 0) {
+        return -1;
+    }
+    for (long k = seen; k < n; k++) {
+        if (expand[w->buf[k] >> 6] & (1ULL << (w->buf[k] & 63))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Look for frontier parents of the unvisited atoms in ranges of bitset
+ * words until none are left
+ */
+static void traverse_bottom_up(struct traverse_worker *w) {
+    struct traverse_level *l = w->level;
+
+    for (;;) {
+        size_t begin = __atomic_fetch_add(&l->cursor, TRAVERSE_CHUNK_WORDS, __ATOMIC_RELAXED);
+        if (begin >= l->words) {
+            return;
+        }
+        size_t end = begin + TRAVERSE_CHUNK_WORDS;
+        if (end > l->words) {
+            end = l->words;
+        }
+
+        for (size_t wd = begin; wd < end; wd++) {
+            uint64_t todo = ~l->visited[wd];
+            uint64_t found = 0;
+            if (wd == l->words - 1 && (l->slots & 63)) {
+                todo &= (1ULL << (l->slots & 63)) - 1;
+            }
+
+            while (todo) {
+                uint32_t v = (uint32_t)(wd << 6) + (uint32_t)__builtin_ctzll(todo);
+                todo &= todo - 1;
+                if (!atomspace_handle_at(v)) {
+                    continue;
+                }
+                int parent = traverse_has_parent(w, v);
+                if (parent < 0) {
+                    return;
+                }
+                if (parent) {
+                    found |= 1ULL << (v & 63);
+                }
+            }
+
+            /* This thread owns the word for the whole level */
+            l->next[wd] = found;
+            l->visited[wd] |= found;
+        }
+    }
+}
+
+/**
+ * Worker thread entry point
+ */
+static void *traverse_worker_main(void *arg) {
+    struct traverse_worker *w = arg;
+
+    cogkern_ctx_bind(w->ctx);
+    if (w->level->bottom_up) {
+        traverse_bottom_up(w);
+    } else {
+        traverse_top_down(w);
+    }
+    return NULL;
+}
+
+/**
+ * Expand one level on up to threads threads, the caller being one of them
+ *
+ * @return Threads used
+ */
+static uint32_t traverse_level_run(struct traverse_level *l, struct traverse_worker *workers,
+                                   uint32_t threads) {
+    size_t chunks = l->bottom_up
+                        ? (l->words + TRAVERSE_CHUNK_WORDS - 1) / TRAVERSE_CHUNK_WORDS
+                        : (l->frontier_count + TRAVERSE_CHUNK_ATOMS - 1) / TRAVERSE_CHUNK_ATOMS;
+    uint32_t count = 1;
+    uint32_t started = 0;
+
+    while (count < threads && chunks >= (size_t)(count + 1) * TRAVERSE_CHUNKS_PER_THREAD) {
+        count++;
+    }
+
+    l->cursor = 0;
+    for (uint32_t i = 0; i < threads; i++) {
+        workers[i].level = l;
+        workers[i].claimed_count = 0;
+    }
+    for (uint32_t i = 1; i < count; i++) {
+        if (pthread_create(&workers[i].thread, NULL, traverse_worker_main, &workers[i]) != 0) {
+            break;
+        }
+        started = i;
+    }
+
+    /* The calling thread takes chunks too, and finishes any left over */
+    if (l->bottom_up) {
+        traverse_bottom_up(&workers[0]);
+    } else {
+        traverse_top_down(&workers[0]);
+    }
+    for (uint32_t i = 1; i <= started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    return started + 1;
+}
+
+/**
+ * Ascending order of atom slots
+ */
+static int traverse_slot_cmp(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Gather the atoms first reached on a level in slot order
+ *
+ * A sparse top-down level sorts the threads' claim lists; any other level
+ * scans the next bitset. Either way the bitset is left clear.
+ *
+ * @param buf Array to receive the atoms, grown as needed
+ * @param cap Capacity of buf
+ * @return Number of atoms, or -1 if buf could not grow
+ */
+static long traverse_gather(struct traverse_level *l, const struct traverse_worker *workers,
+                            uint32_t threads, uint32_t **buf, size_t *cap) {
+    size_t total = 0;
+
+    for (uint32_t i = 0; i < threads; i++) {
+        total += workers[i].claimed_count;
+    }
+    int sparse = !l->bottom_up && total < l->words / TRAVERSE_SPARSE;
+    if (l->bottom_up) {
+        for (size_t wd = 0; wd < l->words; wd++) {
+            total += (size_t)__builtin_popcountll(l->next[wd]);
+        }
+    }
+
+    if (total > *cap) {
+        uint32_t *grown = realloc(*buf, total * sizeof(uint32_t));
+        if (!grown) {
+            return -1;
+        }
+        *buf = grown;
+        *cap = total;
+    }
+
+    size_t n = 0;
+    if (sparse) {
+        for (uint32_t i = 0; i < threads; i++) {
+            if (workers[i].claimed_count > 0) {
+                memcpy(*buf + n, workers[i].claimed, workers[i].claimed_count * sizeof(uint32_t));
+                n += workers[i].claimed_count;
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            l->next[(*buf)[i] >> 6] = 0;
+        }
+        qsort(*buf, n, sizeof(uint32_t), traverse_slot_cmp);
+        return (long)n;
+    }
+
+    for (size_t wd = 0; wd < l->words; wd++) {
+        uint64_t bits = l->next[wd];
+        l->next[wd] = 0;
+        while (bits) {
+            (*buf)[n++] = (uint32_t)(wd << 6) + (uint32_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+        }
+    }
+    return (long)n;
+}
+
+/**
+ * Find the atoms within a number of hops of an atom
+ *
+ * @param start Atom to start from
+ * @param params Traversal parameters (NULL for no limits)
+ * @param out Array to receive the handles of the atoms found
+ * @param hops Array to receive each atom's distance in hops (may be NULL)
+ * @param max Capacity of out and hops
+ * @param stats Pointer to receive traversal statistics (may be NULL)
+ * @return Number of atoms found, which may exceed max, or negative on error
+ */
+int cog_traverse(atom_handle_t start, const struct cog_traverse_params *params,
+                 atom_handle_t *out, uint32_t *hops, size_t max,
+                 struct cog_traverse_stats *stats) {
+    struct cog_traverse_params p = {0};
+    struct cog_traverse_stats local_stats;
+    uint32_t slot;
+
+    if (!stats) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (params) {
+        p = *params;
+    }
+    if (atomspace_lookup(start, &slot) != 0 || (!out && max > 0)) {
+        return -1;
+    }
+
+    uint64_t t0 = traverse_now();
+    uint32_t threads = p.threads;
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint32_t)online : 1;
+    }
+    if (threads > TRAVERSE_MAX_THREADS) {
+        threads = TRAVERSE_MAX_THREADS;
+    }
+
+    struct traverse_level l = {0};
+    l.slots = atomspace_slots();
+    l.words = (l.slots + 63) / 64;
+    l.visited = calloc(l.words, sizeof(uint64_t));
+    l.next = calloc(l.words, sizeof(uint64_t));
+    uint64_t *expand = calloc(l.words, sizeof(uint64_t));
+    uint32_t *frontier = malloc(sizeof(uint32_t));
+    size_t frontier_cap = 1;
+
+    struct traverse_worker workers[TRAVERSE_MAX_THREADS];
+    memset(workers, 0, sizeof(workers));
+    for (uint32_t i = 0; i < threads; i++) {
+        workers[i].ctx = cogkern_ctx_current();
+    }
+
+    int failed = !l.visited || !l.next || !expand || !frontier;
+    size_t found = 0;
+    size_t unvisited = atomspace_count() - 1;
+
+    COG_TRACE_BEGIN(span);
+    if (!failed) {
+        l.visited[slot >> 6] |= 1ULL << (slot & 63);
+        frontier[0] = slot;
+        l.frontier_count = 1;
+    }
+
+    while (!failed && l.frontier_count > 0 && (p.max_hops == 0 || stats->levels < p.max_hops)) {
+        l.frontier = frontier;
+        l.bottom_up = l.frontier_count * TRAVERSE_ALPHA > unvisited;
+        if (l.bottom_up) {
+            memset(expand, 0, l.words * sizeof(uint64_t));
+            for (size_t i = 0; i < l.frontier_count; i++) {
+                expand[frontier[i] >> 6] |= 1ULL << (frontier[i] & 63);
+            }
+            l.expand = expand;
+            stats->bottom_up_levels++;
+        }
+
+        uint32_t used = traverse_level_run(&l, workers, threads);
+        if (used > stats->threads) {
+            stats->threads = used;
+        }
+        for (uint32_t i = 0; i < threads; i++) {
+            failed |= workers[i].failed;
+        }
+        stats->levels++;
+
+        /* The new atoms are the results, and those to expand the frontier */
+        long fresh = failed ? 0 : traverse_gather(&l, workers, threads, &frontier, &frontier_cap);
+        if (fresh < 0) {
+            failed = 1;
+        }
+        l.frontier_count = 0;
+        for (long i = 0; i < fresh; i++) {
+            uint32_t v = frontier[i];
+            uint32_t type_bit = COG_TYPE_BIT(atomspace_type(v));
+
+            if (p.result_types == 0 || (p.result_types & type_bit)) {
+                if (found < max) {
+                    out[found] = atomspace_handle_at(v);
+                    if (hops) {
+                        hops[found] = stats->levels;
+                    }
+                }
+                found++;
+            }
+            if (p.follow_types == 0 || (p.follow_types & type_bit)) {
+                frontier[l.frontier_count++] = v;
+            }
+        }
+        stats->reached += fresh > 0 ? (size_t)fresh : 0;
+        unvisited -= fresh > 0 ? (size_t)fresh : 0;
+    }
+    COG_TRACE_END(span, "traverse");
+
+    for (uint32_t i = 0; i < threads; i++) {
+        free(workers[i].buf);
+        free(workers[i].claimed);
+    }
+    free(frontier);
+    free(expand);
+    free(l.next);
+    free(l.visited);
+    stats->elapsed_ns = traverse_now() - t0;
+
+    if (failed) {
+        return -1;
+    }
+    return found > INT32_MAX ? INT32_MAX : (int)found;
+}
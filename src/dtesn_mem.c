@@ -0,0 +1,547 @@
+/**
+ * @file dtesn_mem.c
+ * @brief DTESN memory regions - Page-level backing store for the kernel
+ *
+ * dtesn_mem_init_regions() reserves the remaining cogkern_init() budget as
+ * a set of regions, optionally backed by transparent or explicit huge
+ * pages and optionally pre-faulted. The regions are laid out back to back
+ * in one mapping and carved into DTESN_MEM_PAGE_SIZE pages tracked by one
+ * bitmap, so a run of pages may cross region boundaries: a kernel table
+ * that doubles as the AtomSpace grows can use the whole budget, not just
+ * one region's share. Every kernel table and hypergraph arena chunk is
+ * served from them.
+ *
+ * Before the regions exist, and when free pages are too scattered to hold
+ * a request, page requests fall back to aligned heap memory charged
+ * against the same budget (in the second case the regions give up that
+ * much of their share until the block is freed), so callers never need
+ * to care which backing they got.
+ */
+
+#include "cogkern_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/**
+ * Maximum number of memory regions
+ */
+#define DTESN_MAX_REGIONS 256
+
+/**
+ * Huge page size used for region alignment
+ */
+#define DTESN_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * Contiguous page pool holding every region
+ */
+struct dtesn_region {
+    char *base;          /**< Pool start (huge-page aligned) */
+    size_t size;         /**< Pool size in bytes */
+    size_t num_pages;    /**< Pages in the pool */
+    size_t free_pages;   /**< Pages not handed out */
+    size_t cursor;       /**< Next-fit search hint (page index) */
+    uint64_t *bitmap;    /**< One bit per page, set when in use */
+    void *map_base;      /**< Address returned by mmap */
+    size_t map_size;     /**< Length passed to mmap */
+};
+
+/**
+ * Memory region state
+ */
+struct mem_state {
+    struct dtesn_region pool;
+    size_t num_regions;
+    size_t region_size;
+    uint32_t flags;
+    uint32_t active_flags;
+    size_t bytes_reserved;
+    size_t bytes_allocated;
+    size_t heap_bytes;
+    int growth_failed;
+};
+
+/**
+ * Memory region state of the default context
+ */
+struct mem_state mem_default = {0};
+
+/**
+ * Memory region state of the calling thread's context
+ */
+#define g_mem (*cogkern_ctx_current()->mem)
+
+/**
+ * Allocate Memory region state for a new context
+ */
+struct mem_state *mem_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct mem_state));
+}
+
+/**
+ * Round up to a multiple of a power-of-two alignment
+ */
+static inline size_t align_up(size_t v, size_t align) {
+    return (v + align - 1) & ~(align - 1);
+}
+
+/**
+ * Map the pool's memory, honouring the huge page and pre-fault flags
+ */
+static int dtesn_region_map(struct dtesn_region *r, size_t size) {
+    int prot = PROT_READ | PROT_WRITE;
+    int base_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    void *mem = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (g_mem.flags & DTESN_MEM_EXPLICIT_HUGEPAGES) {
+        int flags = base_flags | MAP_HUGETLB;
+#ifdef MAP_POPULATE
+        if (g_mem.flags & DTESN_MEM_PREFAULT) {
+            flags |= MAP_POPULATE;
+        }
+#endif
+        mem = mmap(NULL, size, prot, flags, -1, 0);
+        if (mem != MAP_FAILED) {
+            r->map_base = mem;
+            r->map_size = size;
+            r->base = mem;
+            g_mem.active_flags |= DTESN_MEM_EXPLICIT_HUGEPAGES;
+            if (g_mem.flags & DTESN_MEM_PREFAULT) {
+                g_mem.active_flags |= DTESN_MEM_PREFAULT;
+            }
+            return 0;
+        }
+        /* No hugetlbfs pages reserved: fall back to regular mappings */
+    }
+#endif
+
+    /* Over-allocate so the region can start on a huge page boundary */
+    size_t map_size = size + DTESN_HUGE_PAGE_SIZE;
+    mem = mmap(NULL, map_size, prot, base_flags, -1, 0);
+    if (mem == MAP_FAILED) {
+        return -1;
+    }
+
+    r->map_base = mem;
+    r->map_size = map_size;
+    r->base = (char *)align_up((size_t)mem, DTESN_HUGE_PAGE_SIZE);
+
+#ifdef MADV_HUGEPAGE
+    if (g_mem.flags & (DTESN_MEM_TRANSPARENT_HUGEPAGES | DTESN_MEM_EXPLICIT_HUGEPAGES)) {
+        if (madvise(r->base, size, MADV_HUGEPAGE) == 0) {
+            g_mem.active_flags |= DTESN_MEM_TRANSPARENT_HUGEPAGES;
+        }
+    }
+#endif
+
+    if (g_mem.flags & DTESN_MEM_PREFAULT) {
+        /* Touch every page so the first ticks after boot do not fault */
+        for (size_t off = 0; off < size; off += 4096) {
+            r->base[off] = 0;
+        }
+        g_mem.active_flags |= DTESN_MEM_PREFAULT;
+    }
+
+    return 0;
+}
+
+/**
+ * Set memory region options for the next dtesn_mem_init_regions() call
+ *
+ * @param flags Bitwise OR of enum dtesn_mem_flags
+ * @return 0 on success, negative if regions are already initialized
+ */
+int dtesn_mem_set_flags(uint32_t flags) {
+    if (g_mem.num_regions > 0) {
+        return -1;
+    }
+
+    g_mem.flags = flags;
+    return 0;
+}
+
+/**
+ * Initialize memory regions
+ *
+ * Performance target: ≤100ns per memory op
+ *
+ * @param num_regions Number of memory regions
+ * @return 0 on success, negative on error
+ */
+int dtesn_mem_init_regions(size_t num_regions) {
+    if (num_regions == 0 || num_regions > DTESN_MAX_REGIONS) {
+        return -1;
+    }
+
+    if (g_mem.num_regions > 0) {
+        return -1; /* Already initialized */
+    }
+
+    size_t used = 0, budget = 0;
+    if (cogkern_mem_usage(&used, &budget) != 0) {
+        return -1;
+    }
+
+    /* Split the remaining budget evenly, in whole huge pages per region */
+    size_t region_size = (budget - used) / num_regions;
+    region_size &= ~(size_t)(DTESN_HUGE_PAGE_SIZE - 1);
+    if (region_size == 0) {
+        region_size = ((budget - used) / num_regions) & ~(size_t)(DTESN_MEM_PAGE_SIZE - 1);
+    }
+    if (region_size == 0) {
+        return -1;
+    }
+
+    if (cogkern_mem_charge(region_size * num_regions) != 0) {
+        return -1;
+    }
+
+    g_mem.active_flags = 0;
+
+    /* One mapping for all regions, so page runs may span them */
+    struct dtesn_region *r = &g_mem.pool;
+    size_t size = region_size * num_regions;
+    size_t num_pages = size / DTESN_MEM_PAGE_SIZE;
+
+    r->bitmap = calloc((num_pages + 63) / 64, sizeof(uint64_t));
+    if (!r->bitmap || dtesn_region_map(r, size) != 0) {
+        free(r->bitmap);
+        memset(r, 0, sizeof(*r));
+        g_mem.active_flags = 0;
+        cogkern_mem_uncharge(size);
+        return -1;
+    }
+
+    r->size = size;
+    r->num_pages = num_pages;
+    r->free_pages = num_pages;
+    r->cursor = 0;
+
+    g_mem.num_regions = num_regions;
+    g_mem.region_size = region_size;
+    g_mem.bytes_reserved = size;
+    g_mem.bytes_allocated = 0;
+
+    return 0;
+}
+
+/**
+ * Find and claim a run of free pages in the pool
+ *
+ * @return Page index of the run or (size_t)-1 if none fits
+ */
+static size_t dtesn_region_claim(struct dtesn_region *r, size_t pages) {
+    if (r->free_pages < pages) {
+        return (size_t)-1;
+    }
+
+    size_t n = r->num_pages;
+
+    for (size_t pass = 0; pass < 2; pass++) {
+        size_t start = pass == 0 ? r->cursor : 0;
+        size_t limit = pass == 0 ? n : r->cursor + pages;
+        size_t run = 0;
+
+        if (limit > n) {
+            limit = n;
+        }
+
+        for (size_t i = start; i < limit; i++) {
+            uint64_t word = r->bitmap[i / 64];
+
+            /* Skip fully used words while not inside a run */
+            if (run == 0 && (i % 64) == 0 && word == ~(uint64_t)0) {
+                i += 63;
+                continue;
+            }
+
+            if (word & ((uint64_t)1 << (i % 64))) {
+                run = 0;
+                continue;
+            }
+
+            if (++run == pages) {
+                size_t first = i + 1 - pages;
+                for (size_t j = first; j <= i; j++) {
+                    r->bitmap[j / 64] |= (uint64_t)1 << (j % 64);
+                }
+                r->free_pages -= pages;
+                r->cursor = i + 1 < n ? i + 1 : 0;
+                return first;
+            }
+        }
+    }
+
+    return (size_t)-1;
+}
+
+/**
+ * Allocate page-granular kernel storage
+ */
+void *cogkern_pages_alloc(size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+
+    size = align_up(size, DTESN_MEM_PAGE_SIZE);
+
+    if (g_mem.num_regions > 0) {
+        struct dtesn_region *r = &g_mem.pool;
+
+        if (g_mem.bytes_reserved - g_mem.bytes_allocated < size) {
+            return NULL; /* Regions hold the whole remaining budget */
+        }
+
+        size_t first = dtesn_region_claim(r, size / DTESN_MEM_PAGE_SIZE);
+        if (first != (size_t)-1) {
+            g_mem.bytes_allocated += size;
+            return r->base + first * DTESN_MEM_PAGE_SIZE;
+        }
+
+        /* Free pages too scattered: move their budget to a heap block */
+        void *mem = NULL;
+        if (posix_memalign(&mem, DTESN_MEM_PAGE_SIZE, size) != 0) {
+            return NULL;
+        }
+        g_mem.bytes_reserved -= size;
+        g_mem.heap_bytes += size;
+        return mem;
+    }
+
+    if (cogkern_mem_charge(size) != 0) {
+        return NULL;
+    }
+
+    void *mem = NULL;
+    if (posix_memalign(&mem, DTESN_MEM_PAGE_SIZE, size) != 0) {
+        cogkern_mem_uncharge(size);
+        return NULL;
+    }
+
+    g_mem.heap_bytes += size;
+    return mem;
+}
+
+/**
+ * Free storage returned by cogkern_pages_alloc()
+ */
+void cogkern_pages_free(void *ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+
+    size = align_up(size, DTESN_MEM_PAGE_SIZE);
+
+    struct dtesn_region *r = &g_mem.pool;
+
+    if (g_mem.num_regions > 0 && (char *)ptr >= r->base && (char *)ptr < r->base + r->size) {
+        size_t first = (size_t)((char *)ptr - r->base) / DTESN_MEM_PAGE_SIZE;
+        size_t pages = size / DTESN_MEM_PAGE_SIZE;
+
+        for (size_t j = first; j < first + pages; j++) {
+            r->bitmap[j / 64] &= ~((uint64_t)1 << (j % 64));
+        }
+        r->free_pages += pages;
+        g_mem.bytes_allocated -= size;
+        return;
+    }
+
+    free(ptr);
+    g_mem.heap_bytes -= size;
+
+    /* Hand budget the regions lent out back to them */
+    size_t lent = g_mem.num_regions > 0 ? r->size - g_mem.bytes_reserved : 0;
+    size_t back = size < lent ? size : lent;
+    g_mem.bytes_reserved += back;
+    cogkern_mem_uncharge(size - back);
+}
+
+/**
+ * Grow a kernel table to hold at least the requested number of entries
+ */
+int cogkern_table_reserve(void **table, size_t *capacity, size_t elem_size, size_t needed) {
+    void *old;
+    size_t old_bytes;
+
+    if (cogkern_table_grow(table, capacity, elem_size, needed, &old, &old_bytes) != 0) {
+        return -1;
+    }
+
+    cogkern_pages_free(old, old_bytes);
+    return 0;
+}
+
+/**
+ * Grow a kernel table, handing the old storage back instead of freeing it
+ *
+ * The new base pointer is published with release ordering, so a reader
+ * that loads it with acquire ordering sees the copied entries.
+ */
+int cogkern_table_grow(void **table, size_t *capacity, size_t elem_size, size_t needed,
+                       void **old, size_t *old_bytes) {
+    *old = NULL;
+    *old_bytes = 0;
+    if (needed <= *capacity) {
+        return 0;
+    }
+
+    size_t new_cap = *capacity ? *capacity * 2 : DTESN_MEM_PAGE_SIZE / elem_size;
+    if (new_cap < needed) {
+        new_cap = needed;
+    }
+
+    /*
+     * Use the whole page-rounded allocation. Near the end of the budget a
+     * doubled table may not fit next to the old one, so settle for half
+     * the growth until only the requested size is left to try.
+     */
+    size_t min_cap = align_up(needed * elem_size, DTESN_MEM_PAGE_SIZE) / elem_size;
+    char *mem = NULL;
+    while (!mem) {
+        new_cap = align_up(new_cap * elem_size, DTESN_MEM_PAGE_SIZE) / elem_size;
+        mem = cogkern_pages_alloc(new_cap * elem_size);
+        if (!mem && new_cap <= min_cap) {
+            return -1;
+        }
+        if (!mem) {
+            new_cap = *capacity + (new_cap - *capacity) / 2;
+            if (new_cap < min_cap) {
+                new_cap = min_cap;
+            }
+        }
+    }
+
+    if (*table) {
+        memcpy(mem, *table, *capacity * elem_size);
+        *old = *table;
+        *old_bytes = *capacity * elem_size;
+    }
+    memset(mem + *capacity * elem_size, 0, (new_cap - *capacity) * elem_size);
+
+    __atomic_store_n(table, (void *)mem, __ATOMIC_RELEASE);
+    *capacity = new_cap;
+    return 0;
+}
+
+/**
+ * Release a table grown with cogkern_table_reserve()
+ */
+void cogkern_table_free(void **table, size_t *capacity, size_t elem_size) {
+    cogkern_pages_free(*table, *capacity * elem_size);
+    *table = NULL;
+    *capacity = 0;
+}
+
+/**
+ * Exchange two table entries
+ */
+static void table_swap(char *a, char *b, size_t size) {
+    char tmp[64];
+
+    while (size > 0) {
+        size_t n = size < sizeof(tmp) ? size : sizeof(tmp);
+        memcpy(tmp, a, n);
+        memcpy(a, b, n);
+        memcpy(b, tmp, n);
+        a += n;
+        b += n;
+        size -= n;
+    }
+}
+
+/**
+ * Move every entry of a kernel table to a new index in place
+ *
+ * Each cycle of the permutation is followed once from its lowest index,
+ * swapping the entry held there into place, so no second table is needed.
+ */
+void cogkern_table_permute(void *table, size_t elem_size, size_t count, const uint32_t *dest,
+                           uint64_t *done) {
+    char *base = table;
+
+    memset(done, 0, (count + 63) / 64 * sizeof(uint64_t));
+    for (size_t i = 0; i < count; i++) {
+        if (done[i / 64] & ((uint64_t)1 << (i % 64))) {
+            continue;
+        }
+        for (size_t j = dest[i]; j != i; j = dest[j]) {
+            table_swap(base + i * elem_size, base + j * elem_size, elem_size);
+            done[j / 64] |= (uint64_t)1 << (j % 64);
+        }
+    }
+}
+
+/**
+ * Get memory region statistics
+ *
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
+ */
+int dtesn_mem_get_stats(struct dtesn_mem_stats *stats) {
+    if (!stats) {
+        return -1;
+    }
+
+    stats->num_regions = g_mem.num_regions;
+    stats->region_size = g_mem.region_size;
+    stats->bytes_reserved = g_mem.bytes_reserved;
+    stats->bytes_allocated = g_mem.bytes_allocated;
+    stats->heap_bytes = g_mem.heap_bytes;
+    stats->active_flags = g_mem.active_flags;
+
+    return 0;
+}
+
+/**
+ * Fraction of the memory budget holding live kernel data
+ */
+float dtesn_mem_pressure(void) {
+    size_t used = 0, budget = 0;
+
+    if (g_mem.growth_failed) {
+        return 1.0f;
+    }
+    if (cogkern_mem_usage(&used, &budget) != 0 || budget == 0) {
+        return 0.0f;
+    }
+
+    used -= g_mem.bytes_reserved - g_mem.bytes_allocated;
+    return (float)((double)used / (double)budget);
+}
+
+/**
+ * Record that an atom, edge, attention or truth value table could not grow
+ */
+void dtesn_mem_pressure_raise(void) {
+    g_mem.growth_failed = 1;
+}
+
+/**
+ * Clear the failed growth recorded for dtesn_mem_pressure()
+ */
+void dtesn_mem_pressure_clear(void) {
+    g_mem.growth_failed = 0;
+}
+
+/**
+ * Unmap every region and return its budget
+ */
+void dtesn_mem_shutdown(void) {
+    struct dtesn_region *r = &g_mem.pool;
+
+    if (g_mem.num_regions > 0) {
+        munmap(r->map_base, r->map_size);
+        free(r->bitmap);
+        cogkern_mem_uncharge(g_mem.bytes_reserved);
+        memset(r, 0, sizeof(*r));
+    }
+
+    g_mem.num_regions = 0;
+    g_mem.region_size = 0;
+    g_mem.active_flags = 0;
+    g_mem.bytes_reserved = 0;
+    g_mem.bytes_allocated = 0;
+    g_mem.growth_failed = 0;
+}
@@ -6,34 +6,322 @@
  * and importance spreading algorithms.
  */
 
-#include "cogkern.h"
+#include "cogkern_internal.h"
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
-/**
- * Maximum number of attention values
- */
-#define MAX_AVS 1000000
-
 /**
  * Attention value entry
+ * 
+ * Everything after the cell is versioned for read snapshots.
  */
 struct av_entry {
+    struct snap_cell cell;
     atom_handle_t atom;
     struct attention_value av;
-    int active;
+    int active;            /**< AV_NONE, AV_LIVE or AV_PAGED */
+};
+
+/**
+ * Entry states
+ * 
+ * A paged entry's value has moved to the out-of-core tier; the entry keeps
+ * a copy so snapshots see attention values of cold atoms.
+ */
+#define AV_NONE 0
+#define AV_LIVE 1
+#define AV_PAGED 2
+
+/**
+ * Slots per compact attention value block
+ */
+#define AV_BLOCK 32
+
+/**
+ * Handles resolved at a time by dtesn_sched_set_av_batch()
+ */
+#define AV_BATCH_CHUNK 256
+
+/**
+ * Largest compact STI and largest compact LTI or VLTI, in units
+ */
+#define AV_STI_MAX 32767
+#define AV_LTI_MAX 127
+
+/**
+ * Compact attention values of AV_BLOCK consecutive slots
+ * 
+ * STI is held as int16 and LTI and VLTI as int8, in units of the scales
+ * of struct av_scales. Everything after the cell is versioned, so a
+ * snapshot keeps one old block per first write rather than one entry per
+ * slot. Slots without a value hold zeros.
+ */
+struct av_block {
+    struct snap_cell cell;
+    uint32_t live;         /**< Bit per slot in the AV_LIVE state */
+    uint32_t paged;        /**< Bit per slot in the AV_PAGED state */
+    int16_t sti[AV_BLOCK];
+    int8_t lti[AV_BLOCK];
+    int8_t vlti[AV_BLOCK];
+};
+
+/**
+ * Value of one unit of each compact attention component
+ * 
+ * Versioned like the blocks, so a snapshot decodes with the scales of its
+ * own epoch. A scale only ever grows by av_grow(), which requantizes the
+ * table, or shrinks by uniform STI decay, which touches no block.
+ */
+struct av_scales {
+    struct snap_cell cell;
+    float sti;
+    float lti;
+    float vlti;
+};
+
+/**
+ * Components of a compact attention value
+ */
+enum av_component {
+    AV_STI,
+    AV_LTI,
+    AV_VLTI
+};
+
+/**
+ * Forgetting defaults
+ */
+#define FORGET_HIGH_WATERMARK 0.95f
+#define FORGET_LOW_WATERMARK 0.85f
+#define FORGET_SCAN_BATCH 1024
+
+/**
+ * Atoms sampled to estimate the eviction threshold
+ */
+#define FORGET_SAMPLE_SIZE 256
+
+/**
+ * State of the incremental forgetting pass
+ */
+struct forget_pass {
+    int active;            /**< A pass is in progress */
+    size_t target;         /**< Atom count at which the pass ends */
+    size_t cursor;         /**< Next atom slot to examine */
+    size_t swept;          /**< Slots examined since the last threshold estimate */
+    float threshold;       /**< LTI at or below which atoms are evicted */
+    uint64_t forgotten;    /**< Atoms evicted since init */
+    uint64_t passes;       /**< Passes started since init */
+    uint64_t rng;          /**< xorshift state for sampling */
 };
 
 /**
  * ECAN scheduler state
+ * 
+ * Attention values are indexed by atom slot, so lookups are O(1) and the
+ * entry of a removed atom is recognised by its stale handle.
  */
-static struct {
-    struct av_entry avs[MAX_AVS];
-    size_t av_count;
+struct ecan_state {
+    struct av_entry *avs;
+    size_t av_capacity;
+    struct av_block *blocks;   /**< Compact table, used instead of avs */
+    size_t block_capacity;
+    struct av_scales scales;
+    int compact;
+    void *pending;             /**< Table of the other layout being switched to */
+    size_t pending_capacity;
+    int switching;             /**< ecan_compact_reserve() asked for a switch */
+    size_t av_slots;       /**< One past the highest slot ever used */
+    size_t av_count;       /**< Active entries */
     uint32_t tick_interval_us;
     uint64_t tick_count;
+    struct ecan_forget_params forget_params;
+    struct forget_pass forget;
     int initialized;
-} g_ecan = {0};
+};
+
+/**
+ * ECAN scheduler state of the default context
+ */
+struct ecan_state ecan_default = {0};
+
+/**
+ * ECAN scheduler state of the calling thread's context
+ */
+#define g_ecan (*cogkern_ctx_current()->ecan)
+
+/**
+ * Allocate ECAN scheduler state for a new context
+ */
+struct ecan_state *ecan_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct ecan_state));
+}
+
+/**
+ * State of a slot in a compact block
+ */
+static inline int av_block_state(const struct av_block *b, uint32_t lane) {
+    if ((b->live >> lane) & 1) {
+        return AV_LIVE;
+    }
+    return ((b->paged >> lane) & 1) ? AV_PAGED : AV_NONE;
+}
+
+/**
+ * State of the attention value entry of a slot, in either layout
+ */
+static int av_state(uint32_t slot) {
+    if (slot >= g_ecan.av_slots) {
+        return AV_NONE;
+    }
+    if (g_ecan.compact) {
+        return av_block_state(&g_ecan.blocks[slot / AV_BLOCK], slot % AV_BLOCK);
+    }
+    return g_ecan.avs[slot].active;
+}
+
+/**
+ * Decode a compact slot
+ */
+static inline void av_decode(const struct av_block *b, uint32_t lane,
+                             const struct av_scales *scales, struct attention_value *av) {
+    av->sti = (float)b->sti[lane] * scales->sti;
+    av->lti = (float)b->lti[lane] * scales->lti;
+    av->vlti = (float)b->vlti[lane] * scales->vlti;
+}
+
+/**
+ * Nearest whole number of units of a value, saturated to +-max
+ */
+static int32_t av_units(float v, float scale, int32_t max) {
+    float q = v / scale;
+    
+    if (q != q) {
+        return 0; /* NaN, or zero at a zero scale */
+    }
+    if (q >= (float)max) {
+        return max;
+    }
+    if (q <= (float)-max) {
+        return -max;
+    }
+    return (int32_t)roundf(q);
+}
+
+/**
+ * Whether a finite value needs a larger scale to be stored
+ */
+static inline int av_too_large(float v, float scale, int32_t max) {
+    return v != 0.0f && isfinite(v) && !(fabsf(v) / scale < (float)max + 0.5f);
+}
+
+/**
+ * Grow the scale of one component so that v fits
+ * 
+ * Every stored value of the component is requantized with the vector
+ * kernels, and v lands at half the range, so values creeping upwards do
+ * not requantize the table on each store. Must be called inside a write
+ * section.
+ */
+static void av_grow(enum av_component c, float v, int versioned) {
+    const struct cog_kernels *kern = cpu_kernels();
+    struct av_scales next = g_ecan.scales;
+    float *scale = c == AV_STI ? &next.sti : (c == AV_LTI ? &next.lti : &next.vlti);
+    float grown = fabsf(v) * 2.0f / (float)(c == AV_STI ? AV_STI_MAX : AV_LTI_MAX);
+    float factor = *scale / grown;
+    size_t blocks = (g_ecan.av_slots + AV_BLOCK - 1) / AV_BLOCK;
+    
+    for (size_t i = 0; i < blocks; i++) {
+        struct av_block *b = &g_ecan.blocks[i];
+        struct av_block copy;
+        struct av_block *w = b;
+        
+        if (!(b->live | b->paged)) {
+            continue;
+        }
+        if (versioned) {
+            copy = *b;
+            w = &copy;
+        }
+        if (c == AV_STI) {
+            kern->requant_i16(w->sti, AV_BLOCK, factor);
+        } else {
+            kern->requant_i8(c == AV_LTI ? w->lti : w->vlti, AV_BLOCK, factor);
+        }
+        if (versioned) {
+            snap_cell_store(&b->cell, &copy.cell, sizeof(copy));
+        }
+    }
+    
+    *scale = grown;
+    snap_cell_store(&g_ecan.scales.cell, &next.cell, sizeof(next));
+}
+
+/**
+ * Write the state and, if av is given, the value of a compact slot
+ * 
+ * Must be called inside a write section; versioned is what opening it
+ * returned.
+ */
+static void av_block_put(uint32_t slot, int state, const struct attention_value *av,
+                         int versioned) {
+    if (av && av_too_large(av->sti, g_ecan.scales.sti, AV_STI_MAX)) {
+        av_grow(AV_STI, av->sti, versioned);
+    }
+    if (av && av_too_large(av->lti, g_ecan.scales.lti, AV_LTI_MAX)) {
+        av_grow(AV_LTI, av->lti, versioned);
+    }
+    if (av && av_too_large(av->vlti, g_ecan.scales.vlti, AV_LTI_MAX)) {
+        av_grow(AV_VLTI, av->vlti, versioned);
+    }
+    
+    struct av_block *b = &g_ecan.blocks[slot / AV_BLOCK];
+    struct av_block copy;
+    struct av_block *w = b;
+    uint32_t lane = slot % AV_BLOCK;
+    uint32_t bit = (uint32_t)1 << lane;
+    
+    if (versioned) {
+        copy = *b;
+        w = &copy;
+    }
+    w->live = state == AV_LIVE ? w->live | bit : w->live & ~bit;
+    w->paged = state == AV_PAGED ? w->paged | bit : w->paged & ~bit;
+    if (av) {
+        w->sti[lane] = (int16_t)av_units(av->sti, g_ecan.scales.sti, AV_STI_MAX);
+        w->lti[lane] = (int8_t)av_units(av->lti, g_ecan.scales.lti, AV_LTI_MAX);
+        w->vlti[lane] = (int8_t)av_units(av->vlti, g_ecan.scales.vlti, AV_LTI_MAX);
+    } else if (state == AV_NONE) {
+        w->sti[lane] = 0;
+        w->lti[lane] = 0;
+        w->vlti[lane] = 0;
+    }
+    if (versioned) {
+        snap_cell_store(&b->cell, &copy.cell, sizeof(copy));
+    }
+}
+
+/**
+ * Make room for the attention values of the first slots atom slots
+ * 
+ * Must be called inside a write section.
+ */
+static int av_reserve(size_t slots) {
+    if (g_ecan.compact) {
+        size_t blocks = (slots + AV_BLOCK - 1) / AV_BLOCK;
+        if (blocks <= g_ecan.block_capacity) {
+            return 0;
+        }
+        return snap_table_reserve((void **)&g_ecan.blocks, &g_ecan.block_capacity,
+                                  sizeof(struct av_block), blocks);
+    }
+    
+    if (slots <= g_ecan.av_capacity) {
+        return 0;
+    }
+    return snap_table_reserve((void **)&g_ecan.avs, &g_ecan.av_capacity,
+                              sizeof(struct av_entry), slots);
+}
 
 /**
  * Initialize the ECAN scheduler
@@ -48,12 +336,216 @@ int dtesn_sched_init(uint32_t tick_interval_us) {
     
     g_ecan.tick_interval_us = tick_interval_us;
     g_ecan.tick_count = 0;
-    g_ecan.av_count = 0;
+    
+    g_ecan.forget_params.enabled = 1;
+    g_ecan.forget_params.capacity = 0;
+    g_ecan.forget_params.high_watermark = FORGET_HIGH_WATERMARK;
+    g_ecan.forget_params.low_watermark = FORGET_LOW_WATERMARK;
+    g_ecan.forget_params.scan_batch = FORGET_SCAN_BATCH;
+    memset(&g_ecan.forget, 0, sizeof(g_ecan.forget));
+    g_ecan.forget.rng = 0x9E3779B97F4A7C15ULL;
+    
     g_ecan.initialized = 1;
     
     return 0;
 }
 
+/**
+ * Next pseudo-random number for threshold sampling (xorshift64)
+ */
+static inline uint64_t forget_rand(void) {
+    uint64_t x = g_ecan.forget.rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    g_ecan.forget.rng = x;
+    return x;
+}
+
+/**
+ * Forgetting key of an atom slot
+ * 
+ * @return 0 if the atom may be forgotten (key in *lti), negative if it is
+ *         free or protected by a non-zero VLTI
+ */
+static int forget_key(uint32_t slot, float *lti) {
+    atom_handle_t atom = atomspace_handle_at(slot);
+    if (!atom || atomspace_is_cold(slot)) {
+        return -1; /* Cold atoms already hold no memory */
+    }
+    
+    struct attention_value av;
+    if (ecan_peek_av(slot, &av) == 0 && (g_ecan.compact || g_ecan.avs[slot].atom == atom)) {
+        if (av.vlti > 0.0f) {
+            return -1;
+        }
+        *lti = av.lti;
+    } else {
+        *lti = 0.0f; /* Atoms that never received attention go first */
+    }
+    
+    return 0;
+}
+
+/**
+ * k-th smallest value of an array (quickselect, reorders the array)
+ */
+static float select_kth(float *v, size_t n, size_t k) {
+    size_t lo = 0, hi = n - 1;
+    
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        float pivot = v[mid];
+        v[mid] = v[hi];
+        v[hi] = pivot;
+        
+        size_t store = lo;
+        for (size_t i = lo; i < hi; i++) {
+            if (v[i] < pivot) {
+                float t = v[i];
+                v[i] = v[store];
+                v[store++] = t;
+            }
+        }
+        v[hi] = v[store];
+        v[store] = pivot;
+        
+        if (k == store) {
+            break;
+        } else if (k < store) {
+            hi = store - 1;
+        } else {
+            lo = store + 1;
+        }
+    }
+    
+    return v[k];
+}
+
+/**
+ * Estimate the LTI below which atoms must go to reach the pass target
+ * 
+ * Samples random slots instead of sorting the whole attention table.
+ * 
+ * @return 0 on success, negative if no forgettable atom was sampled
+ */
+static int forget_estimate_threshold(void) {
+    float keys[FORGET_SAMPLE_SIZE];
+    size_t slots = atomspace_slots();
+    size_t live = 0, n = 0;
+    
+    for (size_t i = 0; i < FORGET_SAMPLE_SIZE; i++) {
+        uint32_t slot = (uint32_t)(forget_rand() % slots);
+        float lti;
+        
+        if (atomspace_handle_at(slot)) {
+            live++;
+        }
+        if (forget_key(slot, &lti) == 0) {
+            keys[n++] = lti;
+        }
+    }
+    
+    if (n == 0) {
+        return -1;
+    }
+    
+    /* Fraction of live atoms to drop, rescaled to the forgettable ones */
+    size_t count = atomspace_count();
+    double fraction = (double)(count - g_ecan.forget.target) / (double)count;
+    double quantile = fraction * (double)live / (double)n;
+    if (quantile > 1.0) {
+        quantile = 1.0;
+    }
+    
+    size_t k = (size_t)(quantile * (double)n + 0.5);
+    g_ecan.forget.threshold = select_kth(keys, n, k > 0 ? k - 1 : 0);
+    g_ecan.forget.swept = 0;
+    
+    return 0;
+}
+
+/**
+ * Current memory pressure: max of atom count over capacity and budget use
+ */
+static float forget_pressure(void) {
+    float pressure = dtesn_mem_pressure();
+    
+    if (g_ecan.forget_params.capacity > 0) {
+        float fill = (float)atomspace_count() / (float)g_ecan.forget_params.capacity;
+        if (fill > pressure) {
+            pressure = fill;
+        }
+    }
+    
+    return pressure;
+}
+
+/**
+ * Run one increment of the forgetting pass
+ * 
+ * A pass starts when pressure crosses the high watermark and evicts the
+ * lowest-LTI atoms (with their links, edges and truth values) until the
+ * atom count implied by the low watermark is reached. Each call examines
+ * at most scan_batch slots so no tick pays for the whole sweep.
+ * 
+ * @return Number of atoms evicted
+ */
+static int forget_step(void) {
+    struct forget_pass *f = &g_ecan.forget;
+    const struct ecan_forget_params *p = &g_ecan.forget_params;
+    
+    if (!p->enabled || atomspace_count() == 0) {
+        f->active = 0;
+        return 0;
+    }
+    
+    if (!f->active) {
+        float pressure = forget_pressure();
+        if (pressure < p->high_watermark) {
+            return 0;
+        }
+        
+        f->target = (size_t)((double)atomspace_count() * p->low_watermark / pressure);
+        if (forget_estimate_threshold() != 0) {
+            return 0; /* Everything left is protected */
+        }
+        f->active = 1;
+        f->passes++;
+        dtesn_mem_pressure_clear();
+    }
+    
+    size_t before = atomspace_count();
+    size_t slots = atomspace_slots();
+    
+    for (uint32_t n = 0; n < p->scan_batch && atomspace_count() > f->target; n++) {
+        if (f->cursor >= slots) {
+            f->cursor = 0;
+        }
+        
+        uint32_t slot = (uint32_t)f->cursor++;
+        float lti;
+        
+        if (forget_key(slot, &lti) == 0 && lti <= f->threshold) {
+            cog_atom_remove(atomspace_handle_at(slot));
+        }
+        
+        /* A full sweep fell short: raise the threshold from a new sample */
+        if (++f->swept >= slots && forget_estimate_threshold() != 0) {
+            f->active = 0;
+            break;
+        }
+    }
+    
+    if (atomspace_count() <= f->target) {
+        f->active = 0;
+    }
+    
+    size_t evicted = before - atomspace_count();
+    f->forgotten += evicted;
+    return (int)evicted;
+}
+
 /**
  * Execute one scheduler tick
  * 
@@ -67,27 +559,99 @@ int dtesn_sched_tick(void) {
     }
     
     g_ecan.tick_count++;
-    
-    /* In a real implementation:
-     * - Update attention values using GGML tensor operations
-     * - Apply importance diffusion across hypergraph
-     * - Schedule cognitive tasks based on attention
-     * - Perform forgetting (decrease STI/LTI over time)
-     */
-    
-    int tasks_processed = 0;
+    uint64_t t0 = trace_clock_ns();
+    COG_TRACE_BEGIN(span);
     
     /* Stub: Decay all STI values slightly */
-    for (size_t i = 0; i < g_ecan.av_count; i++) {
-        if (g_ecan.avs[i].active) {
-            g_ecan.avs[i].av.sti *= 0.999f;
-            tasks_processed++;
+    int versioned = snap_write_begin();
+    if (g_ecan.compact) {
+        /* Compact STIs share one scale, so decay touches no block */
+        struct av_scales next = g_ecan.scales;
+        next.sti *= 0.999f;
+        snap_cell_store(&g_ecan.scales.cell, &next.cell, sizeof(next));
+    } else {
+        for (size_t i = 0; i < g_ecan.av_slots; i++) {
+            struct av_entry *e = &g_ecan.avs[i];
+            if (e->active != AV_LIVE) {
+                continue;
+            }
+            if (versioned) {
+                struct av_entry next = *e;
+                next.av.sti *= 0.999f;
+                snap_cell_store(&e->cell, &next.cell, sizeof(next));
+            } else {
+                e->av.sti *= 0.999f;
+            }
         }
     }
+    snap_write_end();
+    
+    /* Cognitive tasks, highest attention first */
+    COG_TRACE_BEGIN(task_span);
+    int tasks_processed = task_dispatch();
+    COG_TRACE_END(task_span, "task_dispatch");
+    if (tasks_processed < 0) {
+        COG_TRACE_END(span, "dtesn_sched_tick");
+        return tasks_processed;
+    }
+    
+    /* Forgetting: evict low-LTI atoms when nearing capacity */
+    COG_TRACE_BEGIN(forget_span);
+    tasks_processed += forget_step();
+    COG_TRACE_END(forget_span, "forget_step");
+    
+    /* Tiering: page out atoms that have gone cold */
+    COG_TRACE_BEGIN(tier_span);
+    tasks_processed += tier_step();
+    COG_TRACE_END(tier_span, "tier_step");
     
+    metrics_record(METRIC_SCHED_TICK_NS, trace_clock_ns() - t0);
+    COG_TRACE_END(span, "dtesn_sched_tick");
     return tasks_processed;
 }
 
+/**
+ * Configure LTI-driven forgetting
+ * 
+ * @param params Forgetting parameters
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_set_forgetting(const struct ecan_forget_params *params) {
+    if (!g_ecan.initialized || !params) {
+        return -1;
+    }
+    
+    if (params->low_watermark <= 0.0f || params->high_watermark > 1.0f ||
+        params->low_watermark >= params->high_watermark || params->scan_batch == 0) {
+        return -1;
+    }
+    
+    g_ecan.forget_params = *params;
+    g_ecan.forget.active = 0;
+    
+    return 0;
+}
+
+/**
+ * Get forgetting statistics
+ * 
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
+ */
+int dtesn_sched_get_forget_stats(struct ecan_forget_stats *stats) {
+    if (!g_ecan.initialized || !stats) {
+        return -1;
+    }
+    
+    stats->atoms_forgotten = g_ecan.forget.forgotten;
+    stats->passes = g_ecan.forget.passes;
+    stats->pass_active = g_ecan.forget.active;
+    stats->threshold = g_ecan.forget.threshold;
+    stats->pressure = forget_pressure();
+    
+    return 0;
+}
+
 /**
  * Set attention value for an atom
  * 
@@ -100,25 +664,90 @@ int dtesn_sched_set_av(atom_handle_t atom, const struct attention_value *av) {
         return -1;
     }
     
-    /* Find existing entry or create new one */
-    for (size_t i = 0; i < g_ecan.av_count; i++) {
-        if (g_ecan.avs[i].active && g_ecan.avs[i].atom == atom) {
-            g_ecan.avs[i].av = *av;
-            return 0;
-        }
+    uint32_t slot;
+    if (atomspace_resolve(atom, &slot) != 0) {
+        return -1;
     }
     
-    /* Create new entry */
-    if (g_ecan.av_count >= MAX_AVS) {
+    return ecan_restore_av(slot, atom, av);
+}
+
+/**
+ * Store an attention value into a reserved slot
+ * 
+ * Must be called inside a write section; versioned is what opening it
+ * returned. The caller publishes the slot count.
+ */
+static void av_store(uint32_t slot, atom_handle_t atom, const struct attention_value *av,
+                     int versioned) {
+    if (av_state(slot) != AV_LIVE) {
+        g_ecan.av_count++;
+    }
+    if (g_ecan.compact) {
+        av_block_put(slot, AV_LIVE, av, versioned);
+    } else if (versioned) {
+        struct av_entry *e = &g_ecan.avs[slot];
+        struct av_entry next = *e;
+        next.atom = atom;
+        next.av = *av;
+        next.active = AV_LIVE;
+        snap_cell_store(&e->cell, &next.cell, sizeof(next));
+    } else {
+        struct av_entry *e = &g_ecan.avs[slot];
+        e->atom = atom;
+        e->av = *av;
+        e->active = AV_LIVE;
+    }
+}
+
+/**
+ * Set attention values for a batch of atoms
+ * 
+ * Handles are resolved a chunk at a time and the table is grown once per
+ * chunk, so each value costs one store inside the open write section.
+ * 
+ * @param atoms Array of atom handles
+ * @param avs Array of attention values, one per atom
+ * @param count Number of atoms
+ * @return Number of attention values stored (stale handles are skipped),
+ *         negative on error
+ */
+int dtesn_sched_set_av_batch(const atom_handle_t *atoms, const struct attention_value *avs,
+                             size_t count) {
+    if ((!atoms || !avs) && count > 0) {
         return -1;
     }
     
-    size_t idx = g_ecan.av_count++;
-    g_ecan.avs[idx].atom = atom;
-    g_ecan.avs[idx].av = *av;
-    g_ecan.avs[idx].active = 1;
+    uint32_t slots[AV_BATCH_CHUNK];
+    int stored = 0;
+    int versioned = snap_write_begin();
+    for (size_t i = 0; i < count; i += AV_BATCH_CHUNK) {
+        size_t n = count - i < AV_BATCH_CHUNK ? count - i : AV_BATCH_CHUNK;
+        size_t end = atomspace_resolve_batch(&atoms[i], n, slots);
+        
+        if (av_reserve(end) != 0) {
+            /* Out of room: store what fits one value at a time */
+            for (size_t j = 0; j < n; j++) {
+                if (slots[j] != UINT32_MAX &&
+                    ecan_restore_av(slots[j], atoms[i + j], &avs[i + j]) == 0) {
+                    stored++;
+                }
+            }
+            continue;
+        }
+        if (end > g_ecan.av_slots) {
+            __atomic_store_n(&g_ecan.av_slots, end, __ATOMIC_RELEASE);
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (slots[j] != UINT32_MAX) {
+                av_store(slots[j], atoms[i + j], &avs[i + j], versioned);
+                stored++;
+            }
+        }
+    }
+    snap_write_end();
     
-    return 0;
+    return stored;
 }
 
 /**
@@ -133,14 +762,80 @@ int dtesn_sched_get_av(atom_handle_t atom, struct attention_value *av) {
         return -1;
     }
     
-    for (size_t i = 0; i < g_ecan.av_count; i++) {
-        if (g_ecan.avs[i].active && g_ecan.avs[i].atom == atom) {
-            *av = g_ecan.avs[i].av;
-            return 0;
+    uint32_t slot;
+    uint64_t epoch;
+    if (snap_pinned(&epoch)) {
+        if (atomspace_snapshot_lookup(atom, epoch, &slot) != 0) {
+            return -1;
         }
+        return ecan_snapshot_av(slot, atom, epoch, av);
+    }
+    
+    if (atomspace_resolve(atom, &slot) != 0) {
+        return -1;
     }
     
-    return -1; /* Not found */
+    return ecan_peek_av(slot, av);
+}
+
+/**
+ * Move part of an atom's STI to its neighbours
+ */
+static int spread_importance(atom_handle_t source, float diffusion_rate) {
+    if (diffusion_rate < 0.0f || diffusion_rate > 1.0f) {
+        return -1;
+    }
+    
+    uint32_t slot;
+    struct attention_value src;
+    if (atomspace_resolve(source, &slot) != 0) {
+        return -1;
+    }
+    if (ecan_peek_av(slot, &src) != 0 || src.sti <= 0.0f) {
+        return 0; /* Nothing to spread */
+    }
+    
+    /* Collect neighbours first: faulting them in may grow the tables */
+    atom_handle_t local[64];
+    atom_handle_t *neighbors = local;
+    size_t degree = atomspace_neighbors(slot, local, 64);
+    if (degree == 0) {
+        return 0;
+    }
+    if (degree > 64) {
+        neighbors = malloc(degree * sizeof(atom_handle_t));
+        if (!neighbors) {
+            return -1;
+        }
+        atomspace_neighbors(slot, neighbors, degree);
+    }
+    
+    float share = src.sti * diffusion_rate / (float)degree;
+    int affected = 0;
+    
+    for (size_t i = 0; i < degree; i++) {
+        struct attention_value av;
+        
+        if (neighbors[i] == source) {
+            continue; /* Self-loop */
+        }
+        if (dtesn_sched_get_av(neighbors[i], &av) != 0) {
+            memset(&av, 0, sizeof(av));
+        }
+        av.sti += share;
+        if (dtesn_sched_set_av(neighbors[i], &av) == 0) {
+            affected++;
+        }
+    }
+    
+    if (neighbors != local) {
+        free(neighbors);
+    }
+    
+    src.sti -= share * (float)affected;
+    dtesn_sched_set_av(source, &src);
+    
+    return affected;
 }
 
 /**
@@ -151,16 +846,485 @@ int dtesn_sched_get_av(atom_handle_t atom, struct attention_value *av) {
  * @return Number of atoms affected
  */
 int dtesn_sched_spread_importance(atom_handle_t source, float diffusion_rate) {
-    /* In a real implementation:
-     * - Use GGML tensor operations to propagate STI through hypergraph
-     * - Apply diffusion_rate to control spread intensity
-     * - Use attention values as weights in graph traversal
-     */
+    COG_TRACE_BEGIN(span);
+    int affected = spread_importance(source, diffusion_rate);
+    COG_TRACE_END(span, "spread_importance");
     
-    if (diffusion_rate < 0.0f || diffusion_rate > 1.0f) {
+    return affected;
+}
+
+/**
+ * Set the state of an attention value entry
+ */
+static void av_set_state(uint32_t slot, int state) {
+    if (av_state(slot) == AV_LIVE) {
+        g_ecan.av_count--;
+    }
+    
+    int versioned = snap_write_begin();
+    if (g_ecan.compact) {
+        av_block_put(slot, state, NULL, versioned);
+    } else {
+        struct av_entry *e = &g_ecan.avs[slot];
+        struct av_entry next = *e;
+        next.active = state;
+        snap_cell_store(&e->cell, &next.cell, sizeof(next));
+    }
+    snap_write_end();
+}
+
+/**
+ * Drop the attention value stored for an atom slot
+ */
+void ecan_forget_atom(uint32_t slot) {
+    if (av_state(slot) != AV_NONE) {
+        av_set_state(slot, AV_NONE);
+    }
+}
+
+/**
+ * Copy the attention value stored for an atom slot
+ */
+int ecan_peek_av(uint32_t slot, struct attention_value *av) {
+    if (av_state(slot) != AV_LIVE) {
+        return -1;
+    }
+    
+    if (g_ecan.compact) {
+        av_decode(&g_ecan.blocks[slot / AV_BLOCK], slot % AV_BLOCK, &g_ecan.scales, av);
+    } else {
+        *av = g_ecan.avs[slot].av;
+    }
+    return 0;
+}
+
+/**
+ * Remove and return the attention value stored for an atom slot
+ */
+int ecan_take_av(uint32_t slot, struct attention_value *av) {
+    if (ecan_peek_av(slot, av) != 0) {
+        return -1;
+    }
+    
+    av_set_state(slot, AV_PAGED);
+    return 0;
+}
+
+/**
+ * Store an attention value for an atom slot without resolving the handle
+ */
+int ecan_restore_av(uint32_t slot, atom_handle_t atom, const struct attention_value *av) {
+    int versioned = snap_write_begin();
+    if (av_reserve((size_t)slot + 1) != 0) {
+        snap_write_end();
+        dtesn_mem_pressure_raise();
+        return -1;
+    }
+    
+    av_store(slot, atom, av, versioned);
+    
+    if (slot >= g_ecan.av_slots) {
+        __atomic_store_n(&g_ecan.av_slots, (size_t)slot + 1, __ATOMIC_RELEASE);
+    }
+    snap_write_end();
+    
+    return 0;
+}
+
+/**
+ * Copy the attention value a compact slot had at a snapshot epoch
+ */
+static int av_snapshot_compact(uint32_t slot, uint64_t epoch, struct attention_value *av) {
+    const struct av_block *blocks = __atomic_load_n(&g_ecan.blocks, __ATOMIC_ACQUIRE);
+    struct av_block b;
+    struct av_scales scales;
+    
+    /* Handles were checked at the epoch, and reorders exclude snapshots */
+    if (snap_cell_load(&blocks[slot / AV_BLOCK].cell, &b.cell, sizeof(b), epoch) != 0 ||
+        av_block_state(&b, slot % AV_BLOCK) == AV_NONE ||
+        snap_cell_load(&g_ecan.scales.cell, &scales.cell, sizeof(scales), epoch) != 0) {
+        return -1;
+    }
+    
+    av_decode(&b, slot % AV_BLOCK, &scales, av);
+    return 0;
+}
+
+/**
+ * Copy the attention value an atom slot had at a snapshot epoch
+ */
+int ecan_snapshot_av(uint32_t slot, atom_handle_t atom, uint64_t epoch,
+                     struct attention_value *av) {
+    if (slot >= __atomic_load_n(&g_ecan.av_slots, __ATOMIC_ACQUIRE)) {
         return -1;
     }
+    if (__atomic_load_n(&g_ecan.compact, __ATOMIC_RELAXED)) {
+        return av_snapshot_compact(slot, epoch, av);
+    }
     
-    /* Stub implementation */
+    const struct av_entry *avs = __atomic_load_n(&g_ecan.avs, __ATOMIC_ACQUIRE);
+    struct av_entry e;
+    if (snap_cell_load(&avs[slot].cell, &e.cell, sizeof(e), epoch) != 0 ||
+        e.active == AV_NONE || e.atom != atom) {
+        return -1;
+    }
+    
+    *av = e.av;
     return 0;
 }
+
+/**
+ * Free old attention value versions no epoch at or after keep can reach
+ */
+void ecan_snapshot_trim(uint64_t keep) {
+    if (g_ecan.compact) {
+        size_t blocks = (g_ecan.av_slots + AV_BLOCK - 1) / AV_BLOCK;
+        for (size_t i = 0; i < blocks; i++) {
+            snap_cell_trim(&g_ecan.blocks[i].cell, sizeof(struct av_block), keep);
+        }
+    } else {
+        for (size_t i = 0; i < g_ecan.av_slots; i++) {
+            snap_cell_trim(&g_ecan.avs[i].cell, sizeof(struct av_entry), keep);
+        }
+    }
+    snap_cell_trim(&g_ecan.scales.cell, sizeof(struct av_scales), keep);
+}
+
+/**
+ * Make room for an attention value entry per atom slot before a reorder
+ */
+int ecan_reorder_reserve(size_t slots) {
+    return av_reserve(slots);
+}
+
+/**
+ * Exchange one state bit between two slots of compact blocks
+ */
+static inline void av_bit_swap(uint32_t *x, uint32_t lx, uint32_t *y, uint32_t ly) {
+    uint32_t bx = (*x >> lx) & 1;
+    uint32_t by = (*y >> ly) & 1;
+    
+    *x = (*x & ~((uint32_t)1 << lx)) | by << lx;
+    *y = (*y & ~((uint32_t)1 << ly)) | bx << ly;
+}
+
+/**
+ * Exchange the attention values of two compact slots in place
+ */
+static void av_lane_swap(uint32_t a, uint32_t b) {
+    struct av_block *x = &g_ecan.blocks[a / AV_BLOCK];
+    struct av_block *y = &g_ecan.blocks[b / AV_BLOCK];
+    uint32_t lx = a % AV_BLOCK;
+    uint32_t ly = b % AV_BLOCK;
+    int16_t sti = x->sti[lx];
+    int8_t lti = x->lti[lx];
+    int8_t vlti = x->vlti[lx];
+    
+    av_bit_swap(&x->live, lx, &y->live, ly);
+    av_bit_swap(&x->paged, lx, &y->paged, ly);
+    x->sti[lx] = y->sti[ly];
+    x->lti[lx] = y->lti[ly];
+    x->vlti[lx] = y->vlti[ly];
+    y->sti[ly] = sti;
+    y->lti[ly] = lti;
+    y->vlti[ly] = vlti;
+}
+
+/**
+ * Move attention values along with their atoms to new slots
+ */
+void ecan_reorder(const uint32_t *dest, size_t slots, uint64_t *done) {
+    if (g_ecan.compact) {
+        /* The cycles of cogkern_table_permute(), slot by slot */
+        memset(done, 0, (slots + 63) / 64 * sizeof(uint64_t));
+        for (size_t i = 0; i < slots; i++) {
+            if (done[i / 64] & ((uint64_t)1 << (i % 64))) {
+                continue;
+            }
+            for (size_t j = dest[i]; j != i; j = dest[j]) {
+                av_lane_swap((uint32_t)i, (uint32_t)j);
+                done[j / 64] |= (uint64_t)1 << (j % 64);
+            }
+        }
+    } else {
+        cogkern_table_permute(g_ecan.avs, sizeof(struct av_entry), slots, dest, done);
+    }
+    if (slots > g_ecan.av_slots) {
+        __atomic_store_n(&g_ecan.av_slots, slots, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Whether (sti_a, a) ranks below (sti_b, b) in the attentional focus
+ */
+static inline int focus_below(float sti_a, atom_handle_t a, float sti_b, atom_handle_t b) {
+    return sti_a < sti_b || (sti_a == sti_b && COG_HANDLE_SLOT(a) > COG_HANDLE_SLOT(b));
+}
+
+/**
+ * Restore the min-heap property below position i
+ */
+static void focus_sift_down(atom_handle_t *atoms, float *sti, size_t n, size_t i) {
+    for (;;) {
+        size_t low = i, l = 2 * i + 1, r = l + 1;
+        
+        if (l < n && focus_below(sti[l], atoms[l], sti[low], atoms[low])) {
+            low = l;
+        }
+        if (r < n && focus_below(sti[r], atoms[r], sti[low], atoms[low])) {
+            low = r;
+        }
+        if (low == i) {
+            return;
+        }
+        
+        atom_handle_t ta = atoms[i];
+        float ts = sti[i];
+        atoms[i] = atoms[low];
+        sti[i] = sti[low];
+        atoms[low] = ta;
+        sti[low] = ts;
+        i = low;
+    }
+}
+
+/**
+ * Offer an atom to the k-entry min-heap of the focus holding *n entries
+ */
+static void focus_offer(atom_handle_t *atoms, float *sti, size_t *n, size_t k,
+                        atom_handle_t atom, float value) {
+    if (*n < k) {
+        /* Sift the new entry up */
+        size_t j = (*n)++;
+        while (j > 0) {
+            size_t parent = (j - 1) / 2;
+            if (!focus_below(value, atom, sti[parent], atoms[parent])) {
+                break;
+            }
+            atoms[j] = atoms[parent];
+            sti[j] = sti[parent];
+            j = parent;
+        }
+        atoms[j] = atom;
+        sti[j] = value;
+    } else if (focus_below(sti[0], atoms[0], value, atom)) {
+        atoms[0] = atom;
+        sti[0] = value;
+        focus_sift_down(atoms, sti, *n, 0);
+    }
+}
+
+/**
+ * Fill the focus heap from the compact table
+ * 
+ * Once the heap is full, a block whose largest STI is below the heap
+ * minimum is skipped after one vector reduction over its packed values.
+ * The scale is positive, so comparing decoded values ranks like the units.
+ */
+static size_t focus_scan_compact(size_t k, atom_handle_t *atoms, float *sti) {
+    const struct cog_kernels *kern = cpu_kernels();
+    size_t blocks = (g_ecan.av_slots + AV_BLOCK - 1) / AV_BLOCK;
+    float scale = g_ecan.scales.sti;
+    size_t n = 0;
+    
+    for (size_t i = 0; i < blocks; i++) {
+        const struct av_block *b = &g_ecan.blocks[i];
+        if (!b->live) {
+            continue;
+        }
+        if (n == k && (float)kern->max_i16(b->sti, AV_BLOCK) * scale < sti[0]) {
+            continue;
+        }
+        
+        for (uint32_t live = b->live; live; live &= live - 1) {
+            uint32_t lane = (uint32_t)__builtin_ctz(live);
+            uint32_t slot = (uint32_t)i * AV_BLOCK + lane;
+            focus_offer(atoms, sti, &n, k, atomspace_handle_at(slot),
+                        (float)b->sti[lane] * scale);
+        }
+    }
+    
+    return n;
+}
+
+/**
+ * Select the atoms with the highest STI
+ * 
+ * Keeps a k-entry min-heap over the attention table, then heap-sorts it.
+ */
+size_t ecan_top_sti(size_t k, atom_handle_t *atoms, float *sti) {
+    size_t n = 0;
+    
+    if (k == 0) {
+        return 0;
+    }
+    
+    if (g_ecan.compact) {
+        n = focus_scan_compact(k, atoms, sti);
+    } else {
+        for (size_t i = 0; i < g_ecan.av_slots; i++) {
+            const struct av_entry *e = &g_ecan.avs[i];
+            if (e->active == AV_LIVE) {
+                focus_offer(atoms, sti, &n, k, e->atom, e->av.sti);
+            }
+        }
+    }
+    
+    /* Move the lowest entry to the back until the array is best-first */
+    for (size_t end = n; end > 1; end--) {
+        atom_handle_t ta = atoms[0];
+        float ts = sti[0];
+        atoms[0] = atoms[end - 1];
+        sti[0] = sti[end - 1];
+        atoms[end - 1] = ta;
+        sti[end - 1] = ts;
+        focus_sift_down(atoms, sti, end - 1, 0);
+    }
+    
+    return n;
+}
+
+/**
+ * Fill a compact table from the float one, sizing the scales to the
+ * largest magnitudes held
+ */
+static void av_pack(struct av_block *blocks) {
+    struct av_scales next = g_ecan.scales;
+    float peak[3] = {0.0f, 0.0f, 0.0f};
+    
+    for (size_t i = 0; i < g_ecan.av_slots; i++) {
+        const struct av_entry *e = &g_ecan.avs[i];
+        if (e->active == AV_NONE) {
+            continue;
+        }
+        peak[0] = fmaxf(peak[0], isfinite(e->av.sti) ? fabsf(e->av.sti) : 0.0f);
+        peak[1] = fmaxf(peak[1], isfinite(e->av.lti) ? fabsf(e->av.lti) : 0.0f);
+        peak[2] = fmaxf(peak[2], isfinite(e->av.vlti) ? fabsf(e->av.vlti) : 0.0f);
+    }
+    next.sti = peak[0] * 2.0f / AV_STI_MAX;
+    next.lti = peak[1] * 2.0f / AV_LTI_MAX;
+    next.vlti = peak[2] * 2.0f / AV_LTI_MAX;
+    
+    for (size_t i = 0; i < g_ecan.av_slots; i++) {
+        const struct av_entry *e = &g_ecan.avs[i];
+        struct av_block *b = &blocks[i / AV_BLOCK];
+        uint32_t lane = (uint32_t)(i % AV_BLOCK);
+        
+        if (e->active == AV_NONE) {
+            continue;
+        }
+        if (e->active == AV_LIVE) {
+            b->live |= (uint32_t)1 << lane;
+        } else {
+            b->paged |= (uint32_t)1 << lane;
+        }
+        b->sti[lane] = (int16_t)av_units(e->av.sti, next.sti, AV_STI_MAX);
+        b->lti[lane] = (int8_t)av_units(e->av.lti, next.lti, AV_LTI_MAX);
+        b->vlti[lane] = (int8_t)av_units(e->av.vlti, next.vlti, AV_LTI_MAX);
+    }
+    
+    snap_cell_store(&g_ecan.scales.cell, &next.cell, sizeof(next));
+}
+
+/**
+ * Fill a float table from the compact one
+ */
+static void av_unpack(struct av_entry *avs) {
+    for (size_t i = 0; i < g_ecan.av_slots; i++) {
+        const struct av_block *b = &g_ecan.blocks[i / AV_BLOCK];
+        uint32_t lane = (uint32_t)(i % AV_BLOCK);
+        int state = av_block_state(b, lane);
+        
+        if (state != AV_NONE) {
+            avs[i].atom = atomspace_handle_at((uint32_t)i);
+            avs[i].active = state;
+            av_decode(b, lane, &g_ecan.scales, &avs[i].av);
+        }
+    }
+}
+
+/**
+ * Allocate the attention value table of a storage layout
+ */
+int ecan_compact_reserve(int compact) {
+    g_ecan.switching = (compact != 0) != g_ecan.compact;
+    if (!g_ecan.switching) {
+        return 0;
+    }
+    
+    if (compact) {
+        return cogkern_table_reserve(&g_ecan.pending, &g_ecan.pending_capacity,
+                                     sizeof(struct av_block),
+                                     (g_ecan.av_slots + AV_BLOCK - 1) / AV_BLOCK);
+    }
+    return cogkern_table_reserve(&g_ecan.pending, &g_ecan.pending_capacity,
+                                 sizeof(struct av_entry), g_ecan.av_slots);
+}
+
+/**
+ * Convert the attention values into the table ecan_compact_reserve() made
+ */
+void ecan_compact_apply(int commit) {
+    size_t elem = g_ecan.compact ? sizeof(struct av_entry) : sizeof(struct av_block);
+    
+    if (!g_ecan.switching) {
+        return;
+    }
+    g_ecan.switching = 0;
+    
+    if (commit) {
+        /* No snapshot is pinned, so every old version is unreachable */
+        ecan_snapshot_trim(UINT64_MAX);
+        if (g_ecan.compact) {
+            av_unpack(g_ecan.pending);
+            cogkern_table_free((void **)&g_ecan.blocks, &g_ecan.block_capacity,
+                               sizeof(struct av_block));
+            g_ecan.avs = g_ecan.pending;
+            g_ecan.av_capacity = g_ecan.pending_capacity;
+        } else {
+            av_pack(g_ecan.pending);
+            cogkern_table_free((void **)&g_ecan.avs, &g_ecan.av_capacity,
+                               sizeof(struct av_entry));
+            g_ecan.blocks = g_ecan.pending;
+            g_ecan.block_capacity = g_ecan.pending_capacity;
+        }
+        __atomic_store_n(&g_ecan.compact, !g_ecan.compact, __ATOMIC_RELAXED);
+        g_ecan.pending = NULL;
+        g_ecan.pending_capacity = 0;
+    }
+    
+    cogkern_table_free(&g_ecan.pending, &g_ecan.pending_capacity, elem);
+}
+
+/**
+ * Whether attention values are stored compact
+ */
+int ecan_is_compact(void) {
+    return g_ecan.compact;
+}
+
+/**
+ * Fill the attention value part of cogkern_stats()
+ */
+void ecan_fill_stats(struct cogkern_stats *stats) {
+    stats->attention_values = g_ecan.av_count;
+    stats->av_table_bytes = g_ecan.compact ? g_ecan.block_capacity * sizeof(struct av_block)
+                                           : g_ecan.av_capacity * sizeof(struct av_entry);
+}
+
+/**
+ * Drop all attention values and reset the scheduler
+ */
+void ecan_reset(void) {
+    ecan_snapshot_trim(UINT64_MAX);
+    cogkern_table_free((void **)&g_ecan.avs, &g_ecan.av_capacity, sizeof(struct av_entry));
+    cogkern_table_free((void **)&g_ecan.blocks, &g_ecan.block_capacity,
+                       sizeof(struct av_block));
+    memset(&g_ecan.scales, 0, sizeof(g_ecan.scales));
+    
+    g_ecan.compact = 0;
+    g_ecan.av_slots = 0;
+    g_ecan.av_count = 0;
+    g_ecan.tick_count = 0;
+    g_ecan.initialized = 0;
+}
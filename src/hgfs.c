@@ -0,0 +1,443 @@
+/**
+ * @file hgfs.c
+ * @brief Hypergraph filesystem - Depth-segregated arena allocator
+ *
+ * Implements the allocator behind hgfs_alloc(). Every membrane depth owns
+ * an independent arena built from fixed-size chunks:
+ *
+ * - Small requests (≤ HGFS_MAX_SMALL) are served from size-class slabs.
+ *   Fresh blocks are bump-allocated from the class's current chunk and
+ *   freed blocks are recycled through a per-chunk free list.
+ * - Large requests get a dedicated chunk of their own.
+ * - hgfs_release_depth() drops every chunk of a depth in one pass.
+ *
+ * Chunks are kernel pages (see dtesn_mem.c) aligned to HGFS_CHUNK_SIZE, so
+ * hgfs_free() can locate the owning chunk header by masking the pointer,
+ * without a per-block header. All chunk memory is charged against the
+ * cogkern_init() budget.
+ */
+
+#include "cogkern_internal.h"
+#include <string.h>
+
+/**
+ * Chunk size and alignment (bytes)
+ */
+#define HGFS_CHUNK_SIZE DTESN_MEM_PAGE_SIZE
+
+/**
+ * Bytes reserved at the start of every chunk for its header
+ */
+#define HGFS_CHUNK_HEADER 128
+
+/**
+ * Largest request served from a size-class slab
+ */
+#define HGFS_MAX_SMALL 8192
+
+/**
+ * Number of small size classes
+ */
+#define HGFS_NUM_CLASSES 36
+
+/**
+ * Size class marker for dedicated large chunks
+ */
+#define HGFS_CLASS_LARGE 0xFFFF
+
+/**
+ * Maximum number of empty chunks kept for reuse across depths
+ */
+#define HGFS_CHUNK_CACHE_MAX 64
+
+/**
+ * Chunk header, stored in the first HGFS_CHUNK_HEADER bytes of a chunk
+ */
+struct hgfs_chunk {
+    struct hgfs_chunk *next;      /**< Next chunk on the class partial list */
+    struct hgfs_chunk *prev;      /**< Previous chunk on the class partial list */
+    struct hgfs_chunk *all_next;  /**< Next chunk owned by the same depth */
+    struct hgfs_chunk *all_prev;  /**< Previous chunk owned by the same depth */
+    void *free_list;              /**< Recycled blocks */
+    char *bump;                   /**< Next never-used block */
+    size_t size;                  /**< Total chunk size in bytes */
+    size_t block_size;            /**< Block size (or request size if large) */
+    uint32_t depth;               /**< Owning membrane depth */
+    uint32_t live;                /**< Blocks currently handed out */
+    uint16_t size_class;          /**< Size class or HGFS_CLASS_LARGE */
+    uint16_t in_partial;          /**< Non-zero if on the partial list */
+};
+
+/**
+ * Per-depth state of one size class
+ */
+struct hgfs_class {
+    struct hgfs_chunk *current;   /**< Chunk serving allocations */
+    struct hgfs_chunk *partial;   /**< Other chunks with free blocks */
+};
+
+/**
+ * Arena for one membrane depth
+ */
+struct hgfs_depth {
+    struct hgfs_class classes[HGFS_NUM_CLASSES];
+    struct hgfs_chunk *all;
+    size_t bytes_reserved;
+    size_t bytes_in_use;
+    uint64_t alloc_count;
+    uint64_t free_count;
+};
+
+/**
+ * Block size of each small size class: 16-byte steps up to 256 bytes,
+ * then four classes per power of two up to HGFS_MAX_SMALL
+ */
+static const uint32_t hgfs_class_size[HGFS_NUM_CLASSES] = {
+      16,   32,   48,   64,   80,   96,  112,  128,
+     144,  160,  176,  192,  208,  224,  240,  256,
+     320,  384,  448,  512,  640,  768,  896, 1024,
+    1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096,
+    5120, 6144, 7168, 8192
+};
+
+/**
+ * Allocator state
+ */
+struct hgfs_state {
+    struct hgfs_depth depths[HGFS_MAX_DEPTH];
+    struct hgfs_chunk *chunk_cache;
+    size_t cache_count;
+};
+
+/**
+ * Allocator state of the default context
+ */
+struct hgfs_state hgfs_default = {0};
+
+/**
+ * Allocator state of the calling thread's context
+ */
+#define g_hgfs (*cogkern_ctx_current()->hgfs)
+
+/**
+ * Allocate Allocator state for a new context
+ */
+struct hgfs_state *hgfs_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct hgfs_state));
+}
+
+/**
+ * Map a request size (1..HGFS_MAX_SMALL) to its size class
+ */
+static inline unsigned hgfs_size_class(size_t size) {
+    if (size <= 256) {
+        return (unsigned)((size + 15) >> 4) - 1;
+    }
+
+    unsigned p = 63 - (unsigned)__builtin_clzll((unsigned long long)(size - 1));
+    return 16 + (p - 8) * 4 + (unsigned)((size - 1) >> (p - 2)) - 4;
+}
+
+/**
+ * Obtain chunk memory, preferring the empty-chunk cache
+ */
+static struct hgfs_chunk *hgfs_chunk_acquire(size_t size) {
+    if (size == HGFS_CHUNK_SIZE && g_hgfs.chunk_cache) {
+        struct hgfs_chunk *c = g_hgfs.chunk_cache;
+        g_hgfs.chunk_cache = c->next;
+        g_hgfs.cache_count--;
+        return c;
+    }
+
+    return (struct hgfs_chunk *)cogkern_pages_alloc(size);
+}
+
+/**
+ * Give chunk memory back to the cache or the system
+ */
+static void hgfs_chunk_return(struct hgfs_chunk *c) {
+    if (c->size == HGFS_CHUNK_SIZE && g_hgfs.cache_count < HGFS_CHUNK_CACHE_MAX) {
+        c->next = g_hgfs.chunk_cache;
+        g_hgfs.chunk_cache = c;
+        g_hgfs.cache_count++;
+        return;
+    }
+
+    cogkern_pages_free(c, c->size);
+}
+
+/**
+ * Link a chunk into its depth's list of owned chunks
+ */
+static void hgfs_depth_link(struct hgfs_depth *d, struct hgfs_chunk *c) {
+    c->all_prev = NULL;
+    c->all_next = d->all;
+    if (d->all) {
+        d->all->all_prev = c;
+    }
+    d->all = c;
+    d->bytes_reserved += c->size;
+}
+
+/**
+ * Unlink a chunk from its depth's list of owned chunks
+ */
+static void hgfs_depth_unlink(struct hgfs_depth *d, struct hgfs_chunk *c) {
+    if (c->all_prev) {
+        c->all_prev->all_next = c->all_next;
+    } else {
+        d->all = c->all_next;
+    }
+    if (c->all_next) {
+        c->all_next->all_prev = c->all_prev;
+    }
+    d->bytes_reserved -= c->size;
+}
+
+/**
+ * Remove a chunk from its size class partial list
+ */
+static void hgfs_partial_unlink(struct hgfs_class *k, struct hgfs_chunk *c) {
+    if (c->prev) {
+        c->prev->next = c->next;
+    } else {
+        k->partial = c->next;
+    }
+    if (c->next) {
+        c->next->prev = c->prev;
+    }
+    c->next = c->prev = NULL;
+    c->in_partial = 0;
+}
+
+/**
+ * Allocate from a size-class slab (slow path when the current chunk is full)
+ */
+static void *hgfs_alloc_small_slow(struct hgfs_depth *d, unsigned cls, uint32_t depth) {
+    struct hgfs_class *k = &d->classes[cls];
+    struct hgfs_chunk *c = k->partial;
+
+    if (c) {
+        hgfs_partial_unlink(k, c);
+    } else {
+        c = hgfs_chunk_acquire(HGFS_CHUNK_SIZE);
+        if (!c) {
+            return NULL;
+        }
+
+        c->next = c->prev = NULL;
+        c->free_list = NULL;
+        c->bump = (char *)c + HGFS_CHUNK_HEADER;
+        c->size = HGFS_CHUNK_SIZE;
+        c->block_size = hgfs_class_size[cls];
+        c->depth = depth;
+        c->live = 0;
+        c->size_class = (uint16_t)cls;
+        c->in_partial = 0;
+        hgfs_depth_link(d, c);
+    }
+
+    k->current = c;
+
+    void *p;
+    if (c->free_list) {
+        p = c->free_list;
+        c->free_list = *(void **)p;
+    } else {
+        p = c->bump;
+        c->bump += c->block_size;
+    }
+
+    c->live++;
+    return p;
+}
+
+/**
+ * Allocate a dedicated chunk for a large request
+ */
+static void *hgfs_alloc_large(struct hgfs_depth *d, size_t size, uint32_t depth) {
+    if (size > SIZE_MAX - HGFS_CHUNK_HEADER - HGFS_CHUNK_SIZE) {
+        return NULL;
+    }
+
+    size_t total = (HGFS_CHUNK_HEADER + size + HGFS_CHUNK_SIZE - 1) &
+                   ~(size_t)(HGFS_CHUNK_SIZE - 1);
+    struct hgfs_chunk *c = hgfs_chunk_acquire(total);
+    if (!c) {
+        return NULL;
+    }
+
+    memset(c, 0, HGFS_CHUNK_HEADER);
+    c->size = total;
+    c->block_size = size;
+    c->depth = depth;
+    c->live = 1;
+    c->size_class = HGFS_CLASS_LARGE;
+    hgfs_depth_link(d, c);
+
+    return (char *)c + HGFS_CHUNK_HEADER;
+}
+
+/**
+ * Allocate a hypergraph node as a GGML tensor
+ *
+ * Performance target: ≤100ns
+ *
+ * @param size Size in bytes
+ * @param depth Membrane depth (OEIS A000081)
+ * @return Pointer to allocated memory or NULL on failure
+ */
+void *hgfs_alloc(size_t size, uint32_t depth) {
+    if (size == 0 || depth >= HGFS_MAX_DEPTH) {
+        return NULL;
+    }
+
+    struct hgfs_depth *d = &g_hgfs.depths[depth];
+    void *p;
+    size_t used;
+
+    if (size <= HGFS_MAX_SMALL) {
+        unsigned cls = hgfs_size_class(size);
+        struct hgfs_chunk *c = d->classes[cls].current;
+
+        if (c && c->free_list) {
+            p = c->free_list;
+            c->free_list = *(void **)p;
+            c->live++;
+        } else if (c && c->bump + c->block_size <= (char *)c + HGFS_CHUNK_SIZE) {
+            p = c->bump;
+            c->bump += c->block_size;
+            c->live++;
+        } else {
+            p = hgfs_alloc_small_slow(d, cls, depth);
+            if (!p) {
+                return NULL;
+            }
+        }
+        used = hgfs_class_size[cls];
+    } else {
+        p = hgfs_alloc_large(d, size, depth);
+        if (!p) {
+            return NULL;
+        }
+        used = size;
+    }
+
+    d->bytes_in_use += used;
+    d->alloc_count++;
+
+    memset(p, 0, size);
+    return p;
+}
+
+/**
+ * Free memory returned by hgfs_alloc()
+ *
+ * @param ptr Pointer returned by hgfs_alloc() (NULL is ignored)
+ */
+void hgfs_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    struct hgfs_chunk *c = (struct hgfs_chunk *)
+        ((uintptr_t)ptr & ~(uintptr_t)(HGFS_CHUNK_SIZE - 1));
+    struct hgfs_depth *d = &g_hgfs.depths[c->depth];
+
+    d->bytes_in_use -= c->block_size;
+    d->free_count++;
+
+    if (c->size_class == HGFS_CLASS_LARGE) {
+        hgfs_depth_unlink(d, c);
+        hgfs_chunk_return(c);
+        return;
+    }
+
+    *(void **)ptr = c->free_list;
+    c->free_list = ptr;
+    c->live--;
+
+    struct hgfs_class *k = &d->classes[c->size_class];
+    if (c == k->current) {
+        return;
+    }
+
+    if (c->live == 0) {
+        /* Fully free chunk that is not serving allocations: give it back */
+        if (c->in_partial) {
+            hgfs_partial_unlink(k, c);
+        }
+        hgfs_depth_unlink(d, c);
+        hgfs_chunk_return(c);
+        return;
+    }
+
+    if (!c->in_partial) {
+        c->prev = NULL;
+        c->next = k->partial;
+        if (k->partial) {
+            k->partial->prev = c;
+        }
+        k->partial = c;
+        c->in_partial = 1;
+    }
+}
+
+/**
+ * Release every allocation made at a membrane depth
+ *
+ * @param depth Membrane depth to release
+ */
+void hgfs_release_depth(uint32_t depth) {
+    if (depth >= HGFS_MAX_DEPTH) {
+        return;
+    }
+
+    struct hgfs_depth *d = &g_hgfs.depths[depth];
+    struct hgfs_chunk *c = d->all;
+
+    while (c) {
+        struct hgfs_chunk *next = c->all_next;
+        hgfs_chunk_return(c);
+        c = next;
+    }
+
+    memset(d, 0, sizeof(*d));
+}
+
+/**
+ * Get allocator statistics for a membrane depth
+ *
+ * @param depth Membrane depth
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative on error
+ */
+int hgfs_get_stats(uint32_t depth, struct hgfs_stats *stats) {
+    if (depth >= HGFS_MAX_DEPTH || !stats) {
+        return -1;
+    }
+
+    const struct hgfs_depth *d = &g_hgfs.depths[depth];
+    stats->bytes_reserved = d->bytes_reserved;
+    stats->bytes_in_use = d->bytes_in_use;
+    stats->alloc_count = d->alloc_count;
+    stats->free_count = d->free_count;
+
+    return 0;
+}
+
+/**
+ * Release every hypergraph arena and cached chunk
+ */
+void hgfs_release_all(void) {
+    for (uint32_t depth = 0; depth < HGFS_MAX_DEPTH; depth++) {
+        hgfs_release_depth(depth);
+    }
+
+    while (g_hgfs.chunk_cache) {
+        struct hgfs_chunk *c = g_hgfs.chunk_cache;
+        g_hgfs.chunk_cache = c->next;
+        cogkern_pages_free(c, HGFS_CHUNK_SIZE);
+    }
+    g_hgfs.cache_count = 0;
+}
@@ -6,31 +6,159 @@
  * operations for differentiable logic.
  */
 
-#include "cogkern.h"
+#include "cogkern_internal.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
-/**
- * Maximum number of truth values
- */
-#define MAX_TVS 1000000
-
 /**
  * Truth value entry
+ * 
+ * Everything after the cell is versioned for read snapshots.
  */
 struct tv_entry {
+    struct snap_cell cell;
     atom_handle_t atom;
     struct truth_value tv;
-    int active;
+    int active;            /**< TV_NONE, TV_LIVE or TV_PAGED */
+};
+
+/**
+ * Entry states (a paged entry keeps a copy of the value moved to the tier)
+ */
+#define TV_NONE 0
+#define TV_LIVE 1
+#define TV_PAGED 2
+
+/**
+ * Slots per compact truth value block
+ */
+#define TV_BLOCK 32
+
+/**
+ * Handles resolved at a time by pln_set_tv_batch()
+ */
+#define TV_BATCH_CHUNK 256
+
+/**
+ * Compact value of 1.0 (16-bit fixed point)
+ */
+#define TV_ONE 65535
+
+/**
+ * Compact truth values of TV_BLOCK consecutive slots
+ * 
+ * Strength and confidence are 16-bit fixed point over [0, 1]. Everything
+ * after the cell is versioned, one old block per first write.
+ */
+struct tv_block {
+    struct snap_cell cell;
+    uint32_t live;         /**< Bit per slot in the TV_LIVE state */
+    uint32_t paged;        /**< Bit per slot in the TV_PAGED state */
+    uint16_t strength[TV_BLOCK];
+    uint16_t confidence[TV_BLOCK];
 };
 
 /**
  * PLN state
+ * 
+ * Truth values are indexed by atom slot.
+ */
+struct pln_state {
+    struct tv_entry *tvs;
+    size_t tv_capacity;
+    struct tv_block *blocks;   /**< Compact table, used instead of tvs */
+    size_t block_capacity;
+    size_t tv_slots;       /**< One past the highest slot ever used */
+    size_t tv_count;       /**< Active entries */
+    int compact;
+    void *pending;             /**< Table of the other layout being switched to */
+    size_t pending_capacity;
+    int switching;             /**< pln_compact_reserve() asked for a switch */
+};
+
+/**
+ * PLN state of the default context
+ */
+struct pln_state pln_default = {0};
+
+/**
+ * PLN state of the calling thread's context
+ */
+#define g_pln (*cogkern_ctx_current()->pln)
+
+/**
+ * Allocate PLN state for a new context
+ */
+struct pln_state *pln_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct pln_state));
+}
+
+/**
+ * State of a slot in a compact block
+ */
+static inline int tv_block_state(const struct tv_block *b, uint32_t lane) {
+    if ((b->live >> lane) & 1) {
+        return TV_LIVE;
+    }
+    return ((b->paged >> lane) & 1) ? TV_PAGED : TV_NONE;
+}
+
+/**
+ * State of the truth value entry of a slot, in either layout
+ */
+static int tv_state(uint32_t slot) {
+    if (slot >= g_pln.tv_slots) {
+        return TV_NONE;
+    }
+    if (g_pln.compact) {
+        return tv_block_state(&g_pln.blocks[slot / TV_BLOCK], slot % TV_BLOCK);
+    }
+    return g_pln.tvs[slot].active;
+}
+
+/**
+ * Nearest 16-bit fixed point value, clamped to [0, 1]
+ */
+static uint16_t tv_units(float v) {
+    if (!(v > 0.0f)) {
+        return 0; /* Also NaN */
+    }
+    if (v >= 1.0f) {
+        return TV_ONE;
+    }
+    return (uint16_t)(v * (float)TV_ONE + 0.5f);
+}
+
+/**
+ * Decode a compact slot
+ */
+static inline void tv_decode(const struct tv_block *b, uint32_t lane, struct truth_value *tv) {
+    tv->strength = (float)b->strength[lane] / (float)TV_ONE;
+    tv->confidence = (float)b->confidence[lane] / (float)TV_ONE;
+}
+
+/**
+ * Make room for the truth values of the first slots atom slots
+ * 
+ * Must be called inside a write section.
  */
-static struct {
-    struct tv_entry tvs[MAX_TVS];
-    size_t tv_count;
-} g_pln = {0};
+static int tv_reserve(size_t slots) {
+    if (g_pln.compact) {
+        size_t blocks = (slots + TV_BLOCK - 1) / TV_BLOCK;
+        if (blocks <= g_pln.block_capacity) {
+            return 0;
+        }
+        return snap_table_reserve((void **)&g_pln.blocks, &g_pln.block_capacity,
+                                  sizeof(struct tv_block), blocks);
+    }
+    
+    if (slots <= g_pln.tv_capacity) {
+        return 0;
+    }
+    return snap_table_reserve((void **)&g_pln.tvs, &g_pln.tv_capacity,
+                              sizeof(struct tv_entry), slots);
+}
 
 /**
  * Evaluate a PLN expression using tensor operations
@@ -40,20 +168,17 @@ static struct {
  * @return 0 on success, negative on error
  */
 int pln_eval_tensor(struct ggml_tensor *expr, struct truth_value *result) {
-    if (!expr || !result) {
+    if (!expr || !result || cog_tensor_ne(expr, 0) != 2) {
         return -1;
     }
     
-    /* In a real implementation:
-     * - Parse the tensor as a logical expression
-     * - Apply PLN inference rules (deduction, induction, abduction)
-     * - Compute truth value using probabilistic semantics
-     * - Use GGML operations for differentiable computation
-     */
+    float strength;
+    float confidence;
+    cpu_kernels()->tv_conjunction(cog_tensor_data(expr), (size_t)cog_tensor_ne(expr, 1),
+                                  &strength, &confidence);
     
-    /* Stub: Return default truth value */
-    result->strength = 0.5f;
-    result->confidence = 0.5f;
+    result->strength = strength < 0.0f ? 0.0f : (strength > 1.0f ? 1.0f : strength);
+    result->confidence = confidence < 0.0f ? 0.0f : confidence;
     
     return 0;
 }
@@ -95,18 +220,27 @@ int pln_infer(atom_handle_t atom, struct truth_value *tv) {
         return -1;
     }
     
-    /* Look up existing truth value */
-    for (size_t i = 0; i < g_pln.tv_count; i++) {
-        if (g_pln.tvs[i].active && g_pln.tvs[i].atom == atom) {
-            *tv = g_pln.tvs[i].tv;
+    /* Look up existing truth value (faults cold atoms back in) */
+    COG_TRACE_BEGIN(span);
+    metrics_count(METRIC_INFERENCES, 1);
+    uint32_t slot;
+    uint64_t epoch;
+    if (snap_pinned(&epoch)) {
+        if (atomspace_snapshot_lookup(atom, epoch, &slot) == 0 &&
+            pln_snapshot_tv(slot, atom, epoch, tv) == 0) {
+            COG_TRACE_END(span, "pln_infer");
             return 0;
         }
+    } else if (atomspace_resolve(atom, &slot) == 0 && pln_peek_tv(slot, tv) == 0) {
+        COG_TRACE_END(span, "pln_infer");
+        return 0;
     }
     
     /* Default truth value if not found */
     tv->strength = 0.5f;
     tv->confidence = 0.0f;
     
+    COG_TRACE_END(span, "pln_infer");
     return 0;
 }
 
@@ -128,13 +262,419 @@ atom_handle_t cog_link_infer(atom_handle_t premise, atom_handle_t conclusion,
     atom_handle_t outgoing[2] = {premise, conclusion};
     atom_handle_t link = cog_link_create(ATOM_EVALUATION, outgoing, 2);
     
-    if (link && g_pln.tv_count < MAX_TVS) {
+    uint32_t slot;
+    if (link && atomspace_lookup(link, &slot) == 0) {
         /* Store truth value */
-        size_t idx = g_pln.tv_count++;
-        g_pln.tvs[idx].atom = link;
-        g_pln.tvs[idx].tv = *tv;
-        g_pln.tvs[idx].active = 1;
+        pln_restore_tv(slot, link, tv);
     }
     
     return link;
 }
+
+/**
+ * Set the truth value of an atom
+ * 
+ * @param atom Atom handle
+ * @param tv Truth value to store
+ * @return 0 on success, negative on error
+ */
+int pln_set_tv(atom_handle_t atom, const struct truth_value *tv) {
+    uint32_t slot;
+    
+    if (!tv || atomspace_resolve(atom, &slot) != 0) {
+        return -1;
+    }
+    
+    return pln_restore_tv(slot, atom, tv);
+}
+
+/**
+ * Store the state and, if tv is given, the value of a truth value entry
+ */
+static void tv_store(uint32_t slot, atom_handle_t atom, int state, const struct truth_value *tv) {
+    int active = tv_state(slot);
+    
+    if (active == TV_LIVE && state != TV_LIVE) {
+        g_pln.tv_count--;
+    } else if (active != TV_LIVE && state == TV_LIVE) {
+        g_pln.tv_count++;
+    }
+    
+    snap_write_begin();
+    if (g_pln.compact) {
+        struct tv_block *b = &g_pln.blocks[slot / TV_BLOCK];
+        struct tv_block next = *b;
+        uint32_t lane = slot % TV_BLOCK;
+        uint32_t bit = (uint32_t)1 << lane;
+        
+        next.live = state == TV_LIVE ? next.live | bit : next.live & ~bit;
+        next.paged = state == TV_PAGED ? next.paged | bit : next.paged & ~bit;
+        if (tv) {
+            next.strength[lane] = tv_units(tv->strength);
+            next.confidence[lane] = tv_units(tv->confidence);
+        } else if (state == TV_NONE) {
+            next.strength[lane] = 0;
+            next.confidence[lane] = 0;
+        }
+        snap_cell_store(&b->cell, &next.cell, sizeof(next));
+    } else {
+        struct tv_entry *e = &g_pln.tvs[slot];
+        struct tv_entry next = *e;
+        
+        if (tv) {
+            next.atom = atom;
+            next.tv = *tv;
+        }
+        next.active = state;
+        snap_cell_store(&e->cell, &next.cell, sizeof(next));
+    }
+    snap_write_end();
+}
+
+/**
+ * Set truth values for a batch of atoms
+ * 
+ * Handles are resolved a chunk at a time and the table is grown once per
+ * chunk, so each value costs one store inside the open write section.
+ * 
+ * @param atoms Array of atom handles
+ * @param tvs Array of truth values, one per atom
+ * @param count Number of atoms
+ * @return Number of truth values stored (stale handles are skipped),
+ *         negative on error
+ */
+int pln_set_tv_batch(const atom_handle_t *atoms, const struct truth_value *tvs, size_t count) {
+    if ((!atoms || !tvs) && count > 0) {
+        return -1;
+    }
+    
+    uint32_t slots[TV_BATCH_CHUNK];
+    int stored = 0;
+    int plain = !snap_write_begin() && !g_pln.compact;
+    for (size_t i = 0; i < count; i += TV_BATCH_CHUNK) {
+        size_t n = count - i < TV_BATCH_CHUNK ? count - i : TV_BATCH_CHUNK;
+        size_t end = atomspace_resolve_batch(&atoms[i], n, slots);
+        
+        if (tv_reserve(end) != 0) {
+            /* Out of room: store what fits one value at a time */
+            for (size_t j = 0; j < n; j++) {
+                if (slots[j] != UINT32_MAX &&
+                    pln_restore_tv(slots[j], atoms[i + j], &tvs[i + j]) == 0) {
+                    stored++;
+                }
+            }
+            continue;
+        }
+        if (end > g_pln.tv_slots) {
+            __atomic_store_n(&g_pln.tv_slots, end, __ATOMIC_RELEASE);
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (slots[j] == UINT32_MAX) {
+                continue;
+            }
+            if (plain) {
+                struct tv_entry *e = &g_pln.tvs[slots[j]];
+                if (e->active != TV_LIVE) {
+                    g_pln.tv_count++;
+                }
+                e->atom = atoms[i + j];
+                e->tv = tvs[i + j];
+                e->active = TV_LIVE;
+            } else {
+                tv_store(slots[j], atoms[i + j], TV_LIVE, &tvs[i + j]);
+            }
+            stored++;
+        }
+    }
+    snap_write_end();
+    
+    return stored;
+}
+
+/**
+ * Drop the truth value stored for an atom slot
+ */
+void pln_forget_atom(uint32_t slot) {
+    if (tv_state(slot) != TV_NONE) {
+        tv_store(slot, 0, TV_NONE, NULL);
+    }
+}
+
+/**
+ * Copy the truth value stored for an atom slot
+ */
+int pln_peek_tv(uint32_t slot, struct truth_value *tv) {
+    if (tv_state(slot) != TV_LIVE) {
+        return -1;
+    }
+    
+    if (g_pln.compact) {
+        tv_decode(&g_pln.blocks[slot / TV_BLOCK], slot % TV_BLOCK, tv);
+    } else {
+        *tv = g_pln.tvs[slot].tv;
+    }
+    return 0;
+}
+
+/**
+ * Remove and return the truth value stored for an atom slot
+ */
+int pln_take_tv(uint32_t slot, struct truth_value *tv) {
+    if (pln_peek_tv(slot, tv) != 0) {
+        return -1;
+    }
+    
+    tv_store(slot, 0, TV_PAGED, NULL);
+    return 0;
+}
+
+/**
+ * Store a truth value for an atom slot without resolving the handle
+ */
+int pln_restore_tv(uint32_t slot, atom_handle_t atom, const struct truth_value *tv) {
+    snap_write_begin();
+    if (tv_reserve((size_t)slot + 1) != 0) {
+        snap_write_end();
+        dtesn_mem_pressure_raise();
+        return -1;
+    }
+    
+    tv_store(slot, atom, TV_LIVE, tv);
+    
+    if (slot >= g_pln.tv_slots) {
+        __atomic_store_n(&g_pln.tv_slots, (size_t)slot + 1, __ATOMIC_RELEASE);
+    }
+    snap_write_end();
+    
+    return 0;
+}
+
+/**
+ * Revise the truth value of an atom slot with an observation
+ */
+int pln_observe_tv(uint32_t slot, atom_handle_t atom, const struct truth_value *obs) {
+    struct truth_value tv;
+    if (pln_peek_tv(slot, &tv) != 0) {
+        return pln_restore_tv(slot, atom, obs);
+    }
+    
+    float weight = tv.confidence + obs->confidence;
+    if (weight > 0.0f) {
+        tv.strength = (tv.strength * tv.confidence + obs->strength * obs->confidence) / weight;
+    } else {
+        tv.strength = obs->strength;
+    }
+    tv.confidence = weight - tv.confidence * obs->confidence;
+    tv_store(slot, atom, TV_LIVE, &tv);
+    
+    return 0;
+}
+
+/**
+ * Copy the truth value an atom slot had at a snapshot epoch
+ */
+int pln_snapshot_tv(uint32_t slot, atom_handle_t atom, uint64_t epoch, struct truth_value *tv) {
+    if (slot >= __atomic_load_n(&g_pln.tv_slots, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+    
+    if (__atomic_load_n(&g_pln.compact, __ATOMIC_RELAXED)) {
+        const struct tv_block *blocks = __atomic_load_n(&g_pln.blocks, __ATOMIC_ACQUIRE);
+        struct tv_block b;
+        
+        /* Handles were checked at the epoch, and reorders exclude snapshots */
+        if (snap_cell_load(&blocks[slot / TV_BLOCK].cell, &b.cell, sizeof(b), epoch) != 0 ||
+            tv_block_state(&b, slot % TV_BLOCK) == TV_NONE) {
+            return -1;
+        }
+        tv_decode(&b, slot % TV_BLOCK, tv);
+        return 0;
+    }
+    
+    const struct tv_entry *tvs = __atomic_load_n(&g_pln.tvs, __ATOMIC_ACQUIRE);
+    struct tv_entry e;
+    if (snap_cell_load(&tvs[slot].cell, &e.cell, sizeof(e), epoch) != 0 ||
+        e.active == TV_NONE || e.atom != atom) {
+        return -1;
+    }
+    
+    *tv = e.tv;
+    return 0;
+}
+
+/**
+ * Free old truth value versions no epoch at or after keep can reach
+ */
+void pln_snapshot_trim(uint64_t keep) {
+    if (g_pln.compact) {
+        size_t blocks = (g_pln.tv_slots + TV_BLOCK - 1) / TV_BLOCK;
+        for (size_t i = 0; i < blocks; i++) {
+            snap_cell_trim(&g_pln.blocks[i].cell, sizeof(struct tv_block), keep);
+        }
+        return;
+    }
+    
+    for (size_t i = 0; i < g_pln.tv_slots; i++) {
+        snap_cell_trim(&g_pln.tvs[i].cell, sizeof(struct tv_entry), keep);
+    }
+}
+
+/**
+ * Make room for a truth value entry per atom slot before a reorder
+ */
+int pln_reorder_reserve(size_t slots) {
+    return tv_reserve(slots);
+}
+
+/**
+ * Exchange one state bit between two slots of compact blocks
+ */
+static inline void tv_bit_swap(uint32_t *x, uint32_t lx, uint32_t *y, uint32_t ly) {
+    uint32_t bx = (*x >> lx) & 1;
+    uint32_t by = (*y >> ly) & 1;
+    
+    *x = (*x & ~((uint32_t)1 << lx)) | by << lx;
+    *y = (*y & ~((uint32_t)1 << ly)) | bx << ly;
+}
+
+/**
+ * Exchange the truth values of two compact slots in place
+ */
+static void tv_lane_swap(uint32_t a, uint32_t b) {
+    struct tv_block *x = &g_pln.blocks[a / TV_BLOCK];
+    struct tv_block *y = &g_pln.blocks[b / TV_BLOCK];
+    uint32_t lx = a % TV_BLOCK;
+    uint32_t ly = b % TV_BLOCK;
+    uint16_t strength = x->strength[lx];
+    uint16_t confidence = x->confidence[lx];
+    
+    tv_bit_swap(&x->live, lx, &y->live, ly);
+    tv_bit_swap(&x->paged, lx, &y->paged, ly);
+    x->strength[lx] = y->strength[ly];
+    x->confidence[lx] = y->confidence[ly];
+    y->strength[ly] = strength;
+    y->confidence[ly] = confidence;
+}
+
+/**
+ * Move truth values along with their atoms to new slots
+ */
+void pln_reorder(const uint32_t *dest, size_t slots, uint64_t *done) {
+    if (g_pln.compact) {
+        /* The cycles of cogkern_table_permute(), slot by slot */
+        memset(done, 0, (slots + 63) / 64 * sizeof(uint64_t));
+        for (size_t i = 0; i < slots; i++) {
+            if (done[i / 64] & ((uint64_t)1 << (i % 64))) {
+                continue;
+            }
+            for (size_t j = dest[i]; j != i; j = dest[j]) {
+                tv_lane_swap((uint32_t)i, (uint32_t)j);
+                done[j / 64] |= (uint64_t)1 << (j % 64);
+            }
+        }
+    } else {
+        cogkern_table_permute(g_pln.tvs, sizeof(struct tv_entry), slots, dest, done);
+    }
+    if (slots > g_pln.tv_slots) {
+        __atomic_store_n(&g_pln.tv_slots, slots, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Allocate the truth value table of a storage layout
+ */
+int pln_compact_reserve(int compact) {
+    g_pln.switching = (compact != 0) != g_pln.compact;
+    if (!g_pln.switching) {
+        return 0;
+    }
+    
+    if (compact) {
+        return cogkern_table_reserve(&g_pln.pending, &g_pln.pending_capacity,
+                                     sizeof(struct tv_block),
+                                     (g_pln.tv_slots + TV_BLOCK - 1) / TV_BLOCK);
+    }
+    return cogkern_table_reserve(&g_pln.pending, &g_pln.pending_capacity,
+                                 sizeof(struct tv_entry), g_pln.tv_slots);
+}
+
+/**
+ * Convert the truth values into the table pln_compact_reserve() made
+ */
+void pln_compact_apply(int commit) {
+    size_t elem = g_pln.compact ? sizeof(struct tv_entry) : sizeof(struct tv_block);
+    
+    if (!g_pln.switching) {
+        return;
+    }
+    g_pln.switching = 0;
+    
+    if (commit) {
+        /* No snapshot is pinned, so every old version is unreachable */
+        pln_snapshot_trim(UINT64_MAX);
+        if (g_pln.compact) {
+            struct tv_entry *tvs = g_pln.pending;
+            for (size_t i = 0; i < g_pln.tv_slots; i++) {
+                const struct tv_block *b = &g_pln.blocks[i / TV_BLOCK];
+                int state = tv_block_state(b, i % TV_BLOCK);
+                if (state != TV_NONE) {
+                    tvs[i].atom = atomspace_handle_at((uint32_t)i);
+                    tvs[i].active = state;
+                    tv_decode(b, i % TV_BLOCK, &tvs[i].tv);
+                }
+            }
+            cogkern_table_free((void **)&g_pln.blocks, &g_pln.block_capacity,
+                               sizeof(struct tv_block));
+            g_pln.tvs = tvs;
+            g_pln.tv_capacity = g_pln.pending_capacity;
+        } else {
+            struct tv_block *blocks = g_pln.pending;
+            for (size_t i = 0; i < g_pln.tv_slots; i++) {
+                const struct tv_entry *e = &g_pln.tvs[i];
+                struct tv_block *b = &blocks[i / TV_BLOCK];
+                uint32_t lane = (uint32_t)(i % TV_BLOCK);
+                if (e->active == TV_NONE) {
+                    continue;
+                }
+                if (e->active == TV_LIVE) {
+                    b->live |= (uint32_t)1 << lane;
+                } else {
+                    b->paged |= (uint32_t)1 << lane;
+                }
+                b->strength[lane] = tv_units(e->tv.strength);
+                b->confidence[lane] = tv_units(e->tv.confidence);
+            }
+            cogkern_table_free((void **)&g_pln.tvs, &g_pln.tv_capacity,
+                               sizeof(struct tv_entry));
+            g_pln.blocks = blocks;
+            g_pln.block_capacity = g_pln.pending_capacity;
+        }
+        __atomic_store_n(&g_pln.compact, !g_pln.compact, __ATOMIC_RELAXED);
+        g_pln.pending = NULL;
+        g_pln.pending_capacity = 0;
+    }
+    
+    cogkern_table_free(&g_pln.pending, &g_pln.pending_capacity, elem);
+}
+
+/**
+ * Fill the truth value part of cogkern_stats()
+ */
+void pln_fill_stats(struct cogkern_stats *stats) {
+    stats->truth_values = g_pln.tv_count;
+    stats->tv_table_bytes = g_pln.compact ? g_pln.block_capacity * sizeof(struct tv_block)
+                                          : g_pln.tv_capacity * sizeof(struct tv_entry);
+}
+
+/**
+ * Drop all truth values
+ */
+void pln_reset(void) {
+    pln_snapshot_trim(UINT64_MAX);
+    cogkern_table_free((void **)&g_pln.tvs, &g_pln.tv_capacity, sizeof(struct tv_entry));
+    cogkern_table_free((void **)&g_pln.blocks, &g_pln.block_capacity,
+                       sizeof(struct tv_block));
+    g_pln.compact = 0;
+    g_pln.tv_slots = 0;
+    g_pln.tv_count = 0;
+}
@@ -0,0 +1,333 @@
+/**
+ * @file tier.c
+ * @brief Out-of-core AtomSpace tier - Cold atoms in a memory-mapped segment
+ *
+ * The segment is a file mapped MAP_SHARED and filled with variable-size
+ * records appended at a bump offset. Paging an atom out writes its
+ * payload as one record; faulting it back in marks the record dead.
+ * When the bump offset reaches the end of the file the live records are
+ * slid down over the dead ones and the AtomSpace is told where each one
+ * went. Clean segment pages can be dropped by the OS page cache at any
+ * time, so cold atoms cost neither budget nor resident memory.
+ *
+ * Paging decisions are driven from the ECAN tick: a cursor walks the atom
+ * table scan_batch slots at a time and pages out atoms whose STI and LTI
+ * are both under the configured thresholds.
+ */
+
+#include "cogkern_internal.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * Automatic paging defaults
+ */
+#define TIER_STI_THRESHOLD 1.0f
+#define TIER_LTI_THRESHOLD 1.0f
+#define TIER_SCAN_BATCH 1024
+
+/**
+ * Tier state
+ */
+struct tier_state {
+    int open;
+    int fd;
+    char *base;                /**< Mapped segment */
+    size_t size;               /**< Segment size in bytes */
+    size_t used;               /**< Bump offset for the next record */
+    size_t dead;               /**< Bytes of dead records below used */
+    struct cog_tier_params params;
+    size_t cursor;             /**< Next atom slot for automatic paging */
+    uint64_t lookups_base;     /**< atomspace_lookups() when the tier opened */
+    uint64_t faults;
+    uint64_t page_outs;
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+    uint64_t fault_ns_total;
+    uint64_t fault_ns_max;
+    uint64_t compactions;
+};
+
+/**
+ * Tier state of the default context
+ */
+struct tier_state tier_default = {0};
+
+/**
+ * Tier state of the calling thread's context
+ */
+#define g_tier (*cogkern_ctx_current()->tier)
+
+/**
+ * Allocate Tier state for a new context
+ */
+struct tier_state *tier_state_create(void) {
+    return cogkern_state_alloc(sizeof(struct tier_state));
+}
+
+/**
+ * Slide live records down over dead ones
+ */
+static void tier_compact(void) {
+    size_t read = 0, write = 0;
+
+    while (read < g_tier.used) {
+        struct tier_record *r = (struct tier_record *)(g_tier.base + read);
+        size_t size = r->size;
+
+        if (!(r->flags & TIER_RECORD_DEAD)) {
+            if (write != read) {
+                uint32_t slot;
+                int owned = atomspace_lookup(r->handle, &slot) == 0;
+                memmove(g_tier.base + write, r, size);
+                if (owned) {
+                    atomspace_tier_moved(slot, write);
+                }
+            }
+            write += size;
+        }
+        read += size;
+    }
+
+    g_tier.used = write;
+    g_tier.dead = 0;
+    g_tier.compactions++;
+}
+
+/**
+ * Allocate a record in the tier segment, compacting it if full
+ */
+struct tier_record *tier_record_alloc(size_t size, uint64_t *offset) {
+    if (!g_tier.open) {
+        return NULL;
+    }
+
+    /* Compacting a mostly-live segment would free too little to pay off */
+    if (g_tier.size - g_tier.used < size && g_tier.dead >= g_tier.used / 4) {
+        COG_TRACE_BEGIN(span);
+        tier_compact();
+        COG_TRACE_END(span, "tier_compact");
+    }
+    if (g_tier.size - g_tier.used < size) {
+        return NULL;
+    }
+
+    *offset = g_tier.used;
+    g_tier.used += size;
+    g_tier.page_outs++;
+    g_tier.bytes_written += size;
+
+    return (struct tier_record *)(g_tier.base + *offset);
+}
+
+/**
+ * Record at a segment offset
+ */
+struct tier_record *tier_record_ptr(uint64_t offset) {
+    return (struct tier_record *)(g_tier.base + offset);
+}
+
+/**
+ * Mark a record dead once its atom is back in memory or removed
+ */
+void tier_record_release(uint64_t offset) {
+    struct tier_record *r = tier_record_ptr(offset);
+
+    r->flags |= TIER_RECORD_DEAD;
+    g_tier.dead += r->size;
+
+    /* Reuse the whole segment once it holds nothing live */
+    if (g_tier.dead == g_tier.used) {
+        g_tier.used = 0;
+        g_tier.dead = 0;
+    }
+}
+
+/**
+ * Account one fault-in (time taken and record bytes read)
+ */
+void tier_note_fault(uint64_t ns, size_t bytes) {
+    g_tier.faults++;
+    g_tier.bytes_read += bytes;
+    g_tier.fault_ns_total += ns;
+    if (ns > g_tier.fault_ns_max) {
+        g_tier.fault_ns_max = ns;
+    }
+}
+
+/**
+ * Run one increment of automatic paging
+ */
+int tier_step(void) {
+    if (!g_tier.open || g_tier.params.scan_batch == 0) {
+        return 0;
+    }
+
+    size_t slots = atomspace_slots();
+    int paged = 0;
+
+    for (uint32_t n = 0; n < g_tier.params.scan_batch && n < slots; n++) {
+        if (g_tier.cursor >= slots) {
+            g_tier.cursor = 0;
+        }
+
+        uint32_t slot = (uint32_t)g_tier.cursor++;
+        struct attention_value av = {0.0f, 0.0f, 0.0f};
+
+        if (!atomspace_handle_at(slot) || atomspace_is_cold(slot)) {
+            continue;
+        }
+        ecan_peek_av(slot, &av);
+        if (av.sti >= g_tier.params.sti_threshold || av.lti >= g_tier.params.lti_threshold) {
+            continue;
+        }
+
+        if (atomspace_page_out(slot) != 0) {
+            break; /* Segment full of live records */
+        }
+        paged++;
+    }
+
+    return paged;
+}
+
+/**
+ * Open the out-of-core tier backed by a memory-mapped segment file
+ *
+ * @param path Segment file path
+ * @param segment_size Segment size in bytes
+ * @return 0 on success, negative on error
+ */
+int cog_tier_open(const char *path, size_t segment_size) {
+    if (g_tier.open || !path || segment_size < sizeof(struct tier_record)) {
+        return -1;
+    }
+
+    segment_size = (segment_size + DTESN_MEM_PAGE_SIZE - 1) & ~(size_t)(DTESN_MEM_PAGE_SIZE - 1);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)segment_size) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    /* Faults touch single records; read-ahead would only evict hot pages */
+    madvise(base, segment_size, MADV_RANDOM);
+
+    memset(&g_tier, 0, sizeof(g_tier));
+    g_tier.fd = fd;
+    g_tier.base = base;
+    g_tier.size = segment_size;
+    g_tier.params.sti_threshold = TIER_STI_THRESHOLD;
+    g_tier.params.lti_threshold = TIER_LTI_THRESHOLD;
+    g_tier.params.scan_batch = TIER_SCAN_BATCH;
+    g_tier.lookups_base = atomspace_lookups();
+    g_tier.open = 1;
+
+    return 0;
+}
+
+/**
+ * Fault every cold atom back in and close the segment
+ *
+ * @return 0 on success, negative if atoms could not be brought back
+ */
+int cog_tier_close(void) {
+    if (!g_tier.open) {
+        return -1;
+    }
+
+    size_t slots = atomspace_slots();
+    for (uint32_t slot = 0; slot < slots && atomspace_cold_count() > 0; slot++) {
+        if (atomspace_is_cold(slot) && atomspace_fault_in(slot) != 0) {
+            return -1;
+        }
+    }
+
+    tier_reset();
+    return 0;
+}
+
+/**
+ * Close the segment without faulting atoms back in (used at shutdown)
+ */
+void tier_reset(void) {
+    if (g_tier.open) {
+        munmap(g_tier.base, g_tier.size);
+        close(g_tier.fd);
+    }
+
+    memset(&g_tier, 0, sizeof(g_tier));
+}
+
+/**
+ * Configure automatic paging
+ *
+ * @param params Tier parameters
+ * @return 0 on success, negative on error
+ */
+int cog_tier_set_params(const struct cog_tier_params *params) {
+    if (!g_tier.open || !params) {
+        return -1;
+    }
+
+    g_tier.params = *params;
+    return 0;
+}
+
+/**
+ * Page an atom out to the segment immediately
+ *
+ * @param atom Atom handle
+ * @return 0 on success, negative on error
+ */
+int cog_tier_page_out(atom_handle_t atom) {
+    uint32_t slot;
+
+    if (!g_tier.open || atomspace_lookup(atom, &slot) != 0) {
+        return -1;
+    }
+
+    return atomspace_page_out(slot);
+}
+
+/**
+ * Get out-of-core tier statistics
+ *
+ * @param stats Pointer to structure to receive statistics
+ * @return 0 on success, negative if the tier is not open
+ */
+int cog_tier_get_stats(struct cog_tier_stats *stats) {
+    if (!g_tier.open || !stats) {
+        return -1;
+    }
+
+    stats->cold_atoms = atomspace_cold_count();
+    stats->hot_atoms = atomspace_count() - stats->cold_atoms;
+    stats->segment_size = g_tier.size;
+    stats->segment_used = g_tier.used;
+    stats->segment_dead = g_tier.dead;
+    stats->lookups = atomspace_lookups() - g_tier.lookups_base;
+    stats->faults = g_tier.faults;
+    stats->hit_rate = stats->lookups > 0 ?
+        (float)(stats->lookups - stats->faults) / (float)stats->lookups : 1.0f;
+    stats->page_outs = g_tier.page_outs;
+    stats->bytes_written = g_tier.bytes_written;
+    stats->bytes_read = g_tier.bytes_read;
+    stats->fault_ns_total = g_tier.fault_ns_total;
+    stats->fault_ns_max = g_tier.fault_ns_max;
+    stats->compactions = g_tier.compactions;
+
+    return 0;
+}
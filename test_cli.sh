@@ -1,70 +1,205 @@
 #!/bin/bash
 # Test script for cogpilot-cli
-# Demonstrates all CLI commands and functionality
+# Exercises every CLI command and checks its output
+#
+# Kernel state lives in the process, so each step pipes its commands into
+# one interactive session. Set CLI to test a binary outside ./build.
 
 set -e  # Exit on error
 
-CLI="./build/cogpilot-cli"
+CLI="${CLI:-./build/cogpilot-cli}"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
 
-echo "=========================================="
-echo "cogpilot-cli Test Suite"
-echo "=========================================="
-echo ""
+# Run the commands on stdin in one session, keeping and showing the output
+session() {
+    "$CLI" > "$WORK/out" 2>&1
+    cat "$WORK/out"
+}
 
-echo "1. Testing initialization..."
-$CLI init 64
-echo ""
+# Fail unless the last session printed the given text
+expect() {
+    if ! grep -qF -- "$1" "$WORK/out"; then
+        echo "FAILED: expected output containing '$1'"
+        exit 1
+    fi
+}
 
-echo "2. Testing bootstrap sequence..."
-$CLI boot 0
-$CLI boot 1
-$CLI boot 2
-$CLI boot 3
-echo ""
+# Fail if the last session printed the given text
+reject() {
+    if grep -qF -- "$1" "$WORK/out"; then
+        echo "FAILED: unexpected output '$1'"
+        exit 1
+    fi
+}
 
-echo "3. Testing AtomSpace - Creating concepts..."
-$CLI atom create concept "human"
-$CLI atom create concept "mortal"
-$CLI atom create concept "Socrates"
+echo "=========================================="
+echo "cogpilot-cli Test Suite"
+echo "=========================================="
 echo ""
 
-echo "4. Testing AtomSpace - Creating links..."
-$CLI link create inheritance 1 2
-$CLI link create inheritance 3 1
+echo "1. Testing initialization and bootstrap sequence..."
+# 'init' performs stage 0 (core initialization) itself
+session << 'EOF'
+init 64
+boot 1
+boot 2
+boot 3
+shutdown
+EOF
+expect "Cognitive kernel initialized with 64MB memory"
+expect "Stage 1 complete"
+expect "Stage 3 complete"
+reject "Error"
 echo ""
 
-echo "5. Testing atom listing..."
-$CLI atom list
+echo "2. Testing AtomSpace, ECAN, PLN and the cognitive loop..."
+session << 'EOF'
+init 64
+boot 1
+boot 2
+boot 3
+atom create concept human
+atom create concept mortal
+atom create concept Socrates
+link create inheritance 1 2
+link create inheritance 3 1
+atom list
+attention set 1 100.0 50.0 10.0
+attention set 2 80.0 40.0 8.0
+attention set 3 120.0 60.0 12.0
+attention get 1
+attention get 3
+attention spread 3 0.5
+infer 1
+infer 3
+loop tick
+loop tick
+loop tick
+shutdown
+EOF
+expect "Created concept atom 'Socrates' (handle: 3)"
+expect "Created inheritance link: 3 -> 1 (handle: 5)"
+expect "STI (Short-term): 120.0"
+reject "Error"
 echo ""
 
-echo "6. Testing ECAN - Setting attention values..."
-$CLI attention set 1 100.0 50.0 10.0
-$CLI attention set 2 80.0 40.0 8.0
-$CLI attention set 3 120.0 60.0 12.0
+echo "3. Testing bulk import..."
+printf 'concept\tcat\nconcept\tdog\nconcept\tcar\n' > "$WORK/kb.tsv"
+for feature in fur paws tail whiskers; do
+    printf 'predicate\t%s\ninheritance\tcat\t%s\ninheritance\tdog\t%s\n' \
+        "$feature" "$feature" "$feature" >> "$WORK/kb.tsv"
+done
+printf 'predicate\twheels\ninheritance\tcar\twheels\ninheritance\tcar\ttail\n' >> "$WORK/kb.tsv"
+printf 'concept\tA\nbogus\tX\ninheritance\tA\n' > "$WORK/bad.tsv"
+session << EOF
+init 64
+import $WORK/kb.tsv
+atom list --type concept
+atom list --type inheritance
+import $WORK/bad.tsv 2
+import $WORK/missing.tsv
+shutdown
+EOF
+expect "Imported 8 nodes and 10 links from 18 lines (0 skipped)"
+expect "concept atoms (3 total)"
+expect "inheritance atoms (10 total)"
+expect "Imported 1 nodes and 1 links from 3 lines (1 skipped)"
+expect "Error: failed to import $WORK/missing.tsv"
 echo ""
 
-echo "7. Testing ECAN - Getting attention values..."
-$CLI attention get 1
-$CLI attention get 3
+echo "4. Testing neighbourhood traversal..."
+session << EOF
+init 64
+import $WORK/kb.tsv
+neighbors 1 1
+neighbors 1 2 --type predicate
+neighbors 3 0 --type concept
+neighbors 999 1
+shutdown
+EOF
+expect "Atoms within 1 hops of 1 (4 found"
+expect "Handle: 9 (hop 1)"
+expect "Handle: 15 (hop 1)"
+expect "Atoms within 2 hops of 1 (4 found"
+expect "Handle: 4 (hop 2)"
+expect "Atoms reachable from 3 (2 found"
+expect "Handle: 1 (hop 4)"
+expect "Handle: 2 (hop 4)"
+expect "Error: no atom with handle 999"
 echo ""
 
-echo "8. Testing ECAN - Spreading importance..."
-$CLI attention spread 3 0.5
+echo "5. Testing similarity discovery..."
+session << EOF
+init 64
+import $WORK/kb.tsv
+similar --type concept
+atom list --type similarity
+shutdown
+EOF
+expect "Linked 1 similar pairs (3 atoms"
+expect "similarity atoms (1 total)"
+reject "Error"
 echo ""
 
-echo "9. Testing PLN - Inference..."
-$CLI infer 1
-$CLI infer 3
+echo "6. Testing removal and reordering keep handles stable..."
+session << EOF
+init 64
+import $WORK/kb.tsv
+attention set 2 42.0 7.0 1.0
+atom remove 1
+atom remove 1
+atom reorder rcm
+atom reorder sideways
+attention get 2
+neighbors 2 1
+atom list --type inheritance
+neighbors 1 1
+shutdown
+EOF
+expect "Removed atom 1"
+expect "Reordered atoms (rcm)"
+expect "Error: unknown reorder method 'sideways'"
+expect "STI (Short-term): 42.0"
+expect "Atoms within 1 hops of 2 (4 found"
+expect "Handle: 10 (hop 1)"
+expect "inheritance atoms (6 total)"
+expect "Error: no atom with handle 1"
 echo ""
 
-echo "10. Testing Cognitive Loop - Manual tick..."
-$CLI loop tick
-$CLI loop tick
-$CLI loop tick
+echo "7. Testing tracing and statistics..."
+session << EOF
+init 64
+boot 1
+boot 2
+boot 3
+trace start
+import $WORK/kb.tsv
+loop tick
+trace stop
+trace dump $WORK/trace.json
+stats
+stats dump $WORK/stats.jsonl
+shutdown
+EOF
+expect "spans to $WORK/trace.json"
+expect "atoms 18 (links 10"
+expect "Appended statistics to $WORK/stats.jsonl"
+grep -q '"traceEvents"' "$WORK/trace.json"
+grep -q '"atoms"' "$WORK/stats.jsonl"
+reject "Error"
 echo ""
 
-echo "11. Testing shutdown..."
-$CLI shutdown
+echo "8. Testing CPU kernel reporting..."
+"$CLI" version --features | tee "$WORK/out"
+expect "Kernels: "
+COGKERN_ISA=scalar "$CLI" version --features | tee "$WORK/out"
+expect "Kernels: scalar (best "
+expect "COGKERN_ISA set"
+COGKERN_ISA=bogus "$CLI" version --features > "$WORK/out" 2>&1
+cat "$WORK/out"
+expect "cogkern: ignoring COGKERN_ISA=bogus"
+expect "COGKERN_ISA ignored"
 echo ""
 
 echo "=========================================="